@@ -0,0 +1,324 @@
+"""Analytic design-space explorer for accelerator builds.
+
+Estimates, for every combination of the build_hw.tcl parameters given on
+the command line, the cycles per frame, DMA bandwidth, DSP/FF/BRAM usage
+and speedup over the software model, without running Vivado. Builds with
+the same layer (INPUT_SIZE, kernel, stride, pool, filters, layers) are
+compared on frame time, utilization of the scarcest resource (DSP,
+flip-flop or block RAM) and data width, and only the Pareto-optimal ones
+are kept, so they alone need synthesizing:
+--emit writes them as build_hw.tcl arguments for scripts/build.sh.
+
+The estimates follow the RTL structure (one beat per clock, one FMA per
+kernel tap, filter and lane, flip-flop or block RAM line buffers) with
+platform overheads and software costs calibrated against the tables in
+README.md. They rank configurations; the chosen builds' reports give the
+real figures.
+"""
+
+import argparse
+import itertools
+import math
+import sys
+
+# Fractional bits per data width (sw/common/fixed.h)
+FRACTIONAL_BITS = {32: 12, 16: 12, 8: 4}
+
+# Arty Z7-20 (XC7Z020) resources and clocking
+DEVICE = {'dsp': 220, 'ff': 106400, 'bram': 140}
+CLOCK_HZ = 100e6                  # ACCELERATOR_CLOCK_HZ in sw/hal/config.h
+DDR_MBPS = 1400.0                 # Sustained share of the 16-bit DDR3's 2.1 GB/s peak
+
+# Per-instance platform share (AXI DMA, interconnect, reset) and fixed costs
+PLATFORM_FF = 3000
+PLATFORM_BRAM = 2
+CONTROL_REGISTERS = 15            # Width, height, packet, stages, chaining, counters
+PIPELINE_CYCLES = 8               # Register stages around the MAC chains
+TRANSFER_OVERHEAD_US = 5.0        # Cache maintenance, DMA setup and interrupt per frame
+
+# Software model cost per MAC (README.md, 128x128 row: 33.4 ms for 126*126*9 MACs)
+SOFTWARE_NS_PER_MAC = 234.0
+
+# Block RAM18 aspect ratios (depth, width)
+BRAM18_SHAPES = ((16384, 1), (8192, 2), (4096, 4), (2048, 9), (1024, 18), (512, 36))
+
+
+# ----------------------------------------------------------------------------
+# Configurations
+# ----------------------------------------------------------------------------
+
+class Config:
+    """One build: the build_hw.tcl arguments."""
+
+    FIELDS = ('input_size', 'kernel_size', 'stride', 'pool_size', 'width', 'instances',
+              'bram', 'lanes', 'filters', 'layers')
+
+    def __init__(self, **values):
+        for field in self.FIELDS:
+            setattr(self, field, values[field])
+        self.frac_bits = FRACTIONAL_BITS[self.width]
+
+    def group(self):
+        """Layer the build computes; only builds of one group are compared."""
+        return (self.input_size, self.kernel_size, self.stride, self.pool_size, self.filters, self.layers)
+
+    def tcl_args(self):
+        """Arguments for build_hw.tcl."""
+        return (f"{self.input_size} {self.kernel_size} {self.stride} {self.pool_size} {self.width} "
+                f"{self.frac_bits} {self.instances} {self.bram} {self.lanes} {self.filters} {self.layers}")
+
+
+def valid(config, exact):
+    """Whether the RTL accepts a configuration (and, with exact, pools it without dropping edges)."""
+    conv = conv_size(config.input_size, config.kernel_size, config.stride)
+    if conv < 1 or conv // config.pool_size < 1:
+        return False
+    if config.lanes > 1 and (config.stride != 1 or config.input_size % config.lanes):
+        return False
+    if config.layers > 1 and (config.filters != 1 or config.lanes != 1):
+        return False
+    if config.layers > 1 and conv_size(conv, config.kernel_size, config.stride) < config.pool_size:
+        return False
+    if exact and ((config.input_size - config.kernel_size) % config.stride or conv % config.pool_size):
+        return False
+    return True
+
+
+def conv_size(size, kernel_size, stride):
+    """Valid convolution output side."""
+    return (size - kernel_size) // stride + 1
+
+
+def bits(n):
+    """Bits needed to count to n."""
+    return max(0, math.ceil(math.log2(n))) if n > 1 else 0
+
+
+# ----------------------------------------------------------------------------
+# Estimates
+# ----------------------------------------------------------------------------
+
+def bram18(depth, width):
+    """Block RAM18s for a memory, in the best aspect ratio."""
+    return min(math.ceil(depth / d) * math.ceil(width / w) for d, w in BRAM18_SHAPES)
+
+
+def dsp_per_mac(width, lanes):
+    """DSP48s per product: one up to 18 bits, four at 32, lane pairs sharing one at 8 (fma_dual)."""
+    if 3 * width + 1 <= 25 and lanes % 2 == 0:
+        return 0.5
+    return 1 if width <= 18 else 4
+
+
+def block(size, lanes, config, filters):
+    """DSPs, flip-flops and BRAM18s of one conv/ReLU/pool block on rows of the given width."""
+    k, p, w = config.kernel_size, config.pool_size, config.width
+    depth = math.ceil(size / lanes)
+    conv = conv_size(size, k, config.stride)
+
+    macs = k * k * filters * lanes
+    dsp = macs * dsp_per_mac(w, lanes)
+
+    # Line buffers (K-1 delay lines of one row), windows and MAC pipeline
+    ff = k * (k - 1 + lanes) * w + macs * 2 * w
+    brams = 0
+    if config.bram:
+        brams += (k - 1) * bram18(depth, lanes * w)
+    else:
+        ff += (k - 1) * depth * lanes * w
+
+    # Pooler line buffers at the widened sum width, one per filter
+    ff += filters * (p - 1) * math.ceil(conv / lanes) * lanes * (w + bits(p * p))
+    return dsp, ff, brams
+
+
+def estimate(config, ddr_mbps, software_ns_per_mac):
+    """Estimates for a configuration (per instance resources times instances, frame rates for all)."""
+    size, k, s, p, l = config.input_size, config.kernel_size, config.stride, config.pool_size, config.lanes
+    conv = conv_size(size, k, s)
+    dsp, ff, brams = block(size, l, config, config.filters)
+    registers = k * k * (config.filters + config.layers - 1)
+    out_side = conv // p
+    macs = conv * conv * k * k * config.filters
+
+    if config.layers > 1:
+        # Second block behind the first, sized for unpooled input
+        dsp2, ff2, brams2 = block(conv, 1, config, 1)
+        dsp, ff, brams = dsp + dsp2, ff + ff2, brams + brams2
+        conv2 = conv_size(out_side, k, s)
+        macs += conv2 * conv2 * k * k
+        out_side = conv2 // p
+
+    # Register file with its shadow bank
+    ff += (2 * registers + CONTROL_REGISTERS) * 32
+
+    # One input beat per clock; the output only limits frames it outweighs
+    in_beats = size * size // l
+    out_values = out_side * out_side * config.filters
+    out_beats = math.ceil(out_values / l)
+    cycles = max(in_beats, out_beats) + k * k + PIPELINE_CYCLES
+
+    bytes_in = size * size * config.width // 8
+    bytes_out = out_values * config.width // 8
+    fabric_us = cycles / CLOCK_HZ * 1e6
+    frame_us = fabric_us + TRANSFER_OVERHEAD_US
+    mbps = (bytes_in + bytes_out) / frame_us
+
+    # Instances overlap frames until DDR saturates
+    interval_us = max(frame_us / config.instances, (bytes_in + bytes_out) / ddr_mbps)
+    software_us = macs * software_ns_per_mac / 1000
+
+    n = config.instances
+    return {
+        'cycles': cycles,
+        'mbps': mbps,
+        'dsp': math.ceil(dsp) * n,
+        'ff': (ff + PLATFORM_FF) * n,
+        'bram': math.ceil(brams / 2 + PLATFORM_BRAM) * n,
+        'frame_us': frame_us,
+        'interval_us': interval_us,
+        'fps': 1e6 / interval_us,
+        'speedup': software_us / interval_us,
+    }
+
+
+def fits(result):
+    """Whether a build fits the device."""
+    return all(result[resource] <= DEVICE[resource] for resource in DEVICE)
+
+
+# ----------------------------------------------------------------------------
+# Pareto front
+# ----------------------------------------------------------------------------
+
+def utilization(result):
+    """Share of the device's scarcest resource a build takes."""
+    return max(result[resource] / DEVICE[resource] for resource in DEVICE)
+
+
+def objectives(config, result):
+    """Costs to minimize: frame interval, device utilization and lost precision."""
+    return (result['interval_us'], utilization(result), -config.width)
+
+
+def dominates(a, b):
+    """Whether cost vector a is no worse than b everywhere and better somewhere."""
+    return all(x <= y for x, y in zip(a, b)) and any(x < y for x, y in zip(a, b))
+
+
+def pareto(points):
+    """Indices of the non-dominated (config, result) points.
+
+    Of builds with equal costs (e.g. both limited by DSPs), only the one
+    using least of the device overall is kept.
+    """
+    costs = [objectives(config, result) for config, result in points]
+    best = {}
+    for i, (config, result) in enumerate(points):
+        total = sum(result[resource] / DEVICE[resource] for resource in DEVICE)
+        if costs[i] not in best or total < best[costs[i]][0]:
+            best[costs[i]] = (total, i)
+    return [i for _, i in best.values()
+            if not any(dominates(other, costs[i]) for other in best)]
+
+
+# ----------------------------------------------------------------------------
+# Command line
+# ----------------------------------------------------------------------------
+
+def int_list(text):
+    """Comma-separated integers."""
+    return [int(v) for v in text.split(',')]
+
+
+def explore(args):
+    """All valid configurations with their estimates and Pareto flags, grouped by layer."""
+    points = []
+    for size, k, s, p, w, n, b, f, layers in itertools.product(
+            args.input_sizes, args.kernel_sizes, args.strides, args.pool_sizes, args.widths,
+            args.instances, args.bram, args.filters, args.layers):
+        # Lanes default to one pixel and to a full 32-bit beat (build_hw.tcl's default)
+        lanes = args.lanes or sorted({1, max(1, 32 // w)})
+        for l in lanes:
+            config = Config(input_size=size, kernel_size=k, stride=s, pool_size=p, width=w, instances=n,
+                            bram=b, lanes=l, filters=f, layers=layers)
+            if not valid(config, args.exact):
+                continue
+            result = estimate(config, args.ddr_mbps, args.software_ns_per_mac)
+            if fits(result):
+                points.append((config, result))
+
+    groups = {}
+    for point in points:
+        groups.setdefault(point[0].group(), []).append(point)
+
+    explored = []
+    for group in sorted(groups):
+        members = groups[group]
+        front = set(pareto(members))
+        members = [(config, result, i in front) for i, (config, result) in enumerate(members)]
+        explored.append(sorted(members, key=lambda m: m[1]['interval_us']))
+    return explored
+
+
+def print_table(explored, show_all):
+    """One line per configuration, Pareto-optimal ones marked."""
+    print(f"{'':1} {'M':>5} {'K':>2} {'S':>2} {'P':>2} {'Q':>6} {'N':>2} {'BRAM':>4} {'X':>2} {'F':>2} {'L':>2}"
+          f" {'cycles':>9} {'us/frame':>10} {'fps':>9} {'MB/s':>7} {'DSP':>4} {'FF':>7} {'BRAM36':>6} {'util':>6} {'speedup':>8}")
+    for members in explored:
+        for config, result, optimal in members:
+            if not optimal and not show_all:
+                continue
+            print(f"{'*' if optimal else ' ':1} {config.input_size:5d} {config.kernel_size:2d} {config.stride:2d}"
+                  f" {config.pool_size:2d} {f'{config.width}-{config.frac_bits}':>6} {config.instances:2d}"
+                  f" {config.bram:4d} {config.lanes:2d} {config.filters:2d} {config.layers:2d}"
+                  f" {result['cycles']:9d} {result['interval_us']:10.1f} {result['fps']:9.1f} {result['mbps']:7.1f}"
+                  f" {result['dsp']:4d} {result['ff']:7d} {result['bram']:6d} {100 * utilization(result):5.1f}%"
+                  f" {result['speedup']:7.0f}x")
+
+
+def main():
+    """Explore a configuration space and print or emit the Pareto front."""
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument('--input-sizes', type=int_list, default=[4, 8, 16, 32, 64, 128, 256, 512, 1024])
+    parser.add_argument('--kernel-sizes', type=int_list, default=[3])
+    parser.add_argument('--strides', type=int_list, default=[1])
+    parser.add_argument('--pool-sizes', type=int_list, default=[2])
+    parser.add_argument('--widths', type=int_list, default=[32, 16, 8], help='data widths (8, 16 or 32)')
+    parser.add_argument('--lanes', type=int_list, default=None,
+                        help='PIXELS_PER_BEAT values (default: 1 and a full 32-bit beat)')
+    parser.add_argument('--bram', type=int_list, default=[0, 1], help='LINE_BUFFER_BRAM values')
+    parser.add_argument('--instances', type=int_list, default=[1])
+    parser.add_argument('--filters', type=int_list, default=[1])
+    parser.add_argument('--layers', type=int_list, default=[1])
+    parser.add_argument('--exact', action='store_true', help='only sizes that convolve and pool without dropping edges')
+    parser.add_argument('--ddr-mbps', type=float, default=DDR_MBPS, help='DDR bandwidth shared by all instances')
+    parser.add_argument('--software-ns-per-mac', type=float, default=SOFTWARE_NS_PER_MAC,
+                        help='software model cost (e.g. from the scheduler calibration)')
+    parser.add_argument('--all', action='store_true', help='also print dominated configurations')
+    parser.add_argument('--emit', metavar='FILE', help='write the Pareto front as build_hw.tcl arguments')
+    args = parser.parse_args()
+
+    for w in args.widths:
+        if w not in FRACTIONAL_BITS:
+            parser.error(f"unsupported data width {w}")
+
+    explored = explore(args)
+    if not explored:
+        print("No valid configuration fits the device")
+        return 1
+    print_table(explored, args.all)
+
+    front = [config for members in explored for config, _, optimal in members if optimal]
+    total = sum(len(members) for members in explored)
+    print(f"{len(front)} of {total} fitting configurations are Pareto-optimal")
+    if args.emit:
+        with open(args.emit, 'w') as f:
+            for config in front:
+                f.write(config.tcl_args() + '\n')
+        print(f"Wrote {args.emit} (./scripts/build.sh {args.emit})")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -1,66 +1,76 @@
-"""Fixed-point arithmetic implementation."""
-
-def twos_complement(binary_str, total_bits):
-    """Convert a binary string to its two's complement representation."""
-    inverted = ''.join('1' if bit == '0' else '0' for bit in binary_str)
-    value = int(inverted, 2) + 1
-    return format(value, f'0{total_bits}b')
-
-def float_to_fixed_point(number, int_bits, frac_bits):
-    """Convert a floating-point number to fixed-point binary representation."""
-    is_negative = number < 0
-    abs_number = abs(number)
-
-    # Integer part
-    int_part = int(abs_number)
-    int_binary = format(int_part, f'0{int_bits}b')
-
-    # Fractional part
-    frac_value = abs_number - int_part
-    frac_bits_list = []
-    for _ in range(frac_bits):
-        frac_value *= 2
-        bit = int(frac_value)
-        frac_bits_list.append(str(bit))
-        frac_value -= bit
-    frac_binary = ''.join(frac_bits_list)
-
-    # Combine
-    full_binary = int_binary + frac_binary
-
-    if is_negative:
-        return f"1{twos_complement(full_binary, int_bits + frac_bits)}"
-    else:
-        return f"0{full_binary}"
-    
-def fixed_point_to_float(binary_str, int_bits, frac_bits):
-    """Convert a fixed-point binary string to floating-point representation."""
-    is_negative = binary_str[0] == '1'
-    magnitude_bits = binary_str[1:]
-    
-    # Handle two's complement for negative numbers
-    if is_negative:
-        magnitude_bits = twos_complement(magnitude_bits, int_bits + frac_bits)
-    
-    # Convert to float
-    value = 0.0
-
-    # Process integer bits
-    for i in range(int_bits):
-        value += int(magnitude_bits[i]) * (2 ** (int_bits - 1 - i))
-    
-    # Process fractional bits
-    for i in range(frac_bits):
-        value += int(magnitude_bits[int_bits + i]) * (2 ** -(i + 1))
-    
-    return -value if is_negative else value
+"""Fixed-point arithmetic implementation.
+
+Values are two's complement integers held in NumPy int64 arrays, with the
+data width and fractional bits passed explicitly, so every DATA_WIDTH and
+FRACTIONAL_BITS combination of the RTL (up to 32 bits) is covered. All
+functions accept scalars or arrays.
+"""
+
+import numpy as np
+
+MAX_WIDTH = 32  # Products must fit int64
+
+
+def check_format(width, frac_bits):
+    """Reject formats whose products would not fit int64."""
+    if not 1 < width <= MAX_WIDTH or not 0 <= frac_bits < width:
+        raise ValueError(f"Unsupported fixed-point format {width} bits, {frac_bits} fractional")
+
+
+def value_range(width):
+    """Smallest and largest value of a width."""
+    return -(1 << (width - 1)), (1 << (width - 1)) - 1
+
+
+def wrap(values, width):
+    """Wrap integers to two's complement of the given width, as the RTL truncates."""
+    half = 1 << (width - 1)
+    return ((np.asarray(values, dtype=np.int64) + half) & ((1 << width) - 1)) - half
+
+
+def overflows(values, width):
+    """Mask of values outside the range of a width."""
+    low, high = value_range(width)
+    values = np.asarray(values, dtype=np.int64)
+    return (values < low) | (values > high)
+
+
+def float_to_fixed(values, width, frac_bits):
+    """Convert floats to fixed point, truncating toward zero (float_to_fixed in fixed.c) and wrapping at the width."""
+    check_format(width, frac_bits)
+    scaled = np.trunc(np.asarray(values, dtype=np.float64) * (1 << frac_bits))
+    return wrap(scaled.astype(np.int64), width)
+
+
+def fixed_to_float(values, frac_bits):
+    """Convert fixed-point integers to floats."""
+    return np.asarray(values, dtype=np.float64) / (1 << frac_bits)
+
+
+def multiply(a, b, width, frac_bits):
+    """Product truncated to the format (floored, as the RTL drops the low bits), wrapped."""
+    check_format(width, frac_bits)
+    return wrap((np.asarray(a, dtype=np.int64) * np.asarray(b, dtype=np.int64)) >> frac_bits, width)
+
+
+def fma(a, b, c, width, frac_bits):
+    """a * b + c exactly as fma.vhdl: full product, c aligned to it, truncated to the width."""
+    check_format(width, frac_bits)
+    product = np.asarray(a, dtype=np.int64) * np.asarray(b, dtype=np.int64)
+    return wrap((product >> frac_bits) + np.asarray(c, dtype=np.int64), width)
+
+
+def to_binary(values, width):
+    """Two's complement bit strings (for printing)."""
+    unsigned = np.asarray(values, dtype=np.int64) & ((1 << width) - 1)
+    return np.vectorize(lambda v: format(int(v), f'0{width}b'))(unsigned)
 
 
 if __name__ == "__main__":
-    # Test the fixed-point conversion functions
-    print("Testing twos complement:", twos_complement('0110011110110110', 3 + 12))
-    print("Positive float to fixed point:", float_to_fixed_point(2.356, 3, 12))
-    print("Negative float to fixed point:", float_to_fixed_point(-2.356, 3, 12))
-    print("Fixed point to float:", fixed_point_to_float('0010110111111011',3,12))
-    print("Negative fixed point to float:", fixed_point_to_float('1101101001001110',3,12))
-    print("Round-trip conversion:", fixed_point_to_float(float_to_fixed_point(-2.729, 3, 12), 3, 12))
\ No newline at end of file
+    # Test the fixed-point conversion functions (Q3.12 in 16 bits)
+    print("Positive float to fixed point:", to_binary(float_to_fixed(2.356, 16, 12), 16))
+    print("Negative float to fixed point:", to_binary(float_to_fixed(-2.356, 16, 12), 16))
+    print("Fixed point to float:", fixed_to_float(int('0010110111111011', 2), 12))
+    print("Round-trip conversion:", fixed_to_float(float_to_fixed(-2.729, 16, 12), 12))
+    print("Multiply 1.5 * -2.25:", fixed_to_float(multiply(float_to_fixed(1.5, 16, 12), float_to_fixed(-2.25, 16, 12), 16, 12), 12))
+    print("Wrapped 7.9 * 7.9 in Q3.12:", fixed_to_float(multiply(float_to_fixed(7.9, 16, 12), float_to_fixed(7.9, 16, 12), 16, 12), 12))
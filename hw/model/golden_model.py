@@ -0,0 +1,217 @@
+"""Bit-exact fixed-point golden model of the accelerator datapath.
+
+Integer NumPy implementation of the convolution, ReLU and pooling stages,
+truncating after every MAC as fma.vhdl does, for any data width and number
+of fractional bits. Loops only run over kernel taps, so a 1024x1024 frame
+takes well under a second. The command line generates golden sets (input,
+kernels, the convolver and ReLU stage outputs and the expected output, as
+one decimal value per line) and checks a captured output against one.
+"""
+
+import argparse
+import json
+import os
+import sys
+import time
+
+import numpy as np
+
+from fixed_point_model import check_format, float_to_fixed, overflows, wrap
+
+POOL_MAX, POOL_AVERAGE, POOL_NONE = 0, 1, 2
+POOL_MODES = {'max': POOL_MAX, 'average': POOL_AVERAGE, 'none': POOL_NONE}
+
+
+def convolve(frame, kernel, stride, width, frac_bits):
+    """Valid correlation of one kernel, with the overflow the C model would report.
+
+    Taps accumulate in row-major order; the result wraps at the width as the
+    hardware accumulator does, while the overflow flag marks any product or
+    partial sum the C model (fixed_multiply/fixed_add) rejects.
+    """
+    check_format(width, frac_bits)
+    frame = np.asarray(frame, dtype=np.int64)
+    kernel = np.asarray(kernel, dtype=np.int64)
+    k = kernel.shape[0]
+    rows = (frame.shape[0] - k) // stride + 1
+    cols = (frame.shape[1] - k) // stride + 1
+
+    # Partial sums of wrapped products, exact in int64; wrapping once at the
+    # end equals wrapping after every MAC
+    acc = np.zeros((rows, cols), dtype=np.int64)
+    overflow = False
+    for ki in range(k):
+        for kj in range(k):
+            taps = frame[ki:ki + (rows - 1) * stride + 1:stride, kj:kj + (cols - 1) * stride + 1:stride]
+            product = (taps * kernel[ki, kj]) >> frac_bits
+            acc += wrap(product, width)
+            overflow = overflow or bool(np.any(overflows(product, width)) or np.any(overflows(acc, width)))
+    return wrap(acc, width), overflow
+
+
+def relu(values):
+    """ReLU stage."""
+    return np.maximum(values, 0)
+
+
+def pool(values, mode, pool_size, pool_stride=0):
+    """Pooling stage; windows that would run past the edge are dropped.
+
+    Average pooling floors the exact window sum, as the RTL divides it.
+    """
+    if mode == POOL_NONE:
+        return values
+    stride = pool_stride or pool_size
+    rows = (values.shape[0] - pool_size) // stride + 1
+    cols = (values.shape[1] - pool_size) // stride + 1
+
+    result = None
+    for pi in range(pool_size):
+        for pj in range(pool_size):
+            window = values[pi:pi + (rows - 1) * stride + 1:stride, pj:pj + (cols - 1) * stride + 1:stride]
+            if result is None:
+                result = window.copy()
+            elif mode == POOL_MAX:
+                result = np.maximum(result, window)
+            else:
+                result = result + window
+    if mode == POOL_AVERAGE:
+        result = result // (pool_size * pool_size)
+    return result
+
+
+def layer(frame, kernels, width, frac_bits, stride=1, pool_size=2, pool_mode=POOL_MAX, pool_stride=0, apply_relu=True):
+    """Full layer for one or more kernels, channels interleaved per pixel as the accelerator streams them.
+
+    Returns the output and whether the C model would report overflow.
+    """
+    stages, overflow = layer_stages(frame, kernels, width, frac_bits, stride, pool_size, pool_mode, pool_stride, apply_relu)
+    return stages[-1], overflow
+
+
+def layer_stages(frame, kernels, width, frac_bits, stride=1, pool_size=2, pool_mode=POOL_MAX, pool_stride=0, apply_relu=True):
+    """As layer, returning the convolver, ReLU and pooler outputs (each channel interleaved) for the stage testbenches."""
+    kernels = np.asarray(kernels, dtype=np.int64)
+    if kernels.ndim == 2:
+        kernels = kernels[np.newaxis]
+
+    convolved, activated, pooled = [], [], []
+    overflow = False
+    for kernel in kernels:
+        x, kernel_overflow = convolve(frame, kernel, stride, width, frac_bits)
+        overflow = overflow or kernel_overflow
+        convolved.append(x)
+        if apply_relu:
+            x = relu(x)
+        activated.append(x)
+        pooled.append(pool(x, pool_mode, pool_size, pool_stride))
+
+    stages = []
+    for channels in (convolved, activated, pooled):
+        output = np.stack(channels, axis=-1)
+        stages.append(output.reshape(output.shape[0], -1))
+    return stages, overflow
+
+
+# ----------------------------------------------------------------------------
+# Golden sets
+# ----------------------------------------------------------------------------
+
+def write_values(path, values):
+    """One decimal value per line, row-major (readable by VHDL textio)."""
+    np.savetxt(path, np.asarray(values, dtype=np.int64).ravel(), fmt='%d')
+
+
+def read_values(path):
+    """Values written by write_values."""
+    return np.loadtxt(path, dtype=np.int64, ndmin=1)
+
+
+def generate(args):
+    """Write a random golden set."""
+    rng = np.random.default_rng(args.seed)
+    k = args.kernel_size
+    frame = float_to_fixed(rng.uniform(-args.range, args.range, (args.rows, args.cols)), args.width, args.frac_bits)
+    kernels = float_to_fixed(rng.uniform(-1, 1, (args.filters, k, k)), args.width, args.frac_bits)
+
+    start = time.time()
+    (convolved, activated, output), overflow = layer_stages(frame, kernels, args.width, args.frac_bits, args.stride,
+                                                            args.pool_size, POOL_MODES[args.pool], args.pool_stride,
+                                                            not args.no_relu)
+    elapsed = time.time() - start
+
+    # The stage outputs feed the convolver and pooler testbenches
+    os.makedirs(args.dir, exist_ok=True)
+    write_values(os.path.join(args.dir, 'input.txt'), frame)
+    write_values(os.path.join(args.dir, 'kernel.txt'), kernels)
+    write_values(os.path.join(args.dir, 'convolved.txt'), convolved)
+    write_values(os.path.join(args.dir, 'activated.txt'), activated)
+    write_values(os.path.join(args.dir, 'expected.txt'), output)
+    config = {
+        'rows': args.rows, 'cols': args.cols, 'kernel_size': k, 'filters': args.filters,
+        'stride': args.stride, 'pool_size': args.pool_size, 'pool': args.pool,
+        'pool_stride': args.pool_stride, 'relu': not args.no_relu,
+        'width': args.width, 'frac_bits': args.frac_bits, 'seed': args.seed,
+        'conv_rows': convolved.shape[0], 'conv_cols': convolved.shape[1] // args.filters,
+        'output_rows': output.shape[0], 'output_cols': output.shape[1], 'overflow': overflow,
+    }
+    with open(os.path.join(args.dir, 'config.json'), 'w') as f:
+        json.dump(config, f, indent=1)
+
+    print(f"{args.rows}x{args.cols} -> {output.shape[0]}x{output.shape[1]} in {elapsed:.3f} s"
+          f"{' (overflows, the C model would stop)' if overflow else ''}")
+    return 0
+
+
+def check(args):
+    """Compare a captured output with a golden set."""
+    with open(os.path.join(args.dir, 'config.json')) as f:
+        config = json.load(f)
+    expected = read_values(os.path.join(args.dir, 'expected.txt'))
+    actual = read_values(args.output)
+
+    if actual.shape != expected.shape:
+        print(f"{actual.size} values, expected {expected.size}")
+        return 1
+
+    mismatches = np.flatnonzero(wrap(actual, config['width']) != expected)
+    for i in mismatches[:10]:
+        row, col = divmod(int(i), config['output_cols'])
+        print(f"({row},{col}): {actual[i]} != {expected[i]}")
+    print(f"{len(mismatches)} of {expected.size} values differ")
+    return 1 if len(mismatches) else 0
+
+
+def main():
+    """Generate or check golden sets."""
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    commands = parser.add_subparsers(dest='command', required=True)
+
+    gen = commands.add_parser('generate', help='write a random golden set')
+    gen.add_argument('dir')
+    gen.add_argument('--rows', type=int, default=1024)
+    gen.add_argument('--cols', type=int, default=1024)
+    gen.add_argument('--kernel-size', type=int, default=3)
+    gen.add_argument('--filters', type=int, default=1)
+    gen.add_argument('--stride', type=int, default=1)
+    gen.add_argument('--pool-size', type=int, default=2)
+    gen.add_argument('--pool', choices=POOL_MODES, default='max')
+    gen.add_argument('--pool-stride', type=int, default=0)
+    gen.add_argument('--no-relu', action='store_true')
+    gen.add_argument('--width', type=int, default=32)
+    gen.add_argument('--frac-bits', type=int, default=12)
+    gen.add_argument('--range', type=float, default=4.0, help='input magnitude (weights are within 1)')
+    gen.add_argument('--seed', type=int, default=1)
+    gen.set_defaults(func=generate)
+
+    chk = commands.add_parser('check', help='compare an output file with a golden set')
+    chk.add_argument('dir')
+    chk.add_argument('output')
+    chk.set_defaults(func=check)
+
+    args = parser.parse_args()
+    return args.func(args)
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -3,17 +3,14 @@
 import numpy as np
 from skimage.measure import block_reduce
 
-from fixed_point_model import float_to_fixed_point
+from fixed_point_model import float_to_fixed, to_binary
 from convolution_model import convolution
 
 
 def convert_array_to_fixed_point(array, int_bits=3, frac_bits=12):
-    """Convert floating-point numpy array to fixed-point representation."""
-    shape = array.shape
-    fp_list = []
-    for value in array.flatten():
-        fp_list.append(float_to_fixed_point(value, int_bits, frac_bits))
-    return np.reshape(fp_list, shape)
+    """Convert floating-point numpy array to fixed-point bit strings (sign, integer and fractional bits)."""
+    width = 1 + int_bits + frac_bits
+    return to_binary(float_to_fixed(array, width, frac_bits), width)
 
 
 def print_comparison(name, float_array, fixed_array):
@@ -0,0 +1,452 @@
+"""Randomized cross-model regression runner.
+
+Generates random layer configurations and data, runs them through the golden
+model (golden_model.py), the C software model (sw/cnn), the HAL model backend and,
+optionally, the RTL under GHDL co-simulation, and diffs every output bit for
+bit. Cases are spread over all cores; failing cases are shrunk to a minimal
+reproducer and saved as JSON, which --replay runs again.
+
+The C legs are built for the host from regression_driver.c. BSP_INCLUDE must
+point at host versions of the Xilinx BSP headers, and BSP_SOURCES may list
+sources implementing them (see scripts/cosim.sh).
+"""
+
+import argparse
+import json
+import os
+import subprocess
+import sys
+import time
+from multiprocessing import Pool
+
+import numpy as np
+
+from golden_model import POOL_NONE, layer
+
+ROOT = os.path.abspath(os.path.join(os.path.dirname(__file__), '..', '..'))
+DRIVER = os.path.join(ROOT, 'hw', 'model', 'regression_driver.c')
+
+# Fractional bits per data width (sw/common/fixed.h)
+FRACTIONAL_BITS = {32: 12, 16: 12, 8: 4}
+
+KERNEL_SIZES = (2, 3, 5)
+STRIDES = (1, 2)
+POOL_SIZES = (2, 3)
+LEGS = ('software', 'model', 'rtl')
+OUTCOMES = ('ok', 'overflow', 'skip', 'error')
+CHUNK_CASES = 64
+MAX_SHRINK_STEPS = 400
+
+
+# ----------------------------------------------------------------------------
+# Reference model
+# ----------------------------------------------------------------------------
+
+def reference(case):
+    """Golden output for a case and whether the C models report overflow."""
+    return layer(case['input'], case['kernel'], case['width'], FRACTIONAL_BITS[case['width']],
+                 case['stride'], case['pool_size'], case['pool_mode'], case['pool_stride'], case['relu'])
+
+
+# ----------------------------------------------------------------------------
+# Case generation
+# ----------------------------------------------------------------------------
+
+def min_frame(kernel_size, stride, pool_size):
+    """Smallest frame side that yields one pooled output."""
+    return kernel_size + (pool_size - 1) * stride
+
+
+def random_values(rng, shape, width):
+    """Mostly small values, sometimes the full range to reach overflow."""
+    frac = FRACTIONAL_BITS[width]
+    bits = width - 1 if rng.random() < 0.2 else min(width - 1, frac + 2)
+    return rng.integers(-(1 << bits), 1 << bits, size=shape, dtype=np.int64)
+
+
+def generate_case(seed, index, widths, max_size):
+    """Random case, reproducible from the run seed and its index."""
+    rng = np.random.default_rng([seed, index])
+    width = int(rng.choice(widths))
+    k = int(rng.choice(KERNEL_SIZES))
+    s = int(rng.choice(STRIDES))
+    p = int(rng.choice(POOL_SIZES))
+    low = min_frame(k, s, p)
+    high = max(low, max_size)
+
+    case = {
+        'id': index,
+        'width': width,
+        'rows': int(rng.integers(low, high + 1)),
+        'cols': int(rng.integers(low, high + 1)),
+        'kernel_size': k,
+        'stride': s,
+        'pool_size': p,
+        'pool_mode': int(rng.integers(0, 3)),
+        'pool_stride': 0 if rng.random() < 0.5 else int(rng.integers(1, p + 1)),
+        'relu': int(rng.integers(0, 2)),
+    }
+    case['kernel'] = random_values(rng, (k, k), width)
+    case['input'] = random_values(rng, (case['rows'], case['cols']), width)
+    return case
+
+
+def encode_case(case):
+    """Driver input for one case."""
+    header = [case['id'], case['rows'], case['cols'], case['kernel_size'], case['stride'],
+              case['pool_size'], case['pool_mode'], case['pool_stride'], case['relu']]
+    return '%s\n%s\n%s\n' % (' '.join(map(str, header)),
+                             ' '.join(map(str, case['kernel'].ravel())),
+                             ' '.join(map(str, case['input'].ravel())))
+
+
+# ----------------------------------------------------------------------------
+# Drivers
+# ----------------------------------------------------------------------------
+
+def group_key(case):
+    """Build configuration the accelerator legs need for a case."""
+    return (case['width'], case['kernel_size'], case['stride'], case['pool_size'])
+
+
+def group_supported(key):
+    """Packed streams (narrow widths) need stride 1 (sw/hal/config.h)."""
+    width, _, stride, _ = key
+    return width == 32 or stride == 1
+
+
+def driver_path(build_dir, leg, key):
+    """Executable for a leg; the software leg only depends on the width."""
+    if leg == 'software':
+        return os.path.join(build_dir, 'software_w%d' % key[0])
+    return os.path.join(build_dir, '%s_w%d_k%d_s%d_p%d' % ((leg,) + key))
+
+
+def driver_flags(leg, key, max_size):
+    """Preprocessor overrides selecting the build configuration."""
+    width, k, s, p = key
+    if leg == 'software':
+        return ['-DFIXED_POINT_WIDTH=%d' % width]
+    return ['-DFIXED_POINT_WIDTH=%d' % width, '-DKERNEL_SIZE=%d' % k, '-DSTRIDE=%d' % s,
+            '-DPOOL_SIZE=%d' % p, '-DINPUT_SIZE=%d' % max_size]
+
+
+def up_to_date(path):
+    """Whether a driver is newer than every C source it is built from."""
+    if not os.path.exists(path):
+        return False
+    built = os.path.getmtime(path)
+    for directory in ('sw', os.path.join('hw', 'model')):
+        for base, _, files in os.walk(os.path.join(ROOT, directory)):
+            for name in files:
+                if name.endswith(('.c', '.h')) and os.path.getmtime(os.path.join(base, name)) > built:
+                    return False
+    return True
+
+
+def build_driver(args):
+    """Compile the host driver for one leg and configuration."""
+    build_dir, leg, key, max_size = args
+    path = driver_path(build_dir, leg, key)
+    if up_to_date(path):
+        return path
+
+    bsp_include = os.environ['BSP_INCLUDE']
+    bsp_sources = os.environ.get('BSP_SOURCES', '').split()
+    flags = driver_flags(leg, key, max_size)
+
+    if leg == 'rtl':
+        env = dict(os.environ, CFLAGS=' '.join(flags))
+        subprocess.run([os.path.join(ROOT, 'scripts', 'cosim.sh'), DRIVER, path],
+                       cwd=build_dir, env=env, check=True, stdout=subprocess.DEVNULL)
+        return path
+
+    sources = [DRIVER] + bsp_sources
+    for directory in ('common', 'cnn', 'hal'):
+        base = os.path.join(ROOT, 'sw', directory)
+        sources += [os.path.join(base, name) for name in sorted(os.listdir(base)) if name.endswith('.c')]
+    # The allocator casts 32-bit fabric addresses to host pointers
+    warnings = ['-Wall', '-Werror', '-Wno-int-to-pointer-cast', '-Wno-pointer-to-int-cast']
+    subprocess.run(['gcc', '-O2', '-std=gnu11'] + warnings + ['-DTIMER_BACKEND_HOST', '-I' + bsp_include] +
+                   flags + sources + ['-o', path], check=True)
+    return path
+
+
+def build_drivers(cases, legs, build_dir, max_size, jobs):
+    """Build every driver the cases need; RTL builds share one GHDL library."""
+    os.makedirs(build_dir, exist_ok=True)
+    keys = sorted({group_key(c) for c in cases})
+    builds = []
+    if 'software' in legs:
+        builds += [(build_dir, 'software', (w, 0, 0, 0), max_size) for w in sorted({k[0] for k in keys})]
+    if 'model' in legs:
+        builds += [(build_dir, 'model', key, max_size) for key in keys if group_supported(key)]
+
+    with Pool(jobs) as pool:
+        pool.map(build_driver, builds)
+    if 'rtl' in legs:
+        for key in keys:
+            if group_supported(key):
+                build_driver((build_dir, 'rtl', key, max_size))
+
+
+def run_driver(path, leg, cases):
+    """Run cases through one driver, returning each case's result."""
+    text = ''.join(encode_case(c) for c in cases)
+    process = subprocess.run([path, leg], input=text, capture_output=True, text=True)
+
+    # Results are interleaved with the driver stack's LOG_ERROR output
+    results = {}
+    for line in process.stdout.splitlines():
+        fields = line.split()
+        if len(fields) < 2 or not fields[0].isdigit() or fields[1] not in OUTCOMES:
+            continue
+        case_id, outcome = int(fields[0]), fields[1]
+        if outcome == 'ok':
+            rows, cols = int(fields[2]), int(fields[3])
+            values = np.array(fields[4:4 + rows * cols], dtype=np.int64)
+            results[case_id] = ('ok', values.reshape(rows, cols))
+        else:
+            results[case_id] = (outcome, None)
+
+    # A crash loses the remaining cases
+    for c in cases:
+        results.setdefault(c['id'], ('crash', None))
+    return results
+
+
+# ----------------------------------------------------------------------------
+# Comparison
+# ----------------------------------------------------------------------------
+
+def check(leg, case, expected, overflow, result):
+    """Mismatch description for a leg's result, or None if it matches."""
+    outcome, output = result
+    if outcome == 'skip':
+        return None
+
+    # The C models stop on overflow, the RTL wraps
+    if overflow and leg != 'rtl':
+        return None if outcome == 'overflow' else 'expected overflow, got %s' % outcome
+
+    if outcome != 'ok':
+        return outcome
+    if output.shape != expected.shape:
+        return 'shape %s, expected %s' % (output.shape, expected.shape)
+    diff = np.argwhere(output != expected)
+    if len(diff):
+        r, c = diff[0]
+        return '%d mismatches, first at (%d,%d): %d != %d' % (len(diff), r, c, output[r, c], expected[r, c])
+    return None
+
+
+def legs_for(case, legs, build_dir):
+    """(leg, driver) pairs that can run a case."""
+    key = group_key(case)
+    pairs = []
+    for leg in legs:
+        if leg == 'software':
+            pairs.append((leg, driver_path(build_dir, leg, (case['width'], 0, 0, 0))))
+        elif group_supported(key):
+            pairs.append((leg, driver_path(build_dir, leg, key)))
+    return pairs
+
+
+def run_chunk(args):
+    """Worker: run a chunk of same-configuration cases through every leg."""
+    cases, legs, build_dir = args
+    counts = {leg: [0, 0, 0] for leg in legs}  # compared, skipped, failed
+    failures = []
+
+    references = {c['id']: reference(c) for c in cases}
+    pairs = legs_for(cases[0], legs, build_dir)
+    for leg in set(legs) - {leg for leg, _ in pairs}:
+        counts[leg][1] += len(cases)
+
+    for leg, path in pairs:
+        results = run_driver(path, leg, cases)
+        for c in cases:
+            expected, overflow = references[c['id']]
+            result = results[c['id']]
+            if result[0] == 'skip':
+                counts[leg][1] += 1
+                continue
+            counts[leg][0] += 1
+            message = check(leg, c, expected, overflow, result)
+            if message:
+                counts[leg][2] += 1
+                failures.append((c, leg, message))
+    return counts, failures
+
+
+def still_fails(case, leg, build_dir):
+    """Whether a leg still disagrees with the reference on a case."""
+    path = dict(legs_for(case, [leg], build_dir))[leg]
+    expected, overflow = reference(case)
+    return check(leg, case, expected, overflow, run_driver(path, leg, [case])[case['id']]) is not None
+
+
+# ----------------------------------------------------------------------------
+# Shrinking
+# ----------------------------------------------------------------------------
+
+def candidates(case):
+    """Simpler variants of a case, most aggressive first."""
+    k, s, p = case['kernel_size'], case['stride'], case['pool_size']
+    low = min_frame(k, s, p)
+
+    # Stages
+    for field, value in (('relu', 0), ('pool_mode', POOL_NONE), ('pool_stride', 0)):
+        if case[field] != value:
+            yield dict(case, **{field: value})
+
+    # Frame size (crop from the bottom right)
+    for axis, field in ((0, 'rows'), (1, 'cols')):
+        size = case[field]
+        for new in sorted({low, max(low, size // 2), size - 1}):
+            if low <= new < size:
+                cropped = case['input'][:new, :] if axis == 0 else case['input'][:, :new]
+                yield dict(case, **{field: new, 'input': cropped})
+
+    # Values (zero whole halves, then single values, then halve magnitudes)
+    for field in ('kernel', 'input'):
+        values = case[field]
+        flat = values.ravel()
+        nonzero = np.flatnonzero(flat)
+        for part in (nonzero[:len(nonzero) // 2], nonzero[len(nonzero) // 2:]):
+            if len(part) > 1:
+                zeroed = flat.copy()
+                zeroed[part] = 0
+                yield dict(case, **{field: zeroed.reshape(values.shape)})
+        for i in nonzero[:64]:
+            zeroed = flat.copy()
+            zeroed[i] = 0
+            yield dict(case, **{field: zeroed.reshape(values.shape)})
+        if np.any(np.abs(flat) > 1):
+            yield dict(case, **{field: values // 2})
+
+
+def shrink(case, leg, build_dir):
+    """Greedily simplify a failing case while the leg keeps failing."""
+    steps = 0
+    improved = True
+    while improved and steps < MAX_SHRINK_STEPS:
+        improved = False
+        for candidate in candidates(case):
+            steps += 1
+            if still_fails(candidate, leg, build_dir):
+                case = candidate
+                improved = True
+                break
+            if steps >= MAX_SHRINK_STEPS:
+                break
+    return case
+
+
+def save_reproducer(case, leg, message, build_dir, output_dir):
+    """Write a failing case, the reference and the leg's output as JSON."""
+    os.makedirs(output_dir, exist_ok=True)
+    expected, overflow = reference(case)
+    path = dict(legs_for(case, [leg], build_dir))[leg]
+    outcome, output = run_driver(path, leg, [case])[case['id']]
+
+    record = {key: (value.tolist() if isinstance(value, np.ndarray) else value) for key, value in case.items()}
+    record.update({
+        'leg': leg,
+        'message': message,
+        'reference': expected.tolist(),
+        'reference_overflow': overflow,
+        'outcome': outcome,
+        'output': output.tolist() if output is not None else None,
+    })
+    filename = os.path.join(output_dir, 'case_%d_%s.json' % (case['id'], leg))
+    with open(filename, 'w') as f:
+        json.dump(record, f, indent=1)
+    return filename
+
+
+def load_case(filename):
+    """Case from a reproducer file."""
+    with open(filename) as f:
+        record = json.load(f)
+    case = {key: record[key] for key in ('id', 'width', 'rows', 'cols', 'kernel_size', 'stride',
+                                         'pool_size', 'pool_mode', 'pool_stride', 'relu')}
+    case['kernel'] = np.array(record['kernel'], dtype=np.int64)
+    case['input'] = np.array(record['input'], dtype=np.int64)
+    return case, record['leg']
+
+
+# ----------------------------------------------------------------------------
+# Main
+# ----------------------------------------------------------------------------
+
+def print_summary(counts, num_cases, elapsed):
+    """Per-leg totals and throughput."""
+    print('%d cases in %.1f s (%.0f cases/min)' % (num_cases, elapsed, num_cases * 60.0 / max(elapsed, 1e-9)))
+    for leg, (compared, skipped, failed) in counts.items():
+        print('  %-8s compared %6d  skipped %6d  failed %6d' % (leg, compared, skipped, failed))
+
+
+def main():
+    """Run a randomized regression or replay reproducers."""
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument('--cases', type=int, default=1000)
+    parser.add_argument('--seed', type=int, default=1)
+    parser.add_argument('--jobs', type=int, default=os.cpu_count())
+    parser.add_argument('--legs', default='software,model', help='any of ' + ','.join(LEGS))
+    parser.add_argument('--widths', default='32,16,8')
+    parser.add_argument('--max-size', type=int, default=24, help='largest frame side (INPUT_SIZE of the builds)')
+    parser.add_argument('--shrink', type=int, default=5, help='failures to shrink')
+    parser.add_argument('--build-dir', default=os.path.join(ROOT, 'build', 'regression'))
+    parser.add_argument('--output-dir', default='regression_failures')
+    parser.add_argument('--replay', nargs='*', help='reproducer files to run again')
+    args = parser.parse_args()
+
+    if 'BSP_INCLUDE' not in os.environ:
+        parser.error('BSP_INCLUDE must point at host BSP headers')
+    legs = [leg for leg in args.legs.split(',') if leg]
+    if any(leg not in LEGS for leg in legs):
+        parser.error('unknown leg in %s' % args.legs)
+
+    if args.replay:
+        replays = [load_case(f) for f in args.replay]
+        build_drivers([c for c, _ in replays], {leg for _, leg in replays}, args.build_dir, args.max_size, args.jobs)
+        failed = 0
+        for (case, leg), filename in zip(replays, args.replay):
+            fails = still_fails(case, leg, args.build_dir)
+            failed += fails
+            print('%s: %s %s' % (filename, leg, 'FAIL' if fails else 'pass'))
+        return 1 if failed else 0
+
+    widths = [int(w) for w in args.widths.split(',')]
+    cases = [generate_case(args.seed, i, widths, args.max_size) for i in range(args.cases)]
+    build_drivers(cases, legs, args.build_dir, args.max_size, args.jobs)
+
+    # Chunks of one configuration each, so a worker starts one driver per leg
+    groups = {}
+    for c in cases:
+        groups.setdefault(group_key(c), []).append(c)
+    chunks = [(group[i:i + CHUNK_CASES], legs, args.build_dir)
+              for group in groups.values() for i in range(0, len(group), CHUNK_CASES)]
+
+    start = time.time()
+    counts = {leg: [0, 0, 0] for leg in legs}
+    failures = []
+    with Pool(args.jobs) as pool:
+        for chunk_counts, chunk_failures in pool.imap_unordered(run_chunk, chunks):
+            for leg in legs:
+                counts[leg] = [a + b for a, b in zip(counts[leg], chunk_counts[leg])]
+            failures += chunk_failures
+    print_summary(counts, len(cases), time.time() - start)
+
+    failures.sort(key=lambda f: f[0]['id'])
+    for case, leg, message in failures[:args.shrink]:
+        small = shrink(case, leg, args.build_dir)
+        filename = save_reproducer(small, leg, message, args.build_dir, args.output_dir)
+        print('case %d (seed %d) %s: %s -> %s (%dx%d)' % (case['id'], args.seed, leg, message, filename,
+                                                          small['rows'], small['cols']))
+    return 1 if failures else 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,177 @@
+/**
+ * Cross-model regression driver
+ * Host program for regression.py: reads cases from stdin and prints the
+ * result of one C implementation per case. "software" runs the sw/cnn
+ * model, "model" the HAL model backend and "rtl" the HAL co-simulation
+ * backend (linked through scripts/cosim.sh). Accelerator backends run the
+ * KERNEL_SIZE/STRIDE/POOL_SIZE this is built with and skip other cases.
+ *
+ * Case:   id rows cols kernel_size stride pool_size pool_mode pool_stride relu
+ *         kernel_size^2 weights, rows*cols inputs (raw fixed-point integers)
+ * Result: id ok out_rows out_cols values... | id overflow | id skip | id error
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "../../sw/cnn/cnn.h"
+#include "../../sw/hal/accelerator.h"
+#include "../../sw/hal/bump_allocator.h"
+
+#define MAX_KERNEL_SIZE 16
+
+typedef struct {
+    long id;
+    int rows;
+    int cols;
+    int kernel_size;
+    int stride;
+    int pool_size;
+    cnn_stages_t stages;
+} regression_case_t;
+
+// Forward declarations
+static int read_case(regression_case_t *c, matrix_t **kernel, matrix_t **input);
+static int read_matrix(matrix_t *mat);
+static status_t run_software(const regression_case_t *c, matrix_t *kernel, matrix_t *input, matrix_t **output);
+static int accelerator_supports(const regression_case_t *c);
+static status_t run_accelerator(accelerator_t *acc, const regression_case_t *c, matrix_t *kernel, matrix_t *input, matrix_t **output);
+static void print_result(const regression_case_t *c, status_t status, const matrix_t *output);
+
+int main(int argc, char **argv) {
+    accelerator_t acc;
+    int use_acc;
+
+    if (argc != 2) {
+        fprintf(stderr, "Usage: %s software|model|rtl < cases\n", argv[0]);
+        return 1;
+    }
+
+    if (allocator_init() != STATUS_SUCCESS) {
+        return 1;
+    }
+
+    if (strcmp(argv[1], "software") == 0) {
+        use_acc = 0;
+    } else if (strcmp(argv[1], "model") == 0 || strcmp(argv[1], "rtl") == 0) {
+        use_acc = 1;
+        accelerator_backend_t backend = (argv[1][0] == 'm') ? ACCELERATOR_BACKEND_MODEL : ACCELERATOR_BACKEND_COSIM;
+        if (accelerator_init(&acc, 0, backend) != STATUS_SUCCESS) {
+            return 1;
+        }
+    } else {
+        fprintf(stderr, "Unknown backend %s\n", argv[1]);
+        return 1;
+    }
+
+    // One case at a time, each from a fresh allocator pool
+    for (;;) {
+        regression_case_t c;
+        matrix_t *kernel, *input, *output = NULL;
+
+        allocator_reset();
+        int read = read_case(&c, &kernel, &input);
+        if (read <= 0) {
+            return read < 0;
+        }
+
+        if (use_acc && !accelerator_supports(&c)) {
+            printf("%ld skip\n", c.id);
+            continue;
+        }
+
+        status_t status = use_acc ? run_accelerator(&acc, &c, kernel, input, &output)
+                                  : run_software(&c, kernel, input, &output);
+        print_result(&c, status, output);
+    }
+}
+
+// Returns 1 for a case, 0 at the end of the input and -1 on malformed input
+static int read_case(regression_case_t *c, matrix_t **kernel, matrix_t **input) {
+    int pool, relu;
+
+    int fields = scanf("%ld %d %d %d %d %d %d %d %d", &c->id, &c->rows, &c->cols, &c->kernel_size,
+                       &c->stride, &c->pool_size, &pool, &c->stages.pool_stride, &relu);
+    if (fields == EOF) {
+        return 0;
+    }
+    if (fields != 9 || c->kernel_size <= 0 || c->kernel_size > MAX_KERNEL_SIZE ||
+        c->rows < c->kernel_size || c->cols < c->kernel_size ||
+        pool < CNN_POOL_MAX || pool > CNN_POOL_NONE) {
+        fprintf(stderr, "Malformed case header\n");
+        return -1;
+    }
+    c->stages.pool = (cnn_pool_mode_t)pool;
+    c->stages.relu = relu;
+
+    *kernel = matrix_create(c->kernel_size, c->kernel_size);
+    *input = matrix_create(c->rows, c->cols);
+    if (!*kernel || !*input || !read_matrix(*kernel) || !read_matrix(*input)) {
+        fprintf(stderr, "Malformed case %ld\n", c->id);
+        return -1;
+    }
+    return 1;
+}
+
+static int read_matrix(matrix_t *mat) {
+    for (int i = 0; i < mat->rows * mat->cols; i++) {
+        long value;
+        if (scanf("%ld", &value) != 1) {
+            return 0;
+        }
+        mat->data[i] = (fixed_point_t)value;
+    }
+    return 1;
+}
+
+static status_t run_software(const regression_case_t *c, matrix_t *kernel, matrix_t *input, matrix_t **output) {
+    int conv_rows = (c->rows - c->kernel_size) / c->stride + 1;
+    int conv_cols = (c->cols - c->kernel_size) / c->stride + 1;
+
+    *output = matrix_create(cnn_pooled_size(conv_rows, c->pool_size, &c->stages),
+                            cnn_pooled_size(conv_cols, c->pool_size, &c->stages));
+    if (!*output) {
+        return STATUS_ERROR_MEMORY;
+    }
+    return cnn_forward_stages(input, &kernel, 1, c->pool_size, c->stride, &c->stages, *output);
+}
+
+// The layer shape is fixed by the build, the frame size by the bitstream
+static int accelerator_supports(const regression_case_t *c) {
+    return c->kernel_size == KERNEL_SIZE && c->stride == STRIDE && c->pool_size == POOL_SIZE &&
+           accelerator_dimensions_supported(c->rows, c->cols);
+}
+
+static status_t run_accelerator(accelerator_t *acc, const regression_case_t *c, matrix_t *kernel, matrix_t *input, matrix_t **output) {
+    int conv_rows = (c->rows - KERNEL_SIZE) / STRIDE + 1;
+    int conv_cols = (c->cols - KERNEL_SIZE) / STRIDE + 1;
+    *output = matrix_create(cnn_pooled_size(conv_rows, POOL_SIZE, &c->stages),
+                            cnn_pooled_size(conv_cols, POOL_SIZE, &c->stages));
+    if (!*output) {
+        return STATUS_ERROR_MEMORY;
+    }
+
+    status_t status = accelerator_set_stages(acc, &c->stages);
+    if (status == STATUS_SUCCESS) {
+        status = accelerator_set_kernel(acc, kernel);
+    }
+    if (status == STATUS_SUCCESS) {
+        status = accelerator_compute(acc, input, *output);
+    }
+    return status;
+}
+
+static void print_result(const regression_case_t *c, status_t status, const matrix_t *output) {
+    if (status == STATUS_ERROR_OVERFLOW) {
+        printf("%ld overflow\n", c->id);
+    } else if (status != STATUS_SUCCESS) {
+        printf("%ld error\n", c->id);
+    } else {
+        printf("%ld ok %d %d", c->id, output->rows, output->cols);
+        for (int i = 0; i < output->rows * output->cols; i++) {
+            printf(" %ld", (long)output->data[i]);
+        }
+        printf("\n");
+    }
+    fflush(stdout);
+}
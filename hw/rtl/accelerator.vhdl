@@ -10,8 +10,14 @@ entity accelerator is
 		POOL_SIZE	    : integer := 2;
 		DATA_WIDTH      : integer := 32;
 		FRACTIONAL_BITS : integer := 12;
-		ADDR_WIDTH	    : integer := 6;
-		NUM_REGISTERS   : integer := 9
+		ADDR_WIDTH	    : integer := 7;
+		NUM_REGISTERS   : integer := 9;  -- KERNEL_SIZE*KERNEL_SIZE*(NUM_FILTERS+NUM_LAYERS-1)
+		LINE_BUFFER_BRAM : integer := 0;
+		PIXELS_PER_BEAT : integer := 1;
+		NUM_FILTERS     : integer := 1;
+		NUM_LAYERS      : integer := 1;  -- 2 cascades a second conv/ReLU/pool block
+		OUTPUT_FIFO_DEPTH : integer := 16;  -- Output beats buffered against DMA backpressure (0: none)
+		AXI_DATA_WIDTH  : integer := 32  -- Register width (kernel weights use the low DATA_WIDTH bits)
 	);
 	port (
 		clk_i  : in std_logic;
@@ -22,8 +28,8 @@ entity accelerator is
 		s_axi_awprot  : in  std_logic_vector(2 downto 0);
 		s_axi_awvalid : in  std_logic;
 		s_axi_awready : out std_logic;
-		s_axi_wdata	  : in  std_logic_vector(DATA_WIDTH-1 downto 0);
-		s_axi_wstrb	  : in  std_logic_vector((DATA_WIDTH/8)-1 downto 0);
+		s_axi_wdata	  : in  std_logic_vector(AXI_DATA_WIDTH-1 downto 0);
+		s_axi_wstrb	  : in  std_logic_vector((AXI_DATA_WIDTH/8)-1 downto 0);
 		s_axi_wvalid  : in  std_logic;
 		s_axi_wready  : out std_logic;
 		s_axi_bresp	  : out std_logic_vector(1 downto 0);
@@ -33,22 +39,24 @@ entity accelerator is
 		s_axi_arprot  : in  std_logic_vector(2 downto 0);
 		s_axi_arvalid : in  std_logic;
 		s_axi_arready : out std_logic;
-		s_axi_rdata	  : out std_logic_vector(DATA_WIDTH-1 downto 0);
+		s_axi_rdata	  : out std_logic_vector(AXI_DATA_WIDTH-1 downto 0);
 		s_axi_rresp	  : out std_logic_vector(1 downto 0);
 		s_axi_rvalid  : out std_logic;
 		s_axi_rready  : in  std_logic;
 
-		-- AXI4-Stream Slave Interface
+		-- AXI4-Stream Slave Interface (PIXELS_PER_BEAT pixels per beat, lane 0 first)
 		s_axis_tready  : out std_logic;
-		s_axis_tdata   : in std_logic_vector(DATA_WIDTH-1 downto 0);
-		s_axis_tstrb   : in std_logic_vector((DATA_WIDTH/8)-1 downto 0);
+		s_axis_tdata   : in std_logic_vector(PIXELS_PER_BEAT*DATA_WIDTH-1 downto 0);
+		s_axis_tstrb   : in std_logic_vector((PIXELS_PER_BEAT*DATA_WIDTH/8)-1 downto 0);
 		s_axis_tlast   : in std_logic;
 		s_axis_tvalid  : in std_logic;
 
-		-- AXI4-Stream Master Interface
+		-- AXI4-Stream Master Interface (pooled pixels, NUM_FILTERS channels each,
+		-- or the second layer's output while chained)
 		m_axis_tvalid  : out std_logic;
-		m_axis_tdata   : out std_logic_vector(DATA_WIDTH-1 downto 0);
-		m_axis_tstrb   : out std_logic_vector((DATA_WIDTH/8)-1 downto 0);
+		m_axis_tdata   : out std_logic_vector(PIXELS_PER_BEAT*DATA_WIDTH-1 downto 0);
+		m_axis_tstrb   : out std_logic_vector((PIXELS_PER_BEAT*DATA_WIDTH/8)-1 downto 0);
+		m_axis_tkeep   : out std_logic_vector((PIXELS_PER_BEAT*DATA_WIDTH/8)-1 downto 0);
 		m_axis_tlast   : out std_logic;
 		m_axis_tready  : in std_logic
 	);
@@ -63,23 +71,30 @@ architecture rtl of accelerator is
 			KERNEL_SIZE     : integer := 3;
 			STRIDE          : integer := 1;
 			DATA_WIDTH      : integer := 32;
-			FRACTIONAL_BITS : integer := 12
+			FRACTIONAL_BITS : integer := 12;
+			LINE_BUFFER_BRAM : integer := 0;
+			PIXELS_PER_BEAT : integer := 1;
+			NUM_FILTERS     : integer := 1
 		);
 		port (
 			clk_i        : in  std_logic;
 			rst_i        : in  std_logic;
 			
-			-- Kernel
-			kernel_i : in  std_logic_vector((KERNEL_SIZE*KERNEL_SIZE*DATA_WIDTH)-1 downto 0);
+			-- Kernels
+			kernel_i : in  std_logic_vector((NUM_FILTERS*KERNEL_SIZE*KERNEL_SIZE*DATA_WIDTH)-1 downto 0);
+
+			-- Frame Dimensions
+			width_i  : in  std_logic_vector(15 downto 0);
+			height_i : in  std_logic_vector(15 downto 0);
 			
 			-- Input Stream Interface
-			data_i  : in  std_logic_vector(DATA_WIDTH-1 downto 0);
+			data_i  : in  std_logic_vector(PIXELS_PER_BEAT*DATA_WIDTH-1 downto 0);
 			valid_i : in  std_logic;
 			ready_o : out std_logic;
 			last_i  : in  std_logic;
 			
 			-- Output Stream Interface
-			data_o  : out std_logic_vector(DATA_WIDTH-1 downto 0);
+			data_o  : out std_logic_vector(NUM_FILTERS*PIXELS_PER_BEAT*DATA_WIDTH-1 downto 0);
 			valid_o : out std_logic;
 			ready_i : in  std_logic;
 			last_o  : out std_logic
@@ -100,30 +115,86 @@ architecture rtl of accelerator is
 	-- Pooler Declaration
 	component pooler is
 		generic (
-			INPUT_SIZE : integer := 6;
-			POOL_SIZE  : integer := 2;
-			DATA_WIDTH : integer := 32
+			INPUT_SIZE      : integer := 6;
+			POOL_SIZE       : integer := 2;
+			DATA_WIDTH      : integer := 32;
+			PIXELS_PER_BEAT : integer := 1;
+			LANE_OFFSET     : integer := 0
+		);
+		port (
+			clk_i   : in  std_logic;
+			rst_i   : in  std_logic;
+			width_i  : in  std_logic_vector(15 downto 0);
+			height_i : in  std_logic_vector(15 downto 0);
+			average_i : in  std_logic;
+			bypass_i  : in  std_logic;
+			stride_i  : in  std_logic_vector(7 downto 0);
+			data_i  : in  std_logic_vector(PIXELS_PER_BEAT*DATA_WIDTH-1 downto 0);
+			valid_i : in  std_logic;
+			ready_o : out std_logic;
+			last_i  : in  std_logic;
+			data_o  : out std_logic_vector(PIXELS_PER_BEAT*DATA_WIDTH-1 downto 0);
+			keep_o  : out std_logic_vector(PIXELS_PER_BEAT-1 downto 0);
+			valid_o : out std_logic;
+			ready_i : in  std_logic;
+			last_o  : out std_logic
+		);
+	end component pooler;
+
+	-- Packer Declaration
+	component packer is
+		generic (
+			DATA_WIDTH      : integer := 32;
+			PIXELS_PER_BEAT : integer := 2;
+			INPUT_LANES     : integer := 2
+		);
+		port (
+			clk_i   : in  std_logic;
+			rst_i   : in  std_logic;
+			data_i  : in  std_logic_vector(INPUT_LANES*DATA_WIDTH-1 downto 0);
+			keep_i  : in  std_logic_vector(INPUT_LANES-1 downto 0);
+			valid_i : in  std_logic;
+			ready_o : out std_logic;
+			last_i  : in  std_logic;
+			data_o  : out std_logic_vector(PIXELS_PER_BEAT*DATA_WIDTH-1 downto 0);
+			keep_o  : out std_logic_vector(PIXELS_PER_BEAT-1 downto 0);
+			valid_o : out std_logic;
+			ready_i : in  std_logic;
+			last_o  : out std_logic
+		);
+	end component packer;
+
+	-- FIFO Declaration
+	component fifo is
+		generic (
+			DATA_WIDTH : integer := 32;
+			KEEP_WIDTH : integer := 1;
+			DEPTH      : integer := 16
 		);
 		port (
 			clk_i   : in  std_logic;
 			rst_i   : in  std_logic;
 			data_i  : in  std_logic_vector(DATA_WIDTH-1 downto 0);
+			keep_i  : in  std_logic_vector(KEEP_WIDTH-1 downto 0);
 			valid_i : in  std_logic;
 			ready_o : out std_logic;
 			last_i  : in  std_logic;
 			data_o  : out std_logic_vector(DATA_WIDTH-1 downto 0);
+			keep_o  : out std_logic_vector(KEEP_WIDTH-1 downto 0);
 			valid_o : out std_logic;
 			ready_i : in  std_logic;
 			last_o  : out std_logic
 		);
-	end component pooler;
+	end component fifo;
 
 	-- Registers Declaration
 	component registers is
 		generic (
+			INPUT_SIZE    : integer := 6;
 			DATA_WIDTH	  : integer	:= 32;
-			ADDR_WIDTH	  : integer	:= 6;
-			NUM_REGISTERS : integer := 9
+			ADDR_WIDTH	  : integer	:= 7;
+			NUM_REGISTERS : integer := 9;
+			CHAIN_REGISTERS : integer := 0
 		);
 		port (
 			clk_i     : in  std_logic;
@@ -158,36 +229,216 @@ architecture rtl of accelerator is
 			rvalid_o  : out std_logic;
 			rready_i  : in  std_logic;
 	
+			-- Bank Control
+			swap_i       : in  std_logic;
+			chain_swap_i : in  std_logic;
+
+			-- Performance Events
+			busy_i      : in  std_logic;
+			in_stall_i  : in  std_logic;
+			out_stall_i : in  std_logic;
+			in_beat_i   : in  std_logic;
+			out_beat_i  : in  std_logic;
+			frame_i     : in  std_logic;
+	
 			-- Output Interface
-			kernel_o  : out std_logic_vector(DATA_WIDTH*NUM_REGISTERS-1 downto 0)
+			kernel_o  : out std_logic_vector(DATA_WIDTH*NUM_REGISTERS-1 downto 0);
+			width_o   : out std_logic_vector(15 downto 0);
+			height_o  : out std_logic_vector(15 downto 0);
+			packet_o  : out std_logic_vector(15 downto 0);
+			stages_o  : out std_logic_vector(15 downto 0);
+			chain_o        : out std_logic_vector(15 downto 0);
+			chain_width_o  : out std_logic_vector(15 downto 0);
+			chain_height_o : out std_logic_vector(15 downto 0);
+			chain_stages_o : out std_logic_vector(15 downto 0)
 		);
 	end component registers;
 
+	-- Constants
+	constant CHANNEL_LANES : integer := NUM_FILTERS*PIXELS_PER_BEAT;
+	constant TAPS          : integer := KERNEL_SIZE*KERNEL_SIZE;
+	constant FILTER_REGS   : integer := TAPS*NUM_FILTERS;         -- First layer kernels
+	constant CONV_SIZE     : integer := (INPUT_SIZE-KERNEL_SIZE)/STRIDE+1;  -- Widest second layer input (pooling bypassed)
+
 	-- Signals
-	signal convolver_data_o   : std_logic_vector(DATA_WIDTH-1 downto 0);
+	signal convolver_data_o   : std_logic_vector(CHANNEL_LANES*DATA_WIDTH-1 downto 0);
 	signal convolver_valid_o  : std_logic;
 	signal convolver_last_o   : std_logic;
-	signal relu_data_o        : std_logic_vector(DATA_WIDTH-1 downto 0);
+	signal relu_data_o        : std_logic_vector(CHANNEL_LANES*DATA_WIDTH-1 downto 0);
+	signal stage_data         : std_logic_vector(CHANNEL_LANES*DATA_WIDTH-1 downto 0);
 	signal pooler_ready_o     : std_logic;
-	signal registers_kernel_o : std_logic_vector(DATA_WIDTH*NUM_REGISTERS-1 downto 0);
+	signal pooler_data_o      : std_logic_vector(CHANNEL_LANES*DATA_WIDTH-1 downto 0);
+	signal pooler_keep_o      : std_logic_vector(PIXELS_PER_BEAT-1 downto 0);
+	signal pooler_valid_o     : std_logic;
+	signal pooler_last_o      : std_logic;
+	signal pooler_ready_i     : std_logic;
+	signal result_data        : std_logic_vector(CHANNEL_LANES*DATA_WIDTH-1 downto 0);
+	signal result_keep        : std_logic_vector(PIXELS_PER_BEAT-1 downto 0);
+	signal result_valid       : std_logic;
+	signal result_last        : std_logic;
+	signal result_ready       : std_logic;
+	signal channel_data       : std_logic_vector(CHANNEL_LANES*DATA_WIDTH-1 downto 0);
+	signal channel_keep       : std_logic_vector(CHANNEL_LANES-1 downto 0);
+	signal stream_data        : std_logic_vector(PIXELS_PER_BEAT*DATA_WIDTH-1 downto 0);
+	signal stream_keep        : std_logic_vector(PIXELS_PER_BEAT-1 downto 0);
+	signal stream_valid       : std_logic;
+	signal stream_last        : std_logic;
+	signal stream_ready       : std_logic;
+	signal output_keep        : std_logic_vector(PIXELS_PER_BEAT-1 downto 0);
+	signal registers_kernel_o : std_logic_vector(AXI_DATA_WIDTH*NUM_REGISTERS-1 downto 0);
+	signal kernel             : std_logic_vector(DATA_WIDTH*NUM_REGISTERS-1 downto 0);
+	signal convolver_ready_o  : std_logic;
+	signal input_beat         : std_logic;
+	signal frame_end          : std_logic;
+	signal row_counter        : unsigned(15 downto 0);
+	signal col_counter        : unsigned(15 downto 0);
+	signal kernel_swap        : std_logic;
+	signal chain_swap         : std_logic;
+	signal registers_width_o  : std_logic_vector(15 downto 0);
+	signal registers_height_o : std_logic_vector(15 downto 0);
+	signal registers_packet_o : std_logic_vector(15 downto 0);
+	signal registers_stages_o : std_logic_vector(15 downto 0);
+	signal registers_chain_o  : std_logic_vector(15 downto 0);
+	signal registers_chain_width_o  : std_logic_vector(15 downto 0);
+	signal registers_chain_height_o : std_logic_vector(15 downto 0);
+	signal registers_chain_stages_o : std_logic_vector(15 downto 0);
+	signal pool_stride        : std_logic_vector(7 downto 0);
+	signal conv_first         : std_logic;
+	signal relu_enable        : std_logic;
+	signal relu_on            : std_logic;
+	signal conv_width         : std_logic_vector(15 downto 0);
+	signal conv_height        : std_logic_vector(15 downto 0);
+	signal row_beats          : unsigned(15 downto 0);
+	signal output_valid       : std_logic;
+	signal output_last        : std_logic;
+	signal input_idle         : std_logic;
+	signal output_beat        : std_logic;
+	signal frame_done         : std_logic;
+	signal frames_pending     : unsigned(7 downto 0);
+	signal result_frame       : std_logic;
+	signal packet_count       : unsigned(15 downto 0);
+	signal packet_last        : std_logic;
+	signal busy               : std_logic;
+	signal input_stall        : std_logic;
+	signal output_stall       : std_logic;
 
 begin
 
+	-- Check Configuration
+	assert NUM_REGISTERS = TAPS*(NUM_FILTERS+NUM_LAYERS-1)
+		report "NUM_REGISTERS must hold one kernel per filter and chained layer" severity failure;
+
+	assert NUM_LAYERS = 1 or (NUM_LAYERS = 2 and CHANNEL_LANES = 1)
+		report "Chaining takes a single-channel, one pixel per beat stream" severity failure;
+
+	assert DATA_WIDTH <= AXI_DATA_WIDTH
+		report "DATA_WIDTH must fit a register" severity failure;
+
+	-- Kernel weights sit in the low DATA_WIDTH bits of each register
+	kernel_gen: for i in 0 to NUM_REGISTERS-1 generate
+		kernel((i + 1)*DATA_WIDTH-1 downto i*DATA_WIDTH) <=
+			registers_kernel_o(i*AXI_DATA_WIDTH + DATA_WIDTH-1 downto i*AXI_DATA_WIDTH);
+	end generate;
+
+	-- Frame Tracking (counts beats, since a frame may arrive as several
+	-- DMA packets each closed by tlast)
+	input_beat <= s_axis_tvalid and convolver_ready_o;
+	row_beats  <= unsigned(registers_width_o) / PIXELS_PER_BEAT;
+	frame_end  <= '1' when row_counter = unsigned(registers_height_o)-1 and col_counter = row_beats-1 else '0';
+
+	frame_track: process(clk_i)
+	begin
+		if rising_edge(clk_i) then
+			if rstn_i = '0' then
+				row_counter <= (others => '0');
+				col_counter <= (others => '0');
+			elsif input_beat = '1' then
+				col_counter <= col_counter + 1;
+				if col_counter = row_beats-1 then
+					row_counter <= row_counter + 1;
+					col_counter <= (others => '0');
+				end if;
+				if frame_end = '1' then
+					row_counter <= (others => '0');
+					col_counter <= (others => '0');
+				end if;
+			end if;
+		end if;
+	end process frame_track;
+
+	-- Performance Events (a frame is in flight from its first input beat
+	-- until it leaves the last layer and the output has drained; starved input
+	-- only counts within a frame)
+	input_idle   <= '1' when row_counter = 0 and col_counter = 0 else '0';
+	output_beat  <= output_valid and m_axis_tready;
+	frame_done   <= result_frame;
+	busy         <= '1' when input_idle = '0' or input_beat = '1' or frames_pending /= 0 or output_valid = '1' else '0';
+	input_stall  <= convolver_ready_o and not s_axis_tvalid and not input_idle;
+	output_stall <= output_valid and not m_axis_tready;
+
+	frame_count: process(clk_i)
+	begin
+		if rising_edge(clk_i) then
+			if rstn_i = '0' then
+				frames_pending <= (others => '0');
+			elsif (input_beat and frame_end) = '1' and frame_done = '0' then
+				frames_pending <= frames_pending + 1;
+			elsif (input_beat and frame_end) = '0' and frame_done = '1' then
+				frames_pending <= frames_pending - 1;
+			end if;
+		end if;
+	end process frame_count;
+
+	-- Packets (tlast closes every registers_packet_o-th frame, so a batch of
+	-- back-to-back frames lands in one DMA transfer; 0 and 1 close each frame)
+	result_frame <= result_valid and result_ready and result_last;
+	packet_last  <= result_last when packet_count + 1 >= unsigned(registers_packet_o) else '0';
+
+	packet_track: process(clk_i)
+	begin
+		if rising_edge(clk_i) then
+			if rstn_i = '0' then
+				packet_count <= (others => '0');
+			elsif result_frame = '1' then
+				if packet_last = '1' then
+					packet_count <= (others => '0');
+				else
+					packet_count <= packet_count + 1;
+				end if;
+			end if;
+		end if;
+	end process packet_track;
+
+	-- Kernel products are formed as each pixel is accepted, so a committed
+	-- shadow bank may become active while idle (but not on the beat that
+	-- starts a frame) or on the last beat of a frame
+	kernel_swap <= '1' when row_counter = 0 and col_counter = 0 and input_beat = '0' else (input_beat and frame_end);
+	s_axis_tready <= convolver_ready_o;
+
+	-- Convolution output dimensions feed the pooler
+	conv_width  <= std_logic_vector((unsigned(registers_width_o) - KERNEL_SIZE + 1) / STRIDE);
+	conv_height <= std_logic_vector((unsigned(registers_height_o) - KERNEL_SIZE + 1) / STRIDE);
+
 	convolver_inst: convolver
 		generic map (
 			INPUT_SIZE      => INPUT_SIZE,
 			KERNEL_SIZE     => KERNEL_SIZE,
 			STRIDE          => STRIDE,
 			DATA_WIDTH      => DATA_WIDTH,
-			FRACTIONAL_BITS => FRACTIONAL_BITS
+			FRACTIONAL_BITS => FRACTIONAL_BITS,
+			LINE_BUFFER_BRAM => LINE_BUFFER_BRAM,
+			PIXELS_PER_BEAT => PIXELS_PER_BEAT,
+			NUM_FILTERS     => NUM_FILTERS
 		)
 		port map (
 			clk_i    => clk_i,
 			rst_i    => not rstn_i,
-			kernel_i => registers_kernel_o,
+			kernel_i => kernel(FILTER_REGS*DATA_WIDTH-1 downto 0),
+			width_i  => registers_width_o,
+			height_i => registers_height_o,
 			data_i   => s_axis_tdata,
 			valid_i  => s_axis_tvalid,
-			ready_o  => s_axis_tready,
+			ready_o  => convolver_ready_o,
 			last_i   => s_axis_tlast,
 			data_o   => convolver_data_o,
 			valid_o  => convolver_valid_o,
@@ -195,39 +446,317 @@ begin
 			last_o   => convolver_last_o
 		);
 
-	relu_inst: relu
-		generic map (
-			DATA_WIDTH => DATA_WIDTH
-		)
-		port map (
-			data_i => convolver_data_o,
-			data_o => relu_data_o
-		);
+	relu_gen: for lane in 0 to CHANNEL_LANES-1 generate
+		relu_inst: relu
+			generic map (
+				DATA_WIDTH => DATA_WIDTH
+			)
+			port map (
+				data_i => convolver_data_o((lane + 1)*DATA_WIDTH-1 downto lane*DATA_WIDTH),
+				data_o => relu_data_o((lane + 1)*DATA_WIDTH-1 downto lane*DATA_WIDTH)
+			);
+	end generate;
 
-	pooler_inst: pooler
-		generic map (
-			INPUT_SIZE => (INPUT_SIZE-KERNEL_SIZE+1)/STRIDE,
-			POOL_SIZE  => POOL_SIZE,
-			DATA_WIDTH => DATA_WIDTH
-		)
-		port map (
-			clk_i   => clk_i,
-			rst_i   => not rstn_i,
-			data_i  => relu_data_o,
-			valid_i => convolver_valid_o,
-			ready_o => pooler_ready_o,
-			last_i  => convolver_last_o,
-			data_o  => m_axis_tdata,
-			valid_o => m_axis_tvalid,
-			ready_i => m_axis_tready,
-			last_o  => m_axis_tlast
-		);
+	-- Stage Modes (ReLU acts on the convolver output, so its setting changes
+	-- where that stream crosses a frame boundary; the pooler latches its own)
+	conv_frame: process(clk_i)
+	begin
+		if rising_edge(clk_i) then
+			if rstn_i = '0' then
+				conv_first  <= '1';
+				relu_enable <= '1';
+			else
+				if (convolver_valid_o and pooler_ready_o) = '1' then
+					conv_first <= convolver_last_o;
+				end if;
+				if conv_first = '1' then
+					relu_enable <= registers_stages_o(0);
+				end if;
+			end if;
+		end if;
+	end process conv_frame;
+
+	relu_on     <= registers_stages_o(0) when conv_first = '1' else relu_enable;
+	stage_data  <= relu_data_o when relu_on = '1' else convolver_data_o;
+	pool_stride <= "0000" & registers_stages_o(11 downto 8);
+
+	-- Convolution lane l ends at input lane l, so column 0 sits in lane K-1.
+	-- One pooler per filter; they see identical handshakes and stay in
+	-- lockstep, so the first one drives the shared control signals
+	pooler_gen: for f in 0 to NUM_FILTERS-1 generate
+
+		-- Signals
+		signal filter_ready : std_logic;
+		signal filter_keep  : std_logic_vector(PIXELS_PER_BEAT-1 downto 0);
+		signal filter_valid : std_logic;
+		signal filter_last  : std_logic;
+
+	begin
+
+		pooler_inst: pooler
+			generic map (
+				INPUT_SIZE      => (INPUT_SIZE-KERNEL_SIZE+1)/STRIDE,
+				POOL_SIZE       => POOL_SIZE,
+				DATA_WIDTH      => DATA_WIDTH,
+				PIXELS_PER_BEAT => PIXELS_PER_BEAT,
+				LANE_OFFSET     => (KERNEL_SIZE-1) mod PIXELS_PER_BEAT
+			)
+			port map (
+				clk_i   => clk_i,
+				rst_i   => not rstn_i,
+				width_i  => conv_width,
+				height_i => conv_height,
+				average_i => registers_stages_o(1),
+				bypass_i  => registers_stages_o(2),
+				stride_i  => pool_stride,
+				data_i  => stage_data((f + 1)*PIXELS_PER_BEAT*DATA_WIDTH-1 downto f*PIXELS_PER_BEAT*DATA_WIDTH),
+				valid_i => convolver_valid_o,
+				ready_o => filter_ready,
+				last_i  => convolver_last_o,
+				data_o  => pooler_data_o((f + 1)*PIXELS_PER_BEAT*DATA_WIDTH-1 downto f*PIXELS_PER_BEAT*DATA_WIDTH),
+				keep_o  => filter_keep,
+				valid_o => filter_valid,
+				ready_i => pooler_ready_i,
+				last_o  => filter_last
+			);
+
+		first_gen: if f = 0 generate
+			pooler_ready_o <= filter_ready;
+			pooler_keep_o  <= filter_keep;
+			pooler_valid_o <= filter_valid;
+			pooler_last_o  <= filter_last;
+		end generate;
+
+	end generate;
+
+	-- A single layer streams the pooler output out
+	layer_gen: if NUM_LAYERS = 1 generate
+		result_data    <= pooler_data_o;
+		result_keep    <= pooler_keep_o;
+		result_valid   <= pooler_valid_o;
+		result_last    <= pooler_last_o;
+		pooler_ready_i <= result_ready;
+		chain_swap     <= kernel_swap;
+	end generate;
+
+	-- Chained layers feed the pooled stream straight into a second
+	-- convolver, so the intermediate map never leaves the fabric. Its input
+	-- dimensions and stage modes come from their own registers, which the
+	-- driver only changes while the instance is idle
+	chain_gen: if NUM_LAYERS = 2 generate
+
+		-- Signals
+		signal chain_on                : std_logic;
+		signal chain_convolver_data_o  : std_logic_vector(DATA_WIDTH-1 downto 0);
+		signal chain_convolver_valid_o : std_logic;
+		signal chain_convolver_ready_o : std_logic;
+		signal chain_convolver_last_o  : std_logic;
+		signal chain_relu_data_o       : std_logic_vector(DATA_WIDTH-1 downto 0);
+		signal chain_stage_data        : std_logic_vector(DATA_WIDTH-1 downto 0);
+		signal chain_pooler_ready_o    : std_logic;
+		signal chain_pooler_data_o     : std_logic_vector(DATA_WIDTH-1 downto 0);
+		signal chain_pooler_keep_o     : std_logic_vector(0 downto 0);
+		signal chain_pooler_valid_o    : std_logic;
+		signal chain_pooler_last_o     : std_logic;
+		signal chain_valid             : std_logic;
+		signal chain_conv_width        : std_logic_vector(15 downto 0);
+		signal chain_conv_height       : std_logic_vector(15 downto 0);
+		signal chain_pool_stride       : std_logic_vector(7 downto 0);
+		signal chain_beat              : std_logic;
+		signal chain_idle              : std_logic;
+
+	begin
+
+		-- The second layer takes its kernel between its own frames, which
+		-- end a pooled frame after the first layer's (its input frame ends
+		-- with the first layer's tlast)
+		chain_beat <= chain_valid and chain_convolver_ready_o;
+		chain_swap <= (chain_idle and not chain_beat) or (chain_beat and pooler_last_o);
+
+		chain_track: process(clk_i)
+		begin
+			if rising_edge(clk_i) then
+				if rstn_i = '0' then
+					chain_idle <= '1';
+				elsif chain_beat = '1' then
+					chain_idle <= pooler_last_o;
+				end if;
+			end if;
+		end process chain_track;
+
+		chain_on    <= registers_chain_o(0);
+		chain_valid <= pooler_valid_o and chain_on;
+
+		chain_conv_width  <= std_logic_vector((unsigned(registers_chain_width_o) - KERNEL_SIZE + 1) / STRIDE);
+		chain_conv_height <= std_logic_vector((unsigned(registers_chain_height_o) - KERNEL_SIZE + 1) / STRIDE);
+
+		chain_convolver_inst: convolver
+			generic map (
+				INPUT_SIZE      => CONV_SIZE,
+				KERNEL_SIZE     => KERNEL_SIZE,
+				STRIDE          => STRIDE,
+				DATA_WIDTH      => DATA_WIDTH,
+				FRACTIONAL_BITS => FRACTIONAL_BITS,
+				LINE_BUFFER_BRAM => LINE_BUFFER_BRAM,
+				PIXELS_PER_BEAT => 1,
+				NUM_FILTERS     => 1
+			)
+			port map (
+				clk_i    => clk_i,
+				rst_i    => not rstn_i,
+				kernel_i => kernel((FILTER_REGS+TAPS)*DATA_WIDTH-1 downto FILTER_REGS*DATA_WIDTH),
+				width_i  => registers_chain_width_o,
+				height_i => registers_chain_height_o,
+				data_i   => pooler_data_o,
+				valid_i  => chain_valid,
+				ready_o  => chain_convolver_ready_o,
+				last_i   => pooler_last_o,
+				data_o   => chain_convolver_data_o,
+				valid_o  => chain_convolver_valid_o,
+				ready_i  => chain_pooler_ready_o,
+				last_o   => chain_convolver_last_o
+			);
+
+		chain_relu_inst: relu
+			generic map (
+				DATA_WIDTH => DATA_WIDTH
+			)
+			port map (
+				data_i => chain_convolver_data_o,
+				data_o => chain_relu_data_o
+			);
+
+		chain_stage_data  <= chain_relu_data_o when registers_chain_stages_o(0) = '1' else chain_convolver_data_o;
+		chain_pool_stride <= "0000" & registers_chain_stages_o(11 downto 8);
+
+		chain_pooler_inst: pooler
+			generic map (
+				INPUT_SIZE      => (CONV_SIZE-KERNEL_SIZE+1)/STRIDE,
+				POOL_SIZE       => POOL_SIZE,
+				DATA_WIDTH      => DATA_WIDTH,
+				PIXELS_PER_BEAT => 1,
+				LANE_OFFSET     => 0
+			)
+			port map (
+				clk_i     => clk_i,
+				rst_i     => not rstn_i,
+				width_i   => chain_conv_width,
+				height_i  => chain_conv_height,
+				average_i => registers_chain_stages_o(1),
+				bypass_i  => registers_chain_stages_o(2),
+				stride_i  => chain_pool_stride,
+				data_i    => chain_stage_data,
+				valid_i   => chain_convolver_valid_o,
+				ready_o   => chain_pooler_ready_o,
+				last_i    => chain_convolver_last_o,
+				data_o    => chain_pooler_data_o,
+				keep_o    => chain_pooler_keep_o,
+				valid_o   => chain_pooler_valid_o,
+				ready_i   => result_ready,
+				last_o    => chain_pooler_last_o
+			);
+
+		-- Route the first layer through the second one while chained
+		result_data    <= chain_pooler_data_o when chain_on = '1' else pooler_data_o;
+		result_keep    <= chain_pooler_keep_o when chain_on = '1' else pooler_keep_o;
+		result_valid   <= chain_pooler_valid_o when chain_on = '1' else pooler_valid_o;
+		result_last    <= chain_pooler_last_o when chain_on = '1' else pooler_last_o;
+		pooler_ready_i <= chain_convolver_ready_o when chain_on = '1' else result_ready;
+
+	end generate;
+
+	-- Interleave channels (pixel lane l carries filters 0 to NUM_FILTERS-1)
+	channel_gen: for lane in 0 to PIXELS_PER_BEAT-1 generate
+		filter_gen: for f in 0 to NUM_FILTERS-1 generate
+			channel_data((lane*NUM_FILTERS + f + 1)*DATA_WIDTH-1 downto (lane*NUM_FILTERS + f)*DATA_WIDTH) <=
+				result_data((f*PIXELS_PER_BEAT + lane + 1)*DATA_WIDTH-1 downto (f*PIXELS_PER_BEAT + lane)*DATA_WIDTH);
+			channel_keep(lane*NUM_FILTERS + f) <= result_keep(lane);
+		end generate;
+	end generate;
+
+	-- One pixel per beat streams straight out
+	single_gen: if CHANNEL_LANES = 1 generate
+		stream_data    <= result_data;
+		stream_valid   <= result_valid;
+		stream_last    <= packet_last;
+		stream_keep    <= (others => '1');
+		result_ready   <= stream_ready;
+	end generate;
+
+	-- Wider beats carry sparse pooled lanes (and several channels per
+	-- pixel) that are packed before output
+	packed_gen: if CHANNEL_LANES > 1 generate
+		packer_inst: packer
+			generic map (
+				DATA_WIDTH      => DATA_WIDTH,
+				PIXELS_PER_BEAT => PIXELS_PER_BEAT,
+				INPUT_LANES     => CHANNEL_LANES
+			)
+			port map (
+				clk_i   => clk_i,
+				rst_i   => not rstn_i,
+				data_i  => channel_data,
+				keep_i  => channel_keep,
+				valid_i => result_valid,
+				ready_o => result_ready,
+				last_i  => packet_last,
+				data_o  => stream_data,
+				keep_o  => stream_keep,
+				valid_o => stream_valid,
+				ready_i => stream_ready,
+				last_o  => stream_last
+			);
+	end generate;
+
+	-- Output FIFO (absorbs short S2MM stalls, so they reach the pooler and
+	-- the input stream only once it fills)
+	fifo_gen: if OUTPUT_FIFO_DEPTH > 0 generate
+		fifo_inst: fifo
+			generic map (
+				DATA_WIDTH => PIXELS_PER_BEAT*DATA_WIDTH,
+				KEEP_WIDTH => PIXELS_PER_BEAT,
+				DEPTH      => OUTPUT_FIFO_DEPTH
+			)
+			port map (
+				clk_i   => clk_i,
+				rst_i   => not rstn_i,
+				data_i  => stream_data,
+				keep_i  => stream_keep,
+				valid_i => stream_valid,
+				ready_o => stream_ready,
+				last_i  => stream_last,
+				data_o  => m_axis_tdata,
+				keep_o  => output_keep,
+				valid_o => output_valid,
+				ready_i => m_axis_tready,
+				last_o  => output_last
+			);
+	end generate;
+
+	direct_gen: if OUTPUT_FIFO_DEPTH = 0 generate
+		m_axis_tdata <= stream_data;
+		output_keep  <= stream_keep;
+		output_valid <= stream_valid;
+		output_last  <= stream_last;
+		stream_ready <= m_axis_tready;
+	end generate;
+
+	m_axis_tvalid <= output_valid;
+	m_axis_tlast  <= output_last;
+
+	-- Byte qualifiers (only a frame's final beat may be partial)
+	keep_gen: for lane in 0 to PIXELS_PER_BEAT-1 generate
+		m_axis_tkeep((lane + 1)*DATA_WIDTH/8-1 downto lane*DATA_WIDTH/8) <= (others => output_keep(lane));
+		m_axis_tstrb((lane + 1)*DATA_WIDTH/8-1 downto lane*DATA_WIDTH/8) <= (others => output_keep(lane));
+	end generate;
 
 	registers_inst: registers
 		generic map (
-			DATA_WIDTH    => DATA_WIDTH,
+			INPUT_SIZE    => INPUT_SIZE,
+			DATA_WIDTH    => AXI_DATA_WIDTH,
 			ADDR_WIDTH    => ADDR_WIDTH,
-			NUM_REGISTERS => NUM_REGISTERS
+			NUM_REGISTERS => NUM_REGISTERS,
+			CHAIN_REGISTERS => TAPS*(NUM_LAYERS-1)
 		)
 		port map (
 			clk_i     => clk_i,
@@ -251,7 +780,23 @@ begin
 			rresp_o   => s_axi_rresp,
 			rvalid_o  => s_axi_rvalid,
 			rready_i  => s_axi_rready,
-			kernel_o  => registers_kernel_o
+			swap_i       => kernel_swap,
+			chain_swap_i => chain_swap,
+			busy_i      => busy,
+			in_stall_i  => input_stall,
+			out_stall_i => output_stall,
+			in_beat_i   => input_beat,
+			out_beat_i  => output_beat,
+			frame_i     => frame_done,
+			kernel_o  => registers_kernel_o,
+			width_o   => registers_width_o,
+			height_o  => registers_height_o,
+			packet_o  => registers_packet_o,
+			stages_o  => registers_stages_o,
+			chain_o        => registers_chain_o,
+			chain_width_o  => registers_chain_width_o,
+			chain_height_o => registers_chain_height_o,
+			chain_stages_o => registers_chain_stages_o
 		);
 
 end rtl;
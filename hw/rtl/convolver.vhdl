@@ -4,27 +4,35 @@ use ieee.numeric_std.all;
 
 entity convolver is
     generic (
-        INPUT_SIZE      : integer := 6;
-        KERNEL_SIZE     : integer := 3;
-        STRIDE          : integer := 1;
-        DATA_WIDTH      : integer := 32;
-        FRACTIONAL_BITS : integer := 12
+        INPUT_SIZE       : integer := 6;
+        KERNEL_SIZE      : integer := 3;
+        STRIDE           : integer := 1;
+        DATA_WIDTH       : integer := 32;
+        FRACTIONAL_BITS  : integer := 12;
+        LINE_BUFFER_BRAM : integer := 0;  -- 0: flip-flop shift registers, 1: block RAM
+        PIXELS_PER_BEAT  : integer := 1;  -- 1, 2 or 4 (more than one requires STRIDE 1)
+        NUM_FILTERS      : integer := 1   -- Kernels applied to every window
     );
     port (
         clk_i        : in  std_logic;
         rst_i        : in  std_logic;
-        
-        -- Kernel
-        kernel_i : in  std_logic_vector((KERNEL_SIZE*KERNEL_SIZE*DATA_WIDTH)-1 downto 0);
-        
-        -- Input Stream Interface
-        data_i  : in  std_logic_vector(DATA_WIDTH-1 downto 0);
+
+        -- Kernels (filter f holds weights f*KERNEL_SIZE*KERNEL_SIZE onwards)
+        kernel_i : in  std_logic_vector((NUM_FILTERS*KERNEL_SIZE*KERNEL_SIZE*DATA_WIDTH)-1 downto 0);
+
+        -- Frame Dimensions (up to INPUT_SIZE, width a multiple of PIXELS_PER_BEAT)
+        width_i  : in  std_logic_vector(15 downto 0);
+        height_i : in  std_logic_vector(15 downto 0);
+
+        -- Input Stream Interface (lane 0 holds the leftmost pixel)
+        data_i  : in  std_logic_vector(PIXELS_PER_BEAT*DATA_WIDTH-1 downto 0);
         valid_i : in  std_logic;
         ready_o : out std_logic;
         last_i  : in  std_logic;
-        
-        -- Output Stream Interface
-        data_o  : out std_logic_vector(DATA_WIDTH-1 downto 0);
+
+        -- Output Stream Interface (filter f fills lanes f*PIXELS_PER_BEAT onwards,
+        -- lane l of each holding the window ending at the input lane l)
+        data_o  : out std_logic_vector(NUM_FILTERS*PIXELS_PER_BEAT*DATA_WIDTH-1 downto 0);
         valid_o : out std_logic;
         ready_i : in  std_logic;
         last_o  : out std_logic
@@ -33,6 +41,15 @@ end entity convolver;
 
 architecture rtl of convolver is
 
+    -- Constants
+    constant LANES      : integer := PIXELS_PER_BEAT;
+    constant TAPS       : integer := KERNEL_SIZE*KERNEL_SIZE;
+    constant ZERO       : std_logic_vector(DATA_WIDTH-1 downto 0) := (others => '0');
+    constant LINE_DEPTH : integer := INPUT_SIZE/PIXELS_PER_BEAT;    -- Beats in the widest row
+    constant HISTORY    : integer := KERNEL_SIZE-1;                 -- Pixels carried from earlier beats
+    constant FIRST_BEAT : integer := (KERNEL_SIZE-1)/PIXELS_PER_BEAT; -- First beat holding a complete window
+    constant DUAL_MAC   : boolean := 3*DATA_WIDTH+1 <= 25 and LANES mod 2 = 0;  -- Lane pairs share a DSP48
+
     -- Functions
     function to_std_logic(b : boolean) return std_logic is
     begin
@@ -42,7 +59,20 @@ architecture rtl of convolver is
             return '0';
         end if;
     end function;
-  
+
+    -- Line buffer tap for a runtime width (one row of beats)
+    function line_tap(width : std_logic_vector) return integer is
+        variable n : integer;
+    begin
+        n := to_integer(unsigned(width))/LANES - 1;
+        if n < 0 then
+            return 0;
+        elsif n > LINE_DEPTH-1 then
+            return LINE_DEPTH-1;
+        end if;
+        return n;
+    end function;
+
     -- Componenets
     component fma is
         generic (
@@ -59,181 +89,314 @@ architecture rtl of convolver is
             y_o   : out std_logic_vector(DATA_WIDTH-1 downto 0)
         );
     end component fma;
-  
+
+    component fma_dual is
+        generic (
+            DATA_WIDTH      : integer := 8;
+            FRACTIONAL_BITS : integer := 4
+        );
+        port (
+            clk_i : in  std_logic;
+            rst_i : in  std_logic;
+            cen_i : in  std_logic;
+            a0_i  : in  std_logic_vector(DATA_WIDTH-1 downto 0);
+            a1_i  : in  std_logic_vector(DATA_WIDTH-1 downto 0);
+            b_i   : in  std_logic_vector(DATA_WIDTH-1 downto 0);
+            c0_i  : in  std_logic_vector(DATA_WIDTH-1 downto 0);
+            c1_i  : in  std_logic_vector(DATA_WIDTH-1 downto 0);
+            y0_o  : out std_logic_vector(DATA_WIDTH-1 downto 0);
+            y1_o  : out std_logic_vector(DATA_WIDTH-1 downto 0)
+        );
+    end component fma_dual;
+
     -- Types
-    type weights_t is array (0 to KERNEL_SIZE*KERNEL_SIZE-1) of std_logic_vector(DATA_WIDTH-1 downto 0);
+    type weights_t is array (0 to NUM_FILTERS*TAPS-1) of std_logic_vector(DATA_WIDTH-1 downto 0);
     signal weights : weights_t;
-    
-    -- States
-    type state_t is (PROCESSING, DONE);
-    signal state : state_t;
-
-    -- Internal Bus
-    type input_t is array (0 to KERNEL_SIZE-1) of std_logic_vector(DATA_WIDTH-1 downto 0);
-    signal input : input_t;
-    
-    type result_t is array (0 to KERNEL_SIZE-1) of std_logic_vector(DATA_WIDTH-1 downto 0);
-    signal result : result_t;
+
+    -- Row Streams (kernel row r sees the input delayed by KERNEL_SIZE-1-r rows)
+    type rows_t is array (0 to KERNEL_SIZE-1) of std_logic_vector(LANES*DATA_WIDTH-1 downto 0);
+    signal rows : rows_t;
+
+    -- Windows (per kernel row, HISTORY earlier pixels followed by the current lanes)
+    type pixels_t is array (natural range <>) of std_logic_vector(DATA_WIDTH-1 downto 0);
+    subtype window_t is pixels_t(0 to HISTORY+LANES-1);
+    type windows_t is array (0 to KERNEL_SIZE-1) of window_t;
+    signal windows : windows_t;
+
+    -- Results (all filters and lanes)
+    signal result : std_logic_vector(NUM_FILTERS*LANES*DATA_WIDTH-1 downto 0);
 
     -- Registers
     signal valid : std_logic;
     signal last  : std_logic;
 
-    -- Counters
+    -- Counters (col_counter counts beats)
     signal row_counter : unsigned(31 downto 0);
     signal col_counter : unsigned(31 downto 0);
-    
+
+    -- Dimensions
+    signal width  : std_logic_vector(15 downto 0);
+    signal beats  : unsigned(31 downto 0);
+    signal height : unsigned(31 downto 0);
+    signal tap    : integer range 0 to LINE_DEPTH-1;
+
     -- Signals
-    signal enable : std_logic;
-    signal ready  : std_logic;
+    signal enable    : std_logic;
+    signal ready     : std_logic;
+    signal out_free  : std_logic;
+    signal out_valid : std_logic;
 
 begin
-    
+
+    -- Check Configuration
+    assert PIXELS_PER_BEAT = 1 or STRIDE = 1
+        report "PIXELS_PER_BEAT > 1 requires STRIDE = 1" severity failure;
+    assert INPUT_SIZE mod PIXELS_PER_BEAT = 0
+        report "INPUT_SIZE must be a multiple of PIXELS_PER_BEAT" severity failure;
+
     -- Configure weights
-    weights_gen: for i in 0 to KERNEL_SIZE*KERNEL_SIZE-1 generate
+    weights_gen: for i in 0 to NUM_FILTERS*TAPS-1 generate
         weights(i) <= kernel_i((i + 1)*DATA_WIDTH-1 downto (i)*DATA_WIDTH);
     end generate;
 
-    -- Set Initial Value
-    input(0) <= (others => '0');
+    -- The newest row comes straight from the stream
+    rows(KERNEL_SIZE-1) <= data_i;
 
-    -- Configure Internal Signals
-    ready  <= ready_i or not valid;
-    enable <= ready and valid_i;
+    -- Generate Windows (one per kernel row, shared by every filter)
+    gen_windows: for r in 0 to KERNEL_SIZE-1 generate
 
-    -- Generate Pipeline
-    gen_pipeline: for stage in 0 to KERNEL_SIZE-1 generate
-
-        -- Constants
-        constant NUM_CRS : integer := KERNEL_SIZE-1;
-        constant TRUNCATE_MSB : integer := DATA_WIDTH + FRACTIONAL_BITS - 1;
-        constant TRUNCATE_LSB : integer := FRACTIONAL_BITS;
-
-        -- Compute Registers
-        type crs_t is array (0 to NUM_CRS-1) of std_logic_vector(DATA_WIDTH-1 downto 0);
-        signal crs : crs_t;
-        
-        -- Signals
-        type y_t is array (0 to KERNEL_SIZE-1) of std_logic_vector(DATA_WIDTH-1 downto 0);
-        signal y : y_t;
+        -- Registers
+        signal history : pixels_t(0 to HISTORY-1);
 
     begin
 
-        -- Generate FMAs
-        fma_gen: for i in 0 to KERNEL_SIZE-1 generate
-
-            -- First Stage
-            f_gen: if i = 0 generate
-                f_fma_inst: fma
-                    generic map (
-                        DATA_WIDTH      => DATA_WIDTH,
-                        FRACTIONAL_BITS => FRACTIONAL_BITS
-                    )
-                    port map (
-                        clk_i => clk_i,
-                        rst_i => rst_i,
-                        cen_i => enable,
-                        a_i   => data_i,
-                        b_i   => weights(KERNEL_SIZE*stage+i),
-                        c_i   => input(stage),
-                        y_o   => y(i)
-                    );
-            end generate;
-
-            -- Middle Stages
-            m_gen: if i > 0 and i < KERNEL_SIZE-1 generate
-                m_fma_inst: fma
-                    generic map (
-                        DATA_WIDTH      => DATA_WIDTH,
-                        FRACTIONAL_BITS => FRACTIONAL_BITS
-                    )
-                    port map (
-                        clk_i => clk_i,
-                        rst_i => rst_i,
-                        cen_i => enable,
-                        a_i   => data_i,
-                        b_i   => weights(KERNEL_SIZE*stage+i),
-                        c_i   => crs(i-i),
-                        y_o   => y(i)
-                    );
-            end generate;     
-
-            -- Last Stage
-            l_gen: if i = KERNEL_SIZE-1 generate
-                l_fma_inst: fma
-                    generic map (
-                        DATA_WIDTH      => DATA_WIDTH,
-                        FRACTIONAL_BITS => FRACTIONAL_BITS
-                    )
-                    port map (
-                        clk_i => clk_i,
-                        rst_i => rst_i,
-                        cen_i => enable,
-                        a_i   => data_i,
-                        b_i   => weights(KERNEL_SIZE*(stage+1)-1),
-                        c_i   => crs(i-1),
-                        y_o   => y(i)
-                    );
-            end generate;
+        -- Configure Window
+        window_hist_gen: for i in 0 to HISTORY-1 generate
+            windows(r)(i) <= history(i);
+        end generate;
 
+        window_lane_gen: for lane in 0 to LANES-1 generate
+            windows(r)(HISTORY+lane) <= rows(r)((lane + 1)*DATA_WIDTH-1 downto lane*DATA_WIDTH);
         end generate;
 
-        -- Compute Process
-        compute: process(clk_i)
+        -- History Process (keeps the last HISTORY pixels, across rows as well)
+        hist: process(clk_i)
         begin
             if rising_edge(clk_i) then
                 if rst_i = '1' then
-                    for i in 0 to NUM_CRS-1 loop
-                        crs(i) <= (others => '0');
+                    for i in 0 to HISTORY-1 loop
+                        history(i) <= (others => '0');
                     end loop;
                 else
                     if enable = '1' then
-                        for i in 0 to NUM_CRS-1 loop
-                            crs(i) <= y(i);                           
+                        for i in 0 to HISTORY-1 loop
+                            history(i) <= windows(r)(LANES+i);
                         end loop;
                     end if;
                 end if;
             end if;
-        end process compute;
+        end process hist;
+
+    end generate;
+
+    -- Latch Dimensions as a frame's first beat is accepted (the previous
+    -- frame keeps counting with its own until its last beat)
+    dims: process(clk_i)
+    begin
+        if rising_edge(clk_i) then
+            if rst_i = '1' or (enable = '1' and row_counter = 0 and col_counter = 0) then
+                width  <= width_i;
+                height <= resize(unsigned(height_i), 32);
+            end if;
+        end if;
+    end process dims;
+
+    -- Configure Dimensions
+    beats <= resize(unsigned(width), 32) / LANES;
+    tap   <= line_tap(width);
+
+    -- Configure Internal Signals (the output register takes a new beat when
+    -- empty or being read, and a pending window must move there first)
+    out_free <= ready_i or not out_valid;
+    ready    <= out_free or not valid;
+    enable   <= ready and valid_i;
+
+    -- Generate Filters (one FMA chain per kernel row and lane, each filter
+    -- reading the same windows)
+    gen_filters: for f in 0 to NUM_FILTERS-1 generate
+
+        -- Chains (chain(lane, r, i) feeds tap i of kernel row r, starting at zero)
+        type chains_t is array (0 to LANES-1, 0 to KERNEL_SIZE-1, 0 to KERNEL_SIZE) of std_logic_vector(DATA_WIDTH-1 downto 0);
+        signal chain : chains_t;
+
+    begin
+
+        gen_lanes: for lane in 0 to LANES-1 generate
+            gen_rows: for r in 0 to KERNEL_SIZE-1 generate
 
-        -- Output stage
-        result(stage) <= y(KERNEL_SIZE-1);
+                chain(lane, r, 0) <= ZERO;
 
+                -- Generate FMAs (products are registered as the beat is accepted)
+                fma_gen: for i in 0 to KERNEL_SIZE-1 generate
+
+                    -- One multiplier per product
+                    single_gen: if not DUAL_MAC generate
+                        fma_inst: fma
+                            generic map (
+                                DATA_WIDTH      => DATA_WIDTH,
+                                FRACTIONAL_BITS => FRACTIONAL_BITS
+                            )
+                            port map (
+                                clk_i => clk_i,
+                                rst_i => rst_i,
+                                cen_i => enable,
+                                a_i   => windows(r)(lane+i),
+                                b_i   => weights(f*TAPS + KERNEL_SIZE*r + i),
+                                c_i   => chain(lane, r, i),
+                                y_o   => chain(lane, r, i+1)
+                            );
+                    end generate;
+
+                    -- Neighbouring lanes apply the same weight, so an even
+                    -- lane computes its odd neighbour's product as well
+                    dual_gen: if DUAL_MAC and lane mod 2 = 0 generate
+                        fma_inst: fma_dual
+                            generic map (
+                                DATA_WIDTH      => DATA_WIDTH,
+                                FRACTIONAL_BITS => FRACTIONAL_BITS
+                            )
+                            port map (
+                                clk_i => clk_i,
+                                rst_i => rst_i,
+                                cen_i => enable,
+                                a0_i  => windows(r)(lane+i),
+                                a1_i  => windows(r)(lane+1+i),
+                                b_i   => weights(f*TAPS + KERNEL_SIZE*r + i),
+                                c0_i  => chain(lane, r, i),
+                                c1_i  => chain(lane+1, r, i),
+                                y0_o  => chain(lane, r, i+1),
+                                y1_o  => chain(lane+1, r, i+1)
+                            );
+                    end generate;
+
+                end generate;
+
+            end generate;
+
+            -- Add the kernel rows (each product is truncated on its own, so
+            -- the order of the additions does not change the result)
+            add: process(chain)
+                variable acc : signed(DATA_WIDTH-1 downto 0);
+            begin
+                acc := signed(chain(lane, 0, KERNEL_SIZE));
+                for r in 1 to KERNEL_SIZE-1 loop
+                    acc := acc + signed(chain(lane, r, KERNEL_SIZE));
+                end loop;
+                result((f*LANES + lane + 1)*DATA_WIDTH-1 downto (f*LANES + lane)*DATA_WIDTH) <= std_logic_vector(acc);
+            end process add;
+
+        end generate;
     end generate;
 
-    -- Generate Shift Registers
-    gen_srs: for stage in 0 to KERNEL_SIZE-2 generate
+    -- Generate Line Buffers (each delays the row below it by one row of beats)
+    gen_lines: for r in 0 to KERNEL_SIZE-2 generate
+    begin
 
-        -- Constants
-        constant NUM_SRS : integer := INPUT_SIZE-KERNEL_SIZE+1;
-        
         -- Shift Registers
-        type srs_t is array (0 to NUM_SRS-1) of std_logic_vector(DATA_WIDTH-1 downto 0);
-        signal srs : srs_t;
-        
-    begin
-        
-        -- Shift Register Process
-        sr: process(clk_i)
+        gen_srs: if LINE_BUFFER_BRAM = 0 generate
+
+            -- Shift Registers
+            type srs_t is array (0 to LINE_DEPTH-1) of std_logic_vector(LANES*DATA_WIDTH-1 downto 0);
+            signal srs : srs_t;
+
         begin
-            if rising_edge(clk_i) then
-                if rst_i = '1' then
-                    for i in 0 to NUM_SRS-1 loop
-                        srs(i) <= (others => '0');
-                    end loop;
-                else
-                    if enable = '1' then
-                        srs(0) <= result(stage);
-                        for i in 1 to NUM_SRS-1 loop
-                            srs(i) <= srs(i-1);
+
+            -- Shift Register Process
+            sr: process(clk_i)
+            begin
+                if rising_edge(clk_i) then
+                    if rst_i = '1' then
+                        for i in 0 to LINE_DEPTH-1 loop
+                            srs(i) <= (others => '0');
                         end loop;
+                    else
+                        if enable = '1' then
+                            srs(0) <= rows(r+1);
+                            for i in 1 to LINE_DEPTH-1 loop
+                                srs(i) <= srs(i-1);
+                            end loop;
+                        end if;
                     end if;
                 end if;
-            end if;
-        end process sr;
+            end process sr;
+
+            -- Output Assignment (delay line shortened to the runtime width)
+            rows(r) <= srs(tap);
+
+        end generate;
+
+        -- Block RAM circular buffer returning what srs(tap) would hold
+        gen_bram: if LINE_BUFFER_BRAM /= 0 generate
+
+            -- Memory
+            type ram_t is array (0 to LINE_DEPTH-1) of std_logic_vector(LANES*DATA_WIDTH-1 downto 0);
+            signal ram : ram_t := (others => (others => '0'));
 
-        -- Output Assignment
-        input(stage+1) <= srs(NUM_SRS-1);
+            -- Pointers
+            signal wr_ptr : integer range 0 to LINE_DEPTH-1;
+            signal rd_ptr : integer range 0 to LINE_DEPTH-1;
+
+            -- Registers
+            signal rd_data     : std_logic_vector(LANES*DATA_WIDTH-1 downto 0) := (others => '0');
+            signal bypass_data : std_logic_vector(LANES*DATA_WIDTH-1 downto 0);
+            signal bypass      : std_logic;
+
+        begin
+
+            -- Synchronous read one cycle ahead: the entry the shift register
+            -- would expose after this edge (shifted if enabled, held if not)
+            rd_ptr <= (wr_ptr - tap) mod LINE_DEPTH when enable = '1' else
+                      (wr_ptr - tap - 1) mod LINE_DEPTH;
+
+            -- Memory Process (no reset so it maps to block RAM)
+            mem: process(clk_i)
+            begin
+                if rising_edge(clk_i) then
+                    if enable = '1' then
+                        ram(wr_ptr) <= rows(r+1);
+                    end if;
+                    rd_data <= ram(rd_ptr);
+                end if;
+            end process mem;
+
+            -- Pointer Process
+            ptr: process(clk_i)
+            begin
+                if rising_edge(clk_i) then
+                    if rst_i = '1' then
+                        wr_ptr      <= 0;
+                        bypass      <= '0';
+                        bypass_data <= (others => '0');
+                    else
+                        if enable = '1' then
+                            if wr_ptr = LINE_DEPTH-1 then
+                                wr_ptr <= 0;
+                            else
+                                wr_ptr <= wr_ptr + 1;
+                            end if;
+                            bypass_data <= rows(r+1);
+                        end if;
+
+                        -- A zero-length delay reads the entry being written
+                        bypass <= to_std_logic(enable = '1' and tap = 0);
+                    end if;
+                end if;
+            end process ptr;
+
+            -- Output Assignment
+            rows(r) <= bypass_data when bypass = '1' else rd_data;
+
+        end generate;
 
     end generate;
 
@@ -249,39 +412,39 @@ begin
                 col_counter <= (others => '0');
             else
                 if enable = '1' then
-            
+
                     -- Defaults
                     valid <= '0';
                     last  <= '0';
-    
+
                     -- Update counter
                     col_counter <= col_counter + 1;
-                    if (col_counter = INPUT_SIZE-1) then
+                    if (col_counter = beats-1) then
                         row_counter <= row_counter + 1;
                         col_counter <= (others => '0');
                     end if;
-    
-                    -- Set valid
-                    if (row_counter >= KERNEL_SIZE-1 and col_counter >= KERNEL_SIZE-1 and (row_counter - KERNEL_SIZE + 1) mod STRIDE = 0 and (col_counter - KERNEL_SIZE + 1) mod STRIDE = 0) then
+
+                    -- Set valid (beat holds at least one complete window)
+                    if (row_counter >= KERNEL_SIZE-1 and col_counter >= FIRST_BEAT and (row_counter - KERNEL_SIZE + 1) mod STRIDE = 0 and (col_counter - FIRST_BEAT) mod STRIDE = 0) then
                         valid <= '1';
                     end if;
-            
+
                     -- Set last
-                    if (row_counter = INPUT_SIZE - STRIDE and col_counter = INPUT_SIZE - STRIDE) then
+                    if (row_counter = height - STRIDE and col_counter = beats - STRIDE) then
                         last  <= '1';
                     end if;
-    
+
                     -- End computation
-                    if (row_counter = INPUT_SIZE-1 and col_counter = INPUT_SIZE-1) then
+                    if (row_counter = height-1 and col_counter = beats-1) then
                         row_counter <= (others => '0');
                         col_counter <= (others => '0');
                     end if;
-                    
-                elsif ready_i = '1' then
+
+                elsif out_free = '1' then
                     valid <= '0';
                     last  <= '0';
                 end if;
-                
+
             end if;
         end if;
     end process ctrl;
@@ -291,20 +454,21 @@ begin
     begin
         if rising_edge(clk_i) then
             if rst_i = '1' then
-                data_o  <= (others => '0');
-                valid_o <= '0';
-                last_o  <= '0';
+                data_o    <= (others => '0');
+                out_valid <= '0';
+                last_o    <= '0';
             else
-                if enable = '1' or ready_i = '1' then
-                    data_o  <= result(KERNEL_SIZE-1);
-                    valid_o <= valid;
-                    last_o  <= last;
+                if out_free = '1' then
+                    data_o    <= result;
+                    out_valid <= valid;
+                    last_o    <= last;
                 end if;
             end if;
-        end if;        
+        end if;
     end process;
 
     -- Output Assignements
+    valid_o <= out_valid;
     ready_o <= ready;
 
-end architecture rtl;
\ No newline at end of file
+end architecture rtl;
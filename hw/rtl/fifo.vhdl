@@ -0,0 +1,120 @@
+library ieee;
+use ieee.std_logic_1164.all;
+use ieee.numeric_std.all;
+
+-- First-word-fall-through stream FIFO. Holds up to DEPTH beats with their
+-- keep and last qualifiers, accepting and releasing one beat per cycle, so
+-- a short stall on the output side does not reach the input until the
+-- FIFO fills.
+entity fifo is
+    generic (
+        DATA_WIDTH : integer := 32;
+        KEEP_WIDTH : integer := 1;
+        DEPTH      : integer := 16
+    );
+    port (
+        clk_i   : in  std_logic;
+        rst_i   : in  std_logic;
+        data_i  : in  std_logic_vector(DATA_WIDTH-1 downto 0);
+        keep_i  : in  std_logic_vector(KEEP_WIDTH-1 downto 0);
+        valid_i : in  std_logic;
+        ready_o : out std_logic;
+        last_i  : in  std_logic;
+        data_o  : out std_logic_vector(DATA_WIDTH-1 downto 0);
+        keep_o  : out std_logic_vector(KEEP_WIDTH-1 downto 0);
+        valid_o : out std_logic;
+        ready_i : in  std_logic;
+        last_o  : out std_logic
+    );
+end entity fifo;
+
+architecture rtl of fifo is
+
+    -- Constants
+    constant ENTRY_WIDTH : integer := DATA_WIDTH + KEEP_WIDTH + 1;  -- Data, keep, last
+
+    -- Memory (no reset, so it maps to distributed RAM)
+    type ram_t is array (0 to DEPTH-1) of std_logic_vector(ENTRY_WIDTH-1 downto 0);
+    signal ram : ram_t;
+
+    -- Registers
+    signal wr_ptr : integer range 0 to DEPTH-1;
+    signal rd_ptr : integer range 0 to DEPTH-1;
+    signal count  : integer range 0 to DEPTH;
+
+    -- Signals
+    signal entry  : std_logic_vector(ENTRY_WIDTH-1 downto 0);
+    signal head   : std_logic_vector(ENTRY_WIDTH-1 downto 0);
+    signal ready  : std_logic;
+    signal valid  : std_logic;
+    signal push   : std_logic;
+    signal pop    : std_logic;
+
+begin
+
+    -- Check Configuration
+    assert DEPTH >= 1
+        report "DEPTH must be at least 1" severity failure;
+
+    -- Configure Signals (a full FIFO accepts nothing, even while one beat
+    -- leaves, so ready_o does not depend on ready_i)
+    ready <= '1' when count < DEPTH else '0';
+    valid <= '1' when count > 0 else '0';
+    push  <= valid_i and ready;
+    pop   <= valid and ready_i;
+
+    entry <= last_i & keep_i & data_i;
+    head  <= ram(rd_ptr);
+
+    -- Memory Process
+    mem: process(clk_i)
+    begin
+        if rising_edge(clk_i) then
+            if push = '1' then
+                ram(wr_ptr) <= entry;
+            end if;
+        end if;
+    end process mem;
+
+    -- Pointer Process
+    ptr: process(clk_i)
+    begin
+        if rising_edge(clk_i) then
+            if rst_i = '1' then
+                wr_ptr <= 0;
+                rd_ptr <= 0;
+                count  <= 0;
+            else
+                if push = '1' then
+                    if wr_ptr = DEPTH-1 then
+                        wr_ptr <= 0;
+                    else
+                        wr_ptr <= wr_ptr + 1;
+                    end if;
+                end if;
+
+                if pop = '1' then
+                    if rd_ptr = DEPTH-1 then
+                        rd_ptr <= 0;
+                    else
+                        rd_ptr <= rd_ptr + 1;
+                    end if;
+                end if;
+
+                if push = '1' and pop = '0' then
+                    count <= count + 1;
+                elsif push = '0' and pop = '1' then
+                    count <= count - 1;
+                end if;
+            end if;
+        end if;
+    end process ptr;
+
+    -- Output Assignments
+    data_o  <= head(DATA_WIDTH-1 downto 0);
+    keep_o  <= head(DATA_WIDTH+KEEP_WIDTH-1 downto DATA_WIDTH);
+    last_o  <= head(ENTRY_WIDTH-1);
+    valid_o <= valid;
+    ready_o <= ready;
+
+end architecture rtl;
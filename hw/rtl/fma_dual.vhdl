@@ -0,0 +1,82 @@
+library ieee;
+use ieee.std_logic_1164.all;
+use ieee.numeric_std.all;
+
+-- Two FMAs sharing the multiplier operand b. Both a operands are packed into
+-- one (3*DATA_WIDTH+1)-bit factor, so a single multiplication yields both
+-- products; for DATA_WIDTH <= 8 this fits one DSP48 (25x18). Results match
+-- two fma instances bit for bit.
+entity fma_dual is
+    generic (
+        DATA_WIDTH      : integer := 8;
+        FRACTIONAL_BITS : integer := 4
+    );
+    port (
+        clk_i : in  std_logic;
+        rst_i : in  std_logic;
+        cen_i : in  std_logic;
+        a0_i  : in  std_logic_vector(DATA_WIDTH-1 downto 0);
+        a1_i  : in  std_logic_vector(DATA_WIDTH-1 downto 0);
+        b_i   : in  std_logic_vector(DATA_WIDTH-1 downto 0);
+        c0_i  : in  std_logic_vector(DATA_WIDTH-1 downto 0);
+        c1_i  : in  std_logic_vector(DATA_WIDTH-1 downto 0);
+        y0_o  : out std_logic_vector(DATA_WIDTH-1 downto 0);
+        y1_o  : out std_logic_vector(DATA_WIDTH-1 downto 0)
+    );
+end entity fma_dual;
+
+architecture dataflow of fma_dual is
+
+    -- Constants
+    constant SHIFT        : integer := 2*DATA_WIDTH;  -- Each product fits 2*DATA_WIDTH bits
+    constant PACKED_WIDTH : integer := 3*DATA_WIDTH + 1;
+    constant TRUNCATE_MSB : integer := DATA_WIDTH + FRACTIONAL_BITS - 1;
+    constant TRUNCATE_LSB : integer := FRACTIONAL_BITS;
+
+    -- Registers
+    signal product : signed(PACKED_WIDTH+DATA_WIDTH-1 downto 0);
+
+    -- Signals
+    signal packed   : signed(PACKED_WIDTH-1 downto 0);
+    signal product0 : signed(SHIFT-1 downto 0);
+    signal product1 : signed(SHIFT-1 downto 0);
+    signal borrow   : signed(SHIFT-1 downto 0);
+    signal sum0     : signed(SHIFT-1 downto 0);
+    signal sum1     : signed(SHIFT-1 downto 0);
+
+begin
+
+    -- Packing (a1 * 2^SHIFT + a0, pre-adder friendly)
+    packed <= shift_left(resize(signed(a1_i), PACKED_WIDTH), SHIFT) + resize(signed(a0_i), PACKED_WIDTH);
+
+    -- Compute Process
+    calc: process(clk_i)
+    begin
+        if rising_edge(clk_i) then
+            if rst_i = '1' then
+                product <= (others => '0');
+            else
+                if cen_i = '1' then
+
+                    -- Multiplication
+                    product <= packed * signed(b_i);
+
+                end if;
+            end if;
+        end if;
+    end process calc;
+
+    -- Unpacking (a negative low product borrows one from the high one)
+    product0 <= product(SHIFT-1 downto 0);
+    borrow   <= (0 => product(SHIFT-1), others => '0');
+    product1 <= product(2*SHIFT-1 downto SHIFT) + borrow;
+
+    -- Addition
+    sum0 <= product0 + shift_left(resize(signed(c0_i), SHIFT), FRACTIONAL_BITS);
+    sum1 <= product1 + shift_left(resize(signed(c1_i), SHIFT), FRACTIONAL_BITS);
+
+    -- Truncation
+    y0_o <= std_logic_vector(sum0(TRUNCATE_MSB downto TRUNCATE_LSB));
+    y1_o <= std_logic_vector(sum1(TRUNCATE_MSB downto TRUNCATE_LSB));
+
+end architecture dataflow;
@@ -0,0 +1,119 @@
+library ieee;
+use ieee.std_logic_1164.all;
+use ieee.numeric_std.all;
+
+-- Packs the kept lanes of each input beat, in lane order, into full output
+-- beats. The beat closing a frame (last_i) flushes the remainder as a
+-- partial beat with keep_o marking the valid lanes. Input beats may be wider
+-- than output beats (several filters per pixel), which stalls the input
+-- while the buffer drains.
+entity packer is
+    generic (
+        DATA_WIDTH      : integer := 32;
+        PIXELS_PER_BEAT : integer := 2;  -- Output lanes
+        INPUT_LANES     : integer := 2
+    );
+    port (
+        clk_i   : in  std_logic;
+        rst_i   : in  std_logic;
+        data_i  : in  std_logic_vector(INPUT_LANES*DATA_WIDTH-1 downto 0);
+        keep_i  : in  std_logic_vector(INPUT_LANES-1 downto 0);
+        valid_i : in  std_logic;
+        ready_o : out std_logic;
+        last_i  : in  std_logic;
+        data_o  : out std_logic_vector(PIXELS_PER_BEAT*DATA_WIDTH-1 downto 0);
+        keep_o  : out std_logic_vector(PIXELS_PER_BEAT-1 downto 0);
+        valid_o : out std_logic;
+        ready_i : in  std_logic;
+        last_o  : out std_logic
+    );
+end entity packer;
+
+architecture rtl of packer is
+
+    -- Constants
+    constant LANES : integer := PIXELS_PER_BEAT;
+    constant DEPTH : integer := INPUT_LANES + LANES;
+
+    -- Types
+    type buffer_t is array (0 to DEPTH-1) of std_logic_vector(DATA_WIDTH-1 downto 0);
+
+    -- Registers
+    signal buf   : buffer_t;
+    signal count : integer range 0 to DEPTH;
+    signal flush : std_logic;  -- Frame closed, drain before accepting the next one
+
+    -- Signals
+    signal ready  : std_logic;
+    signal valid  : std_logic;
+    signal last   : std_logic;
+    signal enable : std_logic;
+    signal output : std_logic;
+
+begin
+
+    -- Configure Signals (room for a whole input beat, and no frame draining)
+    ready  <= '1' when flush = '0' and count <= LANES else '0';
+    valid  <= '1' when count >= LANES or (flush = '1' and count > 0) else '0';
+    last   <= '1' when flush = '1' and count <= LANES else '0';
+    enable <= ready and valid_i;
+    output <= valid and ready_i;
+
+    -- Pack Process
+    pack: process(clk_i)
+        variable v_buf   : buffer_t;
+        variable v_count : integer range 0 to DEPTH;
+    begin
+        if rising_edge(clk_i) then
+            if rst_i = '1' then
+                count <= 0;
+                flush <= '0';
+            else
+                v_buf   := buf;
+                v_count := count;
+
+                -- Remove the beat being sent
+                if output = '1' then
+                    for i in 0 to INPUT_LANES-1 loop
+                        v_buf(i) := buf(i+LANES);
+                    end loop;
+                    if count > LANES then
+                        v_count := count - LANES;
+                    else
+                        v_count := 0;
+                    end if;
+                    if last = '1' then
+                        flush <= '0';
+                    end if;
+                end if;
+
+                -- Append the kept lanes
+                if enable = '1' then
+                    for lane in 0 to INPUT_LANES-1 loop
+                        if keep_i(lane) = '1' then
+                            v_buf(v_count) := data_i((lane + 1)*DATA_WIDTH-1 downto lane*DATA_WIDTH);
+                            v_count := v_count + 1;
+                        end if;
+                    end loop;
+                    if last_i = '1' then
+                        flush <= '1';
+                    end if;
+                end if;
+
+                buf   <= v_buf;
+                count <= v_count;
+            end if;
+        end if;
+    end process pack;
+
+    -- Output Assignments
+    gen_out: for lane in 0 to LANES-1 generate
+        data_o((lane + 1)*DATA_WIDTH-1 downto lane*DATA_WIDTH) <= buf(lane);
+        keep_o(lane) <= '1' when lane < count else '0';
+    end generate;
+
+    valid_o <= valid;
+    last_o  <= last;
+    ready_o <= ready;
+
+end architecture rtl;
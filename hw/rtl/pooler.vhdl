@@ -4,18 +4,29 @@ use ieee.numeric_std.all;
 
 entity pooler is
     generic (
-        INPUT_SIZE : integer := 6;
-        POOL_SIZE  : integer := 2;
-        DATA_WIDTH : integer := 32
+        INPUT_SIZE      : integer := 6;
+        POOL_SIZE       : integer := 2;
+        DATA_WIDTH      : integer := 32;
+        PIXELS_PER_BEAT : integer := 1;
+        LANE_OFFSET     : integer := 0   -- Lane holding column 0 of each row
     );
     port (
         clk_i   : in  std_logic;
         rst_i   : in  std_logic;
-        data_i  : in  std_logic_vector(DATA_WIDTH-1 downto 0);
+        width_i  : in  std_logic_vector(15 downto 0);
+        height_i : in  std_logic_vector(15 downto 0);
+
+        -- Modes (latched with the dimensions at frame boundaries)
+        average_i : in  std_logic;                     -- Window mean (floored) instead of maximum
+        bypass_i  : in  std_logic;                     -- Pass every pixel through (1x1 window)
+        stride_i  : in  std_logic_vector(7 downto 0);  -- Window step, 0 means POOL_SIZE
+
+        data_i  : in  std_logic_vector(PIXELS_PER_BEAT*DATA_WIDTH-1 downto 0);
         valid_i : in  std_logic;
         ready_o : out std_logic;
         last_i  : in  std_logic;
-        data_o  : out std_logic_vector(DATA_WIDTH-1 downto 0);
+        data_o  : out std_logic_vector(PIXELS_PER_BEAT*DATA_WIDTH-1 downto 0);
+        keep_o  : out std_logic_vector(PIXELS_PER_BEAT-1 downto 0);  -- Lanes ending a pooling window
         valid_o : out std_logic;
         ready_i : in  std_logic;
         last_o  : out std_logic
@@ -24,162 +35,350 @@ end entity pooler;
 
 architecture rtl of pooler is
 
+    -- Bits needed to count to n
+    function bits(n : integer) return integer is
+        variable b : integer := 0;
+    begin
+        while 2**b < n loop
+            b := b + 1;
+        end loop;
+        return b;
+    end function;
+
     -- Constants
-    constant MIN_VALUE : std_logic_vector(DATA_WIDTH-1 downto 0) := (DATA_WIDTH-1 => '1', others => '0'); -- Minimum value
+    constant LANES      : integer := PIXELS_PER_BEAT;
+    constant LINE_DEPTH : integer := (INPUT_SIZE+LANE_OFFSET+LANES-1)/LANES;  -- Beats in the widest row
+    constant HISTORY    : integer := POOL_SIZE-1;
+    constant AREA       : integer := POOL_SIZE*POOL_SIZE;
+    constant ACC_WIDTH  : integer := DATA_WIDTH + bits(AREA);  -- Window sums never wrap
+    constant MIN_VALUE  : signed(ACC_WIDTH-1 downto 0) := shift_left(to_signed(-1, ACC_WIDTH), DATA_WIDTH-1);  -- Minimum value
+    constant ZERO       : signed(ACC_WIDTH-1 downto 0) := (others => '0');
+    constant MIN_PIXEL  : std_logic_vector(DATA_WIDTH-1 downto 0) := std_logic_vector(resize(MIN_VALUE, DATA_WIDTH));  -- Minimum pixel
+
+    -- Line buffer tap for a runtime width (one row of beats)
+    function line_tap(beats : unsigned) return integer is
+        variable n : integer;
+    begin
+        n := to_integer(beats) - 1;
+        if n < 0 then
+            return 0;
+        elsif n > LINE_DEPTH-1 then
+            return LINE_DEPTH-1;
+        end if;
+        return n;
+    end function;
 
-    -- Internal Bus
-    type input_t is array (0 to POOL_SIZE) of std_logic_vector(DATA_WIDTH-1 downto 0);
-    signal input : input_t;
-    
-    type result_t is array (0 to POOL_SIZE-1) of std_logic_vector(DATA_WIDTH-1 downto 0);
-    signal result : result_t;
+    -- MAX Function
+    function max(a, b : signed) return signed is
+    begin
+        if a > b then
+            return a;
+        else
+            return b;
+        end if;
+    end function;
+
+    -- Window mean, rounded toward minus infinity like an arithmetic shift
+    function mean(sum : signed) return signed is
+        variable q : signed(sum'range);
+    begin
+        q := sum / AREA;
+        if sum < 0 and resize(q * AREA, sum'length) /= sum then
+            q := q - 1;
+        end if;
+        return q;
+    end function;
+
+    -- Window (HISTORY earlier values followed by the current lanes)
+    type pixels_t is array (natural range <>) of std_logic_vector(DATA_WIDTH-1 downto 0);
+    signal history : pixels_t(0 to HISTORY-1);
+    signal window  : pixels_t(0 to HISTORY+LANES-1);
+
+    -- Internal Bus (all lanes of one pooling row stage, at the widened
+    -- accumulator width)
+    type bus_t is array (0 to POOL_SIZE-1) of std_logic_vector(LANES*ACC_WIDTH-1 downto 0);
+    signal input  : bus_t;
+    signal result : bus_t;
+    signal pooled : std_logic_vector(LANES*DATA_WIDTH-1 downto 0);
 
     -- Registers
-    signal data  : std_logic_vector(DATA_WIDTH-1 downto 0);
+    signal data  : std_logic_vector(LANES*DATA_WIDTH-1 downto 0);
+    signal keep  : std_logic_vector(LANES-1 downto 0);
     signal valid : std_logic;
     signal last  : std_logic;
 
-    -- Counters
+    -- Counters (col_counter counts beats)
     signal row_counter : unsigned(31 downto 0);
     signal col_counter : unsigned(31 downto 0);
-    
+
+    -- Dimensions and Modes (latched copies, and the values in effect,
+    -- which come straight from the inputs on a frame's first beat)
+    signal width_r   : unsigned(31 downto 0);
+    signal height_r  : unsigned(31 downto 0);
+    signal average_r : std_logic;
+    signal bypass_r  : std_logic;
+    signal stride_r  : unsigned(7 downto 0);
+    signal width     : unsigned(31 downto 0);
+    signal height    : unsigned(31 downto 0);
+    signal average   : std_logic;
+    signal bypass    : std_logic;
+    signal step      : unsigned(7 downto 0);   -- Window step
+    signal span      : unsigned(7 downto 0);   -- Window size
+    signal beats     : unsigned(31 downto 0);
+    signal tap       : integer range 0 to LINE_DEPTH-1;
+
+    -- Window Tracking (lanes from this beat's lane 0 to the next window
+    -- end, and rows until the next window row)
+    signal dist          : unsigned(15 downto 0);
+    signal dist_cur      : unsigned(15 downto 0);
+    signal dist_next     : unsigned(15 downto 0);
+    signal row_phase     : unsigned(7 downto 0);
+    signal row_phase_cur : unsigned(7 downto 0);
+
     -- Signals
-    signal ready  : std_logic;
-    signal enable : std_logic;
+    signal ready       : std_logic;
+    signal enable      : std_logic;
+    signal frame_start : std_logic;
+    signal window_row  : std_logic;
+    signal final_row   : std_logic;
+    signal final_beat  : std_logic;
+    signal ends        : std_logic_vector(LANES-1 downto 0);
 
 begin
 
-    -- Set Initial Value
-    input(0) <= MIN_VALUE;
+    -- Set Initial Value (identity of the window reduction)
+    gen_initial: for lane in 0 to LANES-1 generate
+        input(0)((lane + 1)*ACC_WIDTH-1 downto lane*ACC_WIDTH) <= std_logic_vector(ZERO) when average = '1' else std_logic_vector(MIN_VALUE);
+    end generate;
+
+    -- Latch Dimensions and Modes between frames (the registers may already
+    -- hold the next frame's settings while this one drains)
+    frame_start <= '1' when row_counter = 0 and col_counter = 0 else '0';
+
+    dims: process(clk_i)
+    begin
+        if rising_edge(clk_i) then
+            if frame_start = '1' then
+                width_r   <= resize(unsigned(width_i), 32);
+                height_r  <= resize(unsigned(height_i), 32);
+                average_r <= average_i;
+                bypass_r  <= bypass_i;
+                stride_r  <= unsigned(stride_i);
+            end if;
+        end if;
+    end process dims;
+
+    width   <= resize(unsigned(width_i), 32) when frame_start = '1' else width_r;
+    height  <= resize(unsigned(height_i), 32) when frame_start = '1' else height_r;
+    average <= average_i when frame_start = '1' else average_r;
+    bypass  <= bypass_i when frame_start = '1' else bypass_r;
+
+    modes: process(bypass, frame_start, stride_i, stride_r)
+        variable stride : unsigned(7 downto 0);
+    begin
+        if frame_start = '1' then
+            stride := unsigned(stride_i);
+        else
+            stride := stride_r;
+        end if;
+
+        if bypass = '1' then
+            step <= to_unsigned(1, 8);
+            span <= to_unsigned(1, 8);
+        elsif stride = 0 then
+            step <= to_unsigned(POOL_SIZE, 8);
+            span <= to_unsigned(POOL_SIZE, 8);
+        else
+            step <= stride;
+            span <= to_unsigned(POOL_SIZE, 8);
+        end if;
+    end process modes;
+
+    beats <= (width + LANE_OFFSET + LANES - 1) / LANES;
+    tap   <= line_tap(beats);
 
     -- Configure Signals
     ready  <= ready_i or not valid;
     enable <= ready and valid_i;
 
-    -- Generate Pipeline
-    gen_pipeline: for stage in 0 to POOL_SIZE-1 generate
-
-        -- Constants
-        constant NUM_CRS : integer := POOL_SIZE-1;
-
-        -- Compute Registers
-        type crs_t is array (0 to NUM_CRS-1) of std_logic_vector(DATA_WIDTH-1 downto 0);
-        signal crs : crs_t;
+    -- Configure Window
+    window_hist_gen: for i in 0 to HISTORY-1 generate
+        window(i) <= history(i);
+    end generate;
 
-        -- MAX Procedure
-        procedure max(
-            signal a_i : in  std_logic_vector(DATA_WIDTH-1 downto 0);
-            signal b_i : in  std_logic_vector(DATA_WIDTH-1 downto 0);
-            signal y_o : out std_logic_vector(DATA_WIDTH-1 downto 0)) is
-        begin
-            if signed(a_i) > signed(b_i) then
-                y_o <= a_i;
-            else
-                y_o <= b_i;
-            end if;
-        end procedure;
+    window_lane_gen: for lane in 0 to LANES-1 generate
+        window(HISTORY+lane) <= data_i((lane + 1)*DATA_WIDTH-1 downto lane*DATA_WIDTH);
+    end generate;
 
+    -- History Process
+    hist: process(clk_i)
     begin
-
-        -- Compute Process
-        compute: process(clk_i)
-        begin
-            if rising_edge(clk_i) then
-                if rst_i = '1' then
-                    for i in 0 to NUM_CRS-1 loop
-                        crs(i) <= (others => '0');
+        if rising_edge(clk_i) then
+            if rst_i = '1' then
+                for i in 0 to HISTORY-1 loop
+                    history(i) <= MIN_PIXEL;
+                end loop;
+            else
+                if enable = '1' then
+                    for i in 0 to HISTORY-1 loop
+                        history(i) <= window(LANES+i);
                     end loop;
-                else
-                    if enable = '1' then
-                        max(data_i, input(stage), crs(0)); -- Initial stage
-                        for i in 1 to NUM_CRS-1 loop 
-                            max(data_i, crs(i-1), crs(i)); -- Middle stages
-                        end loop;
-                    end if;
                 end if;
             end if;
-        end process compute;
+        end if;
+    end process hist;
 
-        -- Output Stage
-        max(data_i, crs(NUM_CRS-1), result(stage));
+    -- Generate Pipeline (one stage per pooling row, one MAX chain per lane)
+    gen_pipeline: for stage in 0 to POOL_SIZE-1 generate
+        gen_lanes: for lane in 0 to LANES-1 generate
 
+            -- Compute (window ending at this lane, merged with the row above)
+            compute: process(window, input, average)
+                variable y : signed(ACC_WIDTH-1 downto 0);
+                variable x : signed(ACC_WIDTH-1 downto 0);
+            begin
+                y := signed(input(stage)((lane + 1)*ACC_WIDTH-1 downto lane*ACC_WIDTH));
+                for i in 0 to POOL_SIZE-1 loop
+                    x := resize(signed(window(lane+i)), ACC_WIDTH);
+                    if average = '1' then
+                        y := y + x;
+                    else
+                        y := max(x, y);
+                    end if;
+                end loop;
+                result(stage)((lane + 1)*ACC_WIDTH-1 downto lane*ACC_WIDTH) <= std_logic_vector(y);
+            end process compute;
+
+        end generate;
     end generate;
-    
+
     -- Generate Shift Registers
     gen_srs: for stage in 0 to POOL_SIZE-2 generate
-   
-        -- Constants
-        constant NUM_SRS : integer := INPUT_SIZE-POOL_SIZE+1;
-        
+
         -- Shift Registers
-        type srs_t is array (0 to NUM_SRS-1) of std_logic_vector(DATA_WIDTH-1 downto 0);
+        type srs_t is array (0 to LINE_DEPTH-1) of std_logic_vector(LANES*ACC_WIDTH-1 downto 0);
         signal srs : srs_t;
-        
+
     begin
-        
+
         -- Shift Register Process
         sr: process(clk_i)
         begin
             if rising_edge(clk_i) then
                 if rst_i = '1' then
-                    for i in 0 to NUM_SRS-1 loop
+                    for i in 0 to LINE_DEPTH-1 loop
                         srs(i) <= (others => '0');
                     end loop;
                 else
                     if enable = '1' then
                         srs(0) <= result(stage);
-                        for i in 1 to NUM_SRS-1 loop
+                        for i in 1 to LINE_DEPTH-1 loop
                             srs(i) <= srs(i-1);
                         end loop;
                     end if;
                 end if;
             end if;
         end process sr;
-        
-        -- Output Assignment
-        input(stage+1) <= srs(NUM_SRS-1);
-        
+
+        -- Output Assignment (delay line shortened to the runtime width)
+        input(stage+1) <= srs(tap);
+
     end generate;
 
+    -- Pooled Lanes (bypass passes the current pixels, windows are reduced
+    -- back to DATA_WIDTH)
+    gen_pooled: for lane in 0 to LANES-1 generate
+        pooled((lane + 1)*DATA_WIDTH-1 downto lane*DATA_WIDTH) <=
+            window(HISTORY+lane) when bypass = '1' else
+            std_logic_vector(resize(mean(signed(result(POOL_SIZE-1)((lane + 1)*ACC_WIDTH-1 downto lane*ACC_WIDTH))), DATA_WIDTH)) when average = '1' else
+            std_logic_vector(resize(signed(result(POOL_SIZE-1)((lane + 1)*ACC_WIDTH-1 downto lane*ACC_WIDTH)), DATA_WIDTH));
+    end generate;
+
+    -- Window End Lanes (lane holds column col_counter*LANES + lane -
+    -- LANE_OFFSET; the first window of a row ends at column span-1, then
+    -- every step columns, so a narrow step may end several per beat)
+    dist_cur <= resize(LANE_OFFSET + span - 1, 16) when col_counter = 0 else dist;
+
+    window_ends: process(dist_cur, step)
+        variable v : unsigned(15 downto 0);
+        variable e : std_logic_vector(LANES-1 downto 0);
+    begin
+        v := dist_cur;
+        e := (others => '0');
+        for k in 0 to LANES-1 loop
+            if v < LANES then
+                e(to_integer(v)) := '1';
+                v := v + step;
+            end if;
+        end loop;
+        ends      <= e;
+        dist_next <= v - LANES;
+    end process window_ends;
+
+    -- Window Rows (the first ends at row span-1, then every step rows)
+    row_phase_cur <= span - 1 when row_counter = 0 else row_phase;
+    window_row    <= '1' when row_phase_cur = 0 else '0';
+
+    -- A trailing row/column that cannot fill a window is dropped, so the
+    -- frame ends on the last complete window
+    final_row  <= '1' when row_counter + step >= height else '0';
+    final_beat <= '1' when dist_next >= resize((beats - 1 - col_counter) * LANES, 16) else '0';
+
     -- Controller
     ctrl: process(clk_i)
     begin
         if rising_edge(clk_i) then
             if rst_i = '1' then
                 data        <= (others => '0');
+                keep        <= (others => '0');
                 valid       <= '0';
                 last        <= '0';
                 row_counter <= (others => '0');
                 col_counter <= (others => '0');
+                dist        <= (others => '0');
+                row_phase   <= (others => '0');
             else
-                if enable = '1' then -- Valid 
-                
+                if enable = '1' then -- Valid
+
                     -- Defaults
-                    data  <= result(POOL_SIZE-1);
+                    data  <= pooled;
+                    keep  <= (others => '0');
                     valid <= '0';
                     last  <= '0';
 
-                    -- Update counters
+                    -- Update counters and window tracking
                     col_counter <= col_counter + 1;
-                    if (col_counter = INPUT_SIZE-1) then
+                    dist        <= dist_next;
+                    if (col_counter = beats-1) then
                         row_counter <= row_counter + 1;
                         col_counter <= (others => '0');
+                        if row_phase_cur = 0 then
+                            row_phase <= step - 1;
+                        else
+                            row_phase <= row_phase_cur - 1;
+                        end if;
                     end if;
 
                     -- Set valid
-                    if ((row_counter - 1) mod POOL_SIZE = 0 and (col_counter - 1) mod POOL_SIZE = 0) then
+                    if (window_row = '1' and ends /= (ends'range => '0')) then
+                        keep  <= ends;
                         valid <= '1';
+
+                        -- Set last
+                        if (final_row = '1' and final_beat = '1') then
+                            last  <= '1';
+                        end if;
                     end if;
-            
-                    -- Set last and end computation
-                    if (row_counter = INPUT_SIZE - 1 and col_counter = INPUT_SIZE - 1) then
-                        last  <= '1';
+
+                    -- End computation
+                    if (row_counter = height - 1 and col_counter = beats - 1) then
                         row_counter <= (others => '0');
                         col_counter <= (others => '0');
                     end if;
-                
+
                 elsif ready_i = '1' then
                     data  <= (others => '0');
+                    keep  <= (others => '0');
                     valid <= '0';
                     last  <= '0';
                 end if;
@@ -187,11 +386,12 @@ begin
             end if;
         end if;
     end process ctrl;
-    
+
     -- Output Assignements
     data_o  <= data;
+    keep_o  <= keep;
     valid_o <= valid;
     last_o  <= last;
     ready_o <= ready;
-    
-end architecture rtl;
\ No newline at end of file
+
+end architecture rtl;
@@ -5,9 +5,11 @@ use ieee.math_real.all;
 
 entity registers is
 	generic (
+		INPUT_SIZE    : integer := 6;
 		DATA_WIDTH	  : integer	:= 32;
-		ADDR_WIDTH	  : integer	:= 6;
-		NUM_REGISTERS : integer := 9
+		ADDR_WIDTH	  : integer	:= 7;
+		NUM_REGISTERS : integer := 9;
+		CHAIN_REGISTERS : integer := 0   -- Trailing kernel registers of a chained second layer
 	);
 	port (
 		clk_i     : in  std_logic;
@@ -42,16 +44,56 @@ entity registers is
 		rvalid_o  : out std_logic;
 		rready_i  : in  std_logic;
 
+		-- Bank Control (a committed upload becomes active at the next
+		-- boundary of the layer it belongs to)
+		swap_i       : in  std_logic;  -- First layer between frames
+		chain_swap_i : in  std_logic;  -- Second layer between frames
+
+		-- Performance Events (each counts the cycles it is high)
+		busy_i      : in  std_logic;  -- Frame in flight
+		in_stall_i  : in  std_logic;  -- Ready for input that is not there
+		out_stall_i : in  std_logic;  -- Output held by backpressure
+		in_beat_i   : in  std_logic;
+		out_beat_i  : in  std_logic;
+		frame_i     : in  std_logic;  -- Last output beat of a frame
+
 		-- Output Interface
-		kernel_o  : out std_logic_vector(DATA_WIDTH*NUM_REGISTERS-1 downto 0)
+		kernel_o  : out std_logic_vector(DATA_WIDTH*NUM_REGISTERS-1 downto 0);
+		width_o   : out std_logic_vector(15 downto 0);
+		height_o  : out std_logic_vector(15 downto 0);
+		packet_o  : out std_logic_vector(15 downto 0);  -- Frames per output packet (tlast)
+		stages_o  : out std_logic_vector(15 downto 0);  -- Post-convolution stage modes
+		chain_o        : out std_logic_vector(15 downto 0);  -- Bit 0 runs the second layer
+		chain_width_o  : out std_logic_vector(15 downto 0);  -- Second layer input dimensions
+		chain_height_o : out std_logic_vector(15 downto 0);
+		chain_stages_o : out std_logic_vector(15 downto 0)   -- Second layer stage modes
 	);
 end entity registers;
 
 architecture rtl of registers is
 
 	-- Constants
+	constant NUM_CONTROL       : integer := 8;
+	constant NUM_COUNTERS      : integer := 6;
+	constant CONFIG_REGISTERS  : integer := NUM_REGISTERS + NUM_CONTROL;
+	constant TOTAL_REGISTERS   : integer := CONFIG_REGISTERS + 1 + NUM_COUNTERS + 1;
+	constant REG_WIDTH         : integer := NUM_REGISTERS;
+	constant REG_HEIGHT        : integer := NUM_REGISTERS + 1;
+	constant REG_PACKET        : integer := NUM_REGISTERS + 2;
+	constant REG_STAGES        : integer := NUM_REGISTERS + 3;  -- Bit 0 ReLU, bit 1 average pool, bit 2 pool bypass, bits 11:8 pool stride
+	constant REG_CHAIN         : integer := NUM_REGISTERS + 4;  -- Bit 0 chains the second layer
+	constant REG_CHAIN_WIDTH   : integer := NUM_REGISTERS + 5;
+	constant REG_CHAIN_HEIGHT  : integer := NUM_REGISTERS + 6;
+	constant REG_CHAIN_STAGES  : integer := NUM_REGISTERS + 7;  -- As REG_STAGES, for the second layer
+	constant REG_PERF_CTRL     : integer := NUM_REGISTERS + 8;  -- Write 1 to bit 0 to latch, bit 1 to clear
+	constant REG_COUNTERS      : integer := NUM_REGISTERS + 9;  -- Latched counters, read-only
+	constant REG_COMMIT        : integer := NUM_REGISTERS + 15; -- Write 1 to bit 0 to commit the shadow bank; reads the pending layers
 	constant ADDR_LSB          : integer := (DATA_WIDTH/32) + 1;
-	constant OPT_MEM_ADDR_BITS : integer := integer(ceil(log2(real(NUM_REGISTERS))));
+	constant OPT_MEM_ADDR_BITS : integer := integer(ceil(log2(real(TOTAL_REGISTERS))));
+	constant MAX_SIZE          : std_logic_vector(DATA_WIDTH-1 downto 0) := std_logic_vector(to_unsigned(INPUT_SIZE, DATA_WIDTH));
+	constant ONE_FRAME         : std_logic_vector(DATA_WIDTH-1 downto 0) := std_logic_vector(to_unsigned(1, DATA_WIDTH));
+	constant DEFAULT_STAGES    : std_logic_vector(DATA_WIDTH-1 downto 0) := std_logic_vector(to_unsigned(1, DATA_WIDTH));  -- ReLU, max pool
+	constant NO_CHAIN          : std_logic_vector(DATA_WIDTH-1 downto 0) := (others => '0');
 
 	-- Write Channel Registers
 	signal awaddr    : std_logic_vector(ADDR_WIDTH-1 downto 0);
@@ -69,9 +111,35 @@ architecture rtl of registers is
 	-- Pointer
 	signal reg_addr : std_logic_vector(ADDR_LSB + OPT_MEM_ADDR_BITS - 1 downto ADDR_LSB);
 	
-	-- Register File
-	type reg_array_t is array (natural range 0 to NUM_REGISTERS-1) of std_logic_vector(DATA_WIDTH-1 downto 0);
+	-- Register File (one kernel per filter and chained layer, then width,
+	-- height, frames per packet, stage modes and the second layer's settings;
+	-- AXI writes land in the shadow bank)
+	type reg_array_t is array (natural range 0 to CONFIG_REGISTERS-1) of std_logic_vector(DATA_WIDTH-1 downto 0);
     signal regs     : reg_array_t;
+    signal active   : reg_array_t;
+
+	-- Performance Counters (active cycles, input stall cycles, output stall
+	-- cycles, input beats, output beats, frames)
+	type counter_array_t is array (natural range 0 to NUM_COUNTERS-1) of unsigned(DATA_WIDTH-1 downto 0);
+	signal counters : counter_array_t;
+	signal latched  : counter_array_t;
+	signal events   : std_logic_vector(NUM_COUNTERS-1 downto 0);
+	signal perf_latch : std_logic;
+	signal perf_clear : std_logic;
+
+	-- Commit (the shadow bank waits for a commit, so an upload split across
+	-- a frame boundary never goes live half-written)
+	signal commit      : std_logic;
+	signal armed       : std_logic;
+	signal chain_armed : std_logic;
+
+	-- Second layer registers (its kernel and input settings swap at its own
+	-- frame boundaries, since it drains after the first layer has moved on)
+	function second_layer(i : integer) return boolean is
+	begin
+		return (i >= NUM_REGISTERS-CHAIN_REGISTERS and i < NUM_REGISTERS) or
+		       i = REG_CHAIN_WIDTH or i = REG_CHAIN_HEIGHT or i = REG_CHAIN_STAGES;
+	end function;
 
 	-- Write State Machine
 	type write_state_t is (WADDR, WDATA);
@@ -103,13 +171,76 @@ begin
 	end process addr_decode;
 
 	-- Kernel Mapping
-    k_map: process(regs)
+    k_map: process(active)
     begin
         for i in 0 to NUM_REGISTERS-1 loop
-            kernel_o((i+1)*DATA_WIDTH-1 downto i*DATA_WIDTH) <= regs(i);
+            kernel_o((i+1)*DATA_WIDTH-1 downto i*DATA_WIDTH) <= active(i);
         end loop;
     end process k_map;
 
+	-- Dimension Mapping (clamped to the synthesized line-buffer depth)
+	width_o  <= active(REG_WIDTH)(15 downto 0) when unsigned(active(REG_WIDTH)) <= INPUT_SIZE else MAX_SIZE(15 downto 0);
+	height_o <= active(REG_HEIGHT)(15 downto 0) when unsigned(active(REG_HEIGHT)) <= INPUT_SIZE else MAX_SIZE(15 downto 0);
+
+	-- Packet and Stage Mapping (tlast closes every frame unless several are
+	-- batched; ReLU and max pooling unless reconfigured)
+	packet_o <= active(REG_PACKET)(15 downto 0);
+	stages_o <= active(REG_STAGES)(15 downto 0);
+
+	-- Chain Mapping (off unless enabled; the second layer's input is at most
+	-- as large as the first)
+	chain_o        <= active(REG_CHAIN)(15 downto 0);
+	chain_width_o  <= active(REG_CHAIN_WIDTH)(15 downto 0) when unsigned(active(REG_CHAIN_WIDTH)) <= INPUT_SIZE else MAX_SIZE(15 downto 0);
+	chain_height_o <= active(REG_CHAIN_HEIGHT)(15 downto 0) when unsigned(active(REG_CHAIN_HEIGHT)) <= INPUT_SIZE else MAX_SIZE(15 downto 0);
+	chain_stages_o <= active(REG_CHAIN_STAGES)(15 downto 0);
+
+	-- Bank Swap (a committed shadow becomes active at frame boundaries)
+	commit <= '1' when wvalid_i = '1' and to_integer(unsigned(reg_addr)) = REG_COMMIT and wstrb_i(0) = '1' and wdata_i(0) = '1' else '0';
+
+	bank_swap: process(clk_i)
+	begin
+		if rising_edge(clk_i) then
+			if rstn_i = '0' then
+				armed       <= '0';
+				chain_armed <= '0';
+				for i in 0 to NUM_REGISTERS-1 loop
+					active(i) <= (others => '0');
+				end loop;
+				active(REG_WIDTH)  <= MAX_SIZE;
+				active(REG_HEIGHT) <= MAX_SIZE;
+				active(REG_PACKET) <= ONE_FRAME;
+				active(REG_STAGES) <= DEFAULT_STAGES;
+				active(REG_CHAIN)        <= NO_CHAIN;
+				active(REG_CHAIN_WIDTH)  <= MAX_SIZE;
+				active(REG_CHAIN_HEIGHT) <= MAX_SIZE;
+				active(REG_CHAIN_STAGES) <= DEFAULT_STAGES;
+			else
+				for i in 0 to CONFIG_REGISTERS-1 loop
+					if second_layer(i) then
+						if chain_swap_i = '1' and chain_armed = '1' then
+							active(i) <= regs(i);
+						end if;
+					elsif swap_i = '1' and armed = '1' then
+						active(i) <= regs(i);
+					end if;
+				end loop;
+
+				if swap_i = '1' then
+					armed <= '0';
+				end if;
+				if chain_swap_i = '1' then
+					chain_armed <= '0';
+				end if;
+
+				-- A commit landing on a swap waits for the next boundary
+				if commit = '1' then
+					armed       <= '1';
+					chain_armed <= '1';
+				end if;
+			end if;
+		end if;
+	end process bank_swap;
+
 	-- Write State Machine
 	write_fsm: process(clk_i)
 	begin
@@ -159,10 +290,18 @@ begin
 				for i in 0 to NUM_REGISTERS-1 loop
 					regs(i) <= (others => '0');
 				end loop;
+				regs(REG_WIDTH)  <= MAX_SIZE;
+				regs(REG_HEIGHT) <= MAX_SIZE;
+				regs(REG_PACKET) <= ONE_FRAME;
+				regs(REG_STAGES) <= DEFAULT_STAGES;
+				regs(REG_CHAIN)        <= NO_CHAIN;
+				regs(REG_CHAIN_WIDTH)  <= MAX_SIZE;
+				regs(REG_CHAIN_HEIGHT) <= MAX_SIZE;
+				regs(REG_CHAIN_STAGES) <= DEFAULT_STAGES;
 			else
 				if (wvalid_i = '1') then
 					reg_index := to_integer(unsigned(reg_addr));
-					if reg_index < NUM_REGISTERS then
+					if reg_index < CONFIG_REGISTERS then
 						for byte_index in 0 to (DATA_WIDTH/8-1) loop
 							if wstrb_i(byte_index) = '1' then
 								regs(reg_index)(byte_index*8+7 downto byte_index*8) <= wdata_i(byte_index*8+7 downto byte_index*8);
@@ -174,6 +313,36 @@ begin
 		end if;
 	end process reg_write;
 
+	-- Counter Control (latching and clearing together snapshots and restarts)
+	perf_latch <= '1' when wvalid_i = '1' and to_integer(unsigned(reg_addr)) = REG_PERF_CTRL and wstrb_i(0) = '1' and wdata_i(0) = '1' else '0';
+	perf_clear <= '1' when wvalid_i = '1' and to_integer(unsigned(reg_addr)) = REG_PERF_CTRL and wstrb_i(0) = '1' and wdata_i(1) = '1' else '0';
+
+	events <= frame_i & out_beat_i & in_beat_i & out_stall_i & in_stall_i & busy_i;
+
+	-- Counter Logic
+	perf_count: process(clk_i)
+	begin
+		if rising_edge(clk_i) then
+			if rstn_i = '0' then
+				for i in 0 to NUM_COUNTERS-1 loop
+					counters(i) <= (others => '0');
+					latched(i)  <= (others => '0');
+				end loop;
+			else
+				for i in 0 to NUM_COUNTERS-1 loop
+					if perf_clear = '1' then
+						counters(i) <= (others => '0');
+					elsif events(i) = '1' then
+						counters(i) <= counters(i) + 1;
+					end if;
+				end loop;
+				if perf_latch = '1' then
+					latched <= counters;
+				end if;
+			end if;
+		end if;
+	end process perf_count;
+
 	-- Read State Machine
 	read_fsm: process(clk_i)
 	begin
@@ -205,13 +374,17 @@ begin
 	end process read_fsm;
 	
 	-- Read Logic
-    reg_read: process(araddr, regs)
+    reg_read: process(araddr, regs, latched, armed, chain_armed)
 		variable reg_index : integer; 
 	begin
 		reg_index := to_integer(unsigned(araddr(ADDR_LSB + OPT_MEM_ADDR_BITS - 1 downto ADDR_LSB)));
 
-		if reg_index < NUM_REGISTERS then
+		if reg_index < CONFIG_REGISTERS then
 			rdata_o <= regs(reg_index);
+		elsif reg_index >= REG_COUNTERS and reg_index < REG_COUNTERS + NUM_COUNTERS then
+			rdata_o <= std_logic_vector(latched(reg_index - REG_COUNTERS));
+		elsif reg_index = REG_COMMIT then
+			rdata_o <= (1 => chain_armed, 0 => armed, others => '0');
 		else
 			rdata_o <= (others => '0');
 		end if;
@@ -0,0 +1,417 @@
+library ieee;
+use ieee.std_logic_1164.all;
+use ieee.numeric_std.all;
+
+library std;
+use std.textio.all;
+
+use work.golden_pkg.all;
+
+-- File-driven accelerator test: programs the kernels of kernel.txt, the
+-- frame size and the stages through AXI4-Lite, streams input.txt and checks
+-- every output pixel against expected.txt of a golden set, with random gaps
+-- in tvalid and tready. scripts/golden_tb.sh sets the generics from the
+-- set's config.json.
+entity accelerator_golden_tb is
+    generic (
+        GOLDEN_DIR        : string  := "golden";
+        ROWS              : integer := 1024;
+        COLS              : integer := 1024;
+        KERNEL_SIZE       : integer := 3;
+        STRIDE            : integer := 1;
+        POOL_SIZE         : integer := 2;
+        POOL_MODE         : integer := 0;      -- 0: max, 1: average, 2: none
+        POOL_STRIDE       : integer := 0;      -- 0 means POOL_SIZE
+        RELU              : boolean := true;
+        DATA_WIDTH        : integer := 32;
+        FRACTIONAL_BITS   : integer := 12;
+        LINE_BUFFER_BRAM  : integer := 1;
+        PIXELS_PER_BEAT   : integer := 1;
+        NUM_FILTERS       : integer := 1;
+        OUTPUT_FIFO_DEPTH : integer := 16;
+        FRAMES            : integer := 1;      -- Times the set is streamed, back to back
+        RANDOM_VALID      : boolean := true;   -- Gaps in the input stream
+        RANDOM_READY      : boolean := true;   -- Backpressure on the output stream
+        SEED              : integer := 1
+    );
+end accelerator_golden_tb;
+
+architecture sim of accelerator_golden_tb is
+
+    -- Constants
+    constant CLK_PERIOD    : time    := 10 ns;
+    constant ADDR_WIDTH    : integer := 12;
+    constant AXI_WIDTH     : integer := 32;
+    constant LANES         : integer := PIXELS_PER_BEAT;
+    constant BEAT_WIDTH    : integer := LANES*DATA_WIDTH;
+    constant LANE_BYTES    : integer := DATA_WIDTH/8;
+    constant NUM_REGISTERS : integer := KERNEL_SIZE*KERNEL_SIZE*NUM_FILTERS;
+    constant REG_WIDTH     : integer := NUM_REGISTERS;
+    constant REG_HEIGHT    : integer := NUM_REGISTERS + 1;
+    constant REG_STAGES    : integer := NUM_REGISTERS + 3;
+    constant REG_COMMIT    : integer := NUM_REGISTERS + 15;
+    constant BEATS         : integer := ROWS*COLS/LANES;
+    constant MAX_REPORTS   : integer := 10;
+
+    -- Stages register (ReLU, average, bypass, stride)
+    function stages return integer is
+        variable value : integer := POOL_STRIDE*256;
+    begin
+        if RELU then
+            value := value + 1;
+        end if;
+        if POOL_MODE = 1 then
+            value := value + 2;
+        elsif POOL_MODE = 2 then
+            value := value + 4;
+        end if;
+        return value;
+    end function;
+
+    -- Component Declaration
+    component accelerator is
+        generic (
+            INPUT_SIZE        : integer := 6;
+            KERNEL_SIZE       : integer := 3;
+            STRIDE            : integer := 1;
+            POOL_SIZE         : integer := 2;
+            DATA_WIDTH        : integer := 32;
+            FRACTIONAL_BITS   : integer := 12;
+            ADDR_WIDTH        : integer := 7;
+            NUM_REGISTERS     : integer := 9;
+            LINE_BUFFER_BRAM  : integer := 0;
+            PIXELS_PER_BEAT   : integer := 1;
+            NUM_FILTERS       : integer := 1;
+            OUTPUT_FIFO_DEPTH : integer := 16
+        );
+        port (
+            clk_i  : in std_logic;
+            rstn_i : in std_logic;
+
+            -- AXI4-Lite Slave Interface
+            s_axi_awaddr  : in  std_logic_vector(ADDR_WIDTH-1 downto 0);
+            s_axi_awprot  : in  std_logic_vector(2 downto 0);
+            s_axi_awvalid : in  std_logic;
+            s_axi_awready : out std_logic;
+            s_axi_wdata   : in  std_logic_vector(31 downto 0);
+            s_axi_wstrb   : in  std_logic_vector(3 downto 0);
+            s_axi_wvalid  : in  std_logic;
+            s_axi_wready  : out std_logic;
+            s_axi_bresp   : out std_logic_vector(1 downto 0);
+            s_axi_bvalid  : out std_logic;
+            s_axi_bready  : in  std_logic;
+            s_axi_araddr  : in  std_logic_vector(ADDR_WIDTH-1 downto 0);
+            s_axi_arprot  : in  std_logic_vector(2 downto 0);
+            s_axi_arvalid : in  std_logic;
+            s_axi_arready : out std_logic;
+            s_axi_rdata   : out std_logic_vector(31 downto 0);
+            s_axi_rresp   : out std_logic_vector(1 downto 0);
+            s_axi_rvalid  : out std_logic;
+            s_axi_rready  : in  std_logic;
+
+            -- AXI4-Stream Slave Interface
+            s_axis_tready : out std_logic;
+            s_axis_tdata  : in  std_logic_vector(PIXELS_PER_BEAT*DATA_WIDTH-1 downto 0);
+            s_axis_tstrb  : in  std_logic_vector((PIXELS_PER_BEAT*DATA_WIDTH/8)-1 downto 0);
+            s_axis_tlast  : in  std_logic;
+            s_axis_tvalid : in  std_logic;
+
+            -- AXI4-Stream Master Interface
+            m_axis_tvalid : out std_logic;
+            m_axis_tdata  : out std_logic_vector(PIXELS_PER_BEAT*DATA_WIDTH-1 downto 0);
+            m_axis_tstrb  : out std_logic_vector((PIXELS_PER_BEAT*DATA_WIDTH/8)-1 downto 0);
+            m_axis_tkeep  : out std_logic_vector((PIXELS_PER_BEAT*DATA_WIDTH/8)-1 downto 0);
+            m_axis_tlast  : out std_logic;
+            m_axis_tready : in  std_logic
+        );
+    end component;
+
+    -- Clock and Reset
+    signal clk_i  : std_logic := '0';
+    signal rstn_i : std_logic := '0';
+
+    -- AXI4-Lite Signals
+    signal s_axi_awaddr  : std_logic_vector(ADDR_WIDTH-1 downto 0) := (others => '0');
+    signal s_axi_awprot  : std_logic_vector(2 downto 0) := (others => '0');
+    signal s_axi_awvalid : std_logic := '0';
+    signal s_axi_awready : std_logic;
+    signal s_axi_wdata   : std_logic_vector(AXI_WIDTH-1 downto 0) := (others => '0');
+    signal s_axi_wstrb   : std_logic_vector((AXI_WIDTH/8)-1 downto 0) := (others => '1');
+    signal s_axi_wvalid  : std_logic := '0';
+    signal s_axi_wready  : std_logic;
+    signal s_axi_bresp   : std_logic_vector(1 downto 0);
+    signal s_axi_bvalid  : std_logic;
+    signal s_axi_bready  : std_logic := '0';
+    signal s_axi_araddr  : std_logic_vector(ADDR_WIDTH-1 downto 0) := (others => '0');
+    signal s_axi_arprot  : std_logic_vector(2 downto 0) := (others => '0');
+    signal s_axi_arvalid : std_logic := '0';
+    signal s_axi_arready : std_logic;
+    signal s_axi_rdata   : std_logic_vector(AXI_WIDTH-1 downto 0);
+    signal s_axi_rresp   : std_logic_vector(1 downto 0);
+    signal s_axi_rvalid  : std_logic;
+    signal s_axi_rready  : std_logic := '0';
+
+    -- AXI4-Stream Signals
+    signal s_axis_tready : std_logic;
+    signal s_axis_tdata  : std_logic_vector(BEAT_WIDTH-1 downto 0) := (others => '0');
+    signal s_axis_tstrb  : std_logic_vector((BEAT_WIDTH/8)-1 downto 0) := (others => '1');
+    signal s_axis_tlast  : std_logic := '0';
+    signal s_axis_tvalid : std_logic := '0';
+    signal m_axis_tvalid : std_logic;
+    signal m_axis_tdata  : std_logic_vector(BEAT_WIDTH-1 downto 0);
+    signal m_axis_tstrb  : std_logic_vector((BEAT_WIDTH/8)-1 downto 0);
+    signal m_axis_tkeep  : std_logic_vector((BEAT_WIDTH/8)-1 downto 0);
+    signal m_axis_tlast  : std_logic;
+    signal m_axis_tready : std_logic := '0';
+
+    -- Timing (cycle at which each frame's first beat was accepted)
+    type cycles_t is array (0 to FRAMES-1) of integer;
+    signal cycle       : integer := 0;
+    signal frame_start : cycles_t := (others => 0);
+
+    signal sim_done     : boolean := false;
+    signal monitor_done : boolean := false;
+    signal mismatches   : integer := 0;
+    signal checked      : integer := 0;
+
+begin
+
+    -- Check Configuration
+    assert COLS mod LANES = 0
+        report "COLS must be a multiple of PIXELS_PER_BEAT" severity failure;
+
+    -- Clock generation
+    clk_proc: process
+    begin
+        while not sim_done loop
+            clk_i <= '0';
+            wait for CLK_PERIOD/2;
+            clk_i <= '1';
+            wait for CLK_PERIOD/2;
+        end loop;
+        wait;
+    end process;
+
+    -- Cycle counter
+    cycle_proc: process(clk_i)
+    begin
+        if rising_edge(clk_i) then
+            cycle <= cycle + 1;
+        end if;
+    end process;
+
+    -- Instantiation
+    DUT: accelerator
+        generic map (
+            INPUT_SIZE        => COLS,
+            KERNEL_SIZE       => KERNEL_SIZE,
+            STRIDE            => STRIDE,
+            POOL_SIZE         => POOL_SIZE,
+            DATA_WIDTH        => DATA_WIDTH,
+            FRACTIONAL_BITS   => FRACTIONAL_BITS,
+            ADDR_WIDTH        => ADDR_WIDTH,
+            NUM_REGISTERS     => NUM_REGISTERS,
+            LINE_BUFFER_BRAM  => LINE_BUFFER_BRAM,
+            PIXELS_PER_BEAT   => PIXELS_PER_BEAT,
+            NUM_FILTERS       => NUM_FILTERS,
+            OUTPUT_FIFO_DEPTH => OUTPUT_FIFO_DEPTH
+        )
+        port map (
+            clk_i         => clk_i,
+            rstn_i        => rstn_i,
+            s_axi_awaddr  => s_axi_awaddr,
+            s_axi_awprot  => s_axi_awprot,
+            s_axi_awvalid => s_axi_awvalid,
+            s_axi_awready => s_axi_awready,
+            s_axi_wdata   => s_axi_wdata,
+            s_axi_wstrb   => s_axi_wstrb,
+            s_axi_wvalid  => s_axi_wvalid,
+            s_axi_wready  => s_axi_wready,
+            s_axi_bresp   => s_axi_bresp,
+            s_axi_bvalid  => s_axi_bvalid,
+            s_axi_bready  => s_axi_bready,
+            s_axi_araddr  => s_axi_araddr,
+            s_axi_arprot  => s_axi_arprot,
+            s_axi_arvalid => s_axi_arvalid,
+            s_axi_arready => s_axi_arready,
+            s_axi_rdata   => s_axi_rdata,
+            s_axi_rresp   => s_axi_rresp,
+            s_axi_rvalid  => s_axi_rvalid,
+            s_axi_rready  => s_axi_rready,
+            s_axis_tready => s_axis_tready,
+            s_axis_tdata  => s_axis_tdata,
+            s_axis_tstrb  => s_axis_tstrb,
+            s_axis_tlast  => s_axis_tlast,
+            s_axis_tvalid => s_axis_tvalid,
+            m_axis_tvalid => m_axis_tvalid,
+            m_axis_tdata  => m_axis_tdata,
+            m_axis_tstrb  => m_axis_tstrb,
+            m_axis_tkeep  => m_axis_tkeep,
+            m_axis_tlast  => m_axis_tlast,
+            m_axis_tready => m_axis_tready
+        );
+
+    -- Stimulus process (registers, then the input frame as often as requested)
+    stim_proc: process
+
+        procedure write_register(index : integer; data : integer) is
+        begin
+            -- Address phase
+            s_axi_awaddr  <= std_logic_vector(to_unsigned(index*(AXI_WIDTH/8), ADDR_WIDTH));
+            s_axi_awvalid <= '1';
+            wait until rising_edge(clk_i) and s_axi_awready = '1';
+            s_axi_awvalid <= '0';
+
+            -- Data phase
+            s_axi_wdata  <= std_logic_vector(to_signed(data, AXI_WIDTH));
+            s_axi_wvalid <= '1';
+            wait until rising_edge(clk_i) and s_axi_wready = '1';
+            s_axi_wvalid <= '0';
+
+            -- Response phase
+            s_axi_bready <= '1';
+            wait until rising_edge(clk_i) and s_axi_bvalid = '1';
+            s_axi_bready <= '0';
+        end procedure;
+
+        file kernel_file : text;
+        file input_file  : text;
+        variable value   : integer;
+        variable pattern : std_logic_vector(7 downto 0) := lfsr_seed(SEED);
+        variable beat    : integer;
+    begin
+        -- Reset
+        rstn_i <= '0';
+        wait for CLK_PERIOD * 5;
+        rstn_i <= '1';
+        wait until rising_edge(clk_i);
+
+        -- Kernels (filter f from register f*KERNEL_SIZE*KERNEL_SIZE), frame and
+        -- stages, then the commit that lets them go live
+        open_values(kernel_file, GOLDEN_DIR, "kernel.txt");
+        for i in 0 to NUM_REGISTERS-1 loop
+            read_value(kernel_file, value);
+            write_register(i, value);
+        end loop;
+        file_close(kernel_file);
+
+        write_register(REG_WIDTH, COLS);
+        write_register(REG_HEIGHT, ROWS);
+        write_register(REG_STAGES, stages);
+        write_register(REG_COMMIT, 1);
+        wait for CLK_PERIOD * 10;
+        wait until rising_edge(clk_i);
+
+        for frame in 0 to FRAMES-1 loop
+            open_values(input_file, GOLDEN_DIR, "input.txt");
+            beat := 0;
+
+            while beat < BEATS loop
+                pattern := lfsr_next(pattern);
+                if RANDOM_VALID and lfsr_hold(pattern) then
+                    s_axis_tvalid <= '0';
+                    wait until rising_edge(clk_i);
+                else
+                    for lane in 0 to LANES-1 loop
+                        read_value(input_file, value);
+                        s_axis_tdata((lane + 1)*DATA_WIDTH-1 downto lane*DATA_WIDTH) <= std_logic_vector(to_signed(value, DATA_WIDTH));
+                    end loop;
+                    s_axis_tvalid <= '1';
+                    if beat = BEATS-1 then
+                        s_axis_tlast <= '1';
+                    else
+                        s_axis_tlast <= '0';
+                    end if;
+                    wait until rising_edge(clk_i) and s_axis_tready = '1';
+                    if beat = 0 then
+                        frame_start(frame) <= cycle;
+                    end if;
+                    beat := beat + 1;
+                end if;
+            end loop;
+
+            file_close(input_file);
+        end loop;
+        s_axis_tvalid <= '0';
+        s_axis_tlast  <= '0';
+
+        -- Drain (generous bound: every output beat stalled by backpressure)
+        if not monitor_done then
+            wait until monitor_done for CLK_PERIOD * (4*BEATS + 1000);
+        end if;
+
+        assert monitor_done
+            report "Timed out with " & integer'image(checked) & " values checked" severity error;
+        assert mismatches = 0
+            report integer'image(mismatches) & " of " & integer'image(checked) & " values differ" severity error;
+        report "Checked " & integer'image(checked) & " values over " & integer'image(FRAMES) & " frames";
+
+        sim_done <= true;
+        wait;
+    end process;
+
+    -- Monitor process (lanes with tkeep set hold the next pixels, channels
+    -- next to each other as in the golden set; tlast closes each frame)
+    monitor_proc: process
+        file expected_file : text;
+        variable expected  : integer;
+        variable actual    : integer;
+        variable errors    : integer := 0;
+        variable total     : integer := 0;
+        variable values    : integer;
+    begin
+        for frame in 0 to FRAMES-1 loop
+            open_values(expected_file, GOLDEN_DIR, "expected.txt");
+            values := 0;
+
+            loop
+                wait until rising_edge(clk_i) and m_axis_tvalid = '1' and m_axis_tready = '1';
+                for lane in 0 to LANES-1 loop
+                    if m_axis_tkeep(lane*LANE_BYTES) = '1' then
+                        read_value(expected_file, expected);
+                        actual := to_integer(signed(m_axis_tdata((lane + 1)*DATA_WIDTH-1 downto lane*DATA_WIDTH)));
+                        if actual /= expected then
+                            errors := errors + 1;
+                            assert errors > MAX_REPORTS
+                                report "Frame " & integer'image(frame) & " value " & integer'image(values) & ": got " &
+                                       integer'image(actual) & ", expected " & integer'image(expected) severity error;
+                        end if;
+                        values := values + 1;
+                    end if;
+                end loop;
+                exit when m_axis_tlast = '1';
+            end loop;
+
+            assert endfile(expected_file)
+                report "Frame " & integer'image(frame) & " ended after " & integer'image(values) & " values" severity error;
+            file_close(expected_file);
+            report_frame(frame, values, cycle - frame_start(frame), BEATS);
+
+            total      := total + values;
+            checked    <= total;
+            mismatches <= errors;
+        end loop;
+
+        monitor_done <= true;
+        wait;
+    end process;
+
+    -- Output backpressure
+    backpressure_proc: process(clk_i)
+        variable pattern : std_logic_vector(7 downto 0) := lfsr_seed(SEED + 97);
+    begin
+        if rising_edge(clk_i) then
+            if rstn_i = '0' or not RANDOM_READY then
+                m_axis_tready <= '1';
+            else
+                pattern := lfsr_next(pattern);
+                if lfsr_hold(pattern) then
+                    m_axis_tready <= '0';
+                else
+                    m_axis_tready <= '1';
+                end if;
+            end if;
+        end if;
+    end process;
+
+end architecture sim;
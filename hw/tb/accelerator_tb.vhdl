@@ -15,8 +15,18 @@ architecture sim of accelerator_tb is
     constant POOL_SIZE       : integer := 2;
     constant DATA_WIDTH      : integer := 32;
     constant FRACTIONAL_BITS : integer := 12;
-    constant ADDR_WIDTH      : integer := 6;
-    constant NUM_REGISTERS   : integer := 9;
+    constant ADDR_WIDTH      : integer := 8;
+    constant NUM_LAYERS      : integer := 2;   -- Both modes: single layer, then chained
+    constant NUM_REGISTERS   : integer := 9*NUM_LAYERS;
+    constant REG_PACKET      : integer := NUM_REGISTERS + 2;
+    constant REG_STAGES      : integer := NUM_REGISTERS + 3;
+    constant REG_CHAIN       : integer := NUM_REGISTERS + 4;
+    constant REG_COMMIT      : integer := NUM_REGISTERS + 15;
+    constant NUM_FRAMES      : integer := 4;   -- Back-to-back frames, each with its own kernel
+    constant FIFO_DEPTH      : integer := 8;   -- Output FIFO of the main DUT (the reference one has none)
+    constant CONV_SIZE       : integer := (INPUT_SIZE-KERNEL_SIZE)/STRIDE+1;
+    constant POOLED_SIZE     : integer := CONV_SIZE/POOL_SIZE;
+    constant CHAIN_SIZE      : integer := ((CONV_SIZE-KERNEL_SIZE)/STRIDE+1)/POOL_SIZE;  -- First layer unpooled
     
     -- Test data constants
     type kernel_array is array (0 to KERNEL_SIZE*KERNEL_SIZE-1) of std_logic_vector(DATA_WIDTH-1 downto 0);
@@ -47,7 +57,9 @@ architecture sim of accelerator_tb is
             DATA_WIDTH      : integer := 32;
             FRACTIONAL_BITS : integer := 12;
             ADDR_WIDTH     : integer := 8;
-            NUM_REGISTERS  : integer := 9
+            NUM_REGISTERS  : integer := 9;
+            NUM_LAYERS     : integer := 1;
+            OUTPUT_FIFO_DEPTH : integer := 16
         );
         port (
             clk_i  : in std_logic;
@@ -85,6 +97,7 @@ architecture sim of accelerator_tb is
             m_axis_tvalid : out std_logic;
             m_axis_tdata  : out std_logic_vector(DATA_WIDTH-1 downto 0);
             m_axis_tstrb  : out std_logic_vector((DATA_WIDTH/8)-1 downto 0);
+            m_axis_tkeep  : out std_logic_vector((DATA_WIDTH/8)-1 downto 0);
             m_axis_tlast  : out std_logic;
             m_axis_tready : in std_logic
         );
@@ -124,10 +137,47 @@ architecture sim of accelerator_tb is
     signal m_axis_tvalid : std_logic;
     signal m_axis_tdata  : std_logic_vector(DATA_WIDTH-1 downto 0);
     signal m_axis_tstrb  : std_logic_vector((DATA_WIDTH/8)-1 downto 0);
+    signal m_axis_tkeep  : std_logic_vector((DATA_WIDTH/8)-1 downto 0);
     signal m_axis_tlast  : std_logic;
     signal m_axis_tready : std_logic := '1';
+
+    -- Reference DUT without the output FIFO (same register writes, its own
+    -- streams, same output backpressure)
+    signal d_s_axi_awready : std_logic;
+    signal d_s_axi_wready  : std_logic;
+    signal d_s_axi_bresp   : std_logic_vector(1 downto 0);
+    signal d_s_axi_bvalid  : std_logic;
+    signal d_s_axi_arready : std_logic;
+    signal d_s_axi_rdata   : std_logic_vector(DATA_WIDTH-1 downto 0);
+    signal d_s_axi_rresp   : std_logic_vector(1 downto 0);
+    signal d_s_axi_rvalid  : std_logic;
+    signal d_s_axis_tready : std_logic;
+    signal d_s_axis_tdata  : std_logic_vector(DATA_WIDTH-1 downto 0) := (others => '0');
+    signal d_s_axis_tlast  : std_logic := '0';
+    signal d_s_axis_tvalid : std_logic := '0';
+    signal d_m_axis_tvalid : std_logic;
+    signal d_m_axis_tdata  : std_logic_vector(DATA_WIDTH-1 downto 0);
+    signal d_m_axis_tstrb  : std_logic_vector((DATA_WIDTH/8)-1 downto 0);
+    signal d_m_axis_tkeep  : std_logic_vector((DATA_WIDTH/8)-1 downto 0);
+    signal d_m_axis_tlast  : std_logic;
+
+    -- Randomized backpressure (bursts of m_axis_tready low, as S2MM write
+    -- hiccups) and the input stall cycles each DUT sees under it
+    signal random_ready  : boolean := false;
+    signal direct_start  : boolean := false;
+    signal direct_done   : boolean := false;
+    signal fifo_stalls   : integer := 0;
+    signal direct_stalls : integer := 0;
+    signal d_out_count   : integer := 0;
     
     signal sim_done : boolean := false;
+    signal frame_outputs : integer := 0;
+
+    -- Every accepted output beat, in order
+    type outputs_t is array (0 to 63) of std_logic_vector(DATA_WIDTH-1 downto 0);
+    signal out_data  : outputs_t;
+    signal out_last  : std_logic_vector(0 to 63);
+    signal out_count : integer := 0;
 
     -- Helper functions
     function to_fixed(real_num : real) return std_logic_vector is
@@ -142,6 +192,105 @@ architecture sim of accelerator_tb is
        return real(to_integer(signed(fixed_num))) / real(2**FRACTIONAL_BITS);
     end function;
 
+    function to_std_logic(b : boolean) return std_logic is
+    begin
+        if b then
+            return '1';
+        else
+            return '0';
+        end if;
+    end function;
+
+    -- Reference for one pooled output of a full frame whose pixels and
+    -- weights are INPUT_DATA and KERNEL_DATA rotated by the given offsets
+    -- (truncated products summed with wrap-around, then ReLU and max pooling)
+    function expected(input_offset, kernel_offset, index : integer) return std_logic_vector is
+        variable product : signed(2*DATA_WIDTH-1 downto 0);
+        variable sum     : signed(DATA_WIDTH-1 downto 0);
+        variable best    : signed(DATA_WIDTH-1 downto 0);
+        variable row     : integer;
+        variable col     : integer;
+    begin
+        best := (others => '0');
+        for py in 0 to POOL_SIZE-1 loop
+            for px in 0 to POOL_SIZE-1 loop
+                row := (index / POOLED_SIZE)*POOL_SIZE + py;
+                col := (index mod POOLED_SIZE)*POOL_SIZE + px;
+                sum := (others => '0');
+                for ky in 0 to KERNEL_SIZE-1 loop
+                    for kx in 0 to KERNEL_SIZE-1 loop
+                        product := signed(INPUT_DATA(((row*STRIDE + ky)*INPUT_SIZE + col*STRIDE + kx + input_offset) mod (INPUT_SIZE*INPUT_SIZE))) *
+                                   signed(KERNEL_DATA((ky*KERNEL_SIZE + kx + kernel_offset) mod (KERNEL_SIZE*KERNEL_SIZE)));
+                        sum := sum + product(FRACTIONAL_BITS+DATA_WIDTH-1 downto FRACTIONAL_BITS);
+                    end loop;
+                end loop;
+                if sum > best then
+                    best := sum;
+                end if;
+            end loop;
+        end loop;
+        return std_logic_vector(best);
+    end function;
+
+    -- Convolution of INPUT_DATA rotated by input_offset with KERNEL_DATA
+    -- rotated by kernel_offset, at convolution output (row, col)
+    function convolve(input_offset, kernel_offset, row, col : integer) return signed is
+        variable product : signed(2*DATA_WIDTH-1 downto 0);
+        variable sum     : signed(DATA_WIDTH-1 downto 0);
+    begin
+        sum := (others => '0');
+        for ky in 0 to KERNEL_SIZE-1 loop
+            for kx in 0 to KERNEL_SIZE-1 loop
+                product := signed(INPUT_DATA(((row*STRIDE + ky)*INPUT_SIZE + col*STRIDE + kx + input_offset) mod (INPUT_SIZE*INPUT_SIZE))) *
+                           signed(KERNEL_DATA((ky*KERNEL_SIZE + kx + kernel_offset) mod (KERNEL_SIZE*KERNEL_SIZE)));
+                sum := sum + product(FRACTIONAL_BITS+DATA_WIDTH-1 downto FRACTIONAL_BITS);
+            end loop;
+        end loop;
+        return sum;
+    end function;
+
+    -- Reference for one output of two chained layers: the first convolves
+    -- and applies ReLU without pooling, the second convolves that map with
+    -- its own kernel, then applies ReLU and max pooling
+    function expected_chain(input_offset, kernel_offset, chain_offset, index : integer) return std_logic_vector is
+        type map_t is array (0 to CONV_SIZE-1, 0 to CONV_SIZE-1) of signed(DATA_WIDTH-1 downto 0);
+        variable layer   : map_t;
+        variable product : signed(2*DATA_WIDTH-1 downto 0);
+        variable sum     : signed(DATA_WIDTH-1 downto 0);
+        variable best    : signed(DATA_WIDTH-1 downto 0);
+        variable row     : integer;
+        variable col     : integer;
+    begin
+        for r in 0 to CONV_SIZE-1 loop
+            for c in 0 to CONV_SIZE-1 loop
+                layer(r, c) := convolve(input_offset, kernel_offset, r, c);
+                if layer(r, c) < 0 then
+                    layer(r, c) := (others => '0');
+                end if;
+            end loop;
+        end loop;
+
+        best := (others => '0');
+        for py in 0 to POOL_SIZE-1 loop
+            for px in 0 to POOL_SIZE-1 loop
+                row := (index / CHAIN_SIZE)*POOL_SIZE + py;
+                col := (index mod CHAIN_SIZE)*POOL_SIZE + px;
+                sum := (others => '0');
+                for ky in 0 to KERNEL_SIZE-1 loop
+                    for kx in 0 to KERNEL_SIZE-1 loop
+                        product := layer(row*STRIDE + ky, col*STRIDE + kx) *
+                                   signed(KERNEL_DATA((ky*KERNEL_SIZE + kx + chain_offset) mod (KERNEL_SIZE*KERNEL_SIZE)));
+                        sum := sum + product(FRACTIONAL_BITS+DATA_WIDTH-1 downto FRACTIONAL_BITS);
+                    end loop;
+                end loop;
+                if sum > best then
+                    best := sum;
+                end if;
+            end loop;
+        end loop;
+        return std_logic_vector(best);
+    end function;
+
     -- Helper procedures
     procedure write_register(
         signal clk      : in  std_logic;
@@ -215,7 +364,9 @@ begin
             DATA_WIDTH      => DATA_WIDTH,
             FRACTIONAL_BITS => FRACTIONAL_BITS,
             ADDR_WIDTH      => ADDR_WIDTH,
-            NUM_REGISTERS   => NUM_REGISTERS
+            NUM_REGISTERS   => NUM_REGISTERS,
+            NUM_LAYERS      => NUM_LAYERS,
+            OUTPUT_FIFO_DEPTH => FIFO_DEPTH
         )
         port map (
             clk_i         => clk_i,
@@ -247,12 +398,64 @@ begin
             m_axis_tvalid => m_axis_tvalid,
             m_axis_tdata  => m_axis_tdata,
             m_axis_tstrb  => m_axis_tstrb,
+            m_axis_tkeep  => m_axis_tkeep,
             m_axis_tlast  => m_axis_tlast,
             m_axis_tready => m_axis_tready
         );
 
+    DUT_DIRECT: accelerator
+        generic map (
+            INPUT_SIZE      => INPUT_SIZE,
+            KERNEL_SIZE     => KERNEL_SIZE,
+            STRIDE          => STRIDE,
+            POOL_SIZE       => POOL_SIZE,
+            DATA_WIDTH      => DATA_WIDTH,
+            FRACTIONAL_BITS => FRACTIONAL_BITS,
+            ADDR_WIDTH      => ADDR_WIDTH,
+            NUM_REGISTERS   => NUM_REGISTERS,
+            NUM_LAYERS      => NUM_LAYERS,
+            OUTPUT_FIFO_DEPTH => 0
+        )
+        port map (
+            clk_i         => clk_i,
+            rstn_i        => rstn_i,
+            s_axi_awaddr  => s_axi_awaddr,
+            s_axi_awprot  => s_axi_awprot,
+            s_axi_awvalid => s_axi_awvalid,
+            s_axi_awready => d_s_axi_awready,
+            s_axi_wdata   => s_axi_wdata,
+            s_axi_wstrb   => s_axi_wstrb,
+            s_axi_wvalid  => s_axi_wvalid,
+            s_axi_wready  => d_s_axi_wready,
+            s_axi_bresp   => d_s_axi_bresp,
+            s_axi_bvalid  => d_s_axi_bvalid,
+            s_axi_bready  => s_axi_bready,
+            s_axi_araddr  => s_axi_araddr,
+            s_axi_arprot  => s_axi_arprot,
+            s_axi_arvalid => s_axi_arvalid,
+            s_axi_arready => d_s_axi_arready,
+            s_axi_rdata   => d_s_axi_rdata,
+            s_axi_rresp   => d_s_axi_rresp,
+            s_axi_rvalid  => d_s_axi_rvalid,
+            s_axi_rready  => s_axi_rready,
+            s_axis_tready => d_s_axis_tready,
+            s_axis_tdata  => d_s_axis_tdata,
+            s_axis_tstrb  => s_axis_tstrb,
+            s_axis_tlast  => d_s_axis_tlast,
+            s_axis_tvalid => d_s_axis_tvalid,
+            m_axis_tvalid => d_m_axis_tvalid,
+            m_axis_tdata  => d_m_axis_tdata,
+            m_axis_tstrb  => d_m_axis_tstrb,
+            m_axis_tkeep  => d_m_axis_tkeep,
+            m_axis_tlast  => d_m_axis_tlast,
+            m_axis_tready => m_axis_tready
+        );
+
     -- Stimulus process
     stim_proc: process
+        variable first    : integer;
+        variable stalls   : integer;
+        variable rotation : integer;
     begin
         -- Reset
         rstn_i <= '0';
@@ -266,6 +469,8 @@ begin
                          s_axi_wvalid, s_axi_bready, i*(DATA_WIDTH/8),
                          KERNEL_DATA(i));
         end loop;
+        write_register(clk_i, s_axi_awaddr, s_axi_awvalid, s_axi_wdata,
+                     s_axi_wvalid, s_axi_bready, REG_COMMIT*(DATA_WIDTH/8), x"00000001");
 
         wait for CLK_PERIOD * 10;
 
@@ -288,6 +493,330 @@ begin
 
         -- Wait for processing completion
         wait for CLK_PERIOD * 50;
+
+        assert frame_outputs = (((INPUT_SIZE-KERNEL_SIZE)/STRIDE+1)/POOL_SIZE)**2
+            report "Full frame: got " & integer'image(frame_outputs) & " outputs" severity error;
+
+        -- Smaller frame on the same bitstream (width and height follow the kernel)
+        write_register(clk_i, s_axi_awaddr, s_axi_awvalid, s_axi_wdata,
+                     s_axi_wvalid, s_axi_bready, NUM_REGISTERS*(DATA_WIDTH/8),
+                     std_logic_vector(to_unsigned(INPUT_SIZE-1, DATA_WIDTH)));
+        write_register(clk_i, s_axi_awaddr, s_axi_awvalid, s_axi_wdata,
+                     s_axi_wvalid, s_axi_bready, (NUM_REGISTERS+1)*(DATA_WIDTH/8),
+                     std_logic_vector(to_unsigned(INPUT_SIZE-1, DATA_WIDTH)));
+        write_register(clk_i, s_axi_awaddr, s_axi_awvalid, s_axi_wdata,
+                     s_axi_wvalid, s_axi_bready, REG_COMMIT*(DATA_WIDTH/8), x"00000001");
+
+        wait for CLK_PERIOD * 10;
+
+        for row in 0 to INPUT_SIZE-2 loop
+            for col in 0 to INPUT_SIZE-2 loop
+                wait until rising_edge(clk_i) and s_axis_tready = '1';
+
+                s_axis_tdata <= INPUT_DATA(row*INPUT_SIZE + col);
+                s_axis_tvalid <= '1';
+
+                if row = INPUT_SIZE-2 and col = INPUT_SIZE-2 then
+                    s_axis_tlast <= '1';
+                end if;
+
+                wait for CLK_PERIOD;
+            end loop;
+        end loop;
+
+        s_axis_tvalid <= '0';
+        s_axis_tlast <= '0';
+
+        wait for CLK_PERIOD * 50;
+
+        assert frame_outputs = (((INPUT_SIZE-1-KERNEL_SIZE)/STRIDE+1)/POOL_SIZE)**2
+            report "Reduced frame: got " & integer'image(frame_outputs) & " outputs" severity error;
+
+        -- Back-to-back frames at full rate: input valid never drops, and the
+        -- next frame's kernel is written into the shadow bank (one register
+        -- per cycle, then the commit) while the current frame streams
+        write_register(clk_i, s_axi_awaddr, s_axi_awvalid, s_axi_wdata,
+                     s_axi_wvalid, s_axi_bready, NUM_REGISTERS*(DATA_WIDTH/8),
+                     std_logic_vector(to_unsigned(INPUT_SIZE, DATA_WIDTH)));
+        write_register(clk_i, s_axi_awaddr, s_axi_awvalid, s_axi_wdata,
+                     s_axi_wvalid, s_axi_bready, (NUM_REGISTERS+1)*(DATA_WIDTH/8),
+                     std_logic_vector(to_unsigned(INPUT_SIZE, DATA_WIDTH)));
+        write_register(clk_i, s_axi_awaddr, s_axi_awvalid, s_axi_wdata,
+                     s_axi_wvalid, s_axi_bready, REG_COMMIT*(DATA_WIDTH/8), x"00000001");
+
+        wait for CLK_PERIOD * 10;
+
+        first  := out_count;
+        stalls := 0;
+        wait until rising_edge(clk_i);
+
+        for frame in 0 to NUM_FRAMES-1 loop
+            for i in 0 to INPUT_SIZE*INPUT_SIZE-1 loop
+                s_axis_tdata  <= INPUT_DATA((i + 7*frame) mod (INPUT_SIZE*INPUT_SIZE));
+                s_axis_tvalid <= '1';
+                s_axis_tlast  <= to_std_logic(i = INPUT_SIZE*INPUT_SIZE-1);
+
+                if frame < NUM_FRAMES-1 and i >= 1 and i <= KERNEL_SIZE*KERNEL_SIZE then
+                    s_axi_awaddr  <= std_logic_vector(to_unsigned((i-1)*(DATA_WIDTH/8), ADDR_WIDTH));
+                    s_axi_wdata   <= KERNEL_DATA((i-1 + frame+1) mod (KERNEL_SIZE*KERNEL_SIZE));
+                    s_axi_awvalid <= '1';
+                    s_axi_wvalid  <= '1';
+                    s_axi_bready  <= '1';
+                elsif frame < NUM_FRAMES-1 and i = KERNEL_SIZE*KERNEL_SIZE+1 then
+                    s_axi_awaddr  <= std_logic_vector(to_unsigned(REG_COMMIT*(DATA_WIDTH/8), ADDR_WIDTH));
+                    s_axi_wdata   <= x"00000001";
+                    s_axi_awvalid <= '1';
+                    s_axi_wvalid  <= '1';
+                    s_axi_bready  <= '1';
+                else
+                    s_axi_awvalid <= '0';
+                    s_axi_wvalid  <= '0';
+                    s_axi_bready  <= '0';
+                end if;
+
+                wait until rising_edge(clk_i);
+                while s_axis_tready = '0' loop
+                    stalls := stalls + 1;
+                    wait until rising_edge(clk_i);
+                end loop;
+            end loop;
+        end loop;
+
+        s_axis_tvalid <= '0';
+        s_axis_tlast  <= '0';
+
+        wait for CLK_PERIOD * 50;
+
+        assert stalls = 0
+            report "Back-to-back frames stalled the input " & integer'image(stalls) & " times" severity error;
+        assert out_count - first = NUM_FRAMES*POOLED_SIZE**2
+            report "Back-to-back frames: got " & integer'image(out_count - first) & " outputs" severity error;
+
+        for frame in 0 to NUM_FRAMES-1 loop
+            for i in 0 to POOLED_SIZE**2-1 loop
+                assert out_data(first + frame*POOLED_SIZE**2 + i) = expected(7*frame, frame, i)
+                    report "Frame " & integer'image(frame) & " output " & integer'image(i) & ": got " &
+                           real'image(to_real(out_data(first + frame*POOLED_SIZE**2 + i))) severity error;
+                assert out_last(first + frame*POOLED_SIZE**2 + i) = to_std_logic(i = POOLED_SIZE**2-1)
+                    report "Frame " & integer'image(frame) & " output " & integer'image(i) & ": wrong tlast" severity error;
+            end loop;
+        end loop;
+
+        -- Two frames per packet: tlast only closes the second frame
+        write_register(clk_i, s_axi_awaddr, s_axi_awvalid, s_axi_wdata,
+                     s_axi_wvalid, s_axi_bready, REG_PACKET*(DATA_WIDTH/8),
+                     std_logic_vector(to_unsigned(2, DATA_WIDTH)));
+        write_register(clk_i, s_axi_awaddr, s_axi_awvalid, s_axi_wdata,
+                     s_axi_wvalid, s_axi_bready, REG_COMMIT*(DATA_WIDTH/8), x"00000001");
+
+        wait for CLK_PERIOD * 10;
+
+        first := out_count;
+        wait until rising_edge(clk_i);
+
+        for frame in 0 to 1 loop
+            for i in 0 to INPUT_SIZE*INPUT_SIZE-1 loop
+                s_axis_tdata  <= INPUT_DATA((i + 7*frame) mod (INPUT_SIZE*INPUT_SIZE));
+                s_axis_tvalid <= '1';
+                s_axis_tlast  <= to_std_logic(i = INPUT_SIZE*INPUT_SIZE-1);
+                wait until rising_edge(clk_i) and s_axis_tready = '1';
+            end loop;
+        end loop;
+
+        s_axis_tvalid <= '0';
+        s_axis_tlast  <= '0';
+
+        wait for CLK_PERIOD * 50;
+
+        assert frame_outputs = 2*POOLED_SIZE**2
+            report "Batched packet: got " & integer'image(frame_outputs) & " outputs" severity error;
+
+        for frame in 0 to 1 loop
+            for i in 0 to POOLED_SIZE**2-1 loop
+                assert out_data(first + frame*POOLED_SIZE**2 + i) = expected(7*frame, NUM_FRAMES-1, i)
+                    report "Batched frame " & integer'image(frame) & " output " & integer'image(i) & " mismatch" severity error;
+            end loop;
+        end loop;
+
+        -- Chained layers: the first keeps ReLU but bypasses pooling, and its
+        -- map feeds the second layer (own kernel, ReLU and max pooling)
+        -- without leaving the accelerator
+        write_register(clk_i, s_axi_awaddr, s_axi_awvalid, s_axi_wdata,
+                     s_axi_wvalid, s_axi_bready, REG_PACKET*(DATA_WIDTH/8),
+                     std_logic_vector(to_unsigned(1, DATA_WIDTH)));
+        write_register(clk_i, s_axi_awaddr, s_axi_awvalid, s_axi_wdata,
+                     s_axi_wvalid, s_axi_bready, REG_STAGES*(DATA_WIDTH/8), x"00000005");
+        for i in 0 to KERNEL_SIZE*KERNEL_SIZE-1 loop
+            write_register(clk_i, s_axi_awaddr, s_axi_awvalid, s_axi_wdata,
+                         s_axi_wvalid, s_axi_bready, (KERNEL_SIZE*KERNEL_SIZE + i)*(DATA_WIDTH/8),
+                         KERNEL_DATA((i + 4) mod (KERNEL_SIZE*KERNEL_SIZE)));
+        end loop;
+        write_register(clk_i, s_axi_awaddr, s_axi_awvalid, s_axi_wdata,
+                     s_axi_wvalid, s_axi_bready, (REG_CHAIN + 1)*(DATA_WIDTH/8),
+                     std_logic_vector(to_unsigned(CONV_SIZE, DATA_WIDTH)));
+        write_register(clk_i, s_axi_awaddr, s_axi_awvalid, s_axi_wdata,
+                     s_axi_wvalid, s_axi_bready, (REG_CHAIN + 2)*(DATA_WIDTH/8),
+                     std_logic_vector(to_unsigned(CONV_SIZE, DATA_WIDTH)));
+        write_register(clk_i, s_axi_awaddr, s_axi_awvalid, s_axi_wdata,
+                     s_axi_wvalid, s_axi_bready, REG_CHAIN*(DATA_WIDTH/8), x"00000001");
+        write_register(clk_i, s_axi_awaddr, s_axi_awvalid, s_axi_wdata,
+                     s_axi_wvalid, s_axi_bready, REG_COMMIT*(DATA_WIDTH/8), x"00000001");
+
+        wait for CLK_PERIOD * 10;
+
+        first := out_count;
+        wait until rising_edge(clk_i);
+
+        for frame in 0 to 1 loop
+            for i in 0 to INPUT_SIZE*INPUT_SIZE-1 loop
+                s_axis_tdata  <= INPUT_DATA((i + 7*frame) mod (INPUT_SIZE*INPUT_SIZE));
+                s_axis_tvalid <= '1';
+                s_axis_tlast  <= to_std_logic(i = INPUT_SIZE*INPUT_SIZE-1);
+                wait until rising_edge(clk_i) and s_axis_tready = '1';
+            end loop;
+        end loop;
+
+        s_axis_tvalid <= '0';
+        s_axis_tlast  <= '0';
+
+        wait for CLK_PERIOD * 50;
+
+        assert out_count - first = 2*CHAIN_SIZE**2
+            report "Chained frames: got " & integer'image(out_count - first) & " outputs" severity error;
+
+        for frame in 0 to 1 loop
+            for i in 0 to CHAIN_SIZE**2-1 loop
+                assert out_data(first + frame*CHAIN_SIZE**2 + i) = expected_chain(7*frame, NUM_FRAMES-1, 4, i)
+                    report "Chained frame " & integer'image(frame) & " output " & integer'image(i) & ": got " &
+                           real'image(to_real(out_data(first + frame*CHAIN_SIZE**2 + i))) severity error;
+                assert out_last(first + frame*CHAIN_SIZE**2 + i) = to_std_logic(i = CHAIN_SIZE**2-1)
+                    report "Chained frame " & integer'image(frame) & " output " & integer'image(i) & ": wrong tlast" severity error;
+            end loop;
+        end loop;
+
+        -- Randomized output backpressure: both DUTs stream the same frames
+        -- under the same m_axis_tready pattern, and the output FIFO should
+        -- keep most write-side hiccups away from the input
+        write_register(clk_i, s_axi_awaddr, s_axi_awvalid, s_axi_wdata,
+                     s_axi_wvalid, s_axi_bready, REG_CHAIN*(DATA_WIDTH/8), x"00000000");
+        write_register(clk_i, s_axi_awaddr, s_axi_awvalid, s_axi_wdata,
+                     s_axi_wvalid, s_axi_bready, REG_STAGES*(DATA_WIDTH/8), x"00000001");
+        write_register(clk_i, s_axi_awaddr, s_axi_awvalid, s_axi_wdata,
+                     s_axi_wvalid, s_axi_bready, REG_COMMIT*(DATA_WIDTH/8), x"00000001");
+
+        wait for CLK_PERIOD * 10;
+
+        first  := out_count;
+        stalls := 0;
+        random_ready <= true;
+        direct_start <= true;
+        wait until rising_edge(clk_i);
+
+        for frame in 0 to NUM_FRAMES-1 loop
+            for i in 0 to INPUT_SIZE*INPUT_SIZE-1 loop
+                s_axis_tdata  <= INPUT_DATA((i + 7*frame) mod (INPUT_SIZE*INPUT_SIZE));
+                s_axis_tvalid <= '1';
+                s_axis_tlast  <= to_std_logic(i = INPUT_SIZE*INPUT_SIZE-1);
+                wait until rising_edge(clk_i);
+                while s_axis_tready = '0' loop
+                    stalls := stalls + 1;
+                    wait until rising_edge(clk_i);
+                end loop;
+            end loop;
+        end loop;
+
+        s_axis_tvalid <= '0';
+        s_axis_tlast  <= '0';
+        fifo_stalls   <= stalls;
+
+        wait until direct_done;
+        wait for CLK_PERIOD * 200;
+
+        report "Input stall cycles under random backpressure: " & integer'image(stalls) &
+               " with a " & integer'image(FIFO_DEPTH) & "-beat output FIFO, " &
+               integer'image(direct_stalls) & " without";
+        assert stalls < direct_stalls or direct_stalls = 0
+            report "Output FIFO did not reduce input stalls" severity error;
+        assert out_count - first = NUM_FRAMES*POOLED_SIZE**2 and d_out_count = NUM_FRAMES*POOLED_SIZE**2
+            report "Backpressured frames: got " & integer'image(out_count - first) & " and " &
+                   integer'image(d_out_count) & " outputs" severity error;
+
+        for frame in 0 to NUM_FRAMES-1 loop
+            for i in 0 to POOLED_SIZE**2-1 loop
+                assert out_data(first + frame*POOLED_SIZE**2 + i) = expected(7*frame, NUM_FRAMES-1, i)
+                    report "Backpressured frame " & integer'image(frame) & " output " & integer'image(i) & " mismatch" severity error;
+                assert out_last(first + frame*POOLED_SIZE**2 + i) = to_std_logic(i = POOLED_SIZE**2-1)
+                    report "Backpressured frame " & integer'image(frame) & " output " & integer'image(i) & ": wrong tlast" severity error;
+            end loop;
+        end loop;
+
+        -- Upload straddling a frame end: half of the next kernel lands during
+        -- the last beats of the first frame and the rest (then the commit)
+        -- during the second, so the second frame keeps the old kernel and
+        -- only the third takes the new one
+        random_ready <= false;
+        wait for CLK_PERIOD * 10;
+
+        first := out_count;
+        wait until rising_edge(clk_i);
+
+        for frame in 0 to 2 loop
+            for i in 0 to INPUT_SIZE*INPUT_SIZE-1 loop
+                s_axis_tdata  <= INPUT_DATA((i + 7*frame) mod (INPUT_SIZE*INPUT_SIZE));
+                s_axis_tvalid <= '1';
+                s_axis_tlast  <= to_std_logic(i = INPUT_SIZE*INPUT_SIZE-1);
+
+                if frame = 0 and i >= INPUT_SIZE*INPUT_SIZE-4 then
+                    s_axi_awaddr  <= std_logic_vector(to_unsigned((i-(INPUT_SIZE*INPUT_SIZE-4))*(DATA_WIDTH/8), ADDR_WIDTH));
+                    s_axi_wdata   <= KERNEL_DATA((i-(INPUT_SIZE*INPUT_SIZE-4) + 5) mod (KERNEL_SIZE*KERNEL_SIZE));
+                    s_axi_awvalid <= '1';
+                    s_axi_wvalid  <= '1';
+                    s_axi_bready  <= '1';
+                elsif frame = 1 and i < KERNEL_SIZE*KERNEL_SIZE-4 then
+                    s_axi_awaddr  <= std_logic_vector(to_unsigned((i+4)*(DATA_WIDTH/8), ADDR_WIDTH));
+                    s_axi_wdata   <= KERNEL_DATA((i+4 + 5) mod (KERNEL_SIZE*KERNEL_SIZE));
+                    s_axi_awvalid <= '1';
+                    s_axi_wvalid  <= '1';
+                    s_axi_bready  <= '1';
+                elsif frame = 1 and i = KERNEL_SIZE*KERNEL_SIZE-4 then
+                    s_axi_awaddr  <= std_logic_vector(to_unsigned(REG_COMMIT*(DATA_WIDTH/8), ADDR_WIDTH));
+                    s_axi_wdata   <= x"00000001";
+                    s_axi_awvalid <= '1';
+                    s_axi_wvalid  <= '1';
+                    s_axi_bready  <= '1';
+                else
+                    s_axi_awvalid <= '0';
+                    s_axi_wvalid  <= '0';
+                    s_axi_bready  <= '0';
+                end if;
+
+                wait until rising_edge(clk_i) and s_axis_tready = '1';
+            end loop;
+        end loop;
+
+        s_axis_tvalid <= '0';
+        s_axis_tlast  <= '0';
+        s_axi_awvalid <= '0';
+        s_axi_wvalid  <= '0';
+        s_axi_bready  <= '0';
+
+        wait for CLK_PERIOD * 50;
+
+        assert out_count - first = 3*POOLED_SIZE**2
+            report "Straddled upload: got " & integer'image(out_count - first) & " outputs" severity error;
+
+        for frame in 0 to 2 loop
+            if frame < 2 then
+                rotation := NUM_FRAMES-1;
+            else
+                rotation := 5;
+            end if;
+            for i in 0 to POOLED_SIZE**2-1 loop
+                assert out_data(first + frame*POOLED_SIZE**2 + i) = expected(7*frame, rotation, i)
+                    report "Straddled frame " & integer'image(frame) & " output " & integer'image(i) & ": got " &
+                           real'image(to_real(out_data(first + frame*POOLED_SIZE**2 + i))) severity error;
+            end loop;
+        end loop;
         
         sim_done <= true;
         wait;
@@ -295,10 +824,80 @@ begin
 
     -- Monitor process for outputs
     monitor_proc: process(clk_i)
+        variable count : integer := 0;
     begin
         if rising_edge(clk_i) then
             if m_axis_tvalid = '1' and m_axis_tready = '1' then
                 report "Output data: " & real'image(to_real(m_axis_tdata));
+                out_data(out_count) <= m_axis_tdata;
+                out_last(out_count) <= m_axis_tlast;
+                out_count <= out_count + 1;
+                count := count + 1;
+                if m_axis_tlast = '1' then
+                    frame_outputs <= count;
+                    count := 0;
+                end if;
+            end if;
+        end if;
+    end process;
+
+    -- Reference DUT stream (the same frames as the main DUT's backpressure
+    -- phase, counting the cycles its input is held off)
+    direct_proc: process
+        variable stalls : integer := 0;
+    begin
+        wait until direct_start;
+        wait until rising_edge(clk_i);
+
+        for frame in 0 to NUM_FRAMES-1 loop
+            for i in 0 to INPUT_SIZE*INPUT_SIZE-1 loop
+                d_s_axis_tdata  <= INPUT_DATA((i + 7*frame) mod (INPUT_SIZE*INPUT_SIZE));
+                d_s_axis_tvalid <= '1';
+                d_s_axis_tlast  <= to_std_logic(i = INPUT_SIZE*INPUT_SIZE-1);
+                wait until rising_edge(clk_i);
+                while d_s_axis_tready = '0' loop
+                    stalls := stalls + 1;
+                    wait until rising_edge(clk_i);
+                end loop;
+            end loop;
+        end loop;
+
+        d_s_axis_tvalid <= '0';
+        d_s_axis_tlast  <= '0';
+        direct_stalls   <= stalls;
+        direct_done     <= true;
+        wait;
+    end process;
+
+    direct_monitor_proc: process(clk_i)
+    begin
+        if rising_edge(clk_i) then
+            if d_m_axis_tvalid = '1' and m_axis_tready = '1' then
+                d_out_count <= d_out_count + 1;
+            end if;
+        end if;
+    end process;
+
+    -- Output backpressure (ready unless the random phase is running, then
+    -- dropped for 2 to 9 cycles at pseudo-random points)
+    backpressure_proc: process(clk_i)
+        variable lfsr   : std_logic_vector(7 downto 0) := X"E1";
+        variable hiccup : integer := 0;
+    begin
+        if rising_edge(clk_i) then
+            if not random_ready then
+                m_axis_tready <= '1';
+            else
+                lfsr := lfsr(6 downto 0) & (lfsr(7) xnor lfsr(5) xnor lfsr(4) xnor lfsr(3));
+                if hiccup > 0 then
+                    hiccup := hiccup - 1;
+                    m_axis_tready <= '0';
+                elsif lfsr(3 downto 0) = "0000" then
+                    hiccup := to_integer(unsigned(lfsr(6 downto 4))) + 1;
+                    m_axis_tready <= '0';
+                else
+                    m_axis_tready <= '1';
+                end if;
             end if;
         end if;
     end process;
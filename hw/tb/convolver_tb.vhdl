@@ -22,23 +22,30 @@ architecture sim of convolver_tb is
             KERNEL_SIZE     : integer := 3;
             STRIDE          : integer := 1;
             DATA_WIDTH      : integer := 32;
-            FRACTIONAL_BITS : integer := 12
+            FRACTIONAL_BITS : integer := 12;
+            LINE_BUFFER_BRAM : integer := 0;
+            PIXELS_PER_BEAT : integer := 1;
+            NUM_FILTERS     : integer := 1
         );
         port (
             clk_i        : in  std_logic;
             rst_i        : in  std_logic;
             
-            -- Kernel
-            kernel_i : in  std_logic_vector((KERNEL_SIZE*KERNEL_SIZE*DATA_WIDTH)-1 downto 0);
+            -- Kernels
+            kernel_i : in  std_logic_vector((NUM_FILTERS*KERNEL_SIZE*KERNEL_SIZE*DATA_WIDTH)-1 downto 0);
+
+            -- Frame Dimensions
+            width_i  : in  std_logic_vector(15 downto 0);
+            height_i : in  std_logic_vector(15 downto 0);
             
             -- Input Stream Interface
-            data_i  : in  std_logic_vector(DATA_WIDTH-1 downto 0);
+            data_i  : in  std_logic_vector(PIXELS_PER_BEAT*DATA_WIDTH-1 downto 0);
             valid_i : in  std_logic;
             ready_o : out std_logic;
             last_i  : in  std_logic;
             
             -- Output Stream Interface
-            data_o  : out std_logic_vector(DATA_WIDTH-1 downto 0);
+            data_o  : out std_logic_vector(NUM_FILTERS*PIXELS_PER_BEAT*DATA_WIDTH-1 downto 0);
             valid_o : out std_logic;
             ready_i : in  std_logic;
             last_o  : out std_logic
@@ -49,6 +56,8 @@ architecture sim of convolver_tb is
     signal clk_i    : std_logic := '0';
     signal rst_i    : std_logic := '0';
     signal kernel_i : std_logic_vector((KERNEL_SIZE*KERNEL_SIZE*DATA_WIDTH)-1 downto 0) := (others => '0');
+    signal width_i  : std_logic_vector(15 downto 0) := std_logic_vector(to_unsigned(INPUT_SIZE, 16));
+    signal height_i : std_logic_vector(15 downto 0) := std_logic_vector(to_unsigned(INPUT_SIZE, 16));
     
     -- Input Stream
     signal data_i   : std_logic_vector(DATA_WIDTH-1 downto 0) := (others => '0');
@@ -61,9 +70,58 @@ architecture sim of convolver_tb is
     signal valid_o  : std_logic;
     signal ready_i  : std_logic := '1';  -- Consumer always ready in this test
     signal last_o   : std_logic;
+
+    -- Block RAM line buffer instance (must match the shift registers every cycle)
+    signal bram_data_o  : std_logic_vector(DATA_WIDTH-1 downto 0);
+    signal bram_valid_o : std_logic;
+    signal bram_ready_o : std_logic;
+    signal bram_last_o  : std_logic;
+
+    -- Two pixels per beat instance (own stimulus, checked lane by lane)
+    constant WIDE_LANES : integer := 2;
+    signal wide_width_i : std_logic_vector(15 downto 0) := std_logic_vector(to_unsigned(INPUT_SIZE, 16));
+    signal wide_data_i  : std_logic_vector(WIDE_LANES*DATA_WIDTH-1 downto 0) := (others => '0');
+    signal wide_valid_i : std_logic := '0';
+    signal wide_ready_o : std_logic;
+    signal wide_last_i  : std_logic := '0';
+    signal wide_data_o  : std_logic_vector(WIDE_LANES*DATA_WIDTH-1 downto 0);
+    signal wide_valid_o : std_logic;
+    signal wide_last_o  : std_logic;
+    signal wide_done    : boolean := false;
+    signal wide_count   : integer := 0;
+
+    -- Two filter instance (second kernel negated, so its output must be the
+    -- negated first filter on every beat)
+    constant MULTI_FILTERS : integer := 2;
+    signal multi_kernel_i : std_logic_vector(MULTI_FILTERS*KERNEL_SIZE*KERNEL_SIZE*DATA_WIDTH-1 downto 0);
+    signal multi_data_o   : std_logic_vector(MULTI_FILTERS*DATA_WIDTH-1 downto 0);
+    signal multi_valid_o  : std_logic;
+    signal multi_ready_o  : std_logic;
+    signal multi_last_o   : std_logic;
     
     signal rand_ready : std_logic_vector(7 downto 0) := (others => '0');
     signal sim_done : boolean := false;
+
+    -- Size sweep checking
+    signal check_en    : boolean := false;
+    signal check_count : integer := 0;
+    
+    -- Expected output for weights w(i) = i and input pixels numbered 0, 1, 2, ...
+    function expected(index, width : integer) return integer is
+        variable out_cols : integer;
+        variable r, c     : integer;
+        variable sum      : integer := 0;
+    begin
+        out_cols := (width - KERNEL_SIZE) / STRIDE + 1;
+        r := index / out_cols;
+        c := index mod out_cols;
+        for ki in 0 to KERNEL_SIZE-1 loop
+            for kj in 0 to KERNEL_SIZE-1 loop
+                sum := sum + (ki*KERNEL_SIZE + kj) * ((r*STRIDE + ki)*width + c*STRIDE + kj);
+            end loop;
+        end loop;
+        return sum * 2**FRACTIONAL_BITS;
+    end function;
     
     -- Helper functions
     function to_fixed(real_num : real) return std_logic_vector is
@@ -105,6 +163,8 @@ begin
             clk_i    => clk_i,
             rst_i    => rst_i,
             kernel_i => kernel_i,
+            width_i  => width_i,
+            height_i => height_i,
             data_i   => data_i,
             valid_i  => valid_i,
             ready_o  => ready_o,
@@ -115,6 +175,87 @@ begin
             last_o   => last_o
         );
 
+    DUT_BRAM: convolver
+        generic map (
+            INPUT_SIZE       => INPUT_SIZE,
+            KERNEL_SIZE      => KERNEL_SIZE,
+            STRIDE           => STRIDE,
+            DATA_WIDTH       => DATA_WIDTH,
+            FRACTIONAL_BITS  => FRACTIONAL_BITS,
+            LINE_BUFFER_BRAM => 1
+        )
+        port map (
+            clk_i    => clk_i,
+            rst_i    => rst_i,
+            kernel_i => kernel_i,
+            width_i  => width_i,
+            height_i => height_i,
+            data_i   => data_i,
+            valid_i  => valid_i,
+            ready_o  => bram_ready_o,
+            last_i   => last_i,
+            data_o   => bram_data_o,
+            valid_o  => bram_valid_o,
+            ready_i  => ready_i,
+            last_o   => bram_last_o
+        );
+
+    DUT_WIDE: convolver
+        generic map (
+            INPUT_SIZE      => INPUT_SIZE,
+            KERNEL_SIZE     => KERNEL_SIZE,
+            STRIDE          => STRIDE,
+            DATA_WIDTH      => DATA_WIDTH,
+            FRACTIONAL_BITS => FRACTIONAL_BITS,
+            PIXELS_PER_BEAT => WIDE_LANES
+        )
+        port map (
+            clk_i    => clk_i,
+            rst_i    => rst_i,
+            kernel_i => kernel_i,
+            width_i  => wide_width_i,
+            height_i => wide_width_i,
+            data_i   => wide_data_i,
+            valid_i  => wide_valid_i,
+            ready_o  => wide_ready_o,
+            last_i   => wide_last_i,
+            data_o   => wide_data_o,
+            valid_o  => wide_valid_o,
+            ready_i  => ready_i,
+            last_o   => wide_last_o
+        );
+
+    multi_kernel_gen: for i in 0 to KERNEL_SIZE*KERNEL_SIZE-1 generate
+        multi_kernel_i((i + 1)*DATA_WIDTH-1 downto i*DATA_WIDTH) <= kernel_i((i + 1)*DATA_WIDTH-1 downto i*DATA_WIDTH);
+        multi_kernel_i((KERNEL_SIZE*KERNEL_SIZE + i + 1)*DATA_WIDTH-1 downto (KERNEL_SIZE*KERNEL_SIZE + i)*DATA_WIDTH) <=
+            std_logic_vector(-signed(kernel_i((i + 1)*DATA_WIDTH-1 downto i*DATA_WIDTH)));
+    end generate;
+
+    DUT_MULTI: convolver
+        generic map (
+            INPUT_SIZE      => INPUT_SIZE,
+            KERNEL_SIZE     => KERNEL_SIZE,
+            STRIDE          => STRIDE,
+            DATA_WIDTH      => DATA_WIDTH,
+            FRACTIONAL_BITS => FRACTIONAL_BITS,
+            NUM_FILTERS     => MULTI_FILTERS
+        )
+        port map (
+            clk_i    => clk_i,
+            rst_i    => rst_i,
+            kernel_i => multi_kernel_i,
+            width_i  => width_i,
+            height_i => height_i,
+            data_i   => data_i,
+            valid_i  => valid_i,
+            ready_o  => multi_ready_o,
+            last_i   => last_i,
+            data_o   => multi_data_o,
+            valid_o  => multi_valid_o,
+            ready_i  => ready_i,
+            last_o   => multi_last_o
+        );
+
     -- Stimulus process
     stim_proc: process
         variable input_count : integer := 0;
@@ -192,17 +333,122 @@ begin
         
         -- Wait for completion
         wait for CLK_PERIOD * (KERNEL_SIZE*KERNEL_SIZE + 10);       
+
+        -- Size sweep: same synthesized line buffers, runtime dimensions
+        check_en <= true;
+        for size in INPUT_SIZE downto KERNEL_SIZE+1 loop
+            width_i  <= std_logic_vector(to_unsigned(size, 16));
+            height_i <= std_logic_vector(to_unsigned(size - 1, 16));
+            input_count := 0;
+            report "Size sweep: " & integer'image(size) & "x" & integer'image(size - 1);
+
+            for row in 0 to size-2 loop
+                for col in 0 to size-1 loop
+                    wait until rising_edge(clk_i) and ready_o = '1';
+                    data_i  <= to_fixed(real(input_count));
+                    valid_i <= '1';
+                    if (row = size-2) and (col = size-1) then
+                        last_i <= '1';
+                    end if;
+                    input_count := input_count + 1;
+                end loop;
+            end loop;
+
+            wait until rising_edge(clk_i) and ready_o = '1';
+            valid_i <= '0';
+            last_i  <= '0';
+            wait for CLK_PERIOD * (KERNEL_SIZE*KERNEL_SIZE + 10);
+
+            assert check_count = ((size - KERNEL_SIZE) / STRIDE + 1) * ((size - 1 - KERNEL_SIZE) / STRIDE + 1)
+                report "Size " & integer'image(size) & ": got " & integer'image(check_count) & " outputs" severity error;
+        end loop;
  
+        wait until wide_done;
         sim_done <= true;
         wait;
     end process;
+
+    -- Wide stimulus process (square frames of even width, after the kernel is set)
+    wide_proc: process
+        variable input_count : integer;
+    begin
+        wait for 200 ns;
+        for size in INPUT_SIZE downto KERNEL_SIZE+1 loop
+            if size mod WIDE_LANES = 0 then
+                wide_width_i <= std_logic_vector(to_unsigned(size, 16));
+                input_count := 0;
+
+                for beat in 0 to size*size/WIDE_LANES-1 loop
+                    wait until rising_edge(clk_i) and wide_ready_o = '1';
+                    for lane in 0 to WIDE_LANES-1 loop
+                        wide_data_i((lane + 1)*DATA_WIDTH-1 downto lane*DATA_WIDTH) <= to_fixed(real(input_count));
+                        input_count := input_count + 1;
+                    end loop;
+                    wide_valid_i <= '1';
+                    if beat = size*size/WIDE_LANES-1 then
+                        wide_last_i <= '1';
+                    end if;
+                end loop;
+
+                wait until rising_edge(clk_i) and wide_ready_o = '1';
+                wide_valid_i <= '0';
+                wide_last_i  <= '0';
+                wait for CLK_PERIOD * (KERNEL_SIZE*KERNEL_SIZE + 10);
+
+                assert wide_count = ((size - KERNEL_SIZE) + 1) * ((size - KERNEL_SIZE) + 1)
+                    report "Wide size " & integer'image(size) & ": got " & integer'image(wide_count) & " outputs" severity error;
+            end if;
+        end loop;
+        wide_done <= true;
+        wait;
+    end process;
+
+    -- Wide monitor process (lane l of a beat holds the window ending at input column 2*beat+l)
+    wide_monitor_proc: process(clk_i)
+        variable beat  : integer := 0;
+        variable count : integer := 0;
+        variable width : integer;
+        variable col   : integer;
+    begin
+        if rising_edge(clk_i) then
+            if wide_valid_o = '1' and ready_i = '1' then
+                width := to_integer(unsigned(wide_width_i));
+                for lane in 0 to WIDE_LANES-1 loop
+                    col := ((KERNEL_SIZE-1)/WIDE_LANES + beat mod (width/WIDE_LANES - (KERNEL_SIZE-1)/WIDE_LANES))*WIDE_LANES + lane;
+                    if col >= KERNEL_SIZE-1 then
+                        assert to_integer(signed(wide_data_o((lane + 1)*DATA_WIDTH-1 downto lane*DATA_WIDTH))) = expected(count, width)
+                            report "Wide output " & integer'image(count) & " mismatch" severity error;
+                        count := count + 1;
+                    end if;
+                end loop;
+                beat := beat + 1;
+                if wide_last_o = '1' then
+                    wide_count <= count;
+                    beat  := 0;
+                    count := 0;
+                end if;
+            end if;
+        end if;
+    end process;
     
     -- Monitor process
     monitor_proc: process(clk_i)
+        variable count : integer := 0;
     begin
         if rising_edge(clk_i) then
             if valid_o = '1' and ready_i = '1' then
                 report "Valid output: " & real'image(to_real(data_o));
+
+                -- Check values and frame length during the size sweep
+                if check_en then
+                    assert to_integer(signed(data_o)) = expected(count, to_integer(unsigned(width_i)))
+                        report "Output " & integer'image(count) & " mismatch" severity error;
+                    count := count + 1;
+                    if last_o = '1' then
+                        check_count <= count;
+                        count := 0;
+                    end if;
+                end if;
             end if;
             
             if last_o = '1' and valid_o = '1' and ready_i = '1' then
@@ -211,6 +457,34 @@ begin
         end if;
     end process;
     
+    -- Line buffer equivalence process
+    compare_proc: process(clk_i)
+    begin
+        if rising_edge(clk_i) and rst_i = '0' then
+            assert bram_ready_o = ready_o and bram_valid_o = valid_o and bram_last_o = last_o
+                report "Block RAM line buffers diverge in handshake" severity error;
+            if valid_o = '1' then
+                assert bram_data_o = data_o
+                    report "Block RAM line buffers diverge in data" severity error;
+            end if;
+        end if;
+    end process;
+    
+    -- Filter equivalence process
+    multi_compare_proc: process(clk_i)
+    begin
+        if rising_edge(clk_i) and rst_i = '0' then
+            assert multi_ready_o = ready_o and multi_valid_o = valid_o and multi_last_o = last_o
+                report "Multi-filter instance diverges in handshake" severity error;
+            if valid_o = '1' then
+                assert multi_data_o(DATA_WIDTH-1 downto 0) = data_o
+                    report "Filter 0 mismatch" severity error;
+                assert signed(multi_data_o(2*DATA_WIDTH-1 downto DATA_WIDTH)) = -signed(data_o)
+                    report "Filter 1 mismatch" severity error;
+            end if;
+        end if;
+    end process;
+    
     backpressure_proc: process(clk_i)
     begin
         if rising_edge(clk_i) then
@@ -0,0 +1,73 @@
+library ieee;
+use ieee.std_logic_1164.all;
+
+-- Foreign calls into the driver's co-simulation backend (sw/hal/cosim.c),
+-- bound through GHDL's VHPIDIRECT interface. The bodies only run when the
+-- testbench is elaborated without the C objects.
+package cosim_pkg is
+
+    -- Commands (must match cosim.c)
+    constant COSIM_IDLE   : integer := 0;
+    constant COSIM_WRITE  : integer := 1;
+    constant COSIM_READ   : integer := 2;
+    constant COSIM_STREAM : integer := 3;
+    constant COSIM_RESET  : integer := 4;
+    constant COSIM_QUIT   : integer := 5;
+
+    -- Command arguments
+    constant COSIM_ARG_ADDR     : integer := 0;
+    constant COSIM_ARG_DATA     : integer := 1;
+    constant COSIM_ARG_TX_BEATS : integer := 2;
+    constant COSIM_ARG_RX_BEATS : integer := 3;
+
+    -- Blocks until the driver posts a command
+    function cosim_command return integer;
+    attribute foreign of cosim_command : function is "VHPIDIRECT cosim_command";
+
+    function cosim_argument(index : integer) return integer;
+    attribute foreign of cosim_argument : function is "VHPIDIRECT cosim_argument";
+
+    -- Input beat of the current stream command
+    function cosim_tx_beat(index : integer) return integer;
+    attribute foreign of cosim_tx_beat : function is "VHPIDIRECT cosim_tx_beat";
+
+    procedure cosim_rx_beat(data : integer; last : integer);
+    attribute foreign of cosim_rx_beat : procedure is "VHPIDIRECT cosim_rx_beat";
+
+    -- Completes the current command (read data or stream status, and cycles)
+    procedure cosim_complete(result : integer; cycles : integer);
+    attribute foreign of cosim_complete : procedure is "VHPIDIRECT cosim_complete";
+
+end package cosim_pkg;
+
+package body cosim_pkg is
+
+    function cosim_command return integer is
+    begin
+        assert false report "cosim_command needs the VHPIDIRECT binding" severity failure;
+        return COSIM_QUIT;
+    end function;
+
+    function cosim_argument(index : integer) return integer is
+    begin
+        assert false report "cosim_argument needs the VHPIDIRECT binding" severity failure;
+        return 0;
+    end function;
+
+    function cosim_tx_beat(index : integer) return integer is
+    begin
+        assert false report "cosim_tx_beat needs the VHPIDIRECT binding" severity failure;
+        return 0;
+    end function;
+
+    procedure cosim_rx_beat(data : integer; last : integer) is
+    begin
+        assert false report "cosim_rx_beat needs the VHPIDIRECT binding" severity failure;
+    end procedure;
+
+    procedure cosim_complete(result : integer; cycles : integer) is
+    begin
+        assert false report "cosim_complete needs the VHPIDIRECT binding" severity failure;
+    end procedure;
+
+end package body cosim_pkg;
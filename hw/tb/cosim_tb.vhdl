@@ -0,0 +1,342 @@
+library ieee;
+use ieee.std_logic_1164.all;
+use ieee.numeric_std.all;
+
+use work.cosim_pkg.all;
+
+-- Co-simulation harness: the accelerator driven by the C driver's cosim
+-- backend. Register accesses and stream transfers are fetched one at a
+-- time through VHPIDIRECT and run on the AXI interfaces, with the DMA side
+-- modeled as always ready. Elaborated with the driver objects linked in
+-- (see scripts/cosim.sh), which also set the generics from config.h.
+entity cosim_tb is
+    generic (
+        INPUT_SIZE        : integer := 128;
+        KERNEL_SIZE       : integer := 3;
+        STRIDE            : integer := 1;
+        POOL_SIZE         : integer := 2;
+        DATA_WIDTH        : integer := 32;
+        FRACTIONAL_BITS   : integer := 12;
+        PIXELS_PER_BEAT   : integer := 1;
+        NUM_FILTERS       : integer := 1;
+        NUM_LAYERS        : integer := 1;
+        OUTPUT_FIFO_DEPTH : integer := 16
+    );
+end cosim_tb;
+
+architecture sim of cosim_tb is
+
+    -- Constants
+    constant CLK_PERIOD    : time    := 10 ns;
+    constant ADDR_WIDTH    : integer := 12;
+    constant AXI_WIDTH     : integer := 32;
+    constant BEAT_WIDTH    : integer := PIXELS_PER_BEAT*DATA_WIDTH;
+    constant NUM_REGISTERS : integer := KERNEL_SIZE*KERNEL_SIZE*(NUM_FILTERS+NUM_LAYERS-1);
+    constant RESET_CYCLES  : integer := 5;
+
+    -- Component Declaration
+    component accelerator is
+        generic (
+            INPUT_SIZE        : integer := 6;
+            KERNEL_SIZE       : integer := 3;
+            STRIDE            : integer := 1;
+            POOL_SIZE         : integer := 2;
+            DATA_WIDTH        : integer := 32;
+            FRACTIONAL_BITS   : integer := 12;
+            ADDR_WIDTH        : integer := 7;
+            NUM_REGISTERS     : integer := 9;
+            PIXELS_PER_BEAT   : integer := 1;
+            NUM_FILTERS       : integer := 1;
+            NUM_LAYERS        : integer := 1;
+            OUTPUT_FIFO_DEPTH : integer := 16
+        );
+        port (
+            clk_i  : in std_logic;
+            rstn_i : in std_logic;
+
+            -- AXI4-Lite Slave Interface
+            s_axi_awaddr  : in  std_logic_vector(ADDR_WIDTH-1 downto 0);
+            s_axi_awprot  : in  std_logic_vector(2 downto 0);
+            s_axi_awvalid : in  std_logic;
+            s_axi_awready : out std_logic;
+            s_axi_wdata   : in  std_logic_vector(31 downto 0);
+            s_axi_wstrb   : in  std_logic_vector(3 downto 0);
+            s_axi_wvalid  : in  std_logic;
+            s_axi_wready  : out std_logic;
+            s_axi_bresp   : out std_logic_vector(1 downto 0);
+            s_axi_bvalid  : out std_logic;
+            s_axi_bready  : in  std_logic;
+            s_axi_araddr  : in  std_logic_vector(ADDR_WIDTH-1 downto 0);
+            s_axi_arprot  : in  std_logic_vector(2 downto 0);
+            s_axi_arvalid : in  std_logic;
+            s_axi_arready : out std_logic;
+            s_axi_rdata   : out std_logic_vector(31 downto 0);
+            s_axi_rresp   : out std_logic_vector(1 downto 0);
+            s_axi_rvalid  : out std_logic;
+            s_axi_rready  : in  std_logic;
+
+            -- AXI4-Stream Slave Interface
+            s_axis_tready : out std_logic;
+            s_axis_tdata  : in  std_logic_vector(PIXELS_PER_BEAT*DATA_WIDTH-1 downto 0);
+            s_axis_tstrb  : in  std_logic_vector((PIXELS_PER_BEAT*DATA_WIDTH/8)-1 downto 0);
+            s_axis_tlast  : in  std_logic;
+            s_axis_tvalid : in  std_logic;
+
+            -- AXI4-Stream Master Interface
+            m_axis_tvalid : out std_logic;
+            m_axis_tdata  : out std_logic_vector(PIXELS_PER_BEAT*DATA_WIDTH-1 downto 0);
+            m_axis_tstrb  : out std_logic_vector((PIXELS_PER_BEAT*DATA_WIDTH/8)-1 downto 0);
+            m_axis_tkeep  : out std_logic_vector((PIXELS_PER_BEAT*DATA_WIDTH/8)-1 downto 0);
+            m_axis_tlast  : out std_logic;
+            m_axis_tready : in  std_logic
+        );
+    end component;
+
+    -- Clock and Reset
+    signal clk_i  : std_logic := '0';
+    signal rstn_i : std_logic := '0';
+
+    -- AXI4-Lite Signals
+    signal s_axi_awaddr  : std_logic_vector(ADDR_WIDTH-1 downto 0) := (others => '0');
+    signal s_axi_awprot  : std_logic_vector(2 downto 0) := (others => '0');
+    signal s_axi_awvalid : std_logic := '0';
+    signal s_axi_awready : std_logic;
+    signal s_axi_wdata   : std_logic_vector(AXI_WIDTH-1 downto 0) := (others => '0');
+    signal s_axi_wstrb   : std_logic_vector((AXI_WIDTH/8)-1 downto 0) := (others => '1');
+    signal s_axi_wvalid  : std_logic := '0';
+    signal s_axi_wready  : std_logic;
+    signal s_axi_bresp   : std_logic_vector(1 downto 0);
+    signal s_axi_bvalid  : std_logic;
+    signal s_axi_bready  : std_logic := '0';
+    signal s_axi_araddr  : std_logic_vector(ADDR_WIDTH-1 downto 0) := (others => '0');
+    signal s_axi_arprot  : std_logic_vector(2 downto 0) := (others => '0');
+    signal s_axi_arvalid : std_logic := '0';
+    signal s_axi_arready : std_logic;
+    signal s_axi_rdata   : std_logic_vector(AXI_WIDTH-1 downto 0);
+    signal s_axi_rresp   : std_logic_vector(1 downto 0);
+    signal s_axi_rvalid  : std_logic;
+    signal s_axi_rready  : std_logic := '0';
+
+    -- AXI4-Stream Signals
+    signal s_axis_tready : std_logic;
+    signal s_axis_tdata  : std_logic_vector(BEAT_WIDTH-1 downto 0) := (others => '0');
+    signal s_axis_tstrb  : std_logic_vector((BEAT_WIDTH/8)-1 downto 0) := (others => '1');
+    signal s_axis_tlast  : std_logic := '0';
+    signal s_axis_tvalid : std_logic := '0';
+    signal m_axis_tvalid : std_logic;
+    signal m_axis_tdata  : std_logic_vector(BEAT_WIDTH-1 downto 0);
+    signal m_axis_tstrb  : std_logic_vector((BEAT_WIDTH/8)-1 downto 0);
+    signal m_axis_tkeep  : std_logic_vector((BEAT_WIDTH/8)-1 downto 0);
+    signal m_axis_tlast  : std_logic;
+    signal m_axis_tready : std_logic := '0';
+
+    signal sim_done : boolean := false;
+
+begin
+
+    -- Check Configuration (the driver moves 32-bit DMA beats)
+    assert BEAT_WIDTH = 32
+        report "Co-simulation needs 32-bit stream beats" severity failure;
+
+    -- Clock generation
+    clk_proc: process
+    begin
+        while not sim_done loop
+            clk_i <= '0';
+            wait for CLK_PERIOD/2;
+            clk_i <= '1';
+            wait for CLK_PERIOD/2;
+        end loop;
+        wait;
+    end process;
+
+    -- Instantiation
+    DUT: accelerator
+        generic map (
+            INPUT_SIZE        => INPUT_SIZE,
+            KERNEL_SIZE       => KERNEL_SIZE,
+            STRIDE            => STRIDE,
+            POOL_SIZE         => POOL_SIZE,
+            DATA_WIDTH        => DATA_WIDTH,
+            FRACTIONAL_BITS   => FRACTIONAL_BITS,
+            ADDR_WIDTH        => ADDR_WIDTH,
+            NUM_REGISTERS     => NUM_REGISTERS,
+            PIXELS_PER_BEAT   => PIXELS_PER_BEAT,
+            NUM_FILTERS       => NUM_FILTERS,
+            NUM_LAYERS        => NUM_LAYERS,
+            OUTPUT_FIFO_DEPTH => OUTPUT_FIFO_DEPTH
+        )
+        port map (
+            clk_i         => clk_i,
+            rstn_i        => rstn_i,
+            s_axi_awaddr  => s_axi_awaddr,
+            s_axi_awprot  => s_axi_awprot,
+            s_axi_awvalid => s_axi_awvalid,
+            s_axi_awready => s_axi_awready,
+            s_axi_wdata   => s_axi_wdata,
+            s_axi_wstrb   => s_axi_wstrb,
+            s_axi_wvalid  => s_axi_wvalid,
+            s_axi_wready  => s_axi_wready,
+            s_axi_bresp   => s_axi_bresp,
+            s_axi_bvalid  => s_axi_bvalid,
+            s_axi_bready  => s_axi_bready,
+            s_axi_araddr  => s_axi_araddr,
+            s_axi_arprot  => s_axi_arprot,
+            s_axi_arvalid => s_axi_arvalid,
+            s_axi_arready => s_axi_arready,
+            s_axi_rdata   => s_axi_rdata,
+            s_axi_rresp   => s_axi_rresp,
+            s_axi_rvalid  => s_axi_rvalid,
+            s_axi_rready  => s_axi_rready,
+            s_axis_tready => s_axis_tready,
+            s_axis_tdata  => s_axis_tdata,
+            s_axis_tstrb  => s_axis_tstrb,
+            s_axis_tlast  => s_axis_tlast,
+            s_axis_tvalid => s_axis_tvalid,
+            m_axis_tvalid => m_axis_tvalid,
+            m_axis_tdata  => m_axis_tdata,
+            m_axis_tstrb  => m_axis_tstrb,
+            m_axis_tkeep  => m_axis_tkeep,
+            m_axis_tlast  => m_axis_tlast,
+            m_axis_tready => m_axis_tready
+        );
+
+    -- Command process (one driver request at a time, completed before the
+    -- next one is fetched)
+    cmd_proc: process
+
+        procedure reset_design is
+        begin
+            rstn_i <= '0';
+            for i in 1 to RESET_CYCLES loop
+                wait until rising_edge(clk_i);
+            end loop;
+            rstn_i <= '1';
+            wait until rising_edge(clk_i);
+        end procedure;
+
+        procedure write_register(addr : integer; data : integer) is
+        begin
+            -- Address phase
+            s_axi_awaddr  <= std_logic_vector(to_unsigned(addr, ADDR_WIDTH));
+            s_axi_awvalid <= '1';
+            wait until rising_edge(clk_i) and s_axi_awready = '1';
+            s_axi_awvalid <= '0';
+
+            -- Data phase
+            s_axi_wdata  <= std_logic_vector(to_signed(data, AXI_WIDTH));
+            s_axi_wvalid <= '1';
+            wait until rising_edge(clk_i) and s_axi_wready = '1';
+            s_axi_wvalid <= '0';
+
+            -- Response phase
+            s_axi_bready <= '1';
+            wait until rising_edge(clk_i) and s_axi_bvalid = '1';
+            s_axi_bready <= '0';
+        end procedure;
+
+        procedure read_register(addr : integer; data : out integer) is
+        begin
+            s_axi_araddr  <= std_logic_vector(to_unsigned(addr, ADDR_WIDTH));
+            s_axi_arvalid <= '1';
+            s_axi_rready  <= '1';
+            wait until rising_edge(clk_i) and s_axi_arready = '1';
+            s_axi_arvalid <= '0';
+            if s_axi_rvalid /= '1' then
+                wait until rising_edge(clk_i) and s_axi_rvalid = '1';
+            end if;
+            data := to_integer(signed(s_axi_rdata));
+            s_axi_rready <= '0';
+        end procedure;
+
+        -- Feeds the input beats while draining the output, counting cycles
+        -- from the first input beat to the last output beat
+        procedure stream(tx_beats : integer; rx_beats : integer; result : out integer; cycles : out integer) is
+            constant TIMEOUT : integer := 64*tx_beats + 10000;
+            variable sent     : integer := 0;
+            variable received : integer := 0;
+            variable count    : integer := 0;
+            variable last     : boolean := false;
+        begin
+            m_axis_tready <= '1';
+            loop
+                if sent < tx_beats then
+                    s_axis_tdata  <= std_logic_vector(to_signed(cosim_tx_beat(sent), BEAT_WIDTH));
+                    s_axis_tvalid <= '1';
+                    if sent = tx_beats-1 then
+                        s_axis_tlast <= '1';
+                    else
+                        s_axis_tlast <= '0';
+                    end if;
+                else
+                    s_axis_tvalid <= '0';
+                    s_axis_tlast  <= '0';
+                end if;
+
+                wait until rising_edge(clk_i);
+                count := count + 1;
+
+                if s_axis_tvalid = '1' and s_axis_tready = '1' then
+                    sent := sent + 1;
+                end if;
+
+                if m_axis_tvalid = '1' then
+                    received := received + 1;
+                    if m_axis_tlast = '1' then
+                        last := true;
+                        cosim_rx_beat(to_integer(signed(m_axis_tdata)), 1);
+                    else
+                        cosim_rx_beat(to_integer(signed(m_axis_tdata)), 0);
+                    end if;
+                end if;
+
+                -- The S2MM side stops at tlast or once its buffer is full
+                exit when sent = tx_beats and (last or received >= rx_beats);
+                exit when count >= TIMEOUT;
+            end loop;
+            s_axis_tvalid <= '0';
+            s_axis_tlast  <= '0';
+            m_axis_tready <= '0';
+
+            if count >= TIMEOUT then
+                report "Stream timed out after " & integer'image(sent) & " of " & integer'image(tx_beats) &
+                       " input and " & integer'image(received) & " output beats" severity warning;
+                result := 1;
+            else
+                result := 0;
+            end if;
+            cycles := count;
+        end procedure;
+
+        variable command : integer;
+        variable result  : integer;
+        variable cycles  : integer;
+    begin
+        reset_design;
+
+        loop
+            command := cosim_command;
+            result  := 0;
+            cycles  := 0;
+
+            case command is
+                when COSIM_WRITE =>
+                    write_register(cosim_argument(COSIM_ARG_ADDR), cosim_argument(COSIM_ARG_DATA));
+                when COSIM_READ =>
+                    read_register(cosim_argument(COSIM_ARG_ADDR), result);
+                when COSIM_STREAM =>
+                    stream(cosim_argument(COSIM_ARG_TX_BEATS), cosim_argument(COSIM_ARG_RX_BEATS), result, cycles);
+                when COSIM_RESET =>
+                    reset_design;
+                when others =>
+                    exit;
+            end case;
+
+            cosim_complete(result, cycles);
+        end loop;
+
+        sim_done <= true;
+        wait;
+    end process;
+
+end architecture sim;
@@ -0,0 +1,199 @@
+library ieee;
+use ieee.std_logic_1164.all;
+use ieee.numeric_std.all;
+
+entity fifo_tb is
+end fifo_tb;
+
+architecture sim of fifo_tb is
+
+    -- Constants
+    constant CLK_PERIOD  : time    := 10 ns;
+    constant DATA_WIDTH  : integer := 16;
+    constant KEEP_WIDTH  : integer := 2;
+    constant DEPTH       : integer := 5;
+    constant NUM_BEATS   : integer := 400;
+    constant FRAME_BEATS : integer := 7;
+
+    -- Components
+    component fifo is
+        generic (
+            DATA_WIDTH : integer := 32;
+            KEEP_WIDTH : integer := 1;
+            DEPTH      : integer := 16
+        );
+        port (
+            clk_i   : in  std_logic;
+            rst_i   : in  std_logic;
+            data_i  : in  std_logic_vector(DATA_WIDTH-1 downto 0);
+            keep_i  : in  std_logic_vector(KEEP_WIDTH-1 downto 0);
+            valid_i : in  std_logic;
+            ready_o : out std_logic;
+            last_i  : in  std_logic;
+            data_o  : out std_logic_vector(DATA_WIDTH-1 downto 0);
+            keep_o  : out std_logic_vector(KEEP_WIDTH-1 downto 0);
+            valid_o : out std_logic;
+            ready_i : in  std_logic;
+            last_o  : out std_logic
+        );
+    end component fifo;
+
+    -- Signals
+    signal clk_i   : std_logic := '0';
+    signal rst_i   : std_logic := '0';
+
+    -- Input Stream
+    signal data_i  : std_logic_vector(DATA_WIDTH-1 downto 0) := (others => '0');
+    signal keep_i  : std_logic_vector(KEEP_WIDTH-1 downto 0) := (others => '0');
+    signal valid_i : std_logic := '0';
+    signal ready_o : std_logic;
+    signal last_i  : std_logic := '0';
+
+    -- Output Stream
+    signal data_o  : std_logic_vector(DATA_WIDTH-1 downto 0);
+    signal keep_o  : std_logic_vector(KEEP_WIDTH-1 downto 0);
+    signal valid_o : std_logic;
+    signal ready_i : std_logic := '0';
+    signal last_o  : std_logic;
+
+    signal rand_ready : std_logic_vector(7 downto 0) := (others => '0');
+    signal sim_done   : boolean := false;
+    signal received   : integer := 0;
+    signal max_level  : integer := 0;
+
+    -- Qualifiers derived from the beat index, so the monitor can check them
+    function keep_of(index : integer) return std_logic_vector is
+    begin
+        return std_logic_vector(to_unsigned(index mod 2**KEEP_WIDTH, KEEP_WIDTH));
+    end function;
+
+    function last_of(index : integer) return std_logic is
+    begin
+        if index mod FRAME_BEATS = FRAME_BEATS-1 then
+            return '1';
+        else
+            return '0';
+        end if;
+    end function;
+
+begin
+
+    -- Clock generation
+    clk_gen: process
+    begin
+        while not sim_done loop
+            clk_i <= '0';
+            wait for CLK_PERIOD/2;
+            clk_i <= '1';
+            wait for CLK_PERIOD/2;
+        end loop;
+        wait;
+    end process;
+
+    -- Instantiation
+    DUT: fifo
+        generic map (
+            DATA_WIDTH => DATA_WIDTH,
+            KEEP_WIDTH => KEEP_WIDTH,
+            DEPTH      => DEPTH
+        )
+        port map (
+            clk_i   => clk_i,
+            rst_i   => rst_i,
+            data_i  => data_i,
+            keep_i  => keep_i,
+            valid_i => valid_i,
+            ready_o => ready_o,
+            last_i  => last_i,
+            data_o  => data_o,
+            keep_o  => keep_o,
+            valid_o => valid_o,
+            ready_i => ready_i,
+            last_o  => last_o
+        );
+
+    -- Stimulus process (consecutive values with gaps in valid, against
+    -- heavier randomized backpressure, so the FIFO fills)
+    stim_proc: process
+        variable pattern : unsigned(7 downto 0) := X"A7";
+        variable index   : integer := 0;
+    begin
+        rst_i <= '1';
+        wait for CLK_PERIOD * 5;
+        rst_i <= '0';
+        wait until rising_edge(clk_i);
+
+        while index < NUM_BEATS loop
+            pattern := pattern(6 downto 0) & (pattern(7) xor pattern(5) xor pattern(4) xor pattern(3));
+            if pattern(1 downto 0) /= "00" then
+                data_i  <= std_logic_vector(to_unsigned(index, DATA_WIDTH));
+                keep_i  <= keep_of(index);
+                last_i  <= last_of(index);
+                valid_i <= '1';
+                wait until rising_edge(clk_i) and ready_o = '1';
+                index := index + 1;
+            else
+                valid_i <= '0';
+                wait until rising_edge(clk_i);
+            end if;
+        end loop;
+        valid_i <= '0';
+        last_i  <= '0';
+
+        wait for CLK_PERIOD * 100;
+
+        assert received = NUM_BEATS
+            report "Received " & integer'image(received) & " of " & integer'image(NUM_BEATS) & " beats" severity error;
+        assert max_level = DEPTH
+            report "FIFO never filled (peak " & integer'image(max_level) & ")" severity error;
+
+        sim_done <= true;
+        wait;
+    end process;
+
+    -- Monitor process (beats leave in order with their qualifiers)
+    monitor_proc: process(clk_i)
+        variable index : integer := 0;
+        variable level : integer := 0;
+    begin
+        if rising_edge(clk_i) then
+            if valid_o = '1' and ready_i = '1' then
+                assert to_integer(unsigned(data_o)) = index
+                    report "Beat " & integer'image(index) & " out of order" severity error;
+                assert keep_o = keep_of(index) and last_o = last_of(index)
+                    report "Beat " & integer'image(index) & " qualifiers mismatch" severity error;
+                index := index + 1;
+                received <= index;
+            end if;
+
+            -- Track the occupancy from the handshakes (ready_o may only drop
+            -- while full)
+            assert ready_o = '1' or level = DEPTH
+                report "Not ready with room for " & integer'image(DEPTH - level) & " beats" severity error;
+
+            if valid_i = '1' and ready_o = '1' then
+                level := level + 1;
+            end if;
+            if valid_o = '1' and ready_i = '1' then
+                level := level - 1;
+            end if;
+            if level > max_level then
+                max_level <= level;
+            end if;
+        end if;
+    end process;
+
+    backpressure_proc: process(clk_i)
+    begin
+        if rising_edge(clk_i) then
+            if rst_i = '1' then
+                ready_i    <= '0';
+                rand_ready <= (0 => '1', others => '0');
+            else
+                rand_ready <= rand_ready(6 downto 0) & (rand_ready(7) xnor rand_ready(5));
+                ready_i    <= rand_ready(0) and rand_ready(3);
+            end if;
+        end if;
+    end process;
+
+end architecture sim;
@@ -0,0 +1,139 @@
+library IEEE;
+use IEEE.STD_LOGIC_1164.ALL;
+use IEEE.NUMERIC_STD.ALL;
+
+entity fma_dual_tb is
+end fma_dual_tb;
+
+architecture sim of fma_dual_tb is
+
+    -- Constants
+    constant CLK_PERIOD      : time    := 10 ns;
+    constant DATA_WIDTH      : integer := 8;
+    constant FRACTIONAL_BITS : integer := 4;
+    constant MIN_VALUE       : integer := -2**(DATA_WIDTH-1);
+    constant MAX_VALUE       : integer := 2**(DATA_WIDTH-1) - 1;
+
+    -- Components
+    component fma_dual is
+        generic (
+            DATA_WIDTH      : integer := 8;
+            FRACTIONAL_BITS : integer := 4
+        );
+        port (
+            clk_i : in  std_logic;
+            rst_i : in  std_logic;
+            cen_i : in  std_logic;
+            a0_i  : in  std_logic_vector(DATA_WIDTH-1 downto 0);
+            a1_i  : in  std_logic_vector(DATA_WIDTH-1 downto 0);
+            b_i   : in  std_logic_vector(DATA_WIDTH-1 downto 0);
+            c0_i  : in  std_logic_vector(DATA_WIDTH-1 downto 0);
+            c1_i  : in  std_logic_vector(DATA_WIDTH-1 downto 0);
+            y0_o  : out std_logic_vector(DATA_WIDTH-1 downto 0);
+            y1_o  : out std_logic_vector(DATA_WIDTH-1 downto 0)
+        );
+    end component fma_dual;
+
+    -- Clock and Reset
+    signal clk_i : std_logic := '0';
+    signal rst_i : std_logic := '1';
+    signal cen_i : std_logic := '0';
+
+    -- DUT Signals
+    signal a0_i : std_logic_vector(DATA_WIDTH-1 downto 0) := (others => '0');
+    signal a1_i : std_logic_vector(DATA_WIDTH-1 downto 0) := (others => '0');
+    signal b_i  : std_logic_vector(DATA_WIDTH-1 downto 0) := (others => '0');
+    signal c0_i : std_logic_vector(DATA_WIDTH-1 downto 0) := (others => '0');
+    signal c1_i : std_logic_vector(DATA_WIDTH-1 downto 0) := (others => '0');
+    signal y0_o : std_logic_vector(DATA_WIDTH-1 downto 0);
+    signal y1_o : std_logic_vector(DATA_WIDTH-1 downto 0);
+
+    signal sim_done : boolean := false;
+
+    -- Reference (what a single fma computes: truncated product plus c, wrapped)
+    function expected(a, b, c : integer) return std_logic_vector is
+        variable product : signed(2*DATA_WIDTH-1 downto 0);
+    begin
+        product := to_signed(a, DATA_WIDTH) * to_signed(b, DATA_WIDTH);
+        return std_logic_vector(resize(shift_right(product, FRACTIONAL_BITS), DATA_WIDTH) + to_signed(c, DATA_WIDTH));
+    end function;
+
+begin
+
+    -- Clock generation
+    clk_gen: process
+    begin
+        while not sim_done loop
+            clk_i <= '0';
+            wait for CLK_PERIOD/2;
+            clk_i <= '1';
+            wait for CLK_PERIOD/2;
+        end loop;
+        wait;
+    end process;
+
+    -- Instantiation
+    DUT: fma_dual
+        generic map (
+            DATA_WIDTH      => DATA_WIDTH,
+            FRACTIONAL_BITS => FRACTIONAL_BITS
+        )
+        port map (
+            clk_i => clk_i,
+            rst_i => rst_i,
+            cen_i => cen_i,
+            a0_i  => a0_i,
+            a1_i  => a1_i,
+            b_i   => b_i,
+            c0_i  => c0_i,
+            c1_i  => c1_i,
+            y0_o  => y0_o,
+            y1_o  => y1_o
+        );
+
+    -- Stimulus process (every a0/a1 pair against the extreme and a few
+    -- ordinary weights, checked one cycle after the product is registered)
+    stim_proc: process
+        type weights_t is array (0 to 5) of integer;
+        constant WEIGHTS : weights_t := (MIN_VALUE, MAX_VALUE, -1, 0, 1, 37);
+        variable errors  : integer := 0;
+        variable c0, c1  : integer;
+    begin
+        rst_i <= '1';
+        wait for CLK_PERIOD * 2;
+        wait until rising_edge(clk_i);
+        rst_i <= '0';
+        cen_i <= '1';
+
+        for w in WEIGHTS'range loop
+            for a0 in MIN_VALUE to MAX_VALUE loop
+                for a1 in MIN_VALUE to MAX_VALUE loop
+                    c0 := (a0 + a1) mod 2**DATA_WIDTH + MIN_VALUE;
+                    c1 := (a0 - a1) mod 2**DATA_WIDTH + MIN_VALUE;
+
+                    a0_i <= std_logic_vector(to_signed(a0, DATA_WIDTH));
+                    a1_i <= std_logic_vector(to_signed(a1, DATA_WIDTH));
+                    b_i  <= std_logic_vector(to_signed(WEIGHTS(w), DATA_WIDTH));
+                    c0_i <= std_logic_vector(to_signed(c0, DATA_WIDTH));
+                    c1_i <= std_logic_vector(to_signed(c1, DATA_WIDTH));
+                    wait until rising_edge(clk_i);
+                    wait for 1 ns;
+
+                    if y0_o /= expected(a0, WEIGHTS(w), c0) or y1_o /= expected(a1, WEIGHTS(w), c1) then
+                        errors := errors + 1;
+                        report "Mismatch for a0=" & integer'image(a0) & " a1=" & integer'image(a1) &
+                               " b=" & integer'image(WEIGHTS(w)) severity error;
+                    end if;
+                end loop;
+            end loop;
+        end loop;
+
+        assert errors = 0
+            report integer'image(errors) & " mismatches" severity error;
+
+        cen_i    <= '0';
+        sim_done <= true;
+        wait;
+    end process;
+
+end architecture;
@@ -0,0 +1,89 @@
+library ieee;
+use ieee.std_logic_1164.all;
+use ieee.numeric_std.all;
+
+library std;
+use std.textio.all;
+
+-- Access to the golden sets of hw/model/golden_model.py for the file-driven
+-- testbenches. Sets hold one decimal value per line and are read a value at
+-- a time, so frames of any size stream without being held in memory.
+package golden_pkg is
+
+    -- Opens a file of a golden set
+    procedure open_values(file f : text; dir : string; name : string);
+
+    -- Next value of a file (fails when the file runs out)
+    procedure read_value(file f : text; value : out integer);
+
+    -- Next state of the handshake LFSR
+    function lfsr_next(state : std_logic_vector(7 downto 0)) return std_logic_vector;
+
+    -- Random handshake decision (asserted three cycles in four)
+    function lfsr_hold(state : std_logic_vector(7 downto 0)) return boolean;
+
+    -- Seed for an LFSR (never all zeros)
+    function lfsr_seed(seed : integer) return std_logic_vector;
+
+    -- Frame timing report
+    procedure report_frame(frame, values, cycles, beats : integer);
+
+end package golden_pkg;
+
+package body golden_pkg is
+
+    procedure open_values(file f : text; dir : string; name : string) is
+        variable status : file_open_status;
+    begin
+        file_open(status, f, dir & "/" & name, read_mode);
+        assert status = open_ok
+            report "Cannot open " & dir & "/" & name severity failure;
+    end procedure;
+
+    procedure read_value(file f : text; value : out integer) is
+        variable l    : line;
+        variable good : boolean;
+    begin
+        assert not endfile(f)
+            report "Golden set ended early" severity failure;
+        readline(f, l);
+        read(l, value, good);
+        assert good
+            report "Malformed golden value" severity failure;
+        deallocate(l);
+    end procedure;
+
+    function lfsr_next(state : std_logic_vector(7 downto 0)) return std_logic_vector is
+    begin
+        return state(6 downto 0) & (state(7) xor state(5) xor state(4) xor state(3));
+    end function;
+
+    function lfsr_hold(state : std_logic_vector(7 downto 0)) return boolean is
+    begin
+        return state(1 downto 0) = "00";
+    end function;
+
+    function lfsr_seed(seed : integer) return std_logic_vector is
+    begin
+        if seed mod 256 = 0 then
+            return X"A7";
+        end if;
+        return std_logic_vector(to_unsigned(seed mod 256, 8));
+    end function;
+
+    procedure report_frame(frame, values, cycles, beats : integer) is
+        variable hundredths : integer;
+    begin
+        hundredths := (100*cycles) / beats;
+        if hundredths mod 100 < 10 then
+            report "Frame " & integer'image(frame) & ": " & integer'image(values) & " values in " &
+                   integer'image(cycles) & " cycles, " & integer'image(hundredths / 100) & ".0" &
+                   integer'image(hundredths mod 100) & " cycles per input beat";
+        else
+            report "Frame " & integer'image(frame) & ": " & integer'image(values) & " values in " &
+                   integer'image(cycles) & " cycles, " & integer'image(hundredths / 100) & "." &
+                   integer'image(hundredths mod 100) & " cycles per input beat";
+        end if;
+    end procedure;
+
+end package body golden_pkg;
@@ -0,0 +1,198 @@
+library ieee;
+use ieee.std_logic_1164.all;
+use ieee.numeric_std.all;
+
+entity packer_tb is
+end packer_tb;
+
+architecture sim of packer_tb is
+
+    -- Constants
+    constant CLK_PERIOD      : time    := 40 ns;
+    constant DATA_WIDTH      : integer := 32;
+    constant PIXELS_PER_BEAT : integer := 4;
+    constant INPUT_LANES     : integer := 8;   -- Two filters per pixel
+    constant NUM_FRAMES      : integer := 4;
+    constant FRAME_BEATS     : integer := 23;
+
+    -- Components
+    component packer is
+        generic (
+            DATA_WIDTH      : integer := 32;
+            PIXELS_PER_BEAT : integer := 2;
+            INPUT_LANES     : integer := 2
+        );
+        port (
+            clk_i   : in  std_logic;
+            rst_i   : in  std_logic;
+            data_i  : in  std_logic_vector(INPUT_LANES*DATA_WIDTH-1 downto 0);
+            keep_i  : in  std_logic_vector(INPUT_LANES-1 downto 0);
+            valid_i : in  std_logic;
+            ready_o : out std_logic;
+            last_i  : in  std_logic;
+            data_o  : out std_logic_vector(PIXELS_PER_BEAT*DATA_WIDTH-1 downto 0);
+            keep_o  : out std_logic_vector(PIXELS_PER_BEAT-1 downto 0);
+            valid_o : out std_logic;
+            ready_i : in  std_logic;
+            last_o  : out std_logic
+        );
+    end component packer;
+
+    -- Signals
+    signal clk_i   : std_logic := '0';
+    signal rst_i   : std_logic := '0';
+
+    -- Input Stream
+    signal data_i  : std_logic_vector(INPUT_LANES*DATA_WIDTH-1 downto 0) := (others => '0');
+    signal keep_i  : std_logic_vector(INPUT_LANES-1 downto 0) := (others => '0');
+    signal valid_i : std_logic := '0';
+    signal ready_o : std_logic;
+    signal last_i  : std_logic := '0';
+
+    -- Output Stream
+    signal data_o  : std_logic_vector(PIXELS_PER_BEAT*DATA_WIDTH-1 downto 0);
+    signal keep_o  : std_logic_vector(PIXELS_PER_BEAT-1 downto 0);
+    signal valid_o : std_logic;
+    signal ready_i : std_logic := '1';
+    signal last_o  : std_logic;
+
+    signal rand_ready : std_logic_vector(7 downto 0) := (others => '0');
+    signal sim_done   : boolean := false;
+
+    -- Checking (values sent per frame, values and frames received)
+    type counts_t is array (0 to NUM_FRAMES-1) of integer;
+    signal sent     : counts_t := (others => 0);
+    signal received : counts_t := (others => 0);
+
+begin
+
+    -- Clock generation
+    clk_gen: process
+    begin
+        while not sim_done loop
+            clk_i <= '0';
+            wait for CLK_PERIOD/2;
+            clk_i <= '1';
+            wait for CLK_PERIOD/2;
+        end loop;
+        wait;
+    end process;
+
+    -- Instantiation
+    DUT: packer
+        generic map (
+            DATA_WIDTH      => DATA_WIDTH,
+            PIXELS_PER_BEAT => PIXELS_PER_BEAT,
+            INPUT_LANES     => INPUT_LANES
+        )
+        port map (
+            clk_i   => clk_i,
+            rst_i   => rst_i,
+            data_i  => data_i,
+            keep_i  => keep_i,
+            valid_i => valid_i,
+            ready_o => ready_o,
+            last_i  => last_i,
+            data_o  => data_o,
+            keep_o  => keep_o,
+            valid_o => valid_o,
+            ready_i => ready_i,
+            last_o  => last_o
+        );
+
+    -- Stimulus process (kept lanes carry consecutive values, restarting each frame)
+    stim_proc: process
+        variable value   : integer;
+        variable pattern : unsigned(7 downto 0) := X"5B";
+    begin
+        rst_i <= '1';
+        wait for 100 ns;
+        rst_i <= '0';
+        wait for 10 ns;
+
+        for frame in 0 to NUM_FRAMES-1 loop
+            value := 0;
+            for beat in 0 to FRAME_BEATS-1 loop
+                wait until rising_edge(clk_i) and ready_o = '1';
+
+                -- Pseudo-random keep pattern, never empty on the closing beat
+                pattern := pattern(6 downto 0) & (pattern(7) xor pattern(5) xor pattern(4) xor pattern(3));
+                keep_i <= std_logic_vector(pattern(INPUT_LANES-1 downto 0));
+                if beat = FRAME_BEATS-1 then
+                    keep_i(0) <= '1';
+                end if;
+
+                for lane in 0 to INPUT_LANES-1 loop
+                    if pattern(lane) = '1' or (beat = FRAME_BEATS-1 and lane = 0) then
+                        data_i((lane + 1)*DATA_WIDTH-1 downto lane*DATA_WIDTH) <= std_logic_vector(to_unsigned(value, DATA_WIDTH));
+                        value := value + 1;
+                    else
+                        data_i((lane + 1)*DATA_WIDTH-1 downto lane*DATA_WIDTH) <= (others => '1');
+                    end if;
+                end loop;
+
+                valid_i <= '1';
+                if beat = FRAME_BEATS-1 then
+                    last_i <= '1';
+                end if;
+            end loop;
+            sent(frame) <= value;
+
+            wait until rising_edge(clk_i) and ready_o = '1';
+            valid_i <= '0';
+            last_i  <= '0';
+        end loop;
+
+        wait for CLK_PERIOD * 20;
+
+        for frame in 0 to NUM_FRAMES-1 loop
+            assert received(frame) = sent(frame)
+                report "Frame " & integer'image(frame) & ": got " & integer'image(received(frame)) &
+                       " of " & integer'image(sent(frame)) & " values" severity error;
+        end loop;
+
+        sim_done <= true;
+        wait;
+    end process;
+
+    -- Monitor process (full beats until the frame's last, which may be partial)
+    monitor_proc: process(clk_i)
+        variable frame : integer := 0;
+        variable value : integer := 0;
+    begin
+        if rising_edge(clk_i) then
+            if valid_o = '1' and ready_i = '1' then
+                for lane in 0 to PIXELS_PER_BEAT-1 loop
+                    if keep_o(lane) = '1' then
+                        assert to_integer(unsigned(data_o((lane + 1)*DATA_WIDTH-1 downto lane*DATA_WIDTH))) = value
+                            report "Frame " & integer'image(frame) & " value " & integer'image(value) & " mismatch" severity error;
+                        value := value + 1;
+                    end if;
+                end loop;
+
+                assert last_o = '1' or keep_o = (keep_o'range => '1')
+                    report "Partial beat before the end of a frame" severity error;
+
+                if last_o = '1' then
+                    received(frame) <= value;
+                    frame := frame + 1;
+                    value := 0;
+                end if;
+            end if;
+        end if;
+    end process;
+
+    backpressure_proc: process(clk_i)
+    begin
+        if rising_edge(clk_i) then
+            if rst_i = '1' then
+                ready_i    <= '0';
+                rand_ready <= (0 => '1', others => '0');
+            else
+                rand_ready <= rand_ready(6 downto 0) & (rand_ready(7) xnor rand_ready(5));
+                ready_i    <= rand_ready(0);
+            end if;
+        end if;
+    end process;
+
+end architecture sim;
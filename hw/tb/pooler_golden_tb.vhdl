@@ -0,0 +1,268 @@
+library ieee;
+use ieee.std_logic_1164.all;
+use ieee.numeric_std.all;
+
+library std;
+use std.textio.all;
+
+use work.golden_pkg.all;
+
+-- File-driven pooler test: streams activated.txt of a single-filter golden
+-- set (the ReLU output, ROWS x COLS being the convolution output size)
+-- through the pooler and checks every output value against expected.txt,
+-- with random gaps in valid and ready. scripts/golden_tb.sh sets the
+-- generics from the set's config.json.
+entity pooler_golden_tb is
+    generic (
+        GOLDEN_DIR   : string  := "golden";
+        ROWS         : integer := 1022;
+        COLS         : integer := 1022;
+        POOL_SIZE    : integer := 2;
+        POOL_MODE    : integer := 0;       -- 0: max, 1: average, 2: none
+        POOL_STRIDE  : integer := 0;       -- 0 means POOL_SIZE
+        DATA_WIDTH   : integer := 32;
+        FRAMES       : integer := 1;       -- Times the set is streamed, back to back
+        RANDOM_VALID : boolean := true;    -- Gaps in the input stream
+        RANDOM_READY : boolean := true;    -- Backpressure on the output stream
+        SEED         : integer := 1
+    );
+end pooler_golden_tb;
+
+architecture sim of pooler_golden_tb is
+
+    -- Constants
+    constant CLK_PERIOD  : time    := 10 ns;
+    constant BEATS       : integer := ROWS*COLS;
+    constant MAX_REPORTS : integer := 10;
+
+    -- Components
+    component pooler is
+        generic (
+            INPUT_SIZE      : integer := 6;
+            POOL_SIZE       : integer := 2;
+            DATA_WIDTH      : integer := 32;
+            PIXELS_PER_BEAT : integer := 1;
+            LANE_OFFSET     : integer := 0
+        );
+        port (
+            clk_i     : in  std_logic;
+            rst_i     : in  std_logic;
+            width_i   : in  std_logic_vector(15 downto 0);
+            height_i  : in  std_logic_vector(15 downto 0);
+            average_i : in  std_logic;
+            bypass_i  : in  std_logic;
+            stride_i  : in  std_logic_vector(7 downto 0);
+            data_i    : in  std_logic_vector(PIXELS_PER_BEAT*DATA_WIDTH-1 downto 0);
+            valid_i   : in  std_logic;
+            ready_o   : out std_logic;
+            last_i    : in  std_logic;
+            data_o    : out std_logic_vector(PIXELS_PER_BEAT*DATA_WIDTH-1 downto 0);
+            keep_o    : out std_logic_vector(PIXELS_PER_BEAT-1 downto 0);
+            valid_o   : out std_logic;
+            ready_i   : in  std_logic;
+            last_o    : out std_logic
+        );
+    end component pooler;
+
+    -- Signals
+    signal clk_i     : std_logic := '0';
+    signal rst_i     : std_logic := '0';
+    signal width_i   : std_logic_vector(15 downto 0) := std_logic_vector(to_unsigned(COLS, 16));
+    signal height_i  : std_logic_vector(15 downto 0) := std_logic_vector(to_unsigned(ROWS, 16));
+    signal average_i : std_logic := '0';
+    signal bypass_i  : std_logic := '0';
+    signal stride_i  : std_logic_vector(7 downto 0) := std_logic_vector(to_unsigned(POOL_STRIDE, 8));
+
+    -- Input Stream
+    signal data_i    : std_logic_vector(DATA_WIDTH-1 downto 0) := (others => '0');
+    signal valid_i   : std_logic := '0';
+    signal ready_o   : std_logic;
+    signal last_i    : std_logic := '0';
+
+    -- Output Stream
+    signal data_o    : std_logic_vector(DATA_WIDTH-1 downto 0);
+    signal keep_o    : std_logic_vector(0 downto 0);
+    signal valid_o   : std_logic;
+    signal ready_i   : std_logic := '0';
+    signal last_o    : std_logic;
+
+    -- Timing (cycle at which each frame's first beat was accepted)
+    type cycles_t is array (0 to FRAMES-1) of integer;
+    signal cycle       : integer := 0;
+    signal frame_start : cycles_t := (others => 0);
+
+    signal sim_done     : boolean := false;
+    signal monitor_done : boolean := false;
+    signal mismatches   : integer := 0;
+    signal checked      : integer := 0;
+
+begin
+
+    -- Clock generation
+    clk_gen: process
+    begin
+        while not sim_done loop
+            clk_i <= '0';
+            wait for CLK_PERIOD/2;
+            clk_i <= '1';
+            wait for CLK_PERIOD/2;
+        end loop;
+        wait;
+    end process;
+
+    -- Cycle counter
+    cycle_proc: process(clk_i)
+    begin
+        if rising_edge(clk_i) then
+            cycle <= cycle + 1;
+        end if;
+    end process;
+
+    -- Modes
+    average_i <= '1' when POOL_MODE = 1 else '0';
+    bypass_i  <= '1' when POOL_MODE = 2 else '0';
+
+    -- Instantiation
+    DUT: pooler
+        generic map (
+            INPUT_SIZE => COLS,
+            POOL_SIZE  => POOL_SIZE,
+            DATA_WIDTH => DATA_WIDTH
+        )
+        port map (
+            clk_i     => clk_i,
+            rst_i     => rst_i,
+            width_i   => width_i,
+            height_i  => height_i,
+            average_i => average_i,
+            bypass_i  => bypass_i,
+            stride_i  => stride_i,
+            data_i    => data_i,
+            valid_i   => valid_i,
+            ready_o   => ready_o,
+            last_i    => last_i,
+            data_o    => data_o,
+            keep_o    => keep_o,
+            valid_o   => valid_o,
+            ready_i   => ready_i,
+            last_o    => last_o
+        );
+
+    -- Stimulus process (the input frame as often as requested)
+    stim_proc: process
+        file input_file  : text;
+        variable value   : integer;
+        variable pattern : std_logic_vector(7 downto 0) := lfsr_seed(SEED);
+        variable beat    : integer;
+    begin
+        rst_i <= '1';
+        wait for CLK_PERIOD * 5;
+        rst_i <= '0';
+        wait until rising_edge(clk_i);
+
+        for frame in 0 to FRAMES-1 loop
+            open_values(input_file, GOLDEN_DIR, "activated.txt");
+            beat := 0;
+
+            while beat < BEATS loop
+                pattern := lfsr_next(pattern);
+                if RANDOM_VALID and lfsr_hold(pattern) then
+                    valid_i <= '0';
+                    wait until rising_edge(clk_i);
+                else
+                    read_value(input_file, value);
+                    data_i  <= std_logic_vector(to_signed(value, DATA_WIDTH));
+                    valid_i <= '1';
+                    if beat = BEATS-1 then
+                        last_i <= '1';
+                    else
+                        last_i <= '0';
+                    end if;
+                    wait until rising_edge(clk_i) and ready_o = '1';
+                    if beat = 0 then
+                        frame_start(frame) <= cycle;
+                    end if;
+                    beat := beat + 1;
+                end if;
+            end loop;
+
+            file_close(input_file);
+        end loop;
+        valid_i <= '0';
+        last_i  <= '0';
+
+        -- Drain (generous bound: every output beat stalled by backpressure)
+        if not monitor_done then
+            wait until monitor_done for CLK_PERIOD * (4*BEATS + 1000);
+        end if;
+
+        assert monitor_done
+            report "Timed out with " & integer'image(checked) & " values checked" severity error;
+        assert mismatches = 0
+            report integer'image(mismatches) & " of " & integer'image(checked) & " values differ" severity error;
+        report "Checked " & integer'image(checked) & " values over " & integer'image(FRAMES) & " frames";
+
+        sim_done <= true;
+        wait;
+    end process;
+
+    -- Monitor process (every output beat ends a window)
+    monitor_proc: process
+        file expected_file : text;
+        variable expected  : integer;
+        variable actual    : integer;
+        variable errors    : integer := 0;
+        variable total     : integer := 0;
+        variable values    : integer;
+    begin
+        for frame in 0 to FRAMES-1 loop
+            open_values(expected_file, GOLDEN_DIR, "expected.txt");
+            values := 0;
+
+            loop
+                wait until rising_edge(clk_i) and valid_o = '1' and ready_i = '1';
+                read_value(expected_file, expected);
+                actual := to_integer(signed(data_o));
+                if actual /= expected or keep_o /= "1" then
+                    errors := errors + 1;
+                    assert errors > MAX_REPORTS
+                        report "Frame " & integer'image(frame) & " value " & integer'image(values) & ": got " &
+                               integer'image(actual) & ", expected " & integer'image(expected) severity error;
+                end if;
+                values := values + 1;
+                exit when last_o = '1';
+            end loop;
+
+            assert endfile(expected_file)
+                report "Frame " & integer'image(frame) & " ended after " & integer'image(values) & " values" severity error;
+            file_close(expected_file);
+            report_frame(frame, values, cycle - frame_start(frame), BEATS);
+
+            total      := total + values;
+            checked    <= total;
+            mismatches <= errors;
+        end loop;
+
+        monitor_done <= true;
+        wait;
+    end process;
+
+    -- Backpressure process
+    backpressure_proc: process(clk_i)
+        variable pattern : std_logic_vector(7 downto 0) := lfsr_seed(SEED + 97);
+    begin
+        if rising_edge(clk_i) then
+            if rst_i = '1' or not RANDOM_READY then
+                ready_i <= '1';
+            else
+                pattern := lfsr_next(pattern);
+                if lfsr_hold(pattern) then
+                    ready_i <= '0';
+                else
+                    ready_i <= '1';
+                end if;
+            end if;
+        end if;
+    end process;
+
+end architecture sim;
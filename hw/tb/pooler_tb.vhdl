@@ -19,16 +19,24 @@ architecture sim of pooler_tb is
         generic (
             INPUT_SIZE      : integer := 6;
             POOL_SIZE       : integer := 2;
-            DATA_WIDTH      : integer := 32
+            DATA_WIDTH      : integer := 32;
+            PIXELS_PER_BEAT : integer := 1;
+            LANE_OFFSET     : integer := 0
         );
         port (
             clk_i   : in  std_logic;
             rst_i   : in  std_logic;
-            data_i  : in  std_logic_vector(DATA_WIDTH-1 downto 0);
+            width_i  : in  std_logic_vector(15 downto 0);
+            height_i : in  std_logic_vector(15 downto 0);
+            average_i : in  std_logic;
+            bypass_i  : in  std_logic;
+            stride_i  : in  std_logic_vector(7 downto 0);
+            data_i  : in  std_logic_vector(PIXELS_PER_BEAT*DATA_WIDTH-1 downto 0);
             valid_i : in  std_logic;
             ready_o : out std_logic;
             last_i  : in  std_logic;
-            data_o  : out std_logic_vector(DATA_WIDTH-1 downto 0);
+            data_o  : out std_logic_vector(PIXELS_PER_BEAT*DATA_WIDTH-1 downto 0);
+            keep_o  : out std_logic_vector(PIXELS_PER_BEAT-1 downto 0);
             valid_o : out std_logic;
             ready_i : in  std_logic;
             last_o  : out std_logic
@@ -38,6 +46,13 @@ architecture sim of pooler_tb is
     -- Signals
     signal clk_i    : std_logic := '0';
     signal rst_i    : std_logic := '0';
+    signal width_i  : std_logic_vector(15 downto 0) := std_logic_vector(to_unsigned(INPUT_SIZE, 16));
+    signal height_i : std_logic_vector(15 downto 0) := std_logic_vector(to_unsigned(INPUT_SIZE, 16));
+
+    -- Modes (max pooling with stride POOL_SIZE by default)
+    signal average_i : std_logic := '0';
+    signal bypass_i  : std_logic := '0';
+    signal stride_i  : std_logic_vector(7 downto 0) := (others => '0');
     
     -- Input Stream
     signal data_i   : std_logic_vector(DATA_WIDTH-1 downto 0) := (others => '0');
@@ -47,12 +62,63 @@ architecture sim of pooler_tb is
     
     -- Output Stream
     signal data_o   : std_logic_vector(DATA_WIDTH-1 downto 0);
+    signal keep_o   : std_logic_vector(0 downto 0);
     signal valid_o  : std_logic;
     signal ready_i  : std_logic := '1';
     signal last_o   : std_logic;
     
     signal rand_ready : std_logic_vector(7 downto 0) := (others => '0');
     signal sim_done : boolean := false;
+
+    -- Size sweep checking
+    signal check_en    : boolean := false;
+    signal check_count : integer := 0;
+
+    -- Window size and step for the current modes
+    function span(bypass : std_logic) return integer is
+    begin
+        if bypass = '1' then
+            return 1;
+        end if;
+        return POOL_SIZE;
+    end function;
+
+    function step(bypass : std_logic; stride : std_logic_vector) return integer is
+    begin
+        if bypass = '1' then
+            return 1;
+        elsif unsigned(stride) = 0 then
+            return POOL_SIZE;
+        end if;
+        return to_integer(unsigned(stride));
+    end function;
+
+    -- Outputs per row or column
+    function pooled(size : integer; bypass : std_logic; stride : std_logic_vector) return integer is
+    begin
+        return (size - span(bypass)) / step(bypass, stride) + 1;
+    end function;
+
+    -- Expected output for a ramp input (the window maximum is its last
+    -- pixel, the mean is floored)
+    function expected(index, width : integer; average, bypass : std_logic; stride : std_logic_vector) return integer is
+        variable r, c : integer;
+        variable sum  : integer;
+    begin
+        r := (index / pooled(width, bypass, stride)) * step(bypass, stride) + span(bypass) - 1;
+        c := (index mod pooled(width, bypass, stride)) * step(bypass, stride) + span(bypass) - 1;
+        if average = '0' or bypass = '1' then
+            return (r*width + c) * 2**FRACTIONAL_BITS;
+        end if;
+
+        sum := 0;
+        for i in 0 to POOL_SIZE-1 loop
+            for j in 0 to POOL_SIZE-1 loop
+                sum := sum + ((r-i)*width + c-j) * 2**FRACTIONAL_BITS;
+            end loop;
+        end loop;
+        return sum / (POOL_SIZE*POOL_SIZE);  -- Ramp values are positive
+    end function;
     
     -- Helper functions
     function to_fixed(real_num : real) return std_logic_vector is
@@ -91,11 +157,17 @@ begin
         port map (
             clk_i    => clk_i,
             rst_i    => rst_i,
+            width_i  => width_i,
+            height_i => height_i,
+            average_i => average_i,
+            bypass_i  => bypass_i,
+            stride_i  => stride_i,
             data_i   => data_i,
             valid_i  => valid_i,
             ready_o  => ready_o,
             last_i   => last_i,
             data_o   => data_o,
+            keep_o   => keep_o,
             valid_o  => valid_o,
             ready_i  => ready_i,
             last_o   => last_o
@@ -103,6 +175,8 @@ begin
 
     -- Stimulus process
     stim_proc: process
+        type modes_t is array (0 to 5) of std_logic_vector(9 downto 0);  -- average, bypass, stride
+        constant MODES       : modes_t := ("00" & X"01", "10" & X"00", "10" & X"01", "01" & X"00", "00" & X"03", "11" & X"02");
         variable input_count : integer := 0;
         variable sign        : integer := 0;
     begin
@@ -180,6 +254,71 @@ begin
         
         -- Wait for completion
         wait for CLK_PERIOD * (POOL_SIZE*POOL_SIZE + 10);
+
+        -- Size sweep: odd sizes drop the trailing row and column
+        check_en <= true;
+        for size in INPUT_SIZE downto POOL_SIZE loop
+            width_i  <= std_logic_vector(to_unsigned(size, 16));
+            height_i <= std_logic_vector(to_unsigned(size, 16));
+            input_count := 0;
+            report "Size sweep: " & integer'image(size) & "x" & integer'image(size);
+            wait until rising_edge(clk_i);
+
+            for row in 0 to size-1 loop
+                for col in 0 to size-1 loop
+                    wait until rising_edge(clk_i) and ready_o = '1';
+                    data_i  <= to_fixed(real(input_count));
+                    valid_i <= '1';
+                    if (row = size-1) and (col = size-1) then
+                        last_i <= '1';
+                    end if;
+                    input_count := input_count + 1;
+                end loop;
+            end loop;
+
+            wait until rising_edge(clk_i) and ready_o = '1';
+            valid_i <= '0';
+            last_i  <= '0';
+            wait for CLK_PERIOD * (POOL_SIZE*POOL_SIZE + 10);
+
+            assert check_count = (size / POOL_SIZE) * (size / POOL_SIZE)
+                report "Size " & integer'image(size) & ": got " & integer'image(check_count) & " outputs" severity error;
+        end loop;
+
+        -- Mode sweep: overlapping and sparse windows, averages and bypass
+        for m in MODES'range loop
+            for size in INPUT_SIZE-1 to INPUT_SIZE loop
+                average_i <= MODES(m)(9);
+                bypass_i  <= MODES(m)(8);
+                stride_i  <= MODES(m)(7 downto 0);
+                width_i   <= std_logic_vector(to_unsigned(size, 16));
+                height_i  <= std_logic_vector(to_unsigned(size, 16));
+                input_count := 0;
+                report "Mode sweep: " & integer'image(m) & " at " & integer'image(size) & "x" & integer'image(size);
+                wait until rising_edge(clk_i);
+
+                for row in 0 to size-1 loop
+                    for col in 0 to size-1 loop
+                        wait until rising_edge(clk_i) and ready_o = '1';
+                        data_i  <= to_fixed(real(input_count));
+                        valid_i <= '1';
+                        if (row = size-1) and (col = size-1) then
+                            last_i <= '1';
+                        end if;
+                        input_count := input_count + 1;
+                    end loop;
+                end loop;
+
+                wait until rising_edge(clk_i) and ready_o = '1';
+                valid_i <= '0';
+                last_i  <= '0';
+                wait for CLK_PERIOD * (POOL_SIZE*POOL_SIZE + size*size + 10);
+
+                assert check_count = pooled(size, bypass_i, stride_i)**2
+                    report "Mode " & integer'image(m) & " size " & integer'image(size) & ": got " &
+                           integer'image(check_count) & " outputs" severity error;
+            end loop;
+        end loop;
         
         sim_done <= true;
         wait;
@@ -187,10 +326,22 @@ begin
     
     -- Monitor process
     monitor_proc: process(clk_i)
+        variable count : integer := 0;
     begin
         if rising_edge(clk_i) then
             if valid_o = '1' and ready_i = '1' then
                 report "Valid output: " & real'image(to_real(data_o));
+
+                -- Check values and frame length during the size sweep
+                if check_en then
+                    assert to_integer(signed(data_o)) = expected(count, to_integer(unsigned(width_i)), average_i, bypass_i, stride_i) and keep_o = "1"
+                        report "Output " & integer'image(count) & " mismatch" severity error;
+                    count := count + 1;
+                    if last_o = '1' then
+                        check_count <= count;
+                        count := 0;
+                    end if;
+                end if;
             end if;
             
             if last_o = '1' and valid_o = '1' and ready_i = '1' then
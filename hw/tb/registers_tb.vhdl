@@ -12,10 +12,12 @@ architecture sim of registers_tb is
     constant DATA_WIDTH    : integer := 32;
     constant ADDR_WIDTH    : integer := 8;
     constant NUM_REGISTERS : integer := 9;
+    constant INPUT_SIZE    : integer := 6;
    
     -- Components
     component registers is
         generic (
+            INPUT_SIZE    : integer := 6;
             DATA_WIDTH	  : integer	:= 32;
             ADDR_WIDTH	  : integer	:= 8;
             NUM_REGISTERS : integer := 9
@@ -53,8 +55,28 @@ architecture sim of registers_tb is
             rvalid_o  : out std_logic;
             rready_i  : in  std_logic;
 
+            -- Bank Control
+            swap_i       : in  std_logic;
+            chain_swap_i : in  std_logic;
+
+            -- Performance Events
+            busy_i      : in  std_logic;
+            in_stall_i  : in  std_logic;
+            out_stall_i : in  std_logic;
+            in_beat_i   : in  std_logic;
+            out_beat_i  : in  std_logic;
+            frame_i     : in  std_logic;
+
             -- Output Interface
-            kernel_o  : out std_logic_vector(DATA_WIDTH*NUM_REGISTERS-1 downto 0)
+            kernel_o  : out std_logic_vector(DATA_WIDTH*NUM_REGISTERS-1 downto 0);
+            width_o   : out std_logic_vector(15 downto 0);
+            height_o  : out std_logic_vector(15 downto 0);
+            packet_o  : out std_logic_vector(15 downto 0);
+            stages_o  : out std_logic_vector(15 downto 0);
+            chain_o        : out std_logic_vector(15 downto 0);
+            chain_width_o  : out std_logic_vector(15 downto 0);
+            chain_height_o : out std_logic_vector(15 downto 0);
+            chain_stages_o : out std_logic_vector(15 downto 0)
         );
     end component registers;
    
@@ -80,7 +102,32 @@ architecture sim of registers_tb is
     signal rresp_o   : std_logic_vector(1 downto 0);
     signal rvalid_o  : std_logic;
     signal rready_i  : std_logic := '0';
+    signal swap_i    : std_logic := '0';
+    signal chain_swap_i : std_logic := '0';
+    signal busy_i      : std_logic := '0';
+    signal in_stall_i  : std_logic := '0';
+    signal out_stall_i : std_logic := '0';
+    signal in_beat_i   : std_logic := '0';
+    signal out_beat_i  : std_logic := '0';
+    signal frame_i     : std_logic := '0';
+    signal kernel_o  : std_logic_vector(DATA_WIDTH*NUM_REGISTERS-1 downto 0);
+    signal width_o   : std_logic_vector(15 downto 0);
+    signal height_o  : std_logic_vector(15 downto 0);
+    signal packet_o  : std_logic_vector(15 downto 0);
+    signal stages_o  : std_logic_vector(15 downto 0);
+    signal chain_o        : std_logic_vector(15 downto 0);
+    signal chain_width_o  : std_logic_vector(15 downto 0);
+    signal chain_height_o : std_logic_vector(15 downto 0);
+    signal chain_stages_o : std_logic_vector(15 downto 0);
    
+    -- Control and performance counter registers
+    constant REG_PACKET    : integer := NUM_REGISTERS + 2;
+    constant REG_STAGES    : integer := NUM_REGISTERS + 3;
+    constant REG_CHAIN     : integer := NUM_REGISTERS + 4;
+    constant REG_PERF_CTRL : integer := NUM_REGISTERS + 8;
+    constant REG_COUNTERS  : integer := NUM_REGISTERS + 9;
+    constant REG_COMMIT    : integer := NUM_REGISTERS + 15;
+
     -- Simulation control
     signal sim_done : boolean := false;
    
@@ -98,6 +145,15 @@ architecture sim of registers_tb is
         return str;
     end function;
    
+    function to_std_logic(b : boolean) return std_logic is
+    begin
+        if b then
+            return '1';
+        else
+            return '0';
+        end if;
+    end function;
+   
     -- Helper procedure for writing to register
     procedure write_register(
         signal clk      : in  std_logic;
@@ -201,6 +257,7 @@ begin
    -- DUT instantiation
    DUT: registers
        generic map (
+           INPUT_SIZE    => INPUT_SIZE,
            DATA_WIDTH    => DATA_WIDTH,
            ADDR_WIDTH    => ADDR_WIDTH,
            NUM_REGISTERS => NUM_REGISTERS
@@ -226,7 +283,24 @@ begin
            rdata_o   => rdata_o,
            rresp_o   => rresp_o,
            rvalid_o  => rvalid_o,
-           rready_i  => rready_i
+           rready_i  => rready_i,
+           swap_i       => swap_i,
+           chain_swap_i => chain_swap_i,
+           busy_i      => busy_i,
+           in_stall_i  => in_stall_i,
+           out_stall_i => out_stall_i,
+           in_beat_i   => in_beat_i,
+           out_beat_i  => out_beat_i,
+           frame_i     => frame_i,
+           kernel_o  => kernel_o,
+           width_o   => width_o,
+           height_o  => height_o,
+           packet_o  => packet_o,
+           stages_o  => stages_o,
+           chain_o        => chain_o,
+           chain_width_o  => chain_width_o,
+           chain_height_o => chain_height_o,
+           chain_stages_o => chain_stages_o
        );
        
    -- Stimulus process
@@ -272,6 +346,239 @@ begin
        end if;
        
        wait for CLK_PERIOD * 2;
+
+       -- Shadow writes must not reach the kernel before a swap
+       assert kernel_o(DATA_WIDTH-1 downto 0) = x"00000000"
+           report "Kernel changed without swap" severity error;
+
+       -- A frame boundary without a commit leaves the active bank alone
+       swap_i <= '1';
+       wait until rising_edge(clk_i);
+       swap_i <= '0';
+       wait until rising_edge(clk_i);
+
+       assert kernel_o(DATA_WIDTH-1 downto 0) = x"00000000"
+           report "Kernel changed without commit" severity error;
+
+       -- Commit, then swap banks
+       write_register(clk_i, awaddr_i, awvalid_i, wdata_i, wvalid_i, bready_i,
+                     REG_COMMIT*4, x"00000001");
+       swap_i <= '1';
+       chain_swap_i <= '1';
+       wait until rising_edge(clk_i);
+       swap_i <= '0';
+       chain_swap_i <= '0';
+       wait until rising_edge(clk_i);
+
+       assert kernel_o(DATA_WIDTH-1 downto 0) = x"12345678"
+           report "Kernel reg0 not updated by swap: " & to_string(kernel_o(DATA_WIDTH-1 downto 0)) severity error;
+       assert kernel_o(9*DATA_WIDTH-1 downto 8*DATA_WIDTH) = x"87654321"
+           report "Kernel reg8 not updated by swap: " & to_string(kernel_o(9*DATA_WIDTH-1 downto 8*DATA_WIDTH)) severity error;
+
+       -- Load the next kernel while the current one stays active
+       write_register(clk_i, awaddr_i, awvalid_i, wdata_i, wvalid_i, bready_i,
+                     0, x"0000CAFE");
+       wait for CLK_PERIOD * 2;
+
+       assert kernel_o(DATA_WIDTH-1 downto 0) = x"12345678"
+           report "Active kernel overwritten by shadow write" severity error;
+
+       -- Reads return the shadow bank
+       read_register(clk_i, araddr_i, arvalid_i, rready_i, 0);
+       assert rdata_o = x"0000CAFE"
+           report "Shadow read back: " & to_string(rdata_o) severity error;
+
+       wait for CLK_PERIOD * 2;
+
+       -- An upload straddling a frame end: the boundary after the first
+       -- half must not make it live, the one after the commit makes all of
+       -- it live at once
+       write_register(clk_i, awaddr_i, awvalid_i, wdata_i, wvalid_i, bready_i,
+                     0, x"0000BEEF");
+       swap_i <= '1';
+       wait until rising_edge(clk_i);
+       swap_i <= '0';
+       wait until rising_edge(clk_i);
+
+       assert kernel_o(DATA_WIDTH-1 downto 0) = x"12345678"
+           report "Half-written upload went live at a frame end" severity error;
+
+       write_register(clk_i, awaddr_i, awvalid_i, wdata_i, wvalid_i, bready_i,
+                     32, x"0000F00D");
+       write_register(clk_i, awaddr_i, awvalid_i, wdata_i, wvalid_i, bready_i,
+                     REG_COMMIT*4, x"00000001");
+       read_register(clk_i, araddr_i, arvalid_i, rready_i, REG_COMMIT*4);
+       assert rdata_o = x"00000003"
+           report "Commit not pending: " & to_string(rdata_o) severity error;
+       assert kernel_o(DATA_WIDTH-1 downto 0) = x"12345678"
+           report "Committed upload went live before a frame boundary" severity error;
+
+       swap_i <= '1';
+       wait until rising_edge(clk_i);
+       swap_i <= '0';
+       wait until rising_edge(clk_i);
+
+       assert kernel_o(DATA_WIDTH-1 downto 0) = x"0000BEEF" and kernel_o(9*DATA_WIDTH-1 downto 8*DATA_WIDTH) = x"0000F00D"
+           report "Committed upload not applied whole" severity error;
+
+       -- The second layer's half stays pending until its own boundary
+       read_register(clk_i, araddr_i, arvalid_i, rready_i, REG_COMMIT*4);
+       assert rdata_o = x"00000002"
+           report "Second layer commit not pending: " & to_string(rdata_o) severity error;
+
+       chain_swap_i <= '1';
+       wait until rising_edge(clk_i);
+       chain_swap_i <= '0';
+       wait until rising_edge(clk_i);
+
+       read_register(clk_i, araddr_i, arvalid_i, rready_i, REG_COMMIT*4);
+       assert rdata_o = x"00000000"
+           report "Commit still pending: " & to_string(rdata_o) severity error;
+
+       wait for CLK_PERIOD * 2;
+
+       -- Dimensions reset to the synthesized maximum
+       assert to_integer(unsigned(width_o)) = INPUT_SIZE and to_integer(unsigned(height_o)) = INPUT_SIZE
+           report "Dimensions not at maximum after reset" severity error;
+
+       -- Program a smaller frame, and an oversized height that must clamp
+       write_register(clk_i, awaddr_i, awvalid_i, wdata_i, wvalid_i, bready_i,
+                     NUM_REGISTERS*4, std_logic_vector(to_unsigned(INPUT_SIZE-2, DATA_WIDTH)));
+       write_register(clk_i, awaddr_i, awvalid_i, wdata_i, wvalid_i, bready_i,
+                     (NUM_REGISTERS+1)*4, std_logic_vector(to_unsigned(INPUT_SIZE+5, DATA_WIDTH)));
+       write_register(clk_i, awaddr_i, awvalid_i, wdata_i, wvalid_i, bready_i,
+                     REG_COMMIT*4, x"00000001");
+       swap_i <= '1';
+       chain_swap_i <= '1';
+       wait until rising_edge(clk_i);
+       swap_i <= '0';
+       chain_swap_i <= '0';
+       wait until rising_edge(clk_i);
+
+       assert to_integer(unsigned(width_o)) = INPUT_SIZE-2
+           report "Width not applied: " & to_string(width_o) severity error;
+       assert to_integer(unsigned(height_o)) = INPUT_SIZE
+           report "Height not clamped: " & to_string(height_o) severity error;
+
+       -- Every frame closes its own packet until a batch size is programmed
+       assert to_integer(unsigned(packet_o)) = 1
+           report "Packet size not one after reset: " & to_string(packet_o) severity error;
+
+       write_register(clk_i, awaddr_i, awvalid_i, wdata_i, wvalid_i, bready_i,
+                     REG_PACKET*4, std_logic_vector(to_unsigned(4, DATA_WIDTH)));
+       write_register(clk_i, awaddr_i, awvalid_i, wdata_i, wvalid_i, bready_i,
+                     REG_COMMIT*4, x"00000001");
+       swap_i <= '1';
+       chain_swap_i <= '1';
+       wait until rising_edge(clk_i);
+       swap_i <= '0';
+       chain_swap_i <= '0';
+       wait until rising_edge(clk_i);
+
+       assert to_integer(unsigned(packet_o)) = 4
+           report "Packet size not applied: " & to_string(packet_o) severity error;
+
+       -- Stages default to ReLU and max pooling at the synthesized stride
+       assert stages_o = x"0001"
+           report "Stage modes not at default after reset: " & to_string(stages_o) severity error;
+
+       write_register(clk_i, awaddr_i, awvalid_i, wdata_i, wvalid_i, bready_i,
+                     REG_STAGES*4, x"00000102");
+       write_register(clk_i, awaddr_i, awvalid_i, wdata_i, wvalid_i, bready_i,
+                     REG_COMMIT*4, x"00000001");
+       swap_i <= '1';
+       chain_swap_i <= '1';
+       wait until rising_edge(clk_i);
+       swap_i <= '0';
+       chain_swap_i <= '0';
+       wait until rising_edge(clk_i);
+
+       assert stages_o = x"0102"
+           report "Stage modes not applied: " & to_string(stages_o) severity error;
+
+       -- Chaining is off after reset, with the second layer at full size
+       assert chain_o = x"0000" and to_integer(unsigned(chain_width_o)) = INPUT_SIZE and
+              to_integer(unsigned(chain_height_o)) = INPUT_SIZE and chain_stages_o = x"0001"
+           report "Chain settings not at default after reset" severity error;
+
+       write_register(clk_i, awaddr_i, awvalid_i, wdata_i, wvalid_i, bready_i,
+                     REG_CHAIN*4, x"00000001");
+       write_register(clk_i, awaddr_i, awvalid_i, wdata_i, wvalid_i, bready_i,
+                     (REG_CHAIN + 1)*4, std_logic_vector(to_unsigned(INPUT_SIZE-3, DATA_WIDTH)));
+       write_register(clk_i, awaddr_i, awvalid_i, wdata_i, wvalid_i, bready_i,
+                     (REG_CHAIN + 2)*4, std_logic_vector(to_unsigned(INPUT_SIZE+5, DATA_WIDTH)));
+       write_register(clk_i, awaddr_i, awvalid_i, wdata_i, wvalid_i, bready_i,
+                     (REG_CHAIN + 3)*4, x"00000004");
+       write_register(clk_i, awaddr_i, awvalid_i, wdata_i, wvalid_i, bready_i,
+                     REG_COMMIT*4, x"00000001");
+       swap_i <= '1';
+       wait until rising_edge(clk_i);
+       swap_i <= '0';
+       wait until rising_edge(clk_i);
+
+       -- The second layer's settings wait for its own frame boundary
+       assert chain_o = x"0001" and to_integer(unsigned(chain_width_o)) = INPUT_SIZE
+           report "Second layer settings applied at a first layer boundary" severity error;
+
+       chain_swap_i <= '1';
+       wait until rising_edge(clk_i);
+       chain_swap_i <= '0';
+       wait until rising_edge(clk_i);
+
+       assert chain_o = x"0001" and to_integer(unsigned(chain_width_o)) = INPUT_SIZE-3 and
+              to_integer(unsigned(chain_height_o)) = INPUT_SIZE and chain_stages_o = x"0004"
+           report "Chain settings not applied" severity error;
+
+       wait for CLK_PERIOD * 2;
+
+       -- Count events: 20 busy cycles, 12 with an input beat, 5 starved,
+       -- 8 with an output beat, 3 backpressured and 2 frames
+       wait until rising_edge(clk_i);
+       for i in 0 to 19 loop
+           busy_i      <= '1';
+           in_beat_i   <= to_std_logic(i < 12);
+           in_stall_i  <= to_std_logic(i >= 12 and i < 17);
+           out_beat_i  <= to_std_logic(i >= 10 and i < 18);
+           out_stall_i <= to_std_logic(i >= 17);
+           frame_i     <= to_std_logic(i = 13 or i = 17);
+           wait until rising_edge(clk_i);
+       end loop;
+       busy_i      <= '0';
+       in_beat_i   <= '0';
+       in_stall_i  <= '0';
+       out_beat_i  <= '0';
+       out_stall_i <= '0';
+       frame_i     <= '0';
+       wait until rising_edge(clk_i);
+
+       -- Nothing is visible until latched
+       read_register(clk_i, araddr_i, arvalid_i, rready_i, REG_COUNTERS*4);
+       assert unsigned(rdata_o) = 0
+           report "Counter visible before latch: " & to_string(rdata_o) severity error;
+
+       -- Latch and clear in one write, then check every counter
+       write_register(clk_i, awaddr_i, awvalid_i, wdata_i, wvalid_i, bready_i,
+                     REG_PERF_CTRL*4, x"00000003");
+       for i in 0 to 5 loop
+           read_register(clk_i, araddr_i, arvalid_i, rready_i, (REG_COUNTERS + i)*4);
+           case i is
+               when 0      => assert unsigned(rdata_o) = 20 report "Active cycles: " & to_string(rdata_o) severity error;
+               when 1      => assert unsigned(rdata_o) = 5  report "Input stalls: " & to_string(rdata_o) severity error;
+               when 2      => assert unsigned(rdata_o) = 3  report "Output stalls: " & to_string(rdata_o) severity error;
+               when 3      => assert unsigned(rdata_o) = 12 report "Input beats: " & to_string(rdata_o) severity error;
+               when 4      => assert unsigned(rdata_o) = 8  report "Output beats: " & to_string(rdata_o) severity error;
+               when others => assert unsigned(rdata_o) = 2  report "Frames: " & to_string(rdata_o) severity error;
+           end case;
+       end loop;
+
+       -- The clear restarted the live counters
+       write_register(clk_i, awaddr_i, awvalid_i, wdata_i, wvalid_i, bready_i,
+                     REG_PERF_CTRL*4, x"00000001");
+       read_register(clk_i, araddr_i, arvalid_i, rready_i, REG_COUNTERS*4);
+       assert unsigned(rdata_o) = 0
+           report "Counters not cleared: " & to_string(rdata_o) severity error;
+
+       wait for CLK_PERIOD * 2;
        
        -- End simulation
        wait for CLK_PERIOD * 10;
@@ -3,12 +3,28 @@
 # Source Vivado settings
 source /tools/Xilinx/Vivado/2024.2/settings64.sh
 
+# Configuration list (optional, one line of build_hw.tcl arguments each,
+# e.g. the Pareto front from hw/model/explore.py --emit)
+if [ -n "$1" ]; then
+    CONFIGS="$(cd "$(dirname "$1")" && pwd)/$(basename "$1")"
+fi
+
 # Create build directory
 mkdir -p build/vivado/
 
 # Change directory
 cd build/vivado/
 
+# Build only the listed configurations
+if [ -n "$CONFIGS" ]; then
+    while read -r ARGS; do
+        [ -z "$ARGS" ] && continue
+        echo "Running build with ($ARGS)"
+        vivado -mode batch -source ../../scripts/build_hw.tcl -tclargs $ARGS < /dev/null
+    done < "$CONFIGS"
+    exit 0
+fi
+
 # Define parameter arrays
 declare -a INPUT_SIZES=(4 8 16 32 64 128 256 512 1024)
 declare -a KERNEL_SIZES=(3)
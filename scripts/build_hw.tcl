@@ -1,8 +1,8 @@
 
 # Check arguments
-if { $argc != 6 } {
+if { $argc < 6 || $argc > 11 } {
     puts "Error: Incorrect number of arguments"
-    puts "Usage: vivado -mode batch -source build_hw.tcl -tclargs <INPUT_SIZE> <KERNEL_SIZE>"
+    puts "Usage: vivado -mode batch -source build_hw.tcl -tclargs <INPUT_SIZE> <KERNEL_SIZE> <STRIDE> <POOL_SIZE> <DATA_WIDTH> <FRAC_BITS> \[NUM_INSTANCES\] \[LINE_BUFFER_BRAM\] \[PIXELS_PER_BEAT\] \[NUM_FILTERS\] \[NUM_LAYERS\]"
     exit 1
 }
 
@@ -13,18 +13,59 @@ set STRIDE [lindex $argv 2]
 set POOL_SIZE [lindex $argv 3]
 set DATA_WIDTH [lindex $argv 4]
 set FRACTIONAL_BITS [lindex $argv 5]
+set NUM_INSTANCES 1
+if { $argc >= 7 } {
+    set NUM_INSTANCES [lindex $argv 6]
+}
+set LINE_BUFFER_BRAM 0
+if { $argc >= 8 } {
+    set LINE_BUFFER_BRAM [lindex $argv 7]
+}
+# Narrow samples default to filling a 32-bit beat (2 at 16 bits, 4 at 8 bits)
+set PIXELS_PER_BEAT [expr {max(1, 32 / $DATA_WIDTH)}]
+if { $argc >= 9 } {
+    set PIXELS_PER_BEAT [lindex $argv 8]
+}
+set NUM_FILTERS 1
+if { $argc >= 10 } {
+    set NUM_FILTERS [lindex $argv 9]
+}
+set NUM_LAYERS 1
+if { $argc == 11 } {
+    set NUM_LAYERS [lindex $argv 10]
+}
 
 # Calculations
-set NUM_REGISTERS [expr {$KERNEL_SIZE * $KERNEL_SIZE}]
-set ADDR_LSB [expr {$DATA_WIDTH/32 + 1}]
-set OPT_MEM_ADDR_BITS [expr {ceil(log($NUM_REGISTERS)/log(2))}]
+set NUM_REGISTERS [expr {$KERNEL_SIZE * $KERNEL_SIZE * ($NUM_FILTERS + $NUM_LAYERS - 1)}]
+# Width, height, frames per packet, stage modes, four chaining registers,
+# counter control, six performance counters and the bank commit
+set NUM_CONTROL_REGISTERS 16
+set ADDR_LSB 2
+set OPT_MEM_ADDR_BITS [expr {ceil(log($NUM_REGISTERS + $NUM_CONTROL_REGISTERS)/log(2))}]
 set ADDR_WIDTH [expr {$ADDR_LSB + $OPT_MEM_ADDR_BITS}]
+set STREAM_WIDTH [expr {$DATA_WIDTH * $PIXELS_PER_BEAT}]
+set MM_WIDTH [expr {max(32, $STREAM_WIDTH)}]
 
 # Board Repository
 set_param board.repoPaths [list "$::env(HOME)/.Xilinx/Vivado/2024.2/xhub/board_store/xilinx_board_store"]
 
 # Project name
 set PROJECT "hw_M${INPUT_SIZE}_K${KERNEL_SIZE}_S${STRIDE}_P${POOL_SIZE}_Q${DATA_WIDTH}-${FRACTIONAL_BITS}"
+if { $NUM_INSTANCES > 1 } {
+    append PROJECT "_N${NUM_INSTANCES}"
+}
+if { $LINE_BUFFER_BRAM != 0 } {
+    append PROJECT "_BRAM"
+}
+if { $PIXELS_PER_BEAT > 1 } {
+    append PROJECT "_X${PIXELS_PER_BEAT}"
+}
+if { $NUM_FILTERS > 1 } {
+    append PROJECT "_F${NUM_FILTERS}"
+}
+if { $NUM_LAYERS > 1 } {
+    append PROJECT "_L${NUM_LAYERS}"
+}
 
 # Setup directories
 set ROOT_DIR "[file normalize [file dirname [info script]]]/.."
@@ -91,10 +132,19 @@ create_bd_cell -type ip -vlnv xilinx.com:ip:axi_dma:7.1 axi_dma_0
 # Add Concat
 create_bd_cell -type ip -vlnv xilinx.com:ip:xlconcat:2.1 xlconcat_0
 
+# Configure Concat (one MM2S and one S2MM interrupt per instance)
+set_property CONFIG.NUM_PORTS [expr {2 * $NUM_INSTANCES}] [get_bd_cells xlconcat_0]
+
 # Configure DMA
 set_property CONFIG.c_sg_include_stscntrl_strm {0} [get_bd_cells axi_dma_0]
 set_property CONFIG.c_include_sg {0} [get_bd_cells axi_dma_0]
 set_property CONFIG.c_sg_length_width {23} [get_bd_cells axi_dma_0]
+set_property -dict [list \
+  CONFIG.c_m_axi_mm2s_data_width $MM_WIDTH \
+  CONFIG.c_m_axis_mm2s_tdata_width $STREAM_WIDTH \
+  CONFIG.c_m_axi_s2mm_data_width $MM_WIDTH \
+  CONFIG.c_s_axis_s2mm_tdata_width $STREAM_WIDTH \
+] [get_bd_cells axi_dma_0]
 
 # Automation 1
 apply_bd_automation -rule xilinx.com:bd_rule:axi4 -config { Clk_master {Auto} Clk_slave {Auto} Clk_xbar {Auto} Master {/processing_system7_0/M_AXI_GP0} Slave {/accelerator_0/s_axi} ddr_seg {Auto} intc_ip {New AXI SmartConnect} master_apm {0}}  [get_bd_intf_pins accelerator_0/s_axi]
@@ -126,6 +176,41 @@ set_property CONFIG.DATA_WIDTH $DATA_WIDTH [get_bd_cells accelerator_0]
 set_property CONFIG.FRACTIONAL_BITS $FRACTIONAL_BITS [get_bd_cells accelerator_0]
 set_property CONFIG.ADDR_WIDTH $ADDR_WIDTH [get_bd_cells accelerator_0]
 set_property CONFIG.NUM_REGISTERS $NUM_REGISTERS [get_bd_cells accelerator_0]
+set_property CONFIG.LINE_BUFFER_BRAM $LINE_BUFFER_BRAM [get_bd_cells accelerator_0]
+set_property CONFIG.PIXELS_PER_BEAT $PIXELS_PER_BEAT [get_bd_cells accelerator_0]
+set_property CONFIG.NUM_FILTERS $NUM_FILTERS [get_bd_cells accelerator_0]
+set_property CONFIG.NUM_LAYERS $NUM_LAYERS [get_bd_cells accelerator_0]
+
+# Additional Accelerator Instances
+for {set i 1} {$i < $NUM_INSTANCES} {incr i} {
+    create_bd_cell -type module -reference accelerator accelerator_$i
+    create_bd_cell -type ip -vlnv xilinx.com:ip:axi_dma:7.1 axi_dma_$i
+
+    set_property CONFIG.c_sg_include_stscntrl_strm {0} [get_bd_cells axi_dma_$i]
+    set_property CONFIG.c_include_sg {0} [get_bd_cells axi_dma_$i]
+    set_property CONFIG.c_sg_length_width {23} [get_bd_cells axi_dma_$i]
+    foreach {param value} [list c_m_axi_mm2s_data_width $MM_WIDTH c_m_axis_mm2s_tdata_width $STREAM_WIDTH c_m_axi_s2mm_data_width $MM_WIDTH c_s_axis_s2mm_tdata_width $STREAM_WIDTH] {
+        set_property CONFIG.$param $value [get_bd_cells axi_dma_$i]
+    }
+
+    apply_bd_automation -rule xilinx.com:bd_rule:axi4 -config { Clk_master {Auto} Clk_slave {Auto} Clk_xbar {Auto} Master {/processing_system7_0/M_AXI_GP0} Slave {/accelerator_$i/s_axi} ddr_seg {Auto} intc_ip {Auto} master_apm {0}}  [get_bd_intf_pins accelerator_$i/s_axi]
+    apply_bd_automation -rule xilinx.com:bd_rule:axi4 -config { Clk_master {Auto} Clk_slave {Auto} Clk_xbar {Auto} Master {/processing_system7_0/M_AXI_GP0} Slave {/axi_dma_$i/S_AXI_LITE} ddr_seg {Auto} intc_ip {Auto} master_apm {0}}  [get_bd_intf_pins axi_dma_$i/S_AXI_LITE]
+    apply_bd_automation -rule xilinx.com:bd_rule:axi4 -config { Clk_master {Auto} Clk_slave {/processing_system7_0/FCLK_CLK0 (100 MHz)} Clk_xbar {/processing_system7_0/FCLK_CLK0 (100 MHz)} Master {/axi_dma_$i/M_AXI_MM2S} Slave {/processing_system7_0/S_AXI_HP0} ddr_seg {Auto} intc_ip {/axi_mem_intercon} master_apm {0}}  [get_bd_intf_pins axi_dma_$i/M_AXI_MM2S]
+    apply_bd_automation -rule xilinx.com:bd_rule:axi4 -config { Clk_master {Auto} Clk_slave {/processing_system7_0/FCLK_CLK0 (100 MHz)} Clk_xbar {/processing_system7_0/FCLK_CLK0 (100 MHz)} Master {/axi_dma_$i/M_AXI_S2MM} Slave {/processing_system7_0/S_AXI_HP0} ddr_seg {Auto} intc_ip {/axi_mem_intercon} master_apm {0}}  [get_bd_intf_pins axi_dma_$i/M_AXI_S2MM]
+
+    connect_bd_intf_net [get_bd_intf_pins accelerator_$i/s_axis] [get_bd_intf_pins axi_dma_$i/M_AXIS_MM2S]
+    connect_bd_intf_net [get_bd_intf_pins accelerator_$i/m_axis] [get_bd_intf_pins axi_dma_$i/S_AXIS_S2MM]
+
+    connect_bd_net [get_bd_pins accelerator_$i/clk_i] [get_bd_pins processing_system7_0/FCLK_CLK0]
+    connect_bd_net [get_bd_pins accelerator_$i/rstn_i] [get_bd_pins rst_ps7_0_100M/peripheral_aresetn]
+
+    connect_bd_net [get_bd_pins axi_dma_$i/mm2s_introut] [get_bd_pins xlconcat_0/In[expr {2 * $i}]]
+    connect_bd_net [get_bd_pins axi_dma_$i/s2mm_introut] [get_bd_pins xlconcat_0/In[expr {2 * $i + 1}]]
+
+    foreach {param value} [list INPUT_SIZE $INPUT_SIZE KERNEL_SIZE $KERNEL_SIZE STRIDE $STRIDE POOL_SIZE $POOL_SIZE DATA_WIDTH $DATA_WIDTH FRACTIONAL_BITS $FRACTIONAL_BITS ADDR_WIDTH $ADDR_WIDTH NUM_REGISTERS $NUM_REGISTERS LINE_BUFFER_BRAM $LINE_BUFFER_BRAM PIXELS_PER_BEAT $PIXELS_PER_BEAT NUM_FILTERS $NUM_FILTERS NUM_LAYERS $NUM_LAYERS] {
+        set_property CONFIG.$param $value [get_bd_cells accelerator_$i]
+    }
+}
 
 # Validate design
 validate_bd_design
@@ -0,0 +1,41 @@
+#!/bin/bash
+
+# Builds a host executable that runs a driver program against the RTL in
+# GHDL. The HAL compiles with the co-simulation backend and the host timer;
+# BSP_INCLUDE must point at host versions of the Xilinx headers it includes
+# (xil_types.h, xil_printf.h, xil_cache.h, xparameters.h, ...), and
+# BSP_SOURCES may list host sources implementing them. CFLAGS is passed to
+# every compile, e.g. -DKERNEL_SIZE=5 to override sw/hal/config.h.
+#
+# Usage: BSP_INCLUDE=<dir> ./scripts/cosim.sh <program.c> [output]
+
+set -e
+
+if [ -z "$1" ] || [ -z "$BSP_INCLUDE" ]; then
+    echo "Usage: BSP_INCLUDE=<dir> $0 <program.c> [output]"
+    exit 1
+fi
+
+ROOT="$(cd "$(dirname "$0")/.." && pwd)"
+PROGRAM="$(cd "$(dirname "$1")" && pwd)/$(basename "$1")"
+OUTPUT="$(pwd)/${2:-cosim}"
+
+mkdir -p build/cosim/
+cd build/cosim/
+
+# Analyze the RTL and the co-simulation testbench
+ghdl -a --std=93c "$ROOT"/hw/rtl/*.vhdl
+ghdl -a --std=93c "$ROOT"/hw/tb/cosim_pkg.vhdl "$ROOT"/hw/tb/cosim_tb.vhdl
+
+# Compile the driver stack (everything but the board demo) and the program
+declare -a OBJECTS=()
+for SRC in "$ROOT"/sw/common/*.c "$ROOT"/sw/cnn/*.c "$ROOT"/sw/hal/*.c "$ROOT"/sw/sched/*.c "$ROOT"/sw/utils/*.c $BSP_SOURCES "$PROGRAM"; do
+    OBJ="$(basename "${SRC%.c}").o"
+    gcc -c -O2 -std=gnu11 -DCOSIM_ENABLE -DTIMER_BACKEND_HOST -I"$BSP_INCLUDE" $CFLAGS "$SRC" -o "$OBJ"
+    OBJECTS+=("$OBJ")
+done
+
+# Bind the design and link it with the objects; main() comes from the
+# program, which starts the simulator through cosim_init()
+ghdl --bind --std=93c cosim_tb
+gcc "${OBJECTS[@]}" $(ghdl --list-link --std=93c cosim_tb) -lpthread -o "$OUTPUT"
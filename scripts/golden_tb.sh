@@ -0,0 +1,68 @@
+#!/bin/bash
+
+# Runs a file-driven testbench in GHDL against a golden set written by
+# hw/model/golden_model.py, with the generics taken from its config.json.
+# The accelerator testbench checks the whole layer, the convolver one the
+# convolution output and the pooler one the pooling stage (single filter
+# sets only). Extra arguments are passed to the simulation, e.g.
+# -gFRAMES=4 or -gRANDOM_VALID=false -gRANDOM_READY=false for the
+# full-rate cycle count.
+#
+# Usage: ./scripts/golden_tb.sh <golden-dir> [accelerator|convolver|pooler] [ghdl run options]
+
+set -e
+
+if [ -z "$1" ] || [ ! -f "$1/config.json" ]; then
+    echo "Usage: $0 <golden-dir> [accelerator|convolver|pooler] [ghdl run options]"
+    exit 1
+fi
+
+ROOT="$(cd "$(dirname "$0")/.." && pwd)"
+GOLDEN="$(cd "$1" && pwd)"
+TB="${2:-accelerator}"
+shift
+[ $# -gt 0 ] && shift
+
+# Generics of the testbench from the set's configuration (packed lanes as
+# fixed.h selects them for the data width)
+GENERICS=$(python3 - "$GOLDEN/config.json" "$TB" <<'EOF'
+import json, sys
+
+config = json.load(open(sys.argv[1]))
+tb = sys.argv[2]
+lanes = 32 // config['width'] if config['stride'] == 1 else 1
+pool_mode = {'max': 0, 'average': 1, 'none': 2}[config['pool']]
+
+if tb == 'accelerator':
+    generics = dict(ROWS=config['rows'], COLS=config['cols'], KERNEL_SIZE=config['kernel_size'],
+                    STRIDE=config['stride'], POOL_SIZE=config['pool_size'], POOL_MODE=pool_mode,
+                    POOL_STRIDE=config['pool_stride'], RELU=str(config['relu']).lower(),
+                    DATA_WIDTH=config['width'], FRACTIONAL_BITS=config['frac_bits'],
+                    PIXELS_PER_BEAT=lanes, NUM_FILTERS=config['filters'])
+elif tb == 'convolver':
+    generics = dict(ROWS=config['rows'], COLS=config['cols'], KERNEL_SIZE=config['kernel_size'],
+                    STRIDE=config['stride'], DATA_WIDTH=config['width'], FRACTIONAL_BITS=config['frac_bits'],
+                    PIXELS_PER_BEAT=lanes, NUM_FILTERS=config['filters'])
+elif tb == 'pooler':
+    if config['filters'] != 1:
+        sys.exit("The pooler testbench needs a single filter set")
+    generics = dict(ROWS=config['conv_rows'], COLS=config['conv_cols'], POOL_SIZE=config['pool_size'],
+                    POOL_MODE=pool_mode, POOL_STRIDE=config['pool_stride'], DATA_WIDTH=config['width'])
+else:
+    sys.exit(f"Unknown testbench {tb}")
+
+if tb != 'pooler' and config['cols'] % lanes:
+    sys.exit(f"{config['cols']} columns do not fill {lanes} lanes")
+print(' '.join(f'-g{name}={value}' for name, value in generics.items()))
+EOF
+)
+
+mkdir -p build/golden/
+cd build/golden/
+
+# Analyze the RTL and the testbench
+ghdl -a --std=93c "$ROOT"/hw/rtl/*.vhdl
+ghdl -a --std=93c "$ROOT"/hw/tb/golden_pkg.vhdl "$ROOT/hw/tb/${TB}_golden_tb.vhdl"
+ghdl -e --std=93c "${TB}_golden_tb"
+
+ghdl -r --std=93c "${TB}_golden_tb" -gGOLDEN_DIR="$GOLDEN" $GENERICS "$@" --ieee-asserts=disable-at-0
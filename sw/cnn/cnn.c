@@ -3,8 +3,17 @@
 #include "xil_printf.h"
 
 #include "../common/fixed.h"
+#include "../common/trace.h"
+#include "../hal/bump_allocator.h"
 #include "../hal/config.h"
 
+// Forward declarations
+static status_t forward_filters(matrix_t *input, matrix_t **kernels, const cnn_sparse_kernel_t *compiled, int count,
+                                int pool_size, int stride, const cnn_stages_t *stages, cnn_scratch_t *scratch,
+                                matrix_t *output);
+static status_t forward_channel(matrix_t *input, matrix_t *kernel, const cnn_sparse_kernel_t *sparse, int pool_size,
+                                int stride, const cnn_stages_t *stages, cnn_scratch_t *scratch, matrix_t *output);
+
 static status_t relu_fp(fixed_point_t x, fixed_point_t* result) {
     if (!result) {
     	LOG_ERROR("NULL result pointer");
@@ -89,6 +98,182 @@ status_t cnn_convolve(matrix_t *input, matrix_t *kernel, int stride, matrix_t *o
     return STATUS_SUCCESS;
 }
 
+status_t cnn_sparse_compile(matrix_t *kernel, cnn_sparse_kernel_t *sparse) {
+    if (!kernel || !sparse) {
+    	LOG_ERROR("NULL pointer(s)");
+        return STATUS_ERROR_INVALID_PARAM;
+    }
+    if (kernel->rows * kernel->cols > CNN_SPARSE_MAX_TAPS) {
+        LOG_ERROR("Kernel %dx%d exceeds %d taps", kernel->rows, kernel->cols, CNN_SPARSE_MAX_TAPS);
+        return STATUS_ERROR_INVALID_PARAM;
+    }
+
+    sparse->rows = kernel->rows;
+    sparse->cols = kernel->cols;
+    sparse->num_taps = 0;
+
+    for (int ki = 0; ki < kernel->rows; ki++) {
+        for (int kj = 0; kj < kernel->cols; kj++) {
+            fixed_point_t weight;
+            status_t status = matrix_get(kernel, ki, kj, &weight);
+            if (status != STATUS_SUCCESS) {
+                LOG_ERROR("Could not read kernel at position %d,%d", ki, kj);
+                return status;
+            }
+
+            if (weight != 0) {
+                sparse->taps[sparse->num_taps++] = (cnn_sparse_tap_t){ ki, kj, weight };
+            }
+        }
+    }
+
+    return STATUS_SUCCESS;
+}
+
+status_t cnn_convolve_sparse(matrix_t *input, const cnn_sparse_kernel_t *kernel, int stride, matrix_t *output) {
+    if (!input || !kernel || !output) {
+    	LOG_ERROR("NULL pointer(s)");
+        return STATUS_ERROR_INVALID_PARAM;
+    }
+    if (stride <= 0) {
+        LOG_ERROR("Invalid stride %d", stride);
+        return STATUS_ERROR_INVALID_PARAM;
+    }
+
+    status_t status;
+    fixed_point_t in_val, prod, sum, tmp, zero;
+    int rows = (input->rows - kernel->rows) / stride + 1;
+    int cols = (input->cols - kernel->cols) / stride + 1;
+    int active[CNN_SPARSE_MAX_TAPS];
+
+    // Nonzero inputs per row under the current output row, and whether each
+    // column of those rows holds one, in rings indexed modulo the largest
+    // kernel side (so any input size fits)
+    int row_counts[CNN_SPARSE_MAX_TAPS];
+    int col_nonzero[CNN_SPARSE_MAX_TAPS];
+
+    status = int_to_fixed(0, &zero);
+    if (status != STATUS_SUCCESS) {
+    	LOG_ERROR("Could not convert zero to fixed point");
+        return status;
+    }
+
+    int64_t nonzero = 0;
+    for (int r = 0; r < input->rows; r++) {
+        for (int c = 0; c < input->cols; c++) {
+            status = matrix_get(input, r, c, &in_val);
+            if (status != STATUS_SUCCESS) {
+                LOG_ERROR("Could not read input at position %d,%d", r, c);
+                return status;
+            }
+            nonzero += (in_val != 0);
+        }
+    }
+
+    // Dense inputs skip no rows or columns, as the checks would cost more
+    // than they save
+    int dense = nonzero * 100 > (int64_t)CNN_SPARSE_DENSITY_PERCENT * input->rows * input->cols;
+
+    int next_row = 0;
+    for (int i = 0; i < rows; i++) {
+        int top = i * stride;
+
+        // Count the rows entering the window (rows a stride skips are never read)
+        if (!dense) {
+            if (next_row < top) {
+                next_row = top;
+            }
+            for (; next_row < top + kernel->rows; next_row++) {
+                int count = 0;
+                for (int c = 0; c < input->cols; c++) {
+                    count += input->data[next_row * input->cols + c] != 0;
+                }
+                row_counts[next_row % CNN_SPARSE_MAX_TAPS] = count;
+            }
+        }
+
+        // Taps over an all-zero input row add nothing to this output row
+        int num_active = 0;
+        for (int t = 0; t < kernel->num_taps; t++) {
+            if (dense || row_counts[(top + kernel->taps[t].row) % CNN_SPARSE_MAX_TAPS] > 0) {
+                active[num_active++] = t;
+            }
+        }
+
+        // Columns are checked as windows reach them; the last nonzero one
+        // tells whether the current window holds any
+        int next_col = 0, last_nonzero = -1;
+        for (int j = 0; j < cols; j++) {
+            int left = j * stride;
+
+            if (!dense) {
+                if (next_col < left) {
+                    next_col = left;
+                }
+                for (; next_col < left + kernel->cols; next_col++) {
+                    int any = 0;
+                    for (int ki = 0; ki < kernel->rows && !any; ki++) {
+                        if (row_counts[(top + ki) % CNN_SPARSE_MAX_TAPS] > 0) {
+                            any = input->data[(top + ki) * input->cols + next_col] != 0;
+                        }
+                    }
+                    col_nonzero[next_col % CNN_SPARSE_MAX_TAPS] = any;
+                    if (any) {
+                        last_nonzero = next_col;
+                    }
+                }
+            }
+
+            sum = zero;
+
+            // A window over a run of zero columns sums to zero
+            if (dense || last_nonzero >= left) {
+                for (int a = 0; a < num_active; a++) {
+                    const cnn_sparse_tap_t *tap = &kernel->taps[active[a]];
+                    int r = top + tap->row;
+                    int c = left + tap->col;
+
+                    if (!dense && !col_nonzero[c % CNN_SPARSE_MAX_TAPS]) {
+                        continue;
+                    }
+
+                    status = matrix_get(input, r, c, &in_val);
+                    if (status != STATUS_SUCCESS) {
+                        LOG_ERROR("Could not read input at position %d,%d", r, c);
+                        return status;
+                    }
+
+                    // A zero product leaves the sum, and its overflow checks, unchanged
+                    if (in_val == 0) {
+                        continue;
+                    }
+
+                    status = fixed_multiply(in_val, tap->weight, &prod);
+                    if (status != STATUS_SUCCESS) {
+                        LOG_ERROR("Multiplication error at position %d,%d", tap->row, tap->col);
+                        return status;
+                    }
+
+                    tmp = sum;
+                    status = fixed_add(prod, tmp, &sum);
+                    if (status != STATUS_SUCCESS) {
+                        LOG_ERROR("Addition error at position %d,%d", tap->row, tap->col);
+                        return status;
+                    }
+                }
+            }
+
+            status = matrix_set(output, i, j, sum);
+            if (status != STATUS_SUCCESS) {
+                LOG_ERROR("Could not write result to position %d,%d", i, j);
+                return status;
+            }
+        }
+    }
+
+    return STATUS_SUCCESS;
+}
+
 status_t cnn_relu_activate(matrix_t *input, matrix_t *output) {
     if (!input || !output) {
     	LOG_ERROR("NULL matrix pointer");
@@ -123,35 +308,60 @@ status_t cnn_relu_activate(matrix_t *input, matrix_t *output) {
 }
 
 status_t cnn_max_pool(matrix_t *input, int pool_size, matrix_t *output) {
+    return cnn_pool(input, CNN_POOL_MAX, pool_size, pool_size, output);
+}
+
+status_t cnn_pool(matrix_t *input, cnn_pool_mode_t mode, int pool_size, int pool_stride, matrix_t *output) {
     if (!input || !output) {
     	LOG_ERROR("NULL pointer(s)");
         return STATUS_ERROR_INVALID_PARAM;
     }
 
-    if (pool_size <= 0) {
-    	LOG_ERROR("Invalid pool size %d", pool_size);
+    if (pool_size <= 0 || pool_stride <= 0) {
+    	LOG_ERROR("Invalid pool size %d stride %d", pool_size, pool_stride);
         return STATUS_ERROR_INVALID_PARAM;
     }
 
-    int rows = input->rows / pool_size;
-    int cols = input->cols / pool_size;
+    // No pooling passes every value through
+    if (mode == CNN_POOL_NONE) {
+        pool_size = 1;
+        pool_stride = 1;
+    }
+
+    // A trailing row/column that cannot fill a window is dropped
+    int rows = (input->rows - pool_size) / pool_stride + 1;
+    int cols = (input->cols - pool_size) / pool_stride + 1;
+    int area = pool_size * pool_size;
     status_t status;
 
     for (int i = 0; i < rows; i++) {
         for (int j = 0; j < cols; j++) {
             fixed_point_t max = FIXED_POINT_MIN;
+            int64_t sum = 0;
             for (int pi = 0; pi < pool_size; pi++) {
                 for (int pj = 0; pj < pool_size; pj++) {
                 	fixed_point_t val;
-                    status = matrix_get(input, i * pool_size + pi, j * pool_size + pj, &val);
+                    status = matrix_get(input, i * pool_stride + pi, j * pool_stride + pj, &val);
                     if (status != STATUS_SUCCESS) {
-                    	LOG_ERROR("Could not read value at position %d,%d", i * pool_size + pi, j * pool_size + pj);
+                    	LOG_ERROR("Could not read value at position %d,%d", i * pool_stride + pi, j * pool_stride + pj);
                         return status;
                     }
                     if (val > max) max = val;
+                    sum += val;
+                }
+            }
+
+            // The mean is floored, as the hardware divides the exact sum
+            fixed_point_t result = max;
+            if (mode == CNN_POOL_AVERAGE) {
+                int64_t mean = sum / area;
+                if (sum % area != 0 && sum < 0) {
+                    mean--;
                 }
+                result = (fixed_point_t)mean;
             }
-            status = matrix_set(output, i, j, max);
+
+            status = matrix_set(output, i, j, result);
             if (status != STATUS_SUCCESS) {
             	LOG_ERROR("Could not write result to position %d,%d", i, j);
                 return status;
@@ -161,13 +371,133 @@ status_t cnn_max_pool(matrix_t *input, int pool_size, matrix_t *output) {
     return STATUS_SUCCESS;
 }
 
+int cnn_pooled_size(int size, int pool_size, const cnn_stages_t *stages) {
+    if (stages->pool == CNN_POOL_NONE) {
+        return size;
+    }
+
+    int pool_stride = (stages->pool_stride > 0) ? stages->pool_stride : pool_size;
+    return (size - pool_size) / pool_stride + 1;
+}
+
 status_t cnn_forward(matrix_t *input, matrix_t *kernel, int pool_size, int stride, matrix_t *output) {
     if (!input || !kernel || !output) {
     	LOG_ERROR("NULL pointer(s)");
         return STATUS_ERROR_INVALID_PARAM;
     }
 
-    if (pool_size <= 0 || stride <= 0) {
+    cnn_stages_t stages = { 1, CNN_POOL_MAX, 0 };
+    return forward_channel(input, kernel, NULL, pool_size, stride, &stages, NULL, output);
+}
+
+status_t cnn_forward_filters(matrix_t *input, matrix_t **kernels, int count, int pool_size, int stride, matrix_t *output) {
+    cnn_stages_t stages = { 1, CNN_POOL_MAX, 0 };
+    return cnn_forward_stages(input, kernels, count, pool_size, stride, &stages, output);
+}
+
+status_t cnn_forward_stages(matrix_t *input, matrix_t **kernels, int count, int pool_size, int stride,
+                            const cnn_stages_t *stages, matrix_t *output) {
+    if (!input || !kernels || !stages || !output) {
+    	LOG_ERROR("NULL pointer(s)");
+        return STATUS_ERROR_INVALID_PARAM;
+    }
+
+    return forward_filters(input, kernels, NULL, count, pool_size, stride, stages, NULL, output);
+}
+
+status_t cnn_forward_compiled(matrix_t *input, const cnn_sparse_kernel_t *kernels, int count, int pool_size, int stride,
+                              const cnn_stages_t *stages, cnn_scratch_t *scratch, matrix_t *output) {
+    if (!input || !kernels || !stages || !output) {
+    	LOG_ERROR("NULL pointer(s)");
+        return STATUS_ERROR_INVALID_PARAM;
+    }
+
+    return forward_filters(input, NULL, kernels, count, pool_size, stride, stages, scratch, output);
+}
+
+status_t cnn_scratch_create(cnn_scratch_t *scratch, int size) {
+    if (!scratch) {
+    	LOG_ERROR("NULL pointer");
+        return STATUS_ERROR_INVALID_PARAM;
+    }
+
+    if (size <= 0) {
+    	LOG_ERROR("Invalid scratch size %d", size);
+        return STATUS_ERROR_INVALID_PARAM;
+    }
+
+    fixed_point_t *data = (fixed_point_t *)allocator_alloc(3 * size * sizeof(fixed_point_t));
+    if (!data) {
+    	LOG_ERROR("Could not allocate scratch maps");
+        return STATUS_ERROR_MEMORY;
+    }
+
+    scratch->conv = data;
+    scratch->relu = data + size;
+    scratch->channel = data + 2 * size;
+    scratch->size = size;
+    return STATUS_SUCCESS;
+}
+
+// Either kernels or their compiled taps are given; without scratch the
+// intermediate maps are allocated for this call
+static status_t forward_filters(matrix_t *input, matrix_t **kernels, const cnn_sparse_kernel_t *compiled, int count,
+                                int pool_size, int stride, const cnn_stages_t *stages, cnn_scratch_t *scratch,
+                                matrix_t *output) {
+    if (count <= 0 || output->cols % count != 0) {
+    	LOG_ERROR("Invalid filter count %d for %d output columns", count, output->cols);
+        return STATUS_ERROR_INVALID_PARAM;
+    }
+
+    // One channel at a time, interleaved per pixel as the accelerator streams them
+    int out_cols = output->cols / count;
+    matrix_t channel_map;
+    matrix_t *channel;
+    if (scratch) {
+        if (output->rows * out_cols > scratch->size) {
+        	LOG_ERROR("Scratch of %d values too small for a %dx%d channel", scratch->size, output->rows, out_cols);
+            return STATUS_ERROR_INVALID_PARAM;
+        }
+        channel_map = (matrix_t){ output->rows, out_cols, scratch->channel, CACHE_STATE_CLEAN };
+        channel = &channel_map;
+    } else {
+        channel = matrix_create(output->rows, out_cols);
+        if (!channel) {
+        	LOG_ERROR("Could not create channel matrix");
+            return STATUS_ERROR_MEMORY;
+        }
+    }
+
+    // The interleave writes the output directly rather than via matrix_set
+    cache_prepare_cpu_access(output->data, output->rows * output->cols * sizeof(fixed_point_t), &output->cache_state);
+
+    status_t status = STATUS_SUCCESS;
+    for (int f = 0; f < count; f++) {
+        status = compiled ? forward_channel(input, NULL, &compiled[f], pool_size, stride, stages, scratch, channel) :
+                            forward_channel(input, kernels[f], NULL, pool_size, stride, stages, scratch, channel);
+        if (status != STATUS_SUCCESS) {
+        	LOG_ERROR("Filter %d failed", f);
+            goto cleanup;
+        }
+
+        for (int i = 0; i < output->rows * out_cols; i++) {
+            output->data[i * count + f] = channel->data[i];
+        }
+    }
+
+    cache_mark_cpu_dirty(&output->cache_state);
+
+cleanup:
+    if (!scratch) {
+        matrix_destroy(channel);
+    }
+    return status;
+}
+
+// A kernel without compiled taps is compiled for this call
+static status_t forward_channel(matrix_t *input, matrix_t *kernel, const cnn_sparse_kernel_t *sparse, int pool_size,
+                                int stride, const cnn_stages_t *stages, cnn_scratch_t *scratch, matrix_t *output) {
+    if (pool_size <= 0 || stride <= 0 || stages->pool_stride < 0) {
     	LOG_ERROR("Invalid parameters pool size %d stride %d", pool_size, stride);
         return STATUS_ERROR_INVALID_PARAM;
     }
@@ -175,54 +505,84 @@ status_t cnn_forward(matrix_t *input, matrix_t *kernel, int pool_size, int strid
     status_t status;
 
     // Calculate intermediate dimensions
-    int conv_rows = (input->rows - kernel->rows) / stride + 1;
-    int conv_cols = (input->cols - kernel->cols) / stride + 1;
+    int kernel_rows = sparse ? sparse->rows : kernel->rows;
+    int kernel_cols = sparse ? sparse->cols : kernel->cols;
+    int conv_rows = (input->rows - kernel_rows) / stride + 1;
+    int conv_cols = (input->cols - kernel_cols) / stride + 1;
+
+    // Intermediate matrices, reusing the scratch maps when given
+    matrix_t conv_map, relu_map;
+    matrix_t *conv_out, *relu_out;
+    if (scratch) {
+        if (conv_rows * conv_cols > scratch->size) {
+        	LOG_ERROR("Scratch of %d values too small for a %dx%d map", scratch->size, conv_rows, conv_cols);
+            return STATUS_ERROR_INVALID_PARAM;
+        }
+        conv_map = (matrix_t){ conv_rows, conv_cols, scratch->conv, CACHE_STATE_CLEAN };
+        relu_map = (matrix_t){ conv_rows, conv_cols, scratch->relu, CACHE_STATE_CLEAN };
+        conv_out = &conv_map;
+        relu_out = &relu_map;
+    } else {
+        conv_out = matrix_create(conv_rows, conv_cols);
+        if (!conv_out) {
+        	LOG_ERROR("Could not create output matrix for convolution");
+            return STATUS_ERROR_MEMORY;
+        }
 
-    // Create intermediate matrices
-    matrix_t *conv_out = matrix_create(conv_rows, conv_cols);
-    if (!conv_out) {
-    	LOG_ERROR("Could not create output matrix for convolution");
-        return STATUS_ERROR_MEMORY;
+        relu_out = matrix_create(conv_rows, conv_cols);
+        if (!relu_out) {
+        	LOG_ERROR("Could not create output matrix for ReLU");
+            matrix_destroy(conv_out);
+            return STATUS_ERROR_MEMORY;
+        }
     }
 
-    matrix_t *relu_out = matrix_create(conv_rows, conv_cols);
-    if (!relu_out) {
-    	LOG_ERROR("Could not create output matrix for ReLU");
-        matrix_destroy(conv_out);
-        return STATUS_ERROR_MEMORY;
+    // Convolution (zero weights, and zero inputs of sparse maps, skipped;
+    // kernels too large to compile run dense)
+    cnn_sparse_kernel_t taps;
+    TRACE_BEGIN("cnn_convolve");
+    if (sparse) {
+        status = cnn_convolve_sparse(input, sparse, stride, conv_out);
+    } else if (kernel->rows * kernel->cols <= CNN_SPARSE_MAX_TAPS) {
+        status = cnn_sparse_compile(kernel, &taps);
+        if (status == STATUS_SUCCESS) {
+            status = cnn_convolve_sparse(input, &taps, stride, conv_out);
+        }
+    } else {
+        status = cnn_convolve(input, kernel, stride, conv_out);
     }
-
-    // Convolution
-    status = cnn_convolve(input, kernel, STRIDE, conv_out);
+    TRACE_END("cnn_convolve");
     if (status != STATUS_SUCCESS) {
     	LOG_ERROR("Convolution operation failed");
-        matrix_destroy(conv_out);
-        matrix_destroy(relu_out);
-        return status;
+        goto cleanup;
     }
 
-    // ReLU
-    status = cnn_relu_activate(conv_out, relu_out);
-    if (status != STATUS_SUCCESS) {
-    	LOG_ERROR("ReLU operation failed");
-        matrix_destroy(conv_out);
-        matrix_destroy(relu_out);
-        return status;
+    // ReLU (a skipped stage pools the convolution directly)
+    matrix_t *pool_in = conv_out;
+    if (stages->relu) {
+        TRACE_BEGIN("cnn_relu");
+        status = cnn_relu_activate(conv_out, relu_out);
+        TRACE_END("cnn_relu");
+        if (status != STATUS_SUCCESS) {
+        	LOG_ERROR("ReLU operation failed");
+            goto cleanup;
+        }
+        pool_in = relu_out;
     }
 
-    // Max Pooling
-    status = cnn_max_pool(relu_out, POOL_SIZE, output);
+    // Pooling
+    int pool_stride = (stages->pool_stride > 0) ? stages->pool_stride : pool_size;
+    TRACE_BEGIN("cnn_pool");
+    status = cnn_pool(pool_in, stages->pool, pool_size, pool_stride, output);
+    TRACE_END("cnn_pool");
     if (status != STATUS_SUCCESS) {
-    	LOG_ERROR("Max pooling operation failed");
+    	LOG_ERROR("Pooling operation failed");
+    }
+
+cleanup:
+    if (!scratch) {
         matrix_destroy(conv_out);
         matrix_destroy(relu_out);
-        return status;
     }
-
-    // Cleanup
-    matrix_destroy(conv_out);
-    matrix_destroy(relu_out);
-
-    return STATUS_SUCCESS;
+    return status;
 }
-
@@ -3,8 +3,68 @@
 #include "../common/matrix.h"
 #include "../common/status.h"
 
+#define CNN_SPARSE_MAX_TAPS        64  // Largest kernel area a sparse kernel holds
+#define CNN_SPARSE_DENSITY_PERCENT 50  // Above this share of nonzero inputs, no zero skipping
+
+// Pooling applied after the activation
+typedef enum {
+    CNN_POOL_MAX = 0,
+    CNN_POOL_AVERAGE = 1,  // Window mean, rounded toward minus infinity
+    CNN_POOL_NONE = 2,
+} cnn_pool_mode_t;
+
+// Post-convolution stages (pool_stride 0 steps by the pool size)
+typedef struct {
+    int relu;
+    cnn_pool_mode_t pool;
+    int pool_stride;
+} cnn_stages_t;
+
+// Nonzero weights of a kernel in row-major order, so the sum of a window
+// accumulates in the same order as cnn_convolve
+typedef struct {
+    int row;
+    int col;
+    fixed_point_t weight;
+} cnn_sparse_tap_t;
+
+typedef struct {
+    int rows;
+    int cols;
+    int num_taps;
+    cnn_sparse_tap_t taps[CNN_SPARSE_MAX_TAPS];
+} cnn_sparse_kernel_t;
+
+// Intermediate maps of a forward pass (convolution, ReLU and one pooled
+// channel, size values each), reused so repeated passes allocate nothing
+typedef struct {
+    fixed_point_t *conv;
+    fixed_point_t *relu;
+    fixed_point_t *channel;
+    int size;
+} cnn_scratch_t;
+
 // Public Interface
 status_t cnn_convolve(matrix_t *input, matrix_t *kernel, int stride, matrix_t *output);
+status_t cnn_sparse_compile(matrix_t *kernel, cnn_sparse_kernel_t *sparse);
+status_t cnn_convolve_sparse(matrix_t *input, const cnn_sparse_kernel_t *kernel, int stride, matrix_t *output);
 status_t cnn_relu_activate(matrix_t *input, matrix_t *output);
 status_t cnn_max_pool(matrix_t *input, int pool_size, matrix_t *output);
+status_t cnn_pool(matrix_t *input, cnn_pool_mode_t mode, int pool_size, int pool_stride, matrix_t *output);
 status_t cnn_forward(matrix_t *input, matrix_t *kernel, int pool_size, int stride, matrix_t *output);
+status_t cnn_forward_filters(matrix_t *input, matrix_t **kernels, int count, int pool_size, int stride, matrix_t *output);
+status_t cnn_forward_stages(matrix_t *input, matrix_t **kernels, int count, int pool_size, int stride,
+                            const cnn_stages_t *stages, matrix_t *output);
+
+// As cnn_forward_stages, with kernels compiled once by cnn_sparse_compile
+// (per kernel load, not per frame) and, unless NULL, the intermediate maps
+// taken from scratch
+status_t cnn_forward_compiled(matrix_t *input, const cnn_sparse_kernel_t *kernels, int count, int pool_size, int stride,
+                              const cnn_stages_t *stages, cnn_scratch_t *scratch, matrix_t *output);
+
+// Scratch maps from the allocator, each holding size values (at least the
+// largest convolution output)
+status_t cnn_scratch_create(cnn_scratch_t *scratch, int size);
+
+// Output rows or columns of the stages for a convolution output size
+int cnn_pooled_size(int size, int pool_size, const cnn_stages_t *stages);
@@ -1,8 +1,9 @@
 #include "fixed.h"
 
-#include "xtime_l.h"
 #include "xil_printf.h"
 
+#include "timer.h"
+
 static u32 rand_seed = 1;
 
 // Forward declarations
@@ -105,8 +106,8 @@ status_t fixed_add(fixed_point_t a, fixed_point_t b, fixed_point_t* result) {
 }
 
 void fixed_print(fixed_point_t value) {
-	int32_t integer_part = value / (1 << 12);
-	int32_t fractional_part = ((value % (1 << 12)) * 1000) >> 12;
+	int32_t integer_part = value / FIXED_POINT_SCALE;
+	int32_t fractional_part = ((value % FIXED_POINT_SCALE) * 1000) >> FIXED_POINT_BITS;
 
 	if (value >= 0) {
 		xil_printf("%d.%03d", integer_part, fractional_part);
@@ -128,9 +129,7 @@ status_t fixed_random(float min_val, float max_val, fixed_point_t *result) {
 
     // Initialize seed if not done
     if (rand_seed == 1) {
-        XTime time;
-        XTime_GetTime(&time);
-        rand_seed = (u32)(time & 0xFFFFFFFF);
+        rand_seed = (u32)(timer_now() & 0xFFFFFFFF);
     }
 
     float rand_val = min_val + (max_val - min_val) * random_float();
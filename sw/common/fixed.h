@@ -2,14 +2,28 @@
 
 #include "status.h"
 
-// Format configuration
+// Format configuration (DATA_WIDTH and FRAC_BITS of the bitstream; host
+// builds may set the width on the command line)
+#ifndef FIXED_POINT_WIDTH
+#define FIXED_POINT_WIDTH 32
+#endif
+
+#if FIXED_POINT_WIDTH == 32
 #define FIXED_POINT_BITS 12
-#define FIXED_POINT_SCALE (1 << FIXED_POINT_BITS)
-#define FIXED_POINT_MAX ((1LL << 31) - 1)
-#define FIXED_POINT_MIN (-(1LL << 31))
+typedef int32_t fixed_point_t;  // Q20.12
+#elif FIXED_POINT_WIDTH == 16
+#define FIXED_POINT_BITS 12
+typedef int16_t fixed_point_t;  // Q4.12
+#elif FIXED_POINT_WIDTH == 8
+#define FIXED_POINT_BITS 4
+typedef int8_t fixed_point_t;   // Q4.4
+#else
+#error "FIXED_POINT_WIDTH must be 32, 16 or 8"
+#endif
 
-// Fixed-point type (Q20.12 format)
-typedef int32_t fixed_point_t;
+#define FIXED_POINT_SCALE (1 << FIXED_POINT_BITS)
+#define FIXED_POINT_MAX ((1LL << (FIXED_POINT_WIDTH - 1)) - 1)
+#define FIXED_POINT_MIN (-(1LL << (FIXED_POINT_WIDTH - 1)))
 
 // Conversion functions
 status_t float_to_fixed(float value, fixed_point_t *result);
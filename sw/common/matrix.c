@@ -27,6 +27,33 @@ matrix_t* matrix_create(int rows, int cols) {
 
     mat->rows = rows;
     mat->cols = cols;
+    mat->cache_state = CACHE_STATE_CLEAN;
+    return mat;
+}
+
+matrix_t* matrix_create_uncached(int rows, int cols) {
+    if (rows <= 0 || cols <= 0) {
+    	LOG_ERROR("Invalid dimensions %dx%d", rows, cols);
+        return NULL;
+    }
+
+    // Structure stays cacheable, only the stream data is mapped non-cacheable
+    matrix_t* mat = (matrix_t*)allocator_alloc(sizeof(matrix_t));
+    if (!mat) {
+        LOG_ERROR("Could not allocate matrix structure");
+        return NULL;
+    }
+
+    mat->data = (fixed_point_t*)allocator_alloc_uncached(rows * cols * sizeof(fixed_point_t));
+    if (!mat->data) {
+        LOG_ERROR("Could not allocate uncached matrix data");
+        allocator_free(mat);
+        return NULL;
+    }
+
+    mat->rows = rows;
+    mat->cols = cols;
+    mat->cache_state = CACHE_STATE_UNCACHED;
     return mat;
 }
 
@@ -39,6 +66,49 @@ void matrix_destroy(matrix_t* mat) {
     allocator_free(mat);
 }
 
+status_t matrix_view_rows(matrix_t* parent, int first_row, int rows, matrix_t* view) {
+    if (!parent || !view) {
+        LOG_ERROR("NULL pointer(s)");
+        return STATUS_ERROR_INVALID_PARAM;
+    }
+
+    if (first_row < 0 || rows <= 0 || first_row + rows > parent->rows) {
+        LOG_ERROR("Invalid rows %d+%d of %d", first_row, rows, parent->rows);
+        return STATUS_ERROR_INVALID_PARAM;
+    }
+
+    view->rows = rows;
+    view->cols = parent->cols;
+    view->data = &parent->data[first_row * parent->cols];
+    view->cache_state = parent->cache_state;
+    return STATUS_SUCCESS;
+}
+
+status_t matrix_view_release(matrix_t* parent, matrix_t* view) {
+    if (!parent || !view) {
+        LOG_ERROR("NULL pointer(s)");
+        return STATUS_ERROR_INVALID_PARAM;
+    }
+
+    u32 size = view->rows * view->cols * sizeof(fixed_point_t);
+
+    // The parent only describes the whole buffer, so a view whose state
+    // cannot stand for the rest is settled on its own rows first
+    if (view->cache_state == parent->cache_state) {
+        return STATUS_SUCCESS;
+    }
+    if (parent->cache_state == CACHE_STATE_CLEAN) {
+        parent->cache_state = view->cache_state;
+    } else if (view->cache_state == CACHE_STATE_CPU_DIRTY) {
+        // Parent device-owned: write back before its stale lines are dropped
+        cache_prepare_device_read(view->data, size, &view->cache_state);
+    } else if (view->cache_state == CACHE_STATE_DEVICE_OWNED) {
+        // Parent CPU-dirty: drop the view's stale lines before a flush
+        cache_prepare_cpu_access(view->data, size, &view->cache_state);
+    }
+    return STATUS_SUCCESS;
+}
+
 status_t matrix_set(matrix_t* mat, int row, int col, fixed_point_t val) {
 	if (!mat) {
     	LOG_ERROR("NULL pointer");
@@ -50,11 +120,14 @@ status_t matrix_set(matrix_t* mat, int row, int col, fixed_point_t val) {
         return STATUS_ERROR_INVALID_PARAM;
     }
 
+    cache_prepare_cpu_access(mat->data, mat->rows * mat->cols * sizeof(fixed_point_t), &mat->cache_state);
+    cache_mark_cpu_dirty(&mat->cache_state);
+
     mat->data[row * mat->cols + col] = val;
     return STATUS_SUCCESS;
 }
 
-status_t matrix_get(const matrix_t* mat, int row, int col, fixed_point_t* val) {
+status_t matrix_get(matrix_t* mat, int row, int col, fixed_point_t* val) {
 	if (!mat || !val) {
     	LOG_ERROR("NULL pointer(s)");
         return STATUS_ERROR_INVALID_PARAM;
@@ -65,6 +138,9 @@ status_t matrix_get(const matrix_t* mat, int row, int col, fixed_point_t* val) {
         return STATUS_ERROR_INVALID_PARAM;
     }
 
+    // Lazily drop stale lines of a buffer last written by the device
+    cache_prepare_cpu_access(mat->data, mat->rows * mat->cols * sizeof(fixed_point_t), &mat->cache_state);
+
     *val = mat->data[row * mat->cols + col];
     return STATUS_SUCCESS;
 }
@@ -120,7 +196,7 @@ status_t matrix_randomize(matrix_t *mat, float min_val, float max_val) {
     return STATUS_SUCCESS;
 }
 
-status_t matrix_print(const matrix_t* mat, const char* name) {
+status_t matrix_print(matrix_t* mat, const char* name) {
     if (!mat || !name) {
         LOG_ERROR("NULL pointer(s)");
         return STATUS_ERROR_INVALID_PARAM;
@@ -147,7 +223,7 @@ status_t matrix_print(const matrix_t* mat, const char* name) {
     return STATUS_SUCCESS;
 }
 
-status_t matrix_compare(const matrix_t* m1, const matrix_t* m2, int* result) {
+status_t matrix_compare(matrix_t* m1, matrix_t* m2, int* result) {
 	if (!m1 || !m2 || !result) {
 		LOG_ERROR("NULL pointer(s)");
 		return STATUS_ERROR_INVALID_PARAM;
@@ -2,24 +2,36 @@
 
 #include "fixed.h"
 #include "status.h"
+#include "../hal/cache.h"
 
-// Matrix type with continuous memory layout
+// Matrix type with continuous memory layout. matrix_set and matrix_get
+// keep cache_state up to date; code that touches data directly must call
+// cache_prepare_cpu_access() before and, after writing,
+// cache_mark_cpu_dirty(), or the next DMA may use stale lines
 typedef struct {
 	int rows;
 	int cols;
 	fixed_point_t *data;
+	cache_state_t cache_state;
 } matrix_t;
 
 // Creation and destruction
 matrix_t* matrix_create(int rows, int cols);
+matrix_t* matrix_create_uncached(int rows, int cols);
 void matrix_destroy(matrix_t *mat);
 
+// Row views share the parent's data and start from a copy of its cache
+// state; releasing a view folds its state back into the parent, so each
+// view is released before the next one is made
+status_t matrix_view_rows(matrix_t *parent, int first_row, int rows, matrix_t *view);
+status_t matrix_view_release(matrix_t *parent, matrix_t *view);
+
 // Basic operations
 status_t matrix_set(matrix_t *mat, int row, int col, fixed_point_t val);
-status_t matrix_get(const matrix_t *mat, int row, int col, fixed_point_t *val);
+status_t matrix_get(matrix_t *mat, int row, int col, fixed_point_t *val);
 
 // Utility functions
 status_t matrix_initialize(matrix_t *mat);
 status_t matrix_randomize(matrix_t *mat, float min_val, float max_val);
-status_t matrix_print(const matrix_t* mat, const char* name);
-status_t matrix_compare(const matrix_t *mat1, const matrix_t *mat2, int *result);
+status_t matrix_print(matrix_t* mat, const char* name);
+status_t matrix_compare(matrix_t *mat1, matrix_t *mat2, int *result);
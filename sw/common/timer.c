@@ -0,0 +1,34 @@
+#include "timer.h"
+
+#ifdef TIMER_BACKEND_HOST
+
+#include <time.h>
+
+#define TICKS_PER_USECOND 1000.0  // Nanosecond ticks
+
+timer_ticks_t timer_now(void) {
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (timer_ticks_t)now.tv_sec * 1000000000u + (timer_ticks_t)now.tv_nsec;
+}
+
+#else
+
+#include "xtime_l.h"
+
+// The global timer counts at half the CPU clock
+#define TICKS_PER_USECOND (COUNTS_PER_SECOND / 1000000.0)
+
+timer_ticks_t timer_now(void) {
+    XTime now;
+
+    XTime_GetTime(&now);
+    return (timer_ticks_t)now;
+}
+
+#endif
+
+double timer_elapsed_us(timer_ticks_t start, timer_ticks_t end) {
+    return (end - start) / (double)TICKS_PER_USECOND;
+}
@@ -0,0 +1,15 @@
+#pragma once
+
+#include <stdint.h>
+
+/**
+ * Monotonic timer
+ * On the board this reads the Cortex-A9 global timer; host builds
+ * (-DTIMER_BACKEND_HOST) read clock_gettime(CLOCK_MONOTONIC) instead, so
+ * benchmarks and sweeps run unchanged against the model.
+ */
+
+typedef uint64_t timer_ticks_t;
+
+timer_ticks_t timer_now(void);
+double timer_elapsed_us(timer_ticks_t start, timer_ticks_t end);
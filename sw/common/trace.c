@@ -0,0 +1,57 @@
+#include "trace.h"
+
+#if TRACE_CAPACITY & (TRACE_CAPACITY - 1)
+#error "TRACE_CAPACITY must be a power of two"
+#endif
+
+#define TRACE_MASK (TRACE_CAPACITY - 1)
+
+static trace_event_t trace_ring[TRACE_CAPACITY];
+static u32 trace_head;        // Events ever recorded since the reset
+static timer_ticks_t trace_origin;
+
+// Claims a slot (ldrex/strex on the A9, so an interrupt between the load
+// and the store retries rather than sharing the slot) and fills it
+void trace_record(const char *name, char phase, trace_track_t track, u32 arg) {
+    timer_ticks_t now = timer_now();
+    u32 slot = __atomic_fetch_add(&trace_head, 1, __ATOMIC_RELAXED) & TRACE_MASK;
+    trace_event_t *event = &trace_ring[slot];
+
+    event->ticks = now;
+    event->name = name;
+    event->arg = arg;
+    event->phase = phase;
+    event->track = (u8)track;
+}
+
+void trace_reset(void) {
+    trace_origin = timer_now();
+    __atomic_store_n(&trace_head, 0, __ATOMIC_RELAXED);
+}
+
+u32 trace_count(void) {
+    u32 head = __atomic_load_n(&trace_head, __ATOMIC_RELAXED);
+
+    return head < TRACE_CAPACITY ? head : TRACE_CAPACITY;
+}
+
+void trace_write(FILE *stream) {
+    u32 head = __atomic_load_n(&trace_head, __ATOMIC_RELAXED);
+    u32 first = head > TRACE_CAPACITY ? head - TRACE_CAPACITY : 0;
+
+    // Timestamps are microseconds since the reset; dropped events were
+    // overwritten by newer ones
+    fprintf(stream, "{\"displayTimeUnit\": \"ns\", \"otherData\": {\"dropped\": %u},\n", (unsigned)first);
+    fprintf(stream, " \"traceEvents\": [\n");
+    for (u32 i = first; i < head; i++) {
+        const trace_event_t *event = &trace_ring[i & TRACE_MASK];
+
+        fprintf(stream, "  {\"name\": \"%s\", \"ph\": \"%c\", \"ts\": %.3f, \"pid\": 0, \"tid\": %u",
+                event->name, event->phase, timer_elapsed_us(trace_origin, event->ticks), (unsigned)event->track);
+        if (event->phase == 'i') {
+            fprintf(stream, ", \"s\": \"t\", \"args\": {\"value\": %u}", (unsigned)event->arg);
+        }
+        fprintf(stream, "}%s\n", i + 1 < head ? "," : "");
+    }
+    fprintf(stream, " ]}\n");
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "xil_types.h"
+#include <stdio.h>
+
+#include "timer.h"
+
+/**
+ * Event tracer
+ * Trace points record timestamped begin, end and instant events into a
+ * fixed-size ring; once full, the oldest events are overwritten. Slots are
+ * claimed with an atomic increment, so interrupt handlers can trace while
+ * the main loop is mid-event. trace_write() prints the ring in Chrome
+ * trace_event JSON (load it in chrome://tracing or Perfetto).
+ *
+ * Trace points compile to nothing unless TRACE_ENABLE is defined.
+ */
+
+#ifndef TRACE_CAPACITY
+#define TRACE_CAPACITY 4096  // Events kept (power of two)
+#endif
+
+typedef enum {
+    TRACE_TRACK_MAIN = 0,  // Main loop
+    TRACE_TRACK_IRQ = 1,   // Interrupt handlers
+} trace_track_t;
+
+typedef struct {
+    timer_ticks_t ticks;
+    const char *name;      // Must outlive the trace (string literals)
+    u32 arg;
+    char phase;            // 'B', 'E' or 'i' as in trace_event
+    u8 track;
+} trace_event_t;
+
+// Public Interface
+void trace_record(const char *name, char phase, trace_track_t track, u32 arg);
+void trace_reset(void);
+u32 trace_count(void);
+
+// Results handling (call while no trace points fire)
+void trace_write(FILE *stream);
+
+#ifdef TRACE_ENABLE
+#define TRACE_BEGIN(name)          trace_record((name), 'B', TRACE_TRACK_MAIN, 0)
+#define TRACE_END(name)            trace_record((name), 'E', TRACE_TRACK_MAIN, 0)
+#define TRACE_INSTANT(name, arg)   trace_record((name), 'i', TRACE_TRACK_MAIN, (arg))
+#define TRACE_IRQ_BEGIN(name)      trace_record((name), 'B', TRACE_TRACK_IRQ, 0)
+#define TRACE_IRQ_END(name)        trace_record((name), 'E', TRACE_TRACK_IRQ, 0)
+#else
+#define TRACE_BEGIN(name)          ((void)0)
+#define TRACE_END(name)            ((void)0)
+#define TRACE_INSTANT(name, arg)   ((void)0)
+#define TRACE_IRQ_BEGIN(name)      ((void)0)
+#define TRACE_IRQ_END(name)        ((void)0)
+#endif
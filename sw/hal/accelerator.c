@@ -1,61 +1,873 @@
 #include "accelerator.h"
 
 #include "xil_printf.h"
+#include <string.h>
 
-#include "dma.h"
+#include "../common/trace.h"
+#include "cache.h"
 #include "registers.h"
 
-status_t accelerator_init(void) {
-    return dma_init();
+// Instance resources
+typedef struct {
+    UINTPTR base_addr;
+    u16 dma_dev_id;
+    u16 tx_intr_id;
+    u16 rx_intr_id;
+} accelerator_config_t;
+
+static const accelerator_config_t accelerator_configs[] = {
+    { ACCELERATOR_BASEADDR, DMA_DEV_ID, TX_INTR_ID, RX_INTR_ID },
+#ifdef XPAR_ACCELERATOR_1_BASEADDR
+    { XPAR_ACCELERATOR_1_BASEADDR, XPAR_AXIDMA_1_DEVICE_ID,
+      XPAR_FABRIC_AXIDMA_1_MM2S_INTROUT_VEC_ID, XPAR_FABRIC_AXIDMA_1_S2MM_INTROUT_VEC_ID },
+#endif
+#ifdef XPAR_ACCELERATOR_2_BASEADDR
+    { XPAR_ACCELERATOR_2_BASEADDR, XPAR_AXIDMA_2_DEVICE_ID,
+      XPAR_FABRIC_AXIDMA_2_MM2S_INTROUT_VEC_ID, XPAR_FABRIC_AXIDMA_2_S2MM_INTROUT_VEC_ID },
+#endif
+#ifdef XPAR_ACCELERATOR_3_BASEADDR
+    { XPAR_ACCELERATOR_3_BASEADDR, XPAR_AXIDMA_3_DEVICE_ID,
+      XPAR_FABRIC_AXIDMA_3_MM2S_INTROUT_VEC_ID, XPAR_FABRIC_AXIDMA_3_S2MM_INTROUT_VEC_ID },
+#endif
+};
+
+#define NUM_HARDWARE_INSTANCES ((int)(sizeof(accelerator_configs) / sizeof(accelerator_configs[0])))
+
+// Forward declarations
+static void retire(void *ctx);
+static u32 kernel_hash(const u32 *weights, int count);
+static status_t set_packet_frames(accelerator_t *acc, int frames);
+static status_t encode_stages(const cnn_stages_t *stages, u32 *value);
+static status_t set_chain_dims(accelerator_t *acc);
+static int output_size(const accelerator_t *acc, int size);
+static int tile_start(int tile, int num_tiles, int out_size);
+static status_t write_register(accelerator_t *acc, u32 index, u32 value);
+static status_t write_block(accelerator_t *acc, u32 first, const u32 *values, u32 count);
+static status_t commit(accelerator_t *acc);
+
+int accelerator_get_instance_count(accelerator_backend_t backend) {
+    if (backend == ACCELERATOR_BACKEND_HARDWARE) {
+        return NUM_HARDWARE_INSTANCES;
+    }
+
+    // One simulator per process
+    if (backend == ACCELERATOR_BACKEND_COSIM) {
+        return 1;
+    }
+    return ACCELERATOR_MAX_INSTANCES;
+}
+
+status_t accelerator_init(accelerator_t *acc, int id, accelerator_backend_t backend) {
+    if (!acc) {
+        LOG_ERROR("NULL pointer");
+        return STATUS_ERROR_INVALID_PARAM;
+    }
+
+    if (id < 0 || id >= accelerator_get_instance_count(backend)) {
+        LOG_ERROR("Invalid instance %d", id);
+        return STATUS_ERROR_INVALID_PARAM;
+    }
+
+    acc->id = id;
+    acc->backend = backend;
+    acc->busy = 0;
+    acc->callback = NULL;
+    acc->callback_ctx = NULL;
+    acc->rows = INPUT_SIZE;
+    acc->cols = INPUT_SIZE;
+    acc->packet_frames = 1;
+    acc->stages = (cnn_stages_t){ 1, CNN_POOL_MAX, 0 };
+    acc->chained = 0;
+    acc->chain_stages = acc->stages;
+    acc->kernel_valid = 0;
+    acc->kernel_uploads = 0;
+    acc->kernel_skips = 0;
+
+    if (backend == ACCELERATOR_BACKEND_MODEL) {
+        acc->base_addr = 0;
+        return model_init(&acc->model);
+    }
+
+    if (backend == ACCELERATOR_BACKEND_COSIM) {
+        acc->base_addr = 0;
+        return cosim_init();
+    }
+
+    const accelerator_config_t *config = &accelerator_configs[id];
+    acc->base_addr = config->base_addr;
+    return dma_init(&acc->dma, config->dma_dev_id, config->tx_intr_id, config->rx_intr_id);
+}
+
+status_t accelerator_cleanup(accelerator_t *acc) {
+    if (!acc) {
+        LOG_ERROR("NULL pointer");
+        return STATUS_ERROR_INVALID_PARAM;
+    }
+
+    if (acc->backend != ACCELERATOR_BACKEND_HARDWARE) {
+        return STATUS_SUCCESS;
+    }
+    return dma_cleanup(&acc->dma);
 }
 
-status_t accelerator_cleanup(void) {
-    return dma_cleanup();
+status_t accelerator_set_kernel(accelerator_t *acc, matrix_t *kernel) {
+	if (!acc || !kernel) {
+    	LOG_ERROR("NULL pointer(s)");
+        return STATUS_ERROR_INVALID_PARAM;
+	}
+
+    return accelerator_set_filters(acc, &kernel, 1);
 }
 
-status_t accelerator_set_kernel(matrix_t *kernel) {
-	if (!kernel) {
-    	LOG_ERROR("NULL pointer");
+status_t accelerator_set_filters(accelerator_t *acc, matrix_t **kernels, int count) {
+	if (!acc || !kernels) {
+    	LOG_ERROR("NULL pointer(s)");
         return STATUS_ERROR_INVALID_PARAM;
 	}
 
+    accelerator_kernel_t handle;
+    status_t status = accelerator_kernel_create_filters(&handle, kernels, count);
+    if (status != STATUS_SUCCESS) {
+        return status;
+    }
+
+    return accelerator_load_kernel(acc, &handle);
+}
+
+int accelerator_dimensions_supported(int rows, int cols) {
+
+    // Rows are streamed as whole beats
+    return rows >= MIN_INPUT_SIZE && rows <= INPUT_SIZE &&
+           cols >= MIN_INPUT_SIZE && cols <= INPUT_SIZE &&
+           cols % PIXELS_PER_BEAT == 0;
+}
+
+status_t accelerator_set_dimensions(accelerator_t *acc, int rows, int cols) {
+    if (!acc) {
+        LOG_ERROR("NULL pointer");
+        return STATUS_ERROR_INVALID_PARAM;
+    }
+
+    if (!accelerator_dimensions_supported(rows, cols)) {
+        LOG_ERROR("Unsupported frame dimensions %dx%d", rows, cols);
+        return STATUS_ERROR_INVALID_PARAM;
+    }
+
+    // Registers keep their value across frames
+    if (acc->rows == rows && acc->cols == cols) {
+        return STATUS_SUCCESS;
+    }
+
+    // Width then height, matching the register layout
+    u32 dims[2] = { (u32)cols, (u32)rows };
+    status_t status = write_block(acc, REG_WIDTH_INDEX, dims, 2);
+    if (status != STATUS_SUCCESS) {
+        LOG_ERROR("Could not program dimensions on instance %d", acc->id);
+        return status;
+    }
+
+    acc->rows = rows;
+    acc->cols = cols;
+    status = set_chain_dims(acc);
+    if (status != STATUS_SUCCESS) {
+        return status;
+    }
+    return commit(acc);
+}
+
+status_t accelerator_set_stages(accelerator_t *acc, const cnn_stages_t *stages) {
+    if (!acc || !stages) {
+        LOG_ERROR("NULL pointer(s)");
+        return STATUS_ERROR_INVALID_PARAM;
+    }
+
+    u32 value;
+    status_t status = encode_stages(stages, &value);
+    if (status != STATUS_SUCCESS) {
+        return status;
+    }
+
+    // Registers keep their value across frames
+    if (acc->stages.relu == (stages->relu != 0) && acc->stages.pool == stages->pool &&
+        acc->stages.pool_stride == stages->pool_stride) {
+        return STATUS_SUCCESS;
+    }
+
+    status = write_register(acc, REG_STAGES_INDEX, value);
+    if (status != STATUS_SUCCESS) {
+        LOG_ERROR("Could not program stages on instance %d", acc->id);
+        return status;
+    }
+
+    acc->stages = *stages;
+    acc->stages.relu = (stages->relu != 0);
+    status = set_chain_dims(acc);
+    if (status != STATUS_SUCCESS) {
+        return status;
+    }
+    return commit(acc);
+}
+
+status_t accelerator_output_dimensions(const accelerator_t *acc, int rows, int cols, int *out_rows, int *out_cols) {
+    if (!acc || !out_rows || !out_cols) {
+        LOG_ERROR("NULL pointer(s)");
+        return STATUS_ERROR_INVALID_PARAM;
+    }
+
+    int pooled_rows = output_size(acc, rows);
+    int pooled_cols = output_size(acc, cols);
+    if (pooled_rows <= 0 || pooled_cols <= 0) {
+        LOG_ERROR("Frame %dx%d too small for the configured layers", rows, cols);
+        return STATUS_ERROR_INVALID_PARAM;
+    }
+
+    *out_rows = pooled_rows;
+    *out_cols = pooled_cols * NUM_FILTERS;
+    return STATUS_SUCCESS;
+}
+
+status_t accelerator_set_chain(accelerator_t *acc, matrix_t *kernel, const cnn_stages_t *stages) {
+    if (!acc || !kernel || !stages) {
+        LOG_ERROR("NULL pointer(s)");
+        return STATUS_ERROR_INVALID_PARAM;
+    }
+
+    if (NUM_LAYERS < 2 || NUM_FILTERS != 1 || PIXELS_PER_BEAT != 1) {
+        LOG_ERROR("Bitstream cannot chain layers");
+        return STATUS_ERROR_INVALID_PARAM;
+    }
+
     if (kernel->rows != KERNEL_SIZE || kernel->cols != KERNEL_SIZE) {
-    	LOG_ERROR("Invalid kernel dimensions %dx%d", kernel->rows, kernel->cols);
+        LOG_ERROR("Invalid kernel dimensions %dx%d", kernel->rows, kernel->cols);
         return STATUS_ERROR_INVALID_PARAM;
     }
 
-    // Write kernel values to hardware registers
-    for (int i = 0; i < kernel->rows; i++) {
-        for (int j = 0; j < kernel->cols; j++) {
-            fixed_point_t val;
-            status_t status = matrix_get(kernel, i, j, &val);
-            if (status != STATUS_SUCCESS) {
-            	LOG_ERROR("Could not read kernel value at %d,%d", i, j);
-                return status;
+    // The second layer's registers are not tied to a frame boundary
+    if (acc->busy) {
+        LOG_ERROR("Instance %d busy", acc->id);
+        return STATUS_ERROR_HARDWARE;
+    }
+
+    u32 value;
+    status_t status = encode_stages(stages, &value);
+    if (status != STATUS_SUCCESS) {
+        return status;
+    }
+
+    u32 weights[KERNEL_REGS];
+    cache_prepare_cpu_access(kernel->data, KERNEL_REGS * sizeof(fixed_point_t), &kernel->cache_state);
+    for (int i = 0; i < KERNEL_REGS; i++) {
+        weights[i] = (u32)kernel->data[i];
+    }
+
+    status = write_block(acc, REG_CHAIN_KERNEL_INDEX, weights, KERNEL_REGS);
+    if (status == STATUS_SUCCESS) {
+        status = write_register(acc, REG_CHAIN_STAGES_INDEX, value);
+    }
+    if (status == STATUS_SUCCESS) {
+        status = write_register(acc, REG_CHAIN_INDEX, CHAIN_ENABLE);
+    }
+    if (status != STATUS_SUCCESS) {
+        LOG_ERROR("Could not program the chained layer on instance %d", acc->id);
+        return status;
+    }
+
+    acc->chained = 1;
+    acc->chain_stages = *stages;
+    acc->chain_stages.relu = (stages->relu != 0);
+    status = set_chain_dims(acc);
+    if (status != STATUS_SUCCESS) {
+        return status;
+    }
+    return commit(acc);
+}
+
+status_t accelerator_clear_chain(accelerator_t *acc) {
+    if (!acc) {
+        LOG_ERROR("NULL pointer");
+        return STATUS_ERROR_INVALID_PARAM;
+    }
+
+    if (!acc->chained) {
+        return STATUS_SUCCESS;
+    }
+
+    if (acc->busy) {
+        LOG_ERROR("Instance %d busy", acc->id);
+        return STATUS_ERROR_HARDWARE;
+    }
+
+    status_t status = write_register(acc, REG_CHAIN_INDEX, 0);
+    if (status == STATUS_SUCCESS) {
+        status = commit(acc);
+    }
+    if (status != STATUS_SUCCESS) {
+        LOG_ERROR("Could not disable the chained layer on instance %d", acc->id);
+        return status;
+    }
+
+    acc->chained = 0;
+    return STATUS_SUCCESS;
+}
+
+status_t accelerator_kernel_create(accelerator_kernel_t *handle, matrix_t *kernel) {
+	if (!handle || !kernel) {
+    	LOG_ERROR("NULL pointer(s)");
+        return STATUS_ERROR_INVALID_PARAM;
+	}
+
+    return accelerator_kernel_create_filters(handle, &kernel, 1);
+}
+
+status_t accelerator_kernel_create_filters(accelerator_kernel_t *handle, matrix_t **kernels, int count) {
+	if (!handle || !kernels) {
+    	LOG_ERROR("NULL pointer(s)");
+        return STATUS_ERROR_INVALID_PARAM;
+	}
+
+    if (count <= 0 || count > NUM_FILTERS) {
+    	LOG_ERROR("Invalid filter count %d (bitstream has %d)", count, NUM_FILTERS);
+        return STATUS_ERROR_INVALID_PARAM;
+    }
+
+    // Snapshot the weights in register order; unused filters stay zero
+    memset(handle->weights, 0, sizeof(handle->weights));
+    for (int f = 0; f < count; f++) {
+        matrix_t *kernel = kernels[f];
+        if (!kernel) {
+        	LOG_ERROR("NULL kernel %d", f);
+            return STATUS_ERROR_INVALID_PARAM;
+        }
+
+        if (kernel->rows != KERNEL_SIZE || kernel->cols != KERNEL_SIZE) {
+        	LOG_ERROR("Invalid kernel dimensions %dx%d", kernel->rows, kernel->cols);
+            return STATUS_ERROR_INVALID_PARAM;
+        }
+
+        cache_prepare_cpu_access(kernel->data, KERNEL_REGS * sizeof(fixed_point_t), &kernel->cache_state);
+        for (int i = 0; i < KERNEL_REGS; i++) {
+            handle->weights[f * KERNEL_REGS + i] = (u32)kernel->data[i];
+        }
+    }
+    handle->hash = kernel_hash(handle->weights, FILTER_REGS);
+
+    return STATUS_SUCCESS;
+}
+
+status_t accelerator_load_kernel(accelerator_t *acc, const accelerator_kernel_t *handle) {
+	if (!acc || !handle) {
+    	LOG_ERROR("NULL pointer(s)");
+        return STATUS_ERROR_INVALID_PARAM;
+	}
+
+    // Skip the upload when the instance already holds this kernel
+    if (acc->kernel_valid && acc->loaded_kernel.hash == handle->hash &&
+        memcmp(acc->loaded_kernel.weights, handle->weights, sizeof(handle->weights)) == 0) {
+        acc->kernel_skips++;
+        return STATUS_SUCCESS;
+    }
+
+    // Hardware latches the shadow bank at the first frame boundary after the
+    // commit, so this is safe while a frame is still streaming
+    TRACE_BEGIN("kernel_upload");
+    status_t status = write_block(acc, 0, handle->weights, FILTER_REGS);
+    if (status == STATUS_SUCCESS) {
+        status = commit(acc);
+    }
+    TRACE_END("kernel_upload");
+    if (status != STATUS_SUCCESS) {
+        LOG_ERROR("Could not upload kernel to instance %d", acc->id);
+        acc->kernel_valid = 0;
+        return status;
+    }
+
+    acc->loaded_kernel = *handle;
+    acc->kernel_valid = 1;
+    acc->kernel_uploads++;
+    return STATUS_SUCCESS;
+}
+
+status_t accelerator_compute(accelerator_t *acc, matrix_t *input, matrix_t *output) {
+    status_t status;
+
+    // Send the packet
+    status = accelerator_submit(acc, input, output);
+    if (status != STATUS_SUCCESS) {
+        LOG_ERROR("Transfer error");
+        return status;
+    }
+
+    return accelerator_wait(acc);
+}
+
+status_t accelerator_compute_batch(accelerator_t *acc, matrix_t *input, matrix_t *output, int frames) {
+    status_t status;
+
+    // One transfer each way for the whole batch
+    status = accelerator_submit_batch(acc, input, output, frames);
+    if (status != STATUS_SUCCESS) {
+        LOG_ERROR("Transfer error");
+        return status;
+    }
+
+    return accelerator_wait(acc);
+}
+
+status_t accelerator_submit(accelerator_t *acc, matrix_t *input, matrix_t *output) {
+    return accelerator_submit_batch(acc, input, output, 1);
+}
+
+status_t accelerator_submit_batch(accelerator_t *acc, matrix_t *input, matrix_t *output, int frames) {
+    if (!acc || !input || !output) {
+        LOG_ERROR("NULL pointer(s)");
+        return STATUS_ERROR_INVALID_PARAM;
+    }
+
+    if (acc->busy) {
+        LOG_ERROR("Instance %d busy", acc->id);
+        return STATUS_ERROR_HARDWARE;
+    }
+
+    if (frames <= 0 || frames > 0xFFFF || input->rows % frames != 0) {
+        LOG_ERROR("Cannot split %d rows into %d frames", input->rows, frames);
+        return STATUS_ERROR_INVALID_PARAM;
+    }
+
+    int rows = input->rows / frames;
+    int out_rows, out_cols;
+    status_t status = accelerator_output_dimensions(acc, rows, input->cols, &out_rows, &out_cols);
+    if (status != STATUS_SUCCESS) {
+        return status;
+    }
+    if (output->rows != frames * out_rows || output->cols != out_cols) {
+        LOG_ERROR("Invalid output dimensions %dx%d", output->rows, output->cols);
+        return STATUS_ERROR_INVALID_PARAM;
+    }
+
+    u32 tx_size = input->rows * input->cols * sizeof(fixed_point_t);
+    u32 rx_size = output->rows * output->cols * sizeof(fixed_point_t);
+    if (tx_size > DMA_MAX_TRANSFER_BYTES) {
+        LOG_ERROR("Batch of %d frames exceeds the DMA transfer length", frames);
+        return STATUS_ERROR_INVALID_PARAM;
+    }
+
+    // Safe to update ahead of the DMA, the shadow bank swaps at the frame
+    // boundary (and the packet size is only read when a frame completes)
+    status = accelerator_set_dimensions(acc, rows, input->cols);
+    if (status != STATUS_SUCCESS) {
+        return status;
+    }
+
+    status = set_packet_frames(acc, frames);
+    if (status != STATUS_SUCCESS) {
+        return status;
+    }
+
+    // The model and the simulator complete synchronously; hardware completes
+    // on interrupt
+    TRACE_INSTANT("accelerator_submit", frames);
+    if (acc->backend == ACCELERATOR_BACKEND_COSIM) {
+        cache_prepare_cpu_access(input->data, tx_size, &input->cache_state);
+        cache_prepare_cpu_access(output->data, rx_size, &output->cache_state);
+        TRACE_BEGIN("cosim_transfer");
+        status = cosim_transfer(input->data, tx_size, output->data, rx_size);
+        TRACE_END("cosim_transfer");
+        cache_mark_cpu_dirty(&output->cache_state);
+    } else if (acc->backend == ACCELERATOR_BACKEND_MODEL) {
+        cache_prepare_cpu_access(input->data, tx_size, &input->cache_state);
+        cache_prepare_cpu_access(output->data, rx_size, &output->cache_state);
+        TRACE_BEGIN("model_transfer");
+        status = model_transfer(&acc->model, input->data, tx_size, output->data, rx_size);
+        TRACE_END("model_transfer");
+        cache_mark_cpu_dirty(&output->cache_state);
+    } else {
+        // Only maintain the cache when ownership actually changes hands
+        cache_prepare_device_read(input->data, tx_size, &input->cache_state);
+        cache_prepare_device_write(output->data, rx_size, &output->cache_state);
+        status = dma_submit(&acc->dma, input->data, tx_size, output->data, rx_size);
+    }
+    if (status != STATUS_SUCCESS) {
+        LOG_ERROR("Submit error on instance %d", acc->id);
+        return status;
+    }
+
+    acc->busy = 1;
+    return STATUS_SUCCESS;
+}
+
+status_t accelerator_poll(accelerator_t *acc, int *done) {
+    if (!acc || !done) {
+        LOG_ERROR("NULL pointer(s)");
+        return STATUS_ERROR_INVALID_PARAM;
+    }
+
+    if (!acc->busy) {
+        *done = 1;
+        return STATUS_SUCCESS;
+    }
+
+    if (acc->backend != ACCELERATOR_BACKEND_HARDWARE) {
+        *done = 1;
+        retire(acc);
+        return STATUS_SUCCESS;
+    }
+
+    status_t status = dma_poll(&acc->dma, done);
+    if (status != STATUS_SUCCESS) {
+        acc->busy = 0;
+        return status;
+    }
+
+    // In callback mode the interrupt handler has already retired the job
+    if (*done && !acc->callback) {
+        acc->busy = 0;
+    }
+    return STATUS_SUCCESS;
+}
+
+status_t accelerator_wait(accelerator_t *acc) {
+    if (!acc) {
+        LOG_ERROR("NULL pointer");
+        return STATUS_ERROR_INVALID_PARAM;
+    }
+
+    if (!acc->busy) {
+        return STATUS_SUCCESS;
+    }
+
+    if (acc->backend != ACCELERATOR_BACKEND_HARDWARE) {
+        retire(acc);
+        return STATUS_SUCCESS;
+    }
+
+    TRACE_BEGIN("accelerator_wait");
+    status_t status = dma_wait(&acc->dma);
+    TRACE_END("accelerator_wait");
+
+    // In callback mode the interrupt handler owns the busy flag
+    if (!acc->callback || status != STATUS_SUCCESS) {
+        acc->busy = 0;
+    }
+    return status;
+}
+
+status_t accelerator_set_callback(accelerator_t *acc, accelerator_callback_t callback, void *ctx) {
+    if (!acc) {
+        LOG_ERROR("NULL pointer");
+        return STATUS_ERROR_INVALID_PARAM;
+    }
+
+    if (acc->busy) {
+        LOG_ERROR("Instance %d busy", acc->id);
+        return STATUS_ERROR_HARDWARE;
+    }
+
+    acc->callback = callback;
+    acc->callback_ctx = ctx;
+
+    // Hardware completions are retired straight from the DMA interrupt
+    if (acc->backend == ACCELERATOR_BACKEND_HARDWARE) {
+        return dma_set_callback(&acc->dma, callback ? retire : NULL, acc);
+    }
+    return STATUS_SUCCESS;
+}
+
+status_t accelerator_stream_open(accelerator_t *acc, matrix_t *output) {
+    if (!acc || !output) {
+        LOG_ERROR("NULL pointer(s)");
+        return STATUS_ERROR_INVALID_PARAM;
+    }
+
+    if (acc->backend != ACCELERATOR_BACKEND_HARDWARE) {
+        LOG_ERROR("Row streaming needs a hardware instance");
+        return STATUS_ERROR_INVALID_PARAM;
+    }
+
+    // Frame size comes from accelerator_set_dimensions
+    int out_rows, out_cols;
+    status_t status = accelerator_output_dimensions(acc, acc->rows, acc->cols, &out_rows, &out_cols);
+    if (status != STATUS_SUCCESS) {
+        return status;
+    }
+    if (output->rows != out_rows || output->cols != out_cols) {
+        LOG_ERROR("Invalid output dimensions %dx%d", output->rows, output->cols);
+        return STATUS_ERROR_INVALID_PARAM;
+    }
+
+    if (acc->busy) {
+        LOG_ERROR("Instance %d busy", acc->id);
+        return STATUS_ERROR_HARDWARE;
+    }
+
+    // The receive completes at the frame's tlast
+    status = set_packet_frames(acc, 1);
+    if (status != STATUS_SUCCESS) {
+        return status;
+    }
+
+    // Arm the receive side; input rows follow as separate sends
+    u32 rx_size = output->rows * output->cols * sizeof(fixed_point_t);
+    cache_prepare_device_write(output->data, rx_size, &output->cache_state);
+    status = dma_receive(&acc->dma, output->data, rx_size);
+    if (status != STATUS_SUCCESS) {
+        LOG_ERROR("Stream open error on instance %d", acc->id);
+        return status;
+    }
+
+    acc->busy = 1;
+    return STATUS_SUCCESS;
+}
+
+status_t accelerator_stream_send(accelerator_t *acc, fixed_point_t *data, u32 size) {
+    if (!acc || !data) {
+        LOG_ERROR("NULL pointer(s)");
+        return STATUS_ERROR_INVALID_PARAM;
+    }
+
+    if (!acc->busy) {
+        LOG_ERROR("No stream open on instance %d", acc->id);
+        return STATUS_ERROR_INVALID_PARAM;
+    }
+
+    status_t status = dma_send(&acc->dma, data, size);
+    if (status != STATUS_SUCCESS) {
+        LOG_ERROR("Stream send error on instance %d", acc->id);
+        acc->busy = 0;
+        return status;
+    }
+    return STATUS_SUCCESS;
+}
+
+int accelerator_tiling_supported(int rows, int cols) {
+
+    // Tiles must cover whole pooling windows and an exact number of strides
+    if ((INPUT_SIZE - KERNEL_SIZE) % STRIDE != 0 ||
+        ((INPUT_SIZE - KERNEL_SIZE) / STRIDE + 1) % POOL_SIZE != 0) {
+        return 0;
+    }
+
+    return rows >= INPUT_SIZE && cols >= INPUT_SIZE;
+}
+
+status_t accelerator_compute_tiled(accelerator_t *acc, matrix_t *input, matrix_t *output) {
+    if (!acc || !input || !output) {
+        LOG_ERROR("NULL pointer(s)");
+        return STATUS_ERROR_INVALID_PARAM;
+    }
+
+    if (!accelerator_tiling_supported(input->rows, input->cols)) {
+        LOG_ERROR("Cannot tile %dx%d input", input->rows, input->cols);
+        return STATUS_ERROR_INVALID_PARAM;
+    }
+
+    // Tile placement assumes whole, non-overlapping pooling windows
+    if (acc->stages.pool == CNN_POOL_NONE ||
+        (acc->stages.pool_stride != 0 && acc->stages.pool_stride != POOL_SIZE)) {
+        LOG_ERROR("Tiling needs non-overlapping pooling windows");
+        return STATUS_ERROR_INVALID_PARAM;
+    }
+
+    if (acc->chained) {
+        LOG_ERROR("Tiling does not support chained layers");
+        return STATUS_ERROR_INVALID_PARAM;
+    }
+
+    // Each pooled pixel carries NUM_FILTERS channels
+    int out_rows = ((input->rows - KERNEL_SIZE) / STRIDE + 1) / POOL_SIZE;
+    int out_cols = ((input->cols - KERNEL_SIZE) / STRIDE + 1) / POOL_SIZE;
+    if (output->rows != out_rows || output->cols != out_cols * NUM_FILTERS) {
+        LOG_ERROR("Invalid output dimensions %dx%d", output->rows, output->cols);
+        return STATUS_ERROR_INVALID_PARAM;
+    }
+
+    // Contiguous staging buffers for the DMA
+    matrix_t *tile_in = matrix_create(INPUT_SIZE, INPUT_SIZE);
+    matrix_t *tile_out = matrix_create(OUTPUT_SIZE, OUTPUT_SIZE * NUM_FILTERS);
+    if (!tile_in || !tile_out) {
+        LOG_ERROR("Could not allocate tile buffers");
+        return STATUS_ERROR_MEMORY;
+    }
+
+    int row_tiles = (out_rows + OUTPUT_SIZE - 1) / OUTPUT_SIZE;
+    int col_tiles = (out_cols + OUTPUT_SIZE - 1) / OUTPUT_SIZE;
+
+    // Gather and scatter go through the CPU cache
+    cache_prepare_cpu_access(input->data, input->rows * input->cols * sizeof(fixed_point_t), &input->cache_state);
+    cache_prepare_cpu_access(output->data, out_rows * output->cols * sizeof(fixed_point_t), &output->cache_state);
+    cache_mark_cpu_dirty(&output->cache_state);
+
+    for (int tr = 0; tr < row_tiles; tr++) {
+        for (int tc = 0; tc < col_tiles; tc++) {
+
+            // Output tile origin (the last tile is pulled back to fit)
+            int out_r = tile_start(tr, row_tiles, out_rows);
+            int out_c = tile_start(tc, col_tiles, out_cols);
+            int in_r = out_r * POOL_SIZE * STRIDE;
+            int in_c = out_c * POOL_SIZE * STRIDE;
+
+            // Gather input tile
+            for (int i = 0; i < INPUT_SIZE; i++) {
+                memcpy(&tile_in->data[i * INPUT_SIZE],
+                       &input->data[(in_r + i) * input->cols + in_c],
+                       INPUT_SIZE * sizeof(fixed_point_t));
             }
+            cache_mark_cpu_dirty(&tile_in->cache_state);
 
-            status = registers_write(i * kernel->cols + j, val);
+            status_t status = accelerator_compute(acc, tile_in, tile_out);
             if (status != STATUS_SUCCESS) {
-            	LOG_ERROR("Could not write to register %d", i * kernel->cols + j);
+                LOG_ERROR("Tile %d,%d failed", tr, tc);
                 return status;
             }
+
+            // Scatter output tile (whole pixels, all channels)
+            cache_prepare_cpu_access(tile_out->data, OUTPUT_SIZE * tile_out->cols * sizeof(fixed_point_t), &tile_out->cache_state);
+            for (int i = 0; i < OUTPUT_SIZE; i++) {
+                memcpy(&output->data[(out_r + i) * output->cols + out_c * NUM_FILTERS],
+                       &tile_out->data[i * tile_out->cols],
+                       tile_out->cols * sizeof(fixed_point_t));
+            }
         }
     }
+
+    matrix_destroy(tile_in);
+    matrix_destroy(tile_out);
+
     return STATUS_SUCCESS;
 }
 
-status_t accelerator_compute(matrix_t *input, matrix_t *output) {
-    status_t status;
+status_t accelerator_read_counters(accelerator_t *acc, int clear, perf_counters_t *counters) {
+    if (!acc || !counters) {
+    	LOG_ERROR("NULL pointer(s)");
+        return STATUS_ERROR_INVALID_PARAM;
+    }
 
-    // Send the packet
-    status = dma_transfer(input->data,
-    					  input->rows * input->cols * sizeof(fixed_point_t),
-					   	  output->data,
-						  output->rows * output->cols * sizeof(fixed_point_t));
+    if (acc->backend == ACCELERATOR_BACKEND_MODEL) {
+        return model_read_counters(&acc->model, clear, counters);
+    }
+    if (acc->backend == ACCELERATOR_BACKEND_COSIM) {
+        return cosim_read_counters(clear, counters);
+    }
+    return registers_read_counters(acc->base_addr, clear, counters);
+}
+
+static void retire(void *ctx) {
+    accelerator_t *acc = (accelerator_t *)ctx;
+
+    acc->busy = 0;
+    if (acc->callback) {
+        acc->callback(acc->callback_ctx);
+    }
+}
+
+// FNV-1a over the weight words
+static u32 kernel_hash(const u32 *weights, int count) {
+    u32 hash = 2166136261u;
+
+    for (int i = 0; i < count; i++) {
+        for (int b = 0; b < 4; b++) {
+            hash ^= (weights[i] >> (8 * b)) & 0xFF;
+            hash *= 16777619u;
+        }
+    }
+    return hash;
+}
+
+// Registers keep their value across transfers, so only changes are written
+static status_t set_packet_frames(accelerator_t *acc, int frames) {
+    if (acc->packet_frames == frames) {
+        return STATUS_SUCCESS;
+    }
+
+    status_t status = write_register(acc, REG_PACKET_INDEX, (u32)frames);
+    if (status == STATUS_SUCCESS) {
+        status = commit(acc);
+    }
     if (status != STATUS_SUCCESS) {
-        LOG_ERROR("Transfer error");
+        LOG_ERROR("Could not program packet size on instance %d", acc->id);
         return status;
     }
 
+    acc->packet_frames = frames;
     return STATUS_SUCCESS;
 }
+
+static int tile_start(int tile, int num_tiles, int out_size) {
+    if (tile == num_tiles - 1) {
+        return out_size - OUTPUT_SIZE;
+    }
+    return tile * OUTPUT_SIZE;
+}
+
+static status_t encode_stages(const cnn_stages_t *stages, u32 *value) {
+    if (stages->pool < CNN_POOL_MAX || stages->pool > CNN_POOL_NONE ||
+        stages->pool_stride < 0 || stages->pool_stride > STAGE_STRIDE_MASK) {
+        LOG_ERROR("Unsupported pooling mode %d stride %d", stages->pool, stages->pool_stride);
+        return STATUS_ERROR_INVALID_PARAM;
+    }
+
+    *value = (stages->relu ? STAGE_RELU : 0) | ((u32)stages->pool_stride << STAGE_STRIDE_SHIFT);
+    if (stages->pool == CNN_POOL_AVERAGE) {
+        *value |= STAGE_POOL_AVERAGE;
+    } else if (stages->pool == CNN_POOL_NONE) {
+        *value |= STAGE_POOL_BYPASS;
+    }
+    return STATUS_SUCCESS;
+}
+
+// The second layer takes the first layer's pooled map, whose size follows
+// the frame dimensions and the first layer's stages
+static status_t set_chain_dims(accelerator_t *acc) {
+    if (!acc->chained) {
+        return STATUS_SUCCESS;
+    }
+
+    // Width then height, matching the register layout
+    u32 dims[2] = {
+        (u32)cnn_pooled_size((acc->cols - KERNEL_SIZE) / STRIDE + 1, POOL_SIZE, &acc->stages),
+        (u32)cnn_pooled_size((acc->rows - KERNEL_SIZE) / STRIDE + 1, POOL_SIZE, &acc->stages)
+    };
+    status_t status = write_block(acc, REG_CHAIN_WIDTH_INDEX, dims, 2);
+    if (status != STATUS_SUCCESS) {
+        LOG_ERROR("Could not program chained dimensions on instance %d", acc->id);
+    }
+    return status;
+}
+
+// Output side length for an input side, through every active layer
+static int output_size(const accelerator_t *acc, int size) {
+    int pooled = cnn_pooled_size((size - KERNEL_SIZE) / STRIDE + 1, POOL_SIZE, &acc->stages);
+    if (acc->chained) {
+        pooled = cnn_pooled_size((pooled - KERNEL_SIZE) / STRIDE + 1, POOL_SIZE, &acc->chain_stages);
+    }
+    return pooled;
+}
+
+static status_t write_register(accelerator_t *acc, u32 index, u32 value) {
+    if (acc->backend == ACCELERATOR_BACKEND_MODEL) {
+        return model_write_register(&acc->model, index, value);
+    }
+    if (acc->backend == ACCELERATOR_BACKEND_COSIM) {
+        return cosim_write_register(index, value);
+    }
+    return registers_write(acc->base_addr, index, value);
+}
+
+static status_t write_block(accelerator_t *acc, u32 first, const u32 *values, u32 count) {
+    if (acc->backend == ACCELERATOR_BACKEND_MODEL) {
+        return model_write_block(&acc->model, first, values, count);
+    }
+    if (acc->backend == ACCELERATOR_BACKEND_COSIM) {
+        return cosim_write_block(first, values, count);
+    }
+    return registers_write_block(acc->base_addr, first, values, count);
+}
+
+// Shadow registers only go live once committed, so every configuration
+// change ends with a commit (and an upload never goes live half-written)
+static status_t commit(accelerator_t *acc) {
+    status_t status = write_register(acc, REG_COMMIT_INDEX, COMMIT_ENABLE);
+    if (status != STATUS_SUCCESS) {
+        LOG_ERROR("Could not commit registers on instance %d", acc->id);
+    }
+    return status;
+}
@@ -1,11 +1,104 @@
 #pragma once
 
+#include "../cnn/cnn.h"
 #include "../common/matrix.h"
 #include "../common/status.h"
 #include "config.h"
+#include "cosim.h"
+#include "dma.h"
+#include "model.h"
+#include "registers.h"
+
+// Backend driving an accelerator instance
+typedef enum {
+    ACCELERATOR_BACKEND_HARDWARE = 0,
+    ACCELERATOR_BACKEND_MODEL = 1,
+    ACCELERATOR_BACKEND_COSIM = 2,  // RTL under GHDL (host builds with COSIM_ENABLE)
+} accelerator_backend_t;
+
+// Kernel snapshot with content hash (unchanged kernels skip the upload),
+// holding the weights of every filter in register order
+typedef struct {
+    u32 weights[FILTER_REGS];
+    u32 hash;
+} accelerator_kernel_t;
+
+// Completion callback (interrupt context on hardware)
+typedef void (*accelerator_callback_t)(void *ctx);
+
+// Accelerator instance handle
+typedef struct {
+    int id;
+    accelerator_backend_t backend;
+    UINTPTR base_addr;
+    dma_t dma;
+    model_t model;
+    volatile int busy;
+    accelerator_callback_t callback;
+    void *callback_ctx;
+    int rows;
+    int cols;
+    int packet_frames;
+    cnn_stages_t stages;
+    int chained;
+    cnn_stages_t chain_stages;
+    accelerator_kernel_t loaded_kernel;
+    int kernel_valid;
+    u32 kernel_uploads;
+    u32 kernel_skips;
+} accelerator_t;
 
 // Public Interface
-status_t accelerator_init(void);
-status_t accelerator_cleanup(void);
-status_t accelerator_set_kernel(matrix_t *kernel);
-status_t accelerator_compute(matrix_t *input, matrix_t *output);
+status_t accelerator_init(accelerator_t *acc, int id, accelerator_backend_t backend);
+status_t accelerator_cleanup(accelerator_t *acc);
+status_t accelerator_set_kernel(accelerator_t *acc, matrix_t *kernel);
+status_t accelerator_set_filters(accelerator_t *acc, matrix_t **kernels, int count);
+status_t accelerator_compute(accelerator_t *acc, matrix_t *input, matrix_t *output);
+
+// Frame Dimensions (runtime, up to the synthesized INPUT_SIZE)
+int accelerator_dimensions_supported(int rows, int cols);
+status_t accelerator_set_dimensions(accelerator_t *acc, int rows, int cols);
+
+// Stage Selection (ReLU on/off, max/average/no pooling and the pool stride,
+// 0 stepping by POOL_SIZE; applies from the next frame boundary)
+status_t accelerator_set_stages(accelerator_t *acc, const cnn_stages_t *stages);
+
+// Output matrix dimensions of one frame through the configured layers and
+// stages (each pooled pixel carries NUM_FILTERS channels)
+status_t accelerator_output_dimensions(const accelerator_t *acc, int rows, int cols, int *out_rows, int *out_cols);
+
+// Layer Chaining (NUM_LAYERS 2 bitstreams: the pooled output runs through a
+// second conv/ReLU/pool layer with its own kernel before it leaves the
+// fabric; set while the instance is idle)
+status_t accelerator_set_chain(accelerator_t *acc, matrix_t *kernel, const cnn_stages_t *stages);
+status_t accelerator_clear_chain(accelerator_t *acc);
+
+// Kernel Handles
+status_t accelerator_kernel_create(accelerator_kernel_t *handle, matrix_t *kernel);
+status_t accelerator_kernel_create_filters(accelerator_kernel_t *handle, matrix_t **kernels, int count);
+status_t accelerator_load_kernel(accelerator_t *acc, const accelerator_kernel_t *handle);
+
+// Batched Interface (frames stacked vertically stream back to back in one
+// transfer each way; output frames follow in the same order)
+status_t accelerator_compute_batch(accelerator_t *acc, matrix_t *input, matrix_t *output, int frames);
+
+// Asynchronous Interface
+status_t accelerator_submit(accelerator_t *acc, matrix_t *input, matrix_t *output);
+status_t accelerator_submit_batch(accelerator_t *acc, matrix_t *input, matrix_t *output, int frames);
+status_t accelerator_poll(accelerator_t *acc, int *done);
+status_t accelerator_wait(accelerator_t *acc);
+status_t accelerator_set_callback(accelerator_t *acc, accelerator_callback_t callback, void *ctx);
+
+// Row Streaming Interface (hardware only, see stream.h)
+status_t accelerator_stream_open(accelerator_t *acc, matrix_t *output);
+status_t accelerator_stream_send(accelerator_t *acc, fixed_point_t *data, u32 size);
+
+// Tiled Interface (frames larger than the synthesized INPUT_SIZE)
+int accelerator_tiling_supported(int rows, int cols);
+status_t accelerator_compute_tiled(accelerator_t *acc, matrix_t *input, matrix_t *output);
+
+// Performance Counters (snapshot since the last clear, optionally clearing)
+status_t accelerator_read_counters(accelerator_t *acc, int clear, perf_counters_t *counters);
+
+// Utility
+int accelerator_get_instance_count(accelerator_backend_t backend);
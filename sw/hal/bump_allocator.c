@@ -1,14 +1,19 @@
 #include "bump_allocator.h"
 
 #include "xil_cache.h"
+#include "xil_mmu.h"
 #include "xil_printf.h"
 
+#include "../common/trace.h"
+
 #define MEMORY_ALIGNMENT CACHE_LINE_SIZE
 
 // State
 typedef struct {
     uint32_t next_free;
     uint32_t total_allocated;
+    uint32_t uncached_next_free;
+    uint32_t uncached_allocated;
     int initialized;
 } allocator_state_t;
 
@@ -28,8 +33,21 @@ status_t allocator_init(void) {
         return STATUS_ERROR_INVALID_PARAM;
     }
 
+    if ((UNCACHED_MEM_BASE & (MMU_SECTION_SIZE - 1)) || (UNCACHED_MEM_SIZE & (MMU_SECTION_SIZE - 1))) {
+    	LOG_ERROR("Uncached region not aligned to MMU sections");
+        return STATUS_ERROR_INVALID_PARAM;
+    }
+
+    // Map the stream-only pool non-cacheable, dropping any lines it still holds
+    Xil_DCacheFlushRange((UINTPTR)UNCACHED_MEM_BASE, UNCACHED_MEM_SIZE);
+    for (uint32_t addr = UNCACHED_MEM_BASE; addr < UNCACHED_MEM_BASE + UNCACHED_MEM_SIZE; addr += MMU_SECTION_SIZE) {
+        Xil_SetTlbAttributes(addr, NORM_NONCACHE);
+    }
+
     allocator_state.next_free = MATRIX_MEM_BASE;
     allocator_state.total_allocated = 0;
+    allocator_state.uncached_next_free = UNCACHED_MEM_BASE;
+    allocator_state.uncached_allocated = 0;
     allocator_state.initialized = 1;
 
     return STATUS_SUCCESS;
@@ -62,7 +80,41 @@ void* allocator_alloc(size_t size) {
     allocator_state.next_free += aligned_size;
     allocator_state.total_allocated += aligned_size;
 
+    TRACE_BEGIN("allocator_alloc");
     Xil_DCacheInvalidateRange((UINTPTR)ptr, aligned_size);
+    TRACE_END("allocator_alloc");
+
+    return ptr;
+}
+
+void* allocator_alloc_uncached(size_t size) {
+    if (!allocator_state.initialized) {
+        LOG_ERROR("Allocator not initialized");
+        return NULL;
+    }
+
+    if (size == 0) {
+        LOG_ERROR("Zero size allocation requested");
+        return NULL;
+    }
+
+    size_t aligned_size = align_up(size);
+
+    if (aligned_size < size) {
+    	LOG_ERROR("Size overflow during alignment");
+        return NULL;
+    }
+
+    if (allocator_state.uncached_allocated + aligned_size > UNCACHED_MEM_SIZE) {
+    	LOG_ERROR("Out of uncached memory (requested: %u, available: %u)", aligned_size, UNCACHED_MEM_SIZE - allocator_state.uncached_allocated);
+        return NULL;
+    }
+
+    // No maintenance needed, the region bypasses the cache
+    void* ptr = (void*)allocator_state.uncached_next_free;
+    allocator_state.uncached_next_free += aligned_size;
+    allocator_state.uncached_allocated += aligned_size;
+    TRACE_INSTANT("allocator_alloc_uncached", aligned_size);
 
     return ptr;
 }
@@ -72,8 +124,11 @@ void allocator_free(void* ptr) {
 }
 
 void allocator_reset(void) {
+    TRACE_INSTANT("allocator_reset", allocator_state.total_allocated);
     allocator_state.next_free = MATRIX_MEM_BASE;
     allocator_state.total_allocated = 0;
+    allocator_state.uncached_next_free = UNCACHED_MEM_BASE;
+    allocator_state.uncached_allocated = 0;
 }
 
 uint32_t allocator_get_used(void) {
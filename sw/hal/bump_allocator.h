@@ -7,11 +7,13 @@
  * Simple bump allocator for matrix operations
  * Allocates memory sequentially from a fixed memory pool.
  * Memory can only be reset in bulk, not freed individually.
+ * A second pool is mapped non-cacheable for stream-only DMA buffers.
  */
 
 // Public Interface
 status_t allocator_init(void);
 void *allocator_alloc(size_t size);
+void *allocator_alloc_uncached(size_t size);
 void allocator_free(void *ptr);
 void allocator_reset(void);
 
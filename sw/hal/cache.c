@@ -0,0 +1,106 @@
+#include "cache.h"
+
+#include "xil_cache.h"
+#include <stdio.h>
+
+#include "../common/timer.h"
+#include "../common/trace.h"
+
+static cache_stats_t cache_stats;
+
+static void flush(void *ptr, u32 size) {
+    TRACE_BEGIN("cache_flush");
+    timer_ticks_t start = timer_now();
+    Xil_DCacheFlushRange((UINTPTR)ptr, size);
+    timer_ticks_t end = timer_now();
+    TRACE_END("cache_flush");
+
+    cache_stats.flushes++;
+    cache_stats.bytes_flushed += size;
+    cache_stats.time_us += timer_elapsed_us(start, end);
+}
+
+static void invalidate(void *ptr, u32 size) {
+    TRACE_BEGIN("cache_invalidate");
+    timer_ticks_t start = timer_now();
+    Xil_DCacheInvalidateRange((UINTPTR)ptr, size);
+    timer_ticks_t end = timer_now();
+    TRACE_END("cache_invalidate");
+
+    cache_stats.invalidates++;
+    cache_stats.bytes_invalidated += size;
+    cache_stats.time_us += timer_elapsed_us(start, end);
+}
+
+void cache_prepare_device_read(void *ptr, u32 size, cache_state_t *state) {
+    switch (*state) {
+        case CACHE_STATE_CPU_DIRTY:
+            flush(ptr, size);
+            *state = CACHE_STATE_CLEAN;
+            break;
+
+        // Memory already holds the data
+        default:
+            cache_stats.skipped++;
+            break;
+    }
+}
+
+void cache_prepare_device_write(void *ptr, u32 size, cache_state_t *state) {
+    switch (*state) {
+
+        // Dirty lines must not be evicted on top of the incoming data.
+        // The device overwrites the whole buffer, so they can be discarded.
+        case CACHE_STATE_CPU_DIRTY:
+            invalidate(ptr, size);
+            *state = CACHE_STATE_DEVICE_OWNED;
+            break;
+
+        case CACHE_STATE_UNCACHED:
+            cache_stats.skipped++;
+            break;
+
+        // No dirty lines; stale clean lines are dropped when the CPU reads
+        default:
+            cache_stats.skipped++;
+            *state = CACHE_STATE_DEVICE_OWNED;
+            break;
+    }
+}
+
+void cache_prepare_cpu_access(void *ptr, u32 size, cache_state_t *state) {
+    if (*state == CACHE_STATE_DEVICE_OWNED) {
+        invalidate(ptr, size);
+        *state = CACHE_STATE_CLEAN;
+    }
+}
+
+void cache_mark_cpu_dirty(cache_state_t *state) {
+    if (*state != CACHE_STATE_UNCACHED) {
+        *state = CACHE_STATE_CPU_DIRTY;
+    }
+}
+
+void cache_stats_reset(void) {
+    cache_stats.flushes = 0;
+    cache_stats.invalidates = 0;
+    cache_stats.skipped = 0;
+    cache_stats.bytes_flushed = 0;
+    cache_stats.bytes_invalidated = 0;
+    cache_stats.time_us = 0;
+}
+
+void cache_stats_get(cache_stats_t *stats) {
+    *stats = cache_stats;
+}
+
+void cache_stats_print(int frames) {
+    printf("\nCache Maintenance:\n");
+    printf("  Flushes:        %u (%llu bytes)\n", (unsigned)cache_stats.flushes, (unsigned long long)cache_stats.bytes_flushed);
+    printf("  Invalidates:    %u (%llu bytes)\n", (unsigned)cache_stats.invalidates, (unsigned long long)cache_stats.bytes_invalidated);
+    printf("  Skipped:        %u\n", (unsigned)cache_stats.skipped);
+    printf("  Total time:     %.2f us\n", cache_stats.time_us);
+    if (frames > 0) {
+        printf("  Per frame:      %.2f us\n", cache_stats.time_us / frames);
+    }
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include "xil_types.h"
+
+/**
+ * Cache ownership tracking for DMA buffers
+ * Each buffer records who holds the current copy of its data, so cache
+ * maintenance is only issued when ownership actually changes hands.
+ */
+
+typedef enum {
+    CACHE_STATE_CLEAN = 0,        // Cache and memory agree
+    CACHE_STATE_CPU_DIRTY = 1,    // CPU wrote through the cache, memory is stale
+    CACHE_STATE_DEVICE_OWNED = 2, // Device wrote memory, cached lines are stale
+    CACHE_STATE_UNCACHED = 3,     // Non-cacheable mapping, never maintained
+} cache_state_t;
+
+typedef struct {
+    u32 flushes;
+    u32 invalidates;
+    u32 skipped;
+    u64 bytes_flushed;
+    u64 bytes_invalidated;
+    double time_us;
+} cache_stats_t;
+
+// Ownership transitions
+void cache_prepare_device_read(void *ptr, u32 size, cache_state_t *state);
+void cache_prepare_device_write(void *ptr, u32 size, cache_state_t *state);
+void cache_prepare_cpu_access(void *ptr, u32 size, cache_state_t *state);
+void cache_mark_cpu_dirty(cache_state_t *state);
+
+// Statistics
+void cache_stats_reset(void);
+void cache_stats_get(cache_stats_t *stats);
+void cache_stats_print(int frames);
@@ -2,6 +2,8 @@
 
 #include "xparameters.h"
 
+#include "../common/fixed.h"
+
 // Memory Map
 #define DDR_BASE_ADDR         XPAR_PS7_DDR_0_S_AXI_BASEADDR
 #define MEM_BASE_ADDR        (DDR_BASE_ADDR + 0x1000000)
@@ -10,14 +12,24 @@
 #define MATRIX_MEM_BASE      (MEM_BASE_ADDR + 0x00500000)
 #define MATRIX_MEM_SIZE       0x04000000  // 64MB
 
+// Non-cacheable region for stream-only buffers (whole 1MB MMU sections)
+#define UNCACHED_MEM_BASE    (MATRIX_MEM_BASE + MATRIX_MEM_SIZE)
+#define UNCACHED_MEM_SIZE     0x01000000  // 16MB
+#define MMU_SECTION_SIZE      0x00100000
+
 // DMA Configuration
 #define DMA_DEV_ID            XPAR_AXIDMA_0_DEVICE_ID
 #define DMA_BASE_ADDR         XPAR_AXI_DMA_0_BASEADDR
+#define DMA_MAX_TRANSFER_BYTES ((1 << 23) - 1)  // c_sg_length_width in build_hw.tcl
 
 // Accelerator Configuration
 #define ACCELERATOR_BASEADDR  XPAR_ACCELERATOR_0_BASEADDR
 #define REG_OFFSET            0x4
 
+// Multi-Instance Configuration
+#define ACCELERATOR_MAX_INSTANCES 4
+#define ACCELERATOR_CLOCK_HZ      100000000
+
 // Cache Configuration
 #define CACHE_LINE_SIZE       64
 
@@ -30,10 +42,90 @@
 #define RESET_TIMEOUT_COUNTER 10000
 #define POLL_TIMEOUT_COUNTER  1000000U
 
-// CNN Parameters
+// CNN Parameters (host builds may override them to match the simulated
+// generics)
+#ifndef INPUT_SIZE
 #define INPUT_SIZE            128
+#endif
+#ifndef KERNEL_SIZE
 #define KERNEL_SIZE           3
+#endif
+#ifndef STRIDE
 #define STRIDE 				  1
+#endif
+#ifndef POOL_SIZE
 #define POOL_SIZE			  2
+#endif
 #define OUTPUT_SIZE        (((INPUT_SIZE - KERNEL_SIZE) / STRIDE + 1) / POOL_SIZE)
-#define NUMBER_OF_REGS       (KERNEL_SIZE * KERNEL_SIZE)
+#define KERNEL_REGS          (KERNEL_SIZE * KERNEL_SIZE)
+
+// Filters applied per pass (must match the bitstream); each pooled pixel
+// streams out as NUM_FILTERS consecutive channel values
+#define NUM_FILTERS           1
+#define FILTER_REGS          (KERNEL_REGS * NUM_FILTERS)
+
+// Conv/ReLU/pool layers in the fabric (must match the bitstream); with 2 the
+// pooled stream can feed a second layer whose kernel follows the filters.
+// Chaining needs NUM_FILTERS 1 and one pixel per beat
+#define NUM_LAYERS            1
+#define REG_CHAIN_KERNEL_INDEX (FILTER_REGS)
+#define NUMBER_OF_REGS       (FILTER_REGS + KERNEL_REGS * (NUM_LAYERS - 1))
+
+// Control registers after the kernel (INPUT_SIZE is the synthesized maximum)
+#define REG_WIDTH_INDEX       (NUMBER_OF_REGS)
+#define REG_HEIGHT_INDEX      (NUMBER_OF_REGS + 1)
+
+// Frames per output packet (tlast closes every n-th frame, so a batch of
+// back-to-back frames completes as one DMA transfer; resets to 1)
+#define REG_PACKET_INDEX      (NUMBER_OF_REGS + 2)
+
+// Post-convolution stage modes (ReLU on/off, max/average/no pooling and a
+// pool stride, 0 meaning POOL_SIZE); they take effect at frame boundaries
+#define REG_STAGES_INDEX      (NUMBER_OF_REGS + 3)
+#define STAGE_RELU            0x1
+#define STAGE_POOL_AVERAGE    0x2
+#define STAGE_POOL_BYPASS     0x4
+#define STAGE_STRIDE_SHIFT    8
+#define STAGE_STRIDE_MASK     0xF
+#define STAGE_DEFAULT         STAGE_RELU
+
+// Layer chaining (bit 0 runs the second layer on the pooled stream, whose
+// dimensions and stage modes have their own registers; only changed while
+// the instance is idle)
+#define REG_CHAIN_INDEX        (NUMBER_OF_REGS + 4)
+#define REG_CHAIN_WIDTH_INDEX  (NUMBER_OF_REGS + 5)
+#define REG_CHAIN_HEIGHT_INDEX (NUMBER_OF_REGS + 6)
+#define REG_CHAIN_STAGES_INDEX (NUMBER_OF_REGS + 7)
+#define CHAIN_ENABLE           0x1
+
+// Performance counters (writing the control register latches and/or clears
+// them; reads return the last latched values)
+#define REG_PERF_CTRL_INDEX   (NUMBER_OF_REGS + 8)
+#define REG_PERF_BASE_INDEX   (NUMBER_OF_REGS + 9)
+#define PERF_CTRL_LATCH       0x1
+#define PERF_CTRL_CLEAR       0x2
+#define PERF_ACTIVE_CYCLES    0
+#define PERF_INPUT_STALLS     1
+#define PERF_OUTPUT_STALLS    2
+#define PERF_INPUT_BEATS      3
+#define PERF_OUTPUT_BEATS     4
+#define PERF_FRAMES           5
+#define PERF_COUNTER_COUNT    6
+
+// Bank commit (kernel and control writes land in a shadow bank that goes
+// live at the first frame boundary after a commit; reads return the layers
+// still waiting for one, bit 0 the first and bit 1 the chained second)
+#define REG_COMMIT_INDEX      (REG_PERF_BASE_INDEX + PERF_COUNTER_COUNT)
+#define COMMIT_ENABLE         0x1
+
+#define REGISTER_FILE_SIZE    (REG_COMMIT_INDEX + 1)
+#define MIN_INPUT_SIZE        (KERNEL_SIZE + (POOL_SIZE - 1) * STRIDE)
+
+// Stream Packing (pixels per AXI4-Stream beat, must match the bitstream;
+// narrow samples default to filling a 32-bit beat)
+#define PIXELS_PER_BEAT       (32 / FIXED_POINT_WIDTH)
+#define STREAM_BEAT_BYTES     (PIXELS_PER_BEAT * FIXED_POINT_WIDTH / 8)
+
+#if PIXELS_PER_BEAT > 1 && STRIDE != 1
+#error "Packed streams require STRIDE 1"
+#endif
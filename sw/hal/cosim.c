@@ -0,0 +1,344 @@
+#include "cosim.h"
+
+#include "xil_printf.h"
+
+#ifdef COSIM_ENABLE
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Commands (must match cosim_pkg.vhdl)
+#define COSIM_IDLE   0
+#define COSIM_WRITE  1
+#define COSIM_READ   2
+#define COSIM_STREAM 3
+#define COSIM_RESET  4
+#define COSIM_QUIT   5
+
+// Command arguments (cosim_argument index)
+#define COSIM_ARG_ADDR     0
+#define COSIM_ARG_DATA     1
+#define COSIM_ARG_TX_BEATS 2
+#define COSIM_ARG_RX_BEATS 3
+
+#define COSIM_MAX_ARGS 16
+
+// Entry point of the GHDL-elaborated design
+extern int ghdl_main(int argc, char **argv);
+
+// Shared with the simulation thread; the driver posts one command and
+// sleeps until the testbench completes it
+typedef struct {
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    int started;
+    int finished;
+    int command;
+    u32 args[4];
+    const u32 *tx;
+    u8 *rx;
+    u32 rx_size;
+    u32 rx_count;
+    int result;
+    u32 cycles;
+} cosim_state_t;
+
+static cosim_state_t cosim = {
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+    .cond = PTHREAD_COND_INITIALIZER,
+};
+
+// Forward declarations
+static void *run_simulation(void *arg);
+static status_t execute(int command, u32 arg0, u32 arg1, int *result);
+
+status_t cosim_init(void) {
+    int result;
+
+    // GHDL runs once per process, so later instances reset the design
+    if (cosim.started) {
+        return execute(COSIM_RESET, 0, 0, &result);
+    }
+
+    if (pthread_create(&cosim.thread, NULL, run_simulation, NULL) != 0) {
+        LOG_ERROR("Could not start the simulation thread");
+        return STATUS_ERROR_HARDWARE;
+    }
+    cosim.started = 1;
+    atexit(cosim_shutdown);
+
+    return STATUS_SUCCESS;
+}
+
+void cosim_shutdown(void) {
+    int result;
+
+    if (!cosim.started || cosim.finished) {
+        return;
+    }
+
+    execute(COSIM_QUIT, 0, 0, &result);
+    pthread_join(cosim.thread, NULL);
+}
+
+status_t cosim_write_register(u32 index, u32 value) {
+    int result;
+
+    if (index >= REGISTER_FILE_SIZE) {
+        return STATUS_ERROR_OVERFLOW;
+    }
+    return execute(COSIM_WRITE, index * REG_OFFSET, value, &result);
+}
+
+status_t cosim_read_register(u32 index, u32 *value_ptr) {
+    int result;
+
+    if (!value_ptr) {
+        return STATUS_ERROR_INVALID_PARAM;
+    }
+
+    if (index >= REGISTER_FILE_SIZE) {
+        return STATUS_ERROR_OVERFLOW;
+    }
+
+    status_t status = execute(COSIM_READ, index * REG_OFFSET, 0, &result);
+    *value_ptr = (u32)result;
+    return status;
+}
+
+status_t cosim_write_block(u32 first, const u32 *values, u32 count) {
+    if (!values) {
+        return STATUS_ERROR_INVALID_PARAM;
+    }
+
+    if (first + count > REGISTER_FILE_SIZE) {
+        return STATUS_ERROR_OVERFLOW;
+    }
+
+    for (u32 i = 0; i < count; i++) {
+        status_t status = cosim_write_register(first + i, values[i]);
+        if (status != STATUS_SUCCESS) {
+            return status;
+        }
+    }
+    return STATUS_SUCCESS;
+}
+
+status_t cosim_read_counters(int clear, perf_counters_t *counters) {
+    u32 values[PERF_COUNTER_COUNT];
+
+    if (!counters) {
+        return STATUS_ERROR_INVALID_PARAM;
+    }
+
+    // Same sequence as registers_read_counters
+    status_t status = cosim_write_register(REG_PERF_CTRL_INDEX, PERF_CTRL_LATCH | (clear ? PERF_CTRL_CLEAR : 0));
+    for (int i = 0; i < PERF_COUNTER_COUNT && status == STATUS_SUCCESS; i++) {
+        status = cosim_read_register(REG_PERF_BASE_INDEX + i, &values[i]);
+    }
+    if (status != STATUS_SUCCESS) {
+        return status;
+    }
+
+    counters->active_cycles = values[PERF_ACTIVE_CYCLES];
+    counters->input_stall_cycles = values[PERF_INPUT_STALLS];
+    counters->output_stall_cycles = values[PERF_OUTPUT_STALLS];
+    counters->input_beats = values[PERF_INPUT_BEATS];
+    counters->output_beats = values[PERF_OUTPUT_BEATS];
+    counters->frames = values[PERF_FRAMES];
+    return STATUS_SUCCESS;
+}
+
+status_t cosim_transfer(void *tx_data_ptr, u32 tx_data_size, void *rx_data_ptr, u32 rx_data_size) {
+    int result;
+
+    if (!tx_data_ptr || !rx_data_ptr) {
+        LOG_ERROR("NULL pointer(s)");
+        return STATUS_ERROR_INVALID_PARAM;
+    }
+
+    // Beats are 32-bit words, as the DMA moves them
+    if (STREAM_BEAT_BYTES != sizeof(u32) || tx_data_size % STREAM_BEAT_BYTES != 0) {
+        LOG_ERROR("Transfer not aligned to %d byte beats", STREAM_BEAT_BYTES);
+        return STATUS_ERROR_INVALID_PARAM;
+    }
+
+    cosim.tx = (const u32 *)tx_data_ptr;
+    cosim.rx = (u8 *)rx_data_ptr;
+    cosim.rx_size = rx_data_size;
+    cosim.rx_count = 0;
+
+    u32 rx_beats = (rx_data_size + STREAM_BEAT_BYTES - 1) / STREAM_BEAT_BYTES;
+    status_t status = execute(COSIM_STREAM, tx_data_size / STREAM_BEAT_BYTES, rx_beats, &result);
+    if (status != STATUS_SUCCESS) {
+        return status;
+    }
+
+    // S2MM stops at tlast, so a short packet leaves the buffer partly unwritten
+    if (result != 0 || cosim.rx_count != rx_beats) {
+        LOG_ERROR("Stream ended after %u of %u output beats (%u cycles)",
+                  (unsigned)cosim.rx_count, (unsigned)rx_beats, (unsigned)cosim.cycles);
+        return STATUS_ERROR_HARDWARE;
+    }
+    return STATUS_SUCCESS;
+}
+
+u32 cosim_get_transfer_cycles(void) {
+    return cosim.cycles;
+}
+
+//
+// VHPIDIRECT callbacks (simulation thread)
+//
+
+int cosim_command(void) {
+    pthread_mutex_lock(&cosim.lock);
+    while (cosim.command == COSIM_IDLE) {
+        pthread_cond_wait(&cosim.cond, &cosim.lock);
+    }
+    int command = cosim.command;
+    pthread_mutex_unlock(&cosim.lock);
+
+    return command;
+}
+
+int cosim_argument(int index) {
+    return (index >= 0 && index < 4) ? (int)cosim.args[index] : 0;
+}
+
+int cosim_tx_beat(int index) {
+    return (int)cosim.tx[index];
+}
+
+void cosim_rx_beat(int data, int last) {
+    u32 offset = cosim.rx_count * STREAM_BEAT_BYTES;
+    u32 word = (u32)data;
+
+    // Bytes past the buffer end are dropped, as the DMA would
+    if (offset < cosim.rx_size) {
+        u32 bytes = cosim.rx_size - offset;
+        memcpy(cosim.rx + offset, &word, bytes < STREAM_BEAT_BYTES ? bytes : STREAM_BEAT_BYTES);
+    }
+    cosim.rx_count++;
+    (void)last;
+}
+
+void cosim_complete(int result, int cycles) {
+    pthread_mutex_lock(&cosim.lock);
+    cosim.result = result;
+    cosim.cycles = (u32)cycles;
+    cosim.command = COSIM_IDLE;
+    pthread_cond_broadcast(&cosim.cond);
+    pthread_mutex_unlock(&cosim.lock);
+}
+
+static void *run_simulation(void *arg) {
+    char generics[COSIM_MAX_ARGS][40];
+    char *argv[COSIM_MAX_ARGS + 1];
+    int argc = 0;
+
+    // Elaborate the testbench with the configuration the driver was built for
+    argv[argc++] = "cosim";
+    snprintf(generics[argc], sizeof(generics[0]), "-gINPUT_SIZE=%d", INPUT_SIZE);
+    argv[argc] = generics[argc]; argc++;
+    snprintf(generics[argc], sizeof(generics[0]), "-gKERNEL_SIZE=%d", KERNEL_SIZE);
+    argv[argc] = generics[argc]; argc++;
+    snprintf(generics[argc], sizeof(generics[0]), "-gSTRIDE=%d", STRIDE);
+    argv[argc] = generics[argc]; argc++;
+    snprintf(generics[argc], sizeof(generics[0]), "-gPOOL_SIZE=%d", POOL_SIZE);
+    argv[argc] = generics[argc]; argc++;
+    snprintf(generics[argc], sizeof(generics[0]), "-gDATA_WIDTH=%d", FIXED_POINT_WIDTH);
+    argv[argc] = generics[argc]; argc++;
+    snprintf(generics[argc], sizeof(generics[0]), "-gFRACTIONAL_BITS=%d", FIXED_POINT_BITS);
+    argv[argc] = generics[argc]; argc++;
+    snprintf(generics[argc], sizeof(generics[0]), "-gPIXELS_PER_BEAT=%d", PIXELS_PER_BEAT);
+    argv[argc] = generics[argc]; argc++;
+    snprintf(generics[argc], sizeof(generics[0]), "-gNUM_FILTERS=%d", NUM_FILTERS);
+    argv[argc] = generics[argc]; argc++;
+    snprintf(generics[argc], sizeof(generics[0]), "-gNUM_LAYERS=%d", NUM_LAYERS);
+    argv[argc] = generics[argc]; argc++;
+    argv[argc] = NULL;
+
+    ghdl_main(argc, argv);
+
+    // A simulation that stops on its own (assertion failure) fails every
+    // later command instead of hanging the driver
+    pthread_mutex_lock(&cosim.lock);
+    cosim.finished = 1;
+    pthread_cond_broadcast(&cosim.cond);
+    pthread_mutex_unlock(&cosim.lock);
+
+    return arg;
+}
+
+static status_t execute(int command, u32 arg0, u32 arg1, int *result) {
+    pthread_mutex_lock(&cosim.lock);
+    if (cosim.finished) {
+        pthread_mutex_unlock(&cosim.lock);
+        LOG_ERROR("Simulation has stopped");
+        return STATUS_ERROR_HARDWARE;
+    }
+
+    if (command == COSIM_READ || command == COSIM_WRITE) {
+        cosim.args[COSIM_ARG_ADDR] = arg0;
+        cosim.args[COSIM_ARG_DATA] = arg1;
+    } else {
+        cosim.args[COSIM_ARG_TX_BEATS] = arg0;
+        cosim.args[COSIM_ARG_RX_BEATS] = arg1;
+    }
+    cosim.command = command;
+    pthread_cond_broadcast(&cosim.cond);
+
+    // Quit is not acknowledged, the thread just ends
+    while (command != COSIM_QUIT && cosim.command != COSIM_IDLE && !cosim.finished) {
+        pthread_cond_wait(&cosim.cond, &cosim.lock);
+    }
+    int completed = (cosim.command == COSIM_IDLE);
+    *result = cosim.result;
+    pthread_mutex_unlock(&cosim.lock);
+
+    if (command != COSIM_QUIT && !completed) {
+        LOG_ERROR("Simulation stopped during command %d", command);
+        return STATUS_ERROR_HARDWARE;
+    }
+    return STATUS_SUCCESS;
+}
+
+#else
+
+status_t cosim_init(void) {
+    LOG_ERROR("Co-simulation not built in (COSIM_ENABLE)");
+    return STATUS_ERROR_HARDWARE;
+}
+
+void cosim_shutdown(void) {
+}
+
+status_t cosim_write_register(u32 index, u32 value) {
+    return STATUS_ERROR_HARDWARE;
+}
+
+status_t cosim_read_register(u32 index, u32 *value_ptr) {
+    return STATUS_ERROR_HARDWARE;
+}
+
+status_t cosim_write_block(u32 first, const u32 *values, u32 count) {
+    return STATUS_ERROR_HARDWARE;
+}
+
+status_t cosim_read_counters(int clear, perf_counters_t *counters) {
+    return STATUS_ERROR_HARDWARE;
+}
+
+status_t cosim_transfer(void *tx_data_ptr, u32 tx_data_size, void *rx_data_ptr, u32 rx_data_size) {
+    return STATUS_ERROR_HARDWARE;
+}
+
+u32 cosim_get_transfer_cycles(void) {
+    return 0;
+}
+
+#endif
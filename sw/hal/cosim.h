@@ -0,0 +1,32 @@
+#pragma once
+
+#include "xil_types.h"
+
+#include "../common/status.h"
+#include "config.h"
+#include "registers.h"
+
+/**
+ * GHDL co-simulation of one accelerator instance
+ * Runs hw/tb/cosim_tb.vhdl (the real accelerator.vhdl) in a GHDL thread of
+ * the same process. The testbench fetches AXI-Lite writes/reads and stream
+ * transfers from here through VHPIDIRECT calls and drives them cycle by
+ * cycle, so the driver stack gets bit-exact results and true cycle counts
+ * on a host. The generics follow config.h.
+ *
+ * Only built with COSIM_ENABLE (see scripts/cosim.sh); otherwise every
+ * call fails.
+ */
+
+// Public Interface
+status_t cosim_init(void);
+void cosim_shutdown(void);
+status_t cosim_write_register(u32 index, u32 value);
+status_t cosim_read_register(u32 index, u32 *value_ptr);
+status_t cosim_write_block(u32 first, const u32 *values, u32 count);
+status_t cosim_read_counters(int clear, perf_counters_t *counters);
+status_t cosim_transfer(void *tx_data_ptr, u32 tx_data_size, void *rx_data_ptr, u32 rx_data_size);
+
+// Clock cycles from the first input beat to the last output beat of the
+// most recent transfer
+u32 cosim_get_transfer_cycles(void);
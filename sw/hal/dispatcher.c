@@ -0,0 +1,170 @@
+#include "dispatcher.h"
+
+#include "xil_printf.h"
+
+// Forward declarations
+static dispatcher_lane_t *shallowest_lane(dispatcher_t *d);
+static status_t service_lane(dispatcher_lane_t *lane, int *completed);
+
+status_t dispatcher_init(dispatcher_t *d, accelerator_t *instances, int num_instances) {
+    if (!d || !instances) {
+        LOG_ERROR("NULL pointer(s)");
+        return STATUS_ERROR_INVALID_PARAM;
+    }
+
+    if (num_instances <= 0 || num_instances > ACCELERATOR_MAX_INSTANCES) {
+        LOG_ERROR("Invalid number of instances %d", num_instances);
+        return STATUS_ERROR_INVALID_PARAM;
+    }
+
+    for (int i = 0; i < num_instances; i++) {
+        d->lanes[i].acc = &instances[i];
+        d->lanes[i].head = 0;
+        d->lanes[i].depth = 0;
+        d->lanes[i].in_flight = 0;
+        d->lanes[i].frames = 0;
+    }
+    d->num_lanes = num_instances;
+
+    return STATUS_SUCCESS;
+}
+
+status_t dispatcher_set_kernel(dispatcher_t *d, matrix_t *kernel) {
+    if (!d || !kernel) {
+        LOG_ERROR("NULL pointer(s)");
+        return STATUS_ERROR_INVALID_PARAM;
+    }
+
+    for (int i = 0; i < d->num_lanes; i++) {
+        status_t status = accelerator_set_kernel(d->lanes[i].acc, kernel);
+        if (status != STATUS_SUCCESS) {
+            LOG_ERROR("Could not set kernel on instance %d", d->lanes[i].acc->id);
+            return status;
+        }
+    }
+    return STATUS_SUCCESS;
+}
+
+status_t dispatcher_run(dispatcher_t *d, matrix_t **inputs, matrix_t **outputs, int num_frames) {
+    if (!d || !inputs || !outputs) {
+        LOG_ERROR("NULL pointer(s)");
+        return STATUS_ERROR_INVALID_PARAM;
+    }
+
+    if (num_frames <= 0) {
+        LOG_ERROR("Invalid number of frames %d", num_frames);
+        return STATUS_ERROR_INVALID_PARAM;
+    }
+
+    int next = 0;
+    int completed = 0;
+
+    while (completed < num_frames) {
+
+        // Assign frames to the least loaded queues
+        while (next < num_frames) {
+            dispatcher_lane_t *lane = shallowest_lane(d);
+            if (!lane) {
+                break;
+            }
+
+            int tail = (lane->head + lane->depth) % DISPATCHER_QUEUE_DEPTH;
+            lane->queue[tail].input = inputs[next];
+            lane->queue[tail].output = outputs[next];
+            lane->depth++;
+            next++;
+        }
+
+        // Retire finished frames and keep every instance busy
+        for (int i = 0; i < d->num_lanes; i++) {
+            status_t status = service_lane(&d->lanes[i], &completed);
+            if (status != STATUS_SUCCESS) {
+                LOG_ERROR("Instance %d failed", d->lanes[i].acc->id);
+                return status;
+            }
+        }
+    }
+
+    return STATUS_SUCCESS;
+}
+
+void dispatcher_print(dispatcher_t *d) {
+    u64 max_cycles = 0;
+    u64 total_cycles = 0;
+
+    xil_printf("\r\nDispatcher Results (%d instances):\r\n", d->num_lanes);
+    for (int i = 0; i < d->num_lanes; i++) {
+        accelerator_t *acc = d->lanes[i].acc;
+        xil_printf("  Instance %d: %u frames", acc->id, d->lanes[i].frames);
+
+        if (acc->backend == ACCELERATOR_BACKEND_MODEL) {
+            u64 cycles = acc->model.busy_cycles;
+            xil_printf(", %u modeled cycles", (u32)cycles);
+            total_cycles += cycles;
+            if (cycles > max_cycles) {
+                max_cycles = cycles;
+            }
+        }
+        xil_printf("\r\n");
+    }
+
+    // Makespan is set by the busiest instance
+    if (max_cycles > 0) {
+        xil_printf("  Modeled makespan: %u us\r\n", (u32)(max_cycles / (ACCELERATOR_CLOCK_HZ / 1000000)));
+        xil_printf("  Modeled scaling:  %u.%02ux\r\n",
+                   (u32)(total_cycles / max_cycles),
+                   (u32)((total_cycles * 100 / max_cycles) % 100));
+    }
+}
+
+static dispatcher_lane_t *shallowest_lane(dispatcher_t *d) {
+    dispatcher_lane_t *best = NULL;
+
+    for (int i = 0; i < d->num_lanes; i++) {
+        dispatcher_lane_t *lane = &d->lanes[i];
+        if (lane->depth >= DISPATCHER_QUEUE_DEPTH) {
+            continue;
+        }
+        if (!best || lane->depth < best->depth) {
+            best = lane;
+        }
+    }
+    return best;
+}
+
+static status_t service_lane(dispatcher_lane_t *lane, int *completed) {
+    accelerator_t *acc = lane->acc;
+    status_t status;
+
+    // Retire the head job once the instance reports completion (with a
+    // completion callback the interrupt may already have cleared busy, and
+    // the poll then reports the job done)
+    if (lane->in_flight) {
+        int done;
+        status = accelerator_poll(acc, &done);
+        if (status != STATUS_SUCCESS) {
+            return status;
+        }
+        if (!done) {
+            return STATUS_SUCCESS;
+        }
+
+        lane->in_flight = 0;
+        lane->head = (lane->head + 1) % DISPATCHER_QUEUE_DEPTH;
+        lane->depth--;
+        lane->frames++;
+        (*completed)++;
+    }
+
+    // Start the next queued job
+    if (lane->depth > 0) {
+        dispatcher_job_t *job = &lane->queue[lane->head];
+        status = accelerator_submit(acc, job->input, job->output);
+        if (status != STATUS_SUCCESS) {
+            return status;
+        }
+        lane->in_flight = 1;
+    }
+
+    return STATUS_SUCCESS;
+}
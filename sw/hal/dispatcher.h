@@ -0,0 +1,42 @@
+#pragma once
+
+#include "../common/matrix.h"
+#include "../common/status.h"
+#include "accelerator.h"
+#include "config.h"
+
+/**
+ * Batch dispatcher for multiple accelerator instances
+ * Each instance owns a bounded job queue. Frames are assigned to the
+ * instance with the shallowest queue and submitted as soon as the
+ * instance is idle, so all instances stream concurrently.
+ */
+
+#define DISPATCHER_QUEUE_DEPTH 4
+
+typedef struct {
+    matrix_t *input;
+    matrix_t *output;
+} dispatcher_job_t;
+
+typedef struct {
+    accelerator_t *acc;
+    dispatcher_job_t queue[DISPATCHER_QUEUE_DEPTH];
+    int head;
+    int depth;
+    int in_flight;            // Head job submitted (tracked here, since a completion callback clears busy first)
+    u32 frames;
+} dispatcher_lane_t;
+
+typedef struct {
+    dispatcher_lane_t lanes[ACCELERATOR_MAX_INSTANCES];
+    int num_lanes;
+} dispatcher_t;
+
+// Public Interface
+status_t dispatcher_init(dispatcher_t *d, accelerator_t *instances, int num_instances);
+status_t dispatcher_set_kernel(dispatcher_t *d, matrix_t *kernel);
+status_t dispatcher_run(dispatcher_t *d, matrix_t **inputs, matrix_t **outputs, int num_frames);
+
+// Results handling
+void dispatcher_print(dispatcher_t *d);
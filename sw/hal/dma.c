@@ -1,109 +1,319 @@
 #include "dma.h"
 
-#include "xil_cache.h"
 #include "xil_exception.h"
 #include "xil_printf.h"
 
+#include "../common/trace.h"
+
 // Forward declarations
-static status_t setup_intr_system(XScuGic *intc_instance_ptr, XAxiDma *axi_dma_ptr, u16 tx_intr_id, u16 rx_intr_id);
+static status_t setup_intr_controller(XScuGic *intc_instance_ptr);
+static status_t connect_intr_system(XScuGic *intc_instance_ptr, dma_t *dma);
 static void disable_intr_system(XScuGic *intc_instance_ptr, u16 tx_intr_id, u16 rx_intr_id);
+static void reset_engine(XAxiDma *axi_dma_inst);
+static void complete_transfer(dma_t *dma);
 static void tx_intr_handler(void *callback);
 static void rx_intr_handler(void *callback);
 
-// Hardware state
-static XAxiDma axi_dma;
+// Shared interrupt controller (one GIC serves every DMA instance)
 static XScuGic interrupt_controller;
-static volatile u32 tx_done;
-static volatile u32 rx_done;
+static int intc_initialized;
+
+status_t dma_init(dma_t *dma, u16 device_id, u16 tx_intr_id, u16 rx_intr_id) {
+	if (!dma) {
+		LOG_ERROR("NULL pointer");
+		return STATUS_ERROR_INVALID_PARAM;
+	}
 
-status_t dma_init() {
+	dma->tx_intr_id = tx_intr_id;
+	dma->rx_intr_id = rx_intr_id;
+	dma->tx_done = 0;
+	dma->rx_done = 0;
+	dma->pending = 0;
+	dma->callback = NULL;
+	dma->callback_ctx = NULL;
 
 	// Fetch DMA configuration
-	XAxiDma_Config *config = XAxiDma_LookupConfig(DMA_DEV_ID);
+	XAxiDma_Config *config = XAxiDma_LookupConfig(device_id);
 	if (!config) {
-		LOG_ERROR("No DMA configuration found for device %d", DMA_DEV_ID);
+		LOG_ERROR("No DMA configuration found for device %d", device_id);
 		return STATUS_ERROR_HARDWARE;
 	}
 
 	// Initialize DMA engine
-	int status = XAxiDma_CfgInitialize(&axi_dma, config);
+	int status = XAxiDma_CfgInitialize(&dma->axi_dma, config);
 	if (status != XST_SUCCESS) {
 		LOG_ERROR("DMA initialization error");
 		return STATUS_ERROR_HARDWARE;
 	}
 
 	// Ensure DMA is configured in simple transfer mode
-	if (XAxiDma_HasSg(&axi_dma)) {
+	if (XAxiDma_HasSg(&dma->axi_dma)) {
 		LOG_ERROR("DMA configured for scatter-gather");
 		return STATUS_ERROR_HARDWARE;
 	}
 
-	// Set up interrupt system
-	status = setup_intr_system(&interrupt_controller, &axi_dma, TX_INTR_ID, RX_INTR_ID);
-	if (status != XST_SUCCESS) {
+	// Set up interrupt controller on first use
+	if (!intc_initialized) {
+		status = setup_intr_controller(&interrupt_controller);
+		if (status != STATUS_SUCCESS) {
+			LOG_ERROR("Interrupt controller setup error");
+			return status;
+		}
+		intc_initialized = 1;
+	}
+
+	// Connect this instance's interrupts
+	status = connect_intr_system(&interrupt_controller, dma);
+	if (status != STATUS_SUCCESS) {
 		LOG_ERROR("Interrupt system setup error");
 		return status;
 	}
 
 	// Toggle interrupts
-	XAxiDma_IntrDisable(&axi_dma, XAXIDMA_IRQ_ALL_MASK, XAXIDMA_DMA_TO_DEVICE);
-	XAxiDma_IntrDisable(&axi_dma, XAXIDMA_IRQ_ALL_MASK, XAXIDMA_DEVICE_TO_DMA);
-	XAxiDma_IntrEnable(&axi_dma, XAXIDMA_IRQ_ALL_MASK, XAXIDMA_DMA_TO_DEVICE);
-	XAxiDma_IntrEnable(&axi_dma, XAXIDMA_IRQ_ALL_MASK, XAXIDMA_DEVICE_TO_DMA);
+	XAxiDma_IntrDisable(&dma->axi_dma, XAXIDMA_IRQ_ALL_MASK, XAXIDMA_DMA_TO_DEVICE);
+	XAxiDma_IntrDisable(&dma->axi_dma, XAXIDMA_IRQ_ALL_MASK, XAXIDMA_DEVICE_TO_DMA);
+	XAxiDma_IntrEnable(&dma->axi_dma, XAXIDMA_IRQ_ALL_MASK, XAXIDMA_DMA_TO_DEVICE);
+	XAxiDma_IntrEnable(&dma->axi_dma, XAXIDMA_IRQ_ALL_MASK, XAXIDMA_DEVICE_TO_DMA);
 
 	return STATUS_SUCCESS;
 }
 
-status_t dma_cleanup(void) {
-	disable_intr_system(&interrupt_controller, TX_INTR_ID, RX_INTR_ID);
+status_t dma_cleanup(dma_t *dma) {
+	if (!dma) {
+		LOG_ERROR("NULL pointer");
+		return STATUS_ERROR_INVALID_PARAM;
+	}
+
+	disable_intr_system(&interrupt_controller, dma->tx_intr_id, dma->rx_intr_id);
 	return STATUS_SUCCESS;
 }
 
-status_t dma_transfer(void *tx_data_ptr, u32 tx_data_size, void *rx_data_ptr, u32 rx_data_size) {
+status_t dma_transfer(dma_t *dma, void *tx_data_ptr, u32 tx_data_size, void *rx_data_ptr, u32 rx_data_size) {
+	status_t status = dma_submit(dma, tx_data_ptr, tx_data_size, rx_data_ptr, rx_data_size);
+	if (status != STATUS_SUCCESS) {
+		return status;
+	}
+
+	return dma_wait(dma);
+}
+
+status_t dma_submit(dma_t *dma, void *tx_data_ptr, u32 tx_data_size, void *rx_data_ptr, u32 rx_data_size) {
+	if (!dma || !tx_data_ptr || !rx_data_ptr) {
+		LOG_ERROR("NULL pointer(s)");
+		return STATUS_ERROR_INVALID_PARAM;
+	}
+
+	if (dma->pending) {
+		LOG_ERROR("Transfer already in flight");
+		return STATUS_ERROR_HARDWARE;
+	}
+
+	// The stream carries whole beats; only the final output beat may be partial
+	if (tx_data_size % STREAM_BEAT_BYTES != 0 ||
+	    (UINTPTR)tx_data_ptr % STREAM_BEAT_BYTES != 0 || (UINTPTR)rx_data_ptr % STREAM_BEAT_BYTES != 0) {
+		LOG_ERROR("Transfer not aligned to %d byte beats", STREAM_BEAT_BYTES);
+		return STATUS_ERROR_INVALID_PARAM;
+	}
+
     // Initialize flags
-    tx_done = 0;
-    rx_done = 0;
+    dma->tx_done = 0;
+    dma->rx_done = 0;
+    dma->pending = 1;
 
-    // Flush the buffers before DMA transfer
-    Xil_DCacheFlushRange((UINTPTR)tx_data_ptr, tx_data_size);
-    Xil_DCacheFlushRange((UINTPTR)rx_data_ptr, rx_data_size);
+    // Cache maintenance is owned by the caller (see cache.h)
 
     // Configure DMA to receive data from hardware
-    int status = XAxiDma_SimpleTransfer(&axi_dma, (UINTPTR)rx_data_ptr, rx_data_size, XAXIDMA_DEVICE_TO_DMA);
+    TRACE_BEGIN("dma_submit");
+    int status = XAxiDma_SimpleTransfer(&dma->axi_dma, (UINTPTR)rx_data_ptr, rx_data_size, XAXIDMA_DEVICE_TO_DMA);
     if (status != XST_SUCCESS) {
+        TRACE_END("dma_submit");
         LOG_ERROR("RX DMA transfer setup error");
+        dma->pending = 0;
         return STATUS_ERROR_HARDWARE;
     }
 
     // Send data to hardware for processing
-    status = XAxiDma_SimpleTransfer(&axi_dma, (UINTPTR)tx_data_ptr, tx_data_size, XAXIDMA_DMA_TO_DEVICE);
+    status = XAxiDma_SimpleTransfer(&dma->axi_dma, (UINTPTR)tx_data_ptr, tx_data_size, XAXIDMA_DMA_TO_DEVICE);
+    TRACE_END("dma_submit");
     if (status != XST_SUCCESS) {
         LOG_ERROR("TX DMA transfer error");
+        dma->pending = 0;
         return STATUS_ERROR_HARDWARE;
     }
 
+    return STATUS_SUCCESS;
+}
+
+status_t dma_poll(dma_t *dma, int *done) {
+	if (!dma || !done) {
+		LOG_ERROR("NULL pointer(s)");
+		return STATUS_ERROR_INVALID_PARAM;
+	}
+
+	*done = 0;
+
+	// Completion is retired by the interrupt handler in callback mode
+	if (dma->callback) {
+		*done = !dma->pending;
+		return STATUS_SUCCESS;
+	}
+
+	if (!dma->pending) {
+		LOG_ERROR("No transfer in flight");
+		return STATUS_ERROR_INVALID_PARAM;
+	}
+
+	// Transfer still running
+	if (!dma->tx_done || !dma->rx_done) {
+		return STATUS_SUCCESS;
+	}
+
+    dma->pending = 0;
+    *done = 1;
+    return STATUS_SUCCESS;
+}
+
+status_t dma_wait(dma_t *dma) {
+	if (!dma) {
+		LOG_ERROR("NULL pointer");
+		return STATUS_ERROR_INVALID_PARAM;
+	}
+
+	// Completion is retired by the interrupt handler in callback mode, which
+	// sets the same flags before it runs the callback
+	if (dma->callback && !dma->pending) {
+		return STATUS_SUCCESS;
+	}
+
+	if (!dma->pending) {
+		LOG_ERROR("No transfer in flight");
+		return STATUS_ERROR_INVALID_PARAM;
+	}
+
     // Wait for transmission complete
-    status = Xil_WaitForEventSet(POLL_TIMEOUT_COUNTER, 1, &tx_done);
+    int status = Xil_WaitForEventSet(POLL_TIMEOUT_COUNTER, 1, &dma->tx_done);
     if (status != XST_SUCCESS) {
         LOG_ERROR("TX completion timeout");
+        dma->pending = 0;
         return STATUS_ERROR_HARDWARE;
     }
 
     // Wait for reception complete
-    status = Xil_WaitForEventSet(POLL_TIMEOUT_COUNTER, 1, &rx_done);
+    status = Xil_WaitForEventSet(POLL_TIMEOUT_COUNTER, 1, &dma->rx_done);
     if (status != XST_SUCCESS) {
         LOG_ERROR("RX completion timeout");
+        dma->pending = 0;
         return STATUS_ERROR_HARDWARE;
     }
 
-    // Invalidate receive buffer
-    Xil_DCacheInvalidateRange((UINTPTR)rx_data_ptr, rx_data_size);
-
+    // The callback may already have submitted the next transfer
+    if (!dma->callback) {
+        dma->pending = 0;
+    }
     return STATUS_SUCCESS;
 }
 
+status_t dma_set_callback(dma_t *dma, dma_callback_t callback, void *ctx) {
+	if (!dma) {
+		LOG_ERROR("NULL pointer");
+		return STATUS_ERROR_INVALID_PARAM;
+	}
+
+	if (dma->pending) {
+		LOG_ERROR("Cannot change callback with a transfer in flight");
+		return STATUS_ERROR_HARDWARE;
+	}
+
+	dma->callback = callback;
+	dma->callback_ctx = ctx;
+	return STATUS_SUCCESS;
+}
+
+status_t dma_receive(dma_t *dma, void *rx_data_ptr, u32 rx_data_size) {
+	if (!dma || !rx_data_ptr) {
+		LOG_ERROR("NULL pointer(s)");
+		return STATUS_ERROR_INVALID_PARAM;
+	}
+
+	if (dma->pending) {
+		LOG_ERROR("Transfer already in flight");
+		return STATUS_ERROR_HARDWARE;
+	}
+
+	if (dma->callback) {
+		LOG_ERROR("Chunked transfers are not supported in callback mode");
+		return STATUS_ERROR_INVALID_PARAM;
+	}
+
+	if ((UINTPTR)rx_data_ptr % STREAM_BEAT_BYTES != 0) {
+		LOG_ERROR("Transfer not aligned to %d byte beats", STREAM_BEAT_BYTES);
+		return STATUS_ERROR_INVALID_PARAM;
+	}
+
+	// No send outstanding yet
+	dma->tx_done = 1;
+	dma->rx_done = 0;
+	dma->pending = 1;
+
+	int status = XAxiDma_SimpleTransfer(&dma->axi_dma, (UINTPTR)rx_data_ptr, rx_data_size, XAXIDMA_DEVICE_TO_DMA);
+	if (status != XST_SUCCESS) {
+		LOG_ERROR("RX DMA transfer setup error");
+		dma->pending = 0;
+		return STATUS_ERROR_HARDWARE;
+	}
+
+	return STATUS_SUCCESS;
+}
+
+status_t dma_send(dma_t *dma, void *tx_data_ptr, u32 tx_data_size) {
+	if (!dma || !tx_data_ptr) {
+		LOG_ERROR("NULL pointer(s)");
+		return STATUS_ERROR_INVALID_PARAM;
+	}
+
+	if (!dma->pending) {
+		LOG_ERROR("No receive in flight");
+		return STATUS_ERROR_INVALID_PARAM;
+	}
+
+	if (tx_data_size % STREAM_BEAT_BYTES != 0 || (UINTPTR)tx_data_ptr % STREAM_BEAT_BYTES != 0) {
+		LOG_ERROR("Transfer not aligned to %d byte beats", STREAM_BEAT_BYTES);
+		return STATUS_ERROR_INVALID_PARAM;
+	}
+
+	// Simple mode holds one MM2S transfer at a time
+	int status = Xil_WaitForEventSet(POLL_TIMEOUT_COUNTER, 1, &dma->tx_done);
+	if (status != XST_SUCCESS) {
+		LOG_ERROR("TX completion timeout");
+		dma->pending = 0;
+		return STATUS_ERROR_HARDWARE;
+	}
+
+	dma->tx_done = 0;
+	status = XAxiDma_SimpleTransfer(&dma->axi_dma, (UINTPTR)tx_data_ptr, tx_data_size, XAXIDMA_DMA_TO_DEVICE);
+	if (status != XST_SUCCESS) {
+		LOG_ERROR("TX DMA transfer error");
+		dma->pending = 0;
+		return STATUS_ERROR_HARDWARE;
+	}
+
+	return STATUS_SUCCESS;
+}
+
+static void complete_transfer(dma_t *dma) {
+
+	// Only retire here when a callback owns completion
+	if (!dma->callback || !dma->pending || !dma->tx_done || !dma->rx_done) {
+		return;
+	}
+
+	dma->pending = 0;
+	dma->callback(dma->callback_ctx);
+}
+
 static void tx_intr_handler(void *callback) {
-	XAxiDma *axi_dma_inst = (XAxiDma *)callback;
+	dma_t *dma = (dma_t *)callback;
+	XAxiDma *axi_dma_inst = &dma->axi_dma;
 
 	// Read and acknowledge pending interrupts
 	u32 irq_status = XAxiDma_IntrGetIrq(axi_dma_inst, XAXIDMA_DMA_TO_DEVICE);
@@ -116,29 +326,22 @@ static void tx_intr_handler(void *callback) {
 
 	// If error bit is set, need to reset the DMA engine
 	if ((irq_status & XAXIDMA_IRQ_ERROR_MASK)) {
-
-		// Reset DMA engine
-		XAxiDma_Reset(axi_dma_inst);
-
-		// Wait until reset is done
-		int time_out = RESET_TIMEOUT_COUNTER;
-		while (time_out) {
-			if (XAxiDma_ResetIsDone(axi_dma_inst)) {
-				break;
-			}
-			time_out -= 1;
-		}
+		reset_engine(axi_dma_inst);
 		return;
 	}
 
 	// If IOC (Interrupt On Complete) bit set, transfer is done
 	if ((irq_status & XAXIDMA_IRQ_IOC_MASK)) {
-		tx_done = 1;
+		TRACE_IRQ_BEGIN("dma_tx_done");
+		dma->tx_done = 1;
+		complete_transfer(dma);
+		TRACE_IRQ_END("dma_tx_done");
 	}
 }
 
 static void rx_intr_handler(void *callback) {
-	XAxiDma *axi_dma_inst = (XAxiDma *)callback;
+	dma_t *dma = (dma_t *)callback;
+	XAxiDma *axi_dma_inst = &dma->axi_dma;
 
 	// Read and acknowledge pending interrupts
 	u32 irq_status = XAxiDma_IntrGetIrq(axi_dma_inst, XAXIDMA_DEVICE_TO_DMA);
@@ -151,28 +354,35 @@ static void rx_intr_handler(void *callback) {
 
 	// If error bit is set, need to reset the DMA engine
 	if ((irq_status & XAXIDMA_IRQ_ERROR_MASK)) {
-
-		// Reset DMA engine
-		XAxiDma_Reset(axi_dma_inst);
-
-		// Wait until reset is done
-		int time_out = RESET_TIMEOUT_COUNTER;
-		while (time_out) {
-			if (XAxiDma_ResetIsDone(axi_dma_inst)) {
-				break;
-			}
-			time_out -= 1;
-		}
+		reset_engine(axi_dma_inst);
 		return;
 	}
 
 	// If IOC (Interrupt On Complete) bit set, transfer is done
 	if ((irq_status & XAXIDMA_IRQ_IOC_MASK)) {
-		rx_done = 1;
+		TRACE_IRQ_BEGIN("dma_rx_done");
+		dma->rx_done = 1;
+		complete_transfer(dma);
+		TRACE_IRQ_END("dma_rx_done");
+	}
+}
+
+static void reset_engine(XAxiDma *axi_dma_inst) {
+
+	// Reset DMA engine
+	XAxiDma_Reset(axi_dma_inst);
+
+	// Wait until reset is done
+	int time_out = RESET_TIMEOUT_COUNTER;
+	while (time_out) {
+		if (XAxiDma_ResetIsDone(axi_dma_inst)) {
+			break;
+		}
+		time_out -= 1;
 	}
 }
 
-static status_t setup_intr_system(XScuGic *intc_instance_ptr, XAxiDma *axi_dma_ptr, u16 tx_intr_id, u16 rx_intr_id) {
+static status_t setup_intr_controller(XScuGic *intc_instance_ptr) {
 
 	// Initialize the Generic Interrupt Controller (GIC)
 	XScuGic_Config *intc_config = XScuGic_LookupConfig(INTC_DEVICE_ID);
@@ -188,41 +398,48 @@ static status_t setup_intr_system(XScuGic *intc_instance_ptr, XAxiDma *axi_dma_p
 		return STATUS_ERROR_HARDWARE;
 	}
 
+	// Initialize exception handling
+	Xil_ExceptionInit();
+
+	// Register GIC handler for interrupt exceptions
+	Xil_ExceptionRegisterHandler(XIL_EXCEPTION_ID_INT, (Xil_ExceptionHandler)XScuGic_InterruptHandler, (void *)intc_instance_ptr);
+
+	// Enable exceptions
+	Xil_ExceptionEnable();
+
+	return STATUS_SUCCESS;
+}
+
+static status_t connect_intr_system(XScuGic *intc_instance_ptr, dma_t *dma) {
+
 	// Set up interrupt priorities and triggers
-	XScuGic_SetPriorityTriggerType(intc_instance_ptr, tx_intr_id, 0xA0, 0x3);
-	XScuGic_SetPriorityTriggerType(intc_instance_ptr, rx_intr_id, 0xA0, 0x3);
+	XScuGic_SetPriorityTriggerType(intc_instance_ptr, dma->tx_intr_id, 0xA0, 0x3);
+	XScuGic_SetPriorityTriggerType(intc_instance_ptr, dma->rx_intr_id, 0xA0, 0x3);
 
 	// Connect TX interrupt handler to the GIC
-	status = XScuGic_Connect(intc_instance_ptr, tx_intr_id,(Xil_InterruptHandler)tx_intr_handler, axi_dma_ptr);
+	int status = XScuGic_Connect(intc_instance_ptr, dma->tx_intr_id, (Xil_InterruptHandler)tx_intr_handler, dma);
 	if (status != XST_SUCCESS) {
-		LOG_ERROR("ITX interrupt connection error");
+		LOG_ERROR("TX interrupt connection error");
 		return STATUS_ERROR_HARDWARE;
 	}
 
 	// Connect RX interrupt handler to the GIC
-	status = XScuGic_Connect(intc_instance_ptr, rx_intr_id, (Xil_InterruptHandler)rx_intr_handler, axi_dma_ptr);
+	status = XScuGic_Connect(intc_instance_ptr, dma->rx_intr_id, (Xil_InterruptHandler)rx_intr_handler, dma);
 	if (status != XST_SUCCESS) {
 		LOG_ERROR("RX interrupt connection error");
 		return STATUS_ERROR_HARDWARE;
 	}
 
 	// Enable the interrupts in the GIC
-	XScuGic_Enable(intc_instance_ptr, tx_intr_id);
-	XScuGic_Enable(intc_instance_ptr, rx_intr_id);
-
-	// Initialize exception handling
-	Xil_ExceptionInit();
-
-	// Register GIC handler for interrupt exceptions
-	Xil_ExceptionRegisterHandler(XIL_EXCEPTION_ID_INT, (Xil_ExceptionHandler)XScuGic_InterruptHandler, (void *)intc_instance_ptr);
-
-	// Enable exceptions
-	Xil_ExceptionEnable();
+	XScuGic_Enable(intc_instance_ptr, dma->tx_intr_id);
+	XScuGic_Enable(intc_instance_ptr, dma->rx_intr_id);
 
 	return STATUS_SUCCESS;
 }
 
 static void disable_intr_system(XScuGic *intc_instance_ptr, u16 tx_intr_id, u16 rx_intr_id) {
+	XScuGic_Disable(intc_instance_ptr, tx_intr_id);
+	XScuGic_Disable(intc_instance_ptr, rx_intr_id);
 	XScuGic_Disconnect(intc_instance_ptr, tx_intr_id);
 	XScuGic_Disconnect(intc_instance_ptr, rx_intr_id);
 }
@@ -7,7 +7,32 @@
 #include "../common/status.h"
 #include "config.h"
 
+// Completion callback (runs in interrupt context)
+typedef void (*dma_callback_t)(void *ctx);
+
+// DMA channel pair (one per accelerator instance)
+typedef struct {
+	XAxiDma axi_dma;
+	u16 tx_intr_id;
+	u16 rx_intr_id;
+	volatile u32 tx_done;
+	volatile u32 rx_done;
+	volatile int pending;
+	dma_callback_t callback;
+	void *callback_ctx;
+} dma_t;
+
 // Public Interface
-status_t dma_init();
-status_t dma_cleanup(void);
-status_t dma_transfer(void *TxDataPtr, u32 TxDataSize, void *RxDataPtr, u32 RxDataSize);
+status_t dma_init(dma_t *dma, u16 device_id, u16 tx_intr_id, u16 rx_intr_id);
+status_t dma_cleanup(dma_t *dma);
+status_t dma_transfer(dma_t *dma, void *TxDataPtr, u32 TxDataSize, void *RxDataPtr, u32 RxDataSize);
+
+// Asynchronous Interface
+status_t dma_submit(dma_t *dma, void *TxDataPtr, u32 TxDataSize, void *RxDataPtr, u32 RxDataSize);
+status_t dma_poll(dma_t *dma, int *done);
+status_t dma_wait(dma_t *dma);
+status_t dma_set_callback(dma_t *dma, dma_callback_t callback, void *ctx);
+
+// Chunked Interface (one receive, several sends, then dma_wait)
+status_t dma_receive(dma_t *dma, void *RxDataPtr, u32 RxDataSize);
+status_t dma_send(dma_t *dma, void *TxDataPtr, u32 TxDataSize);
@@ -0,0 +1,266 @@
+#include "model.h"
+
+#include "xil_printf.h"
+
+// Largest first-layer convolution map (frames clamp to INPUT_SIZE; the
+// pooled and chained maps are never larger)
+#define MAP_SIZE (((INPUT_SIZE - KERNEL_SIZE) / STRIDE + 1) * ((INPUT_SIZE - KERNEL_SIZE) / STRIDE + 1))
+
+// Intermediate maps, shared by every instance as transfers run one at a
+// time, so frames allocate nothing
+static fixed_point_t conv_map[MAP_SIZE];
+static fixed_point_t relu_map[MAP_SIZE];
+static fixed_point_t channel_map[MAP_SIZE];
+static fixed_point_t mid_map[MAP_SIZE * NUM_FILTERS];
+static cnn_scratch_t scratch = { conv_map, relu_map, channel_map, MAP_SIZE };
+
+// Forward declarations
+static void decode_stages(u32 bits, cnn_stages_t *stages);
+static status_t compile_kernels(model_t *model);
+
+status_t model_init(model_t *model) {
+    if (!model) {
+        LOG_ERROR("NULL pointer");
+        return STATUS_ERROR_INVALID_PARAM;
+    }
+
+    for (int i = 0; i < REGISTER_FILE_SIZE; i++) {
+        model->regs[i] = 0;
+    }
+    for (int i = 0; i < PERF_COUNTER_COUNT; i++) {
+        model->counters[i] = 0;
+    }
+    model->regs[REG_WIDTH_INDEX] = INPUT_SIZE;
+    model->regs[REG_HEIGHT_INDEX] = INPUT_SIZE;
+    model->regs[REG_PACKET_INDEX] = 1;
+    model->regs[REG_STAGES_INDEX] = STAGE_DEFAULT;
+    model->regs[REG_CHAIN_WIDTH_INDEX] = INPUT_SIZE;
+    model->regs[REG_CHAIN_HEIGHT_INDEX] = INPUT_SIZE;
+    model->regs[REG_CHAIN_STAGES_INDEX] = STAGE_DEFAULT;
+    model->compiled_valid = 0;
+    model->busy_cycles = 0;
+    model->frames = 0;
+
+    return STATUS_SUCCESS;
+}
+
+status_t model_write_register(model_t *model, u32 index, u32 value) {
+    if (!model) {
+        LOG_ERROR("NULL pointer");
+        return STATUS_ERROR_INVALID_PARAM;
+    }
+
+    // The counter control acts on the live counters; counters are read-only
+    // and writes outside the register file are ignored, as in registers.vhdl.
+    // The model has a single bank, so a commit has nothing to wait for
+    if (index == REG_PERF_CTRL_INDEX) {
+        for (int i = 0; i < PERF_COUNTER_COUNT; i++) {
+            if (value & PERF_CTRL_LATCH) {
+                model->regs[REG_PERF_BASE_INDEX + i] = model->counters[i];
+            }
+            if (value & PERF_CTRL_CLEAR) {
+                model->counters[i] = 0;
+            }
+        }
+    } else if (index < REG_PERF_CTRL_INDEX) {
+        model->regs[index] = value;
+        if (index < NUMBER_OF_REGS) {
+            model->compiled_valid = 0;
+        }
+    }
+    return STATUS_SUCCESS;
+}
+
+status_t model_read_register(model_t *model, u32 index, u32 *value_ptr) {
+    if (!model || !value_ptr) {
+        LOG_ERROR("NULL pointer(s)");
+        return STATUS_ERROR_INVALID_PARAM;
+    }
+
+    *value_ptr = (index < REGISTER_FILE_SIZE) ? model->regs[index] : 0;
+    return STATUS_SUCCESS;
+}
+
+status_t model_write_block(model_t *model, u32 first, const u32 *values, u32 count) {
+    if (!model || !values) {
+        LOG_ERROR("NULL pointer(s)");
+        return STATUS_ERROR_INVALID_PARAM;
+    }
+
+    if (first + count > REGISTER_FILE_SIZE) {
+        LOG_ERROR("Block %u+%u exceeds register file", first, count);
+        return STATUS_ERROR_OVERFLOW;
+    }
+
+    for (u32 i = 0; i < count; i++) {
+        model_write_register(model, first + i, values[i]);
+    }
+    return STATUS_SUCCESS;
+}
+
+status_t model_read_counters(model_t *model, int clear, perf_counters_t *counters) {
+    if (!model || !counters) {
+        LOG_ERROR("NULL pointer(s)");
+        return STATUS_ERROR_INVALID_PARAM;
+    }
+
+    model_write_register(model, REG_PERF_CTRL_INDEX, PERF_CTRL_LATCH | (clear ? PERF_CTRL_CLEAR : 0));
+
+    counters->active_cycles = model->regs[REG_PERF_BASE_INDEX + PERF_ACTIVE_CYCLES];
+    counters->input_stall_cycles = model->regs[REG_PERF_BASE_INDEX + PERF_INPUT_STALLS];
+    counters->output_stall_cycles = model->regs[REG_PERF_BASE_INDEX + PERF_OUTPUT_STALLS];
+    counters->input_beats = model->regs[REG_PERF_BASE_INDEX + PERF_INPUT_BEATS];
+    counters->output_beats = model->regs[REG_PERF_BASE_INDEX + PERF_OUTPUT_BEATS];
+    counters->frames = model->regs[REG_PERF_BASE_INDEX + PERF_FRAMES];
+    return STATUS_SUCCESS;
+}
+
+status_t model_transfer(model_t *model, void *tx_data_ptr, u32 tx_data_size, void *rx_data_ptr, u32 rx_data_size) {
+    if (!model || !tx_data_ptr || !rx_data_ptr) {
+        LOG_ERROR("NULL pointer(s)");
+        return STATUS_ERROR_INVALID_PARAM;
+    }
+
+    // Frame dimensions clamp to the synthesized maximum, as in registers.vhdl
+    int cols = (model->regs[REG_WIDTH_INDEX] < INPUT_SIZE) ? model->regs[REG_WIDTH_INDEX] : INPUT_SIZE;
+    int rows = (model->regs[REG_HEIGHT_INDEX] < INPUT_SIZE) ? model->regs[REG_HEIGHT_INDEX] : INPUT_SIZE;
+    if (rows < MIN_INPUT_SIZE || cols < MIN_INPUT_SIZE || cols % PIXELS_PER_BEAT != 0) {
+        LOG_ERROR("Invalid frame dimensions %dx%d", rows, cols);
+        return STATUS_ERROR_INVALID_PARAM;
+    }
+
+    // A transfer carries one packet, which closes after this many frames
+    // (the hardware reads the low 16 bits, and 0 behaves as 1)
+    int packet = model->regs[REG_PACKET_INDEX] & 0xFFFF;
+    int frames = (packet > 1) ? packet : 1;
+
+    cnn_stages_t stages;
+    decode_stages(model->regs[REG_STAGES_INDEX], &stages);
+
+    int mid_rows = cnn_pooled_size((rows - KERNEL_SIZE) / STRIDE + 1, POOL_SIZE, &stages);
+    int mid_cols = cnn_pooled_size((cols - KERNEL_SIZE) / STRIDE + 1, POOL_SIZE, &stages);
+    int out_rows = mid_rows;
+    int out_cols = mid_cols;
+
+    // A chained second layer takes its input size from its own registers,
+    // which must describe the first layer's pooled map
+    int chained = NUM_LAYERS > 1 && (model->regs[REG_CHAIN_INDEX] & CHAIN_ENABLE);
+    cnn_stages_t chain_stages;
+    if (chained) {
+        if ((int)model->regs[REG_CHAIN_WIDTH_INDEX] != mid_cols || (int)model->regs[REG_CHAIN_HEIGHT_INDEX] != mid_rows) {
+            LOG_ERROR("Chained dimensions %ux%u do not match the pooled %dx%d",
+                      model->regs[REG_CHAIN_HEIGHT_INDEX], model->regs[REG_CHAIN_WIDTH_INDEX], mid_rows, mid_cols);
+            return STATUS_ERROR_INVALID_PARAM;
+        }
+        decode_stages(model->regs[REG_CHAIN_STAGES_INDEX], &chain_stages);
+        out_rows = cnn_pooled_size((mid_rows - KERNEL_SIZE) / STRIDE + 1, POOL_SIZE, &chain_stages);
+        out_cols = cnn_pooled_size((mid_cols - KERNEL_SIZE) / STRIDE + 1, POOL_SIZE, &chain_stages);
+    }
+    if (out_rows <= 0 || out_cols <= 0) {
+        LOG_ERROR("Frame %dx%d too small for the configured layers", rows, cols);
+        return STATUS_ERROR_INVALID_PARAM;
+    }
+
+    u32 frame_tx = rows * cols;
+    u32 frame_rx = out_rows * out_cols * NUM_FILTERS;
+    if (tx_data_size != frames * frame_tx * sizeof(fixed_point_t) ||
+        rx_data_size != frames * frame_rx * sizeof(fixed_point_t)) {
+        LOG_ERROR("Invalid transfer sizes %u, %u", tx_data_size, rx_data_size);
+        return STATUS_ERROR_INVALID_PARAM;
+    }
+
+    // Beats carry PIXELS_PER_BEAT consecutive row pixels, lowest lane first, so
+    // the packed stream is the row-major buffer (the last output beat may be
+    // partial, marked by tkeep)
+
+    // Kernels are compiled once per weight upload, not per frame
+    if (!model->compiled_valid) {
+        status_t status = compile_kernels(model);
+        if (status != STATUS_SUCCESS) {
+            LOG_ERROR("Could not compile kernels");
+            return status;
+        }
+    }
+
+    // The first layer's map stays on chip when chained
+    matrix_t mid = { mid_rows, mid_cols * NUM_FILTERS, mid_map, CACHE_STATE_CLEAN };
+
+    // Wrap each frame of the stream buffers in turn
+    for (int frame = 0; frame < frames; frame++) {
+        matrix_t input = { rows, cols, (fixed_point_t *)tx_data_ptr + frame * frame_tx, CACHE_STATE_CLEAN };
+        matrix_t output = { out_rows, out_cols * NUM_FILTERS, (fixed_point_t *)rx_data_ptr + frame * frame_rx, CACHE_STATE_CLEAN };
+
+        status_t status;
+        if (chained) {
+            status = cnn_forward_compiled(&input, model->compiled, NUM_FILTERS, POOL_SIZE, STRIDE, &stages,
+                                          &scratch, &mid);
+            if (status == STATUS_SUCCESS) {
+                status = cnn_forward_compiled(&mid, &model->compiled[NUM_FILTERS], 1, POOL_SIZE, STRIDE,
+                                              &chain_stages, &scratch, &output);
+            }
+        } else {
+            status = cnn_forward_compiled(&input, model->compiled, NUM_FILTERS, POOL_SIZE, STRIDE, &stages,
+                                          &scratch, &output);
+        }
+        if (status != STATUS_SUCCESS) {
+            LOG_ERROR("Model computation failed");
+            return status;
+        }
+    }
+
+    // One input beat per clock, with frames back to back so the pipeline
+    // drains once per packet; an output row whose channels need more beats
+    // than its input row stalls the stream
+    int row_beats = cols / PIXELS_PER_BEAT;
+    int out_beats = (out_cols * NUM_FILTERS + PIXELS_PER_BEAT - 1) / PIXELS_PER_BEAT;
+    u32 frame_cycles = rows * row_beats;
+    if (out_beats > row_beats) {
+        frame_cycles += out_rows * (out_beats - row_beats);
+    }
+    u32 packet_cycles = frames * frame_cycles + MODEL_PIPELINE_CYCLES;
+    if (chained) {
+        packet_cycles += MODEL_PIPELINE_CYCLES;
+    }
+    model->busy_cycles += packet_cycles;
+    model->frames += frames;
+
+    // The modelled DMA never starves or backpressures the stream, and the
+    // output packs across rows and frames into whole beats until the
+    // packet's last
+    model->counters[PERF_ACTIVE_CYCLES] += packet_cycles;
+    model->counters[PERF_INPUT_BEATS] += frames * rows * row_beats;
+    model->counters[PERF_OUTPUT_BEATS] += (rx_data_size / sizeof(fixed_point_t) + PIXELS_PER_BEAT - 1) / PIXELS_PER_BEAT;
+    model->counters[PERF_FRAMES] += frames;
+
+    return STATUS_SUCCESS;
+}
+
+// Weights are the low FIXED_POINT_WIDTH bits of each register, as the
+// hardware reads them; filter f and then the chained kernel follow in
+// register order
+static status_t compile_kernels(model_t *model) {
+    fixed_point_t weights[NUMBER_OF_REGS];
+    for (int i = 0; i < NUMBER_OF_REGS; i++) {
+        weights[i] = (fixed_point_t)model->regs[i];
+    }
+
+    for (int k = 0; k < NUM_FILTERS + NUM_LAYERS - 1; k++) {
+        matrix_t kernel = { KERNEL_SIZE, KERNEL_SIZE, &weights[k * KERNEL_REGS], CACHE_STATE_CLEAN };
+        status_t status = cnn_sparse_compile(&kernel, &model->compiled[k]);
+        if (status != STATUS_SUCCESS) {
+            return status;
+        }
+    }
+
+    model->compiled_valid = 1;
+    return STATUS_SUCCESS;
+}
+
+// Stage selection, decoded as the pooler and ReLU read it (bypass wins over
+// average, and a zero stride steps by the window size)
+static void decode_stages(u32 bits, cnn_stages_t *stages) {
+    stages->relu = (bits & STAGE_RELU) != 0;
+    stages->pool = (bits & STAGE_POOL_BYPASS) ? CNN_POOL_NONE :
+                   (bits & STAGE_POOL_AVERAGE) ? CNN_POOL_AVERAGE : CNN_POOL_MAX;
+    stages->pool_stride = (bits >> STAGE_STRIDE_SHIFT) & STAGE_STRIDE_MASK;
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include "xil_types.h"
+
+#include "../cnn/cnn.h"
+#include "../common/status.h"
+#include "config.h"
+#include "registers.h"
+
+/**
+ * Host model of one accelerator instance
+ * Emulates the register file and the conv/ReLU/pool datapath with the
+ * bit-exact software model, and accounts the cycles the fabric would spend
+ * so multi-instance scaling can be evaluated without extra hardware.
+ */
+
+// Cycles the pipeline needs to drain after the last input beat
+#define MODEL_PIPELINE_CYCLES (KERNEL_SIZE + POOL_SIZE + 2)
+
+typedef struct {
+    u32 regs[REGISTER_FILE_SIZE];
+    u32 counters[PERF_COUNTER_COUNT];  // Live counters, latched into regs
+
+    // Zero-skipping taps of every filter and the chained kernel, compiled
+    // on the first frame after a weight write
+    cnn_sparse_kernel_t compiled[NUM_FILTERS + NUM_LAYERS - 1];
+    int compiled_valid;
+    u64 busy_cycles;
+    u32 frames;
+} model_t;
+
+// Public Interface
+status_t model_init(model_t *model);
+status_t model_write_register(model_t *model, u32 index, u32 value);
+status_t model_read_register(model_t *model, u32 index, u32 *value_ptr);
+status_t model_write_block(model_t *model, u32 first, const u32 *values, u32 count);
+status_t model_read_counters(model_t *model, int clear, perf_counters_t *counters);
+status_t model_transfer(model_t *model, void *tx_data_ptr, u32 tx_data_size, void *rx_data_ptr, u32 rx_data_size);
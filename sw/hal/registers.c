@@ -3,12 +3,47 @@
 #include "xil_io.h"
 #include "config.h"
 
-status_t registers_write(u32 index, u32 value) {
-	Xil_Out32(ACCELERATOR_BASEADDR + (index * REG_OFFSET), value);
+status_t registers_write(UINTPTR base_addr, u32 index, u32 value) {
+	Xil_Out32(base_addr + (index * REG_OFFSET), value);
 	return STATUS_SUCCESS;
 }
 
-status_t registers_read(u32 index, u32 *value_ptr) {
-	*value_ptr = Xil_In32(ACCELERATOR_BASEADDR + (index * REG_OFFSET));
+status_t registers_read(UINTPTR base_addr, u32 index, u32 *value_ptr) {
+	*value_ptr = Xil_In32(base_addr + (index * REG_OFFSET));
+	return STATUS_SUCCESS;
+}
+
+status_t registers_write_block(UINTPTR base_addr, u32 first, const u32 *values, u32 count) {
+	if (!values) {
+		return STATUS_ERROR_INVALID_PARAM;
+	}
+
+	if (first + count > REGISTER_FILE_SIZE) {
+		return STATUS_ERROR_OVERFLOW;
+	}
+
+	// Consecutive offsets, no read-modify-write
+	UINTPTR addr = base_addr + (first * REG_OFFSET);
+	for (u32 i = 0; i < count; i++) {
+		Xil_Out32(addr, values[i]);
+		addr += REG_OFFSET;
+	}
+	return STATUS_SUCCESS;
+}
+
+status_t registers_read_counters(UINTPTR base_addr, int clear, perf_counters_t *counters) {
+	if (!counters) {
+		return STATUS_ERROR_INVALID_PARAM;
+	}
+
+	// Latch every counter in the same cycle (clearing restarts them)
+	registers_write(base_addr, REG_PERF_CTRL_INDEX, PERF_CTRL_LATCH | (clear ? PERF_CTRL_CLEAR : 0));
+
+	registers_read(base_addr, REG_PERF_BASE_INDEX + PERF_ACTIVE_CYCLES, &counters->active_cycles);
+	registers_read(base_addr, REG_PERF_BASE_INDEX + PERF_INPUT_STALLS, &counters->input_stall_cycles);
+	registers_read(base_addr, REG_PERF_BASE_INDEX + PERF_OUTPUT_STALLS, &counters->output_stall_cycles);
+	registers_read(base_addr, REG_PERF_BASE_INDEX + PERF_INPUT_BEATS, &counters->input_beats);
+	registers_read(base_addr, REG_PERF_BASE_INDEX + PERF_OUTPUT_BEATS, &counters->output_beats);
+	registers_read(base_addr, REG_PERF_BASE_INDEX + PERF_FRAMES, &counters->frames);
 	return STATUS_SUCCESS;
 }
@@ -1,6 +1,20 @@
 #pragma once
 
+#include "xil_types.h"
+
 #include "../common/status.h"
 
-status_t registers_write(u32 index, u32 value);
-status_t registers_read(u32 index, u32 *value_ptr);
+// Performance counter snapshot (cycles at the accelerator clock)
+typedef struct {
+    u32 active_cycles;        // A frame in flight
+    u32 input_stall_cycles;   // Ready for s_axis data that had not arrived
+    u32 output_stall_cycles;  // m_axis data held by backpressure
+    u32 input_beats;
+    u32 output_beats;
+    u32 frames;
+} perf_counters_t;
+
+status_t registers_write(UINTPTR base_addr, u32 index, u32 value);
+status_t registers_read(UINTPTR base_addr, u32 index, u32 *value_ptr);
+status_t registers_write_block(UINTPTR base_addr, u32 first, const u32 *values, u32 count);
+status_t registers_read_counters(UINTPTR base_addr, int clear, perf_counters_t *counters);
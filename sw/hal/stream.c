@@ -0,0 +1,286 @@
+#include "stream.h"
+
+#include "xil_printf.h"
+#include <string.h>
+
+#include "../common/fixed.h"
+#include "bump_allocator.h"
+#include "cache.h"
+
+// Forward declarations
+static void pool_window(const cnn_stages_t *stages, int *window, int *step);
+static int rows_needed(const stream_t *s, int pooled_row);
+static status_t compute_pooled_row(stream_t *s, int pooled_row);
+static status_t compute_conv(stream_t *s, int row, int col, fixed_point_t *result);
+
+status_t stream_begin(stream_t *s, stream_backend_t backend, accelerator_t *acc, matrix_t *kernel,
+                      const cnn_stages_t *stages, int rows, int cols, matrix_t *output) {
+    if (!s || !kernel || !stages || !output) {
+        LOG_ERROR("NULL pointer(s)");
+        return STATUS_ERROR_INVALID_PARAM;
+    }
+
+    if (kernel->rows != KERNEL_SIZE || kernel->cols != KERNEL_SIZE) {
+        LOG_ERROR("Invalid kernel dimensions %dx%d", kernel->rows, kernel->cols);
+        return STATUS_ERROR_INVALID_PARAM;
+    }
+
+    if (rows < KERNEL_SIZE || cols < KERNEL_SIZE) {
+        LOG_ERROR("Invalid frame dimensions %dx%d", rows, cols);
+        return STATUS_ERROR_INVALID_PARAM;
+    }
+
+    if (backend == STREAM_BACKEND_ACCELERATOR && !acc) {
+        LOG_ERROR("NULL accelerator");
+        return STATUS_ERROR_INVALID_PARAM;
+    }
+
+    s->backend = backend;
+    s->acc = acc;
+    s->kernel = kernel;
+    s->stages = *stages;
+    s->output = output;
+    s->rows = rows;
+    s->cols = cols;
+    s->rows_in = 0;
+    s->rows_out = 0;
+    s->lines = NULL;
+    s->staging = NULL;
+
+    status_t status;
+    int out_rows, out_cols;
+
+    if (backend == STREAM_BACKEND_SOFTWARE) {
+        out_rows = cnn_pooled_size((rows - KERNEL_SIZE) / STRIDE + 1, POOL_SIZE, stages);
+        out_cols = cnn_pooled_size((cols - KERNEL_SIZE) / STRIDE + 1, POOL_SIZE, stages);
+        if (out_rows <= 0 || out_cols <= 0 || output->rows != out_rows || output->cols != out_cols) {
+            LOG_ERROR("Invalid output dimensions %dx%d", output->rows, output->cols);
+            return STATUS_ERROR_INVALID_PARAM;
+        }
+
+        s->lines = (fixed_point_t *)allocator_alloc(STREAM_WINDOW_ROWS * cols * sizeof(fixed_point_t));
+        if (!s->lines) {
+            LOG_ERROR("Could not allocate line buffer");
+            return STATUS_ERROR_MEMORY;
+        }
+
+        // Pooled rows are written directly as they complete
+        cache_prepare_cpu_access(kernel->data, KERNEL_SIZE * KERNEL_SIZE * sizeof(fixed_point_t), &kernel->cache_state);
+        cache_prepare_cpu_access(output->data, out_rows * out_cols * sizeof(fixed_point_t), &output->cache_state);
+        cache_mark_cpu_dirty(&output->cache_state);
+        return STATUS_SUCCESS;
+    }
+
+    status = accelerator_set_dimensions(acc, rows, cols);
+    if (status != STATUS_SUCCESS) {
+        LOG_ERROR("Accelerator cannot stream %dx%d frames", rows, cols);
+        return status;
+    }
+
+    status = accelerator_set_stages(acc, stages);
+    if (status != STATUS_SUCCESS) {
+        LOG_ERROR("Could not configure stages");
+        return status;
+    }
+
+    // Same output size the accelerator validates for every transfer
+    status = accelerator_output_dimensions(acc, rows, cols, &out_rows, &out_cols);
+    if (status != STATUS_SUCCESS) {
+        return status;
+    }
+    if (output->rows != out_rows || output->cols != out_cols) {
+        LOG_ERROR("Invalid output dimensions %dx%d", output->rows, output->cols);
+        return STATUS_ERROR_INVALID_PARAM;
+    }
+
+    status = accelerator_set_kernel(acc, kernel);
+    if (status != STATUS_SUCCESS) {
+        LOG_ERROR("Could not configure kernel");
+        return status;
+    }
+
+    // Chunks may be reused by the source, so keep a DMA-visible copy
+    s->staging = matrix_create(rows, cols);
+    if (!s->staging) {
+        LOG_ERROR("Could not allocate staging frame");
+        return STATUS_ERROR_MEMORY;
+    }
+
+    // The host model needs the whole frame and runs at stream_end
+    if (acc->backend == ACCELERATOR_BACKEND_HARDWARE) {
+        return accelerator_stream_open(acc, output);
+    }
+    return STATUS_SUCCESS;
+}
+
+status_t stream_push_rows(stream_t *s, const fixed_point_t *data, int num_rows, int *rows_ready) {
+    if (!s || !data || !rows_ready) {
+        LOG_ERROR("NULL pointer(s)");
+        return STATUS_ERROR_INVALID_PARAM;
+    }
+
+    if (num_rows <= 0 || s->rows_in + num_rows > s->rows) {
+        LOG_ERROR("Invalid chunk of %d rows at row %d", num_rows, s->rows_in);
+        return STATUS_ERROR_INVALID_PARAM;
+    }
+
+    status_t status;
+    u32 row_bytes = s->cols * sizeof(fixed_point_t);
+
+    if (s->backend == STREAM_BACKEND_SOFTWARE) {
+        for (int i = 0; i < num_rows; i++) {
+            memcpy(&s->lines[(s->rows_in % STREAM_WINDOW_ROWS) * s->cols], &data[i * s->cols], row_bytes);
+            s->rows_in++;
+
+            // Emit every pooled row whose window is now complete
+            while (s->rows_out < s->output->rows && s->rows_in >= rows_needed(s, s->rows_out)) {
+                status = compute_pooled_row(s, s->rows_out);
+                if (status != STATUS_SUCCESS) {
+                    LOG_ERROR("Pooled row %d failed", s->rows_out);
+                    return status;
+                }
+                s->rows_out++;
+            }
+        }
+
+        *rows_ready = s->rows_out;
+        return STATUS_SUCCESS;
+    }
+
+    // Stage the chunk and hand it to the fabric right away (the output
+    // still lands in one packet, so no rows are ready before stream_end)
+    fixed_point_t *chunk = &s->staging->data[s->rows_in * s->cols];
+    memcpy(chunk, data, num_rows * row_bytes);
+    s->rows_in += num_rows;
+
+    if (s->acc->backend == ACCELERATOR_BACKEND_HARDWARE) {
+        cache_state_t chunk_state = CACHE_STATE_CPU_DIRTY;
+        cache_prepare_device_read(chunk, num_rows * row_bytes, &chunk_state);
+
+        status = accelerator_stream_send(s->acc, chunk, num_rows * row_bytes);
+        if (status != STATUS_SUCCESS) {
+            LOG_ERROR("Could not send rows %d-%d", s->rows_in - num_rows, s->rows_in - 1);
+            return status;
+        }
+    } else {
+        cache_mark_cpu_dirty(&s->staging->cache_state);
+    }
+
+    *rows_ready = s->rows_out;
+    return STATUS_SUCCESS;
+}
+
+status_t stream_end(stream_t *s, int *rows_ready) {
+    if (!s || !rows_ready) {
+        LOG_ERROR("NULL pointer(s)");
+        return STATUS_ERROR_INVALID_PARAM;
+    }
+
+    if (s->rows_in != s->rows) {
+        LOG_ERROR("Stream ended after %d of %d rows", s->rows_in, s->rows);
+        return STATUS_ERROR_INVALID_PARAM;
+    }
+
+    status_t status = STATUS_SUCCESS;
+
+    if (s->backend == STREAM_BACKEND_ACCELERATOR) {
+        if (s->acc->backend == ACCELERATOR_BACKEND_HARDWARE) {
+            status = accelerator_wait(s->acc);
+        } else {
+            status = accelerator_compute(s->acc, s->staging, s->output);
+        }
+        matrix_destroy(s->staging);
+        s->staging = NULL;
+
+        if (status != STATUS_SUCCESS) {
+            LOG_ERROR("Accelerator stream failed");
+            return status;
+        }
+        s->rows_out = s->output->rows;
+    }
+
+    *rows_ready = s->rows_out;
+    return STATUS_SUCCESS;
+}
+
+// Pooling window side and step, as cnn_pool applies them
+static void pool_window(const cnn_stages_t *stages, int *window, int *step) {
+    if (stages->pool == CNN_POOL_NONE) {
+        *window = 1;
+        *step = 1;
+        return;
+    }
+    *window = POOL_SIZE;
+    *step = (stages->pool_stride > 0) ? stages->pool_stride : POOL_SIZE;
+}
+
+// Input rows received before pooled row can be produced
+static int rows_needed(const stream_t *s, int pooled_row) {
+    int window, step;
+    pool_window(&s->stages, &window, &step);
+    return (pooled_row * step + window - 1) * STRIDE + KERNEL_SIZE;
+}
+
+static status_t compute_pooled_row(stream_t *s, int pooled_row) {
+    status_t status;
+    int window, step;
+    pool_window(&s->stages, &window, &step);
+    int area = window * window;
+
+    // Same ReLU then pool order as cnn_forward_stages
+    for (int j = 0; j < s->output->cols; j++) {
+        fixed_point_t max = FIXED_POINT_MIN;
+        int64_t sum = 0;
+        for (int pi = 0; pi < window; pi++) {
+            for (int pj = 0; pj < window; pj++) {
+                fixed_point_t val;
+                status = compute_conv(s, pooled_row * step + pi, j * step + pj, &val);
+                if (status != STATUS_SUCCESS) {
+                    return status;
+                }
+                if (s->stages.relu && val < 0) val = 0;
+                if (val > max) max = val;
+                sum += val;
+            }
+        }
+
+        // The mean is floored, as in cnn_pool
+        fixed_point_t result = max;
+        if (s->stages.pool == CNN_POOL_AVERAGE) {
+            int64_t mean = sum / area;
+            if (sum % area != 0 && sum < 0) {
+                mean--;
+            }
+            result = (fixed_point_t)mean;
+        }
+        s->output->data[pooled_row * s->output->cols + j] = result;
+    }
+    return STATUS_SUCCESS;
+}
+
+static status_t compute_conv(stream_t *s, int row, int col, fixed_point_t *result) {
+    status_t status;
+    fixed_point_t prod, tmp, sum = 0;
+
+    // Accumulation order matches cnn_convolve for bit-exact results
+    for (int ki = 0; ki < KERNEL_SIZE; ki++) {
+        const fixed_point_t *line = &s->lines[((row * STRIDE + ki) % STREAM_WINDOW_ROWS) * s->cols];
+        for (int kj = 0; kj < KERNEL_SIZE; kj++) {
+            status = fixed_multiply(line[col * STRIDE + kj], s->kernel->data[ki * KERNEL_SIZE + kj], &prod);
+            if (status != STATUS_SUCCESS) {
+                LOG_ERROR("Multiplication error at %d,%d", row, col);
+                return status;
+            }
+
+            tmp = sum;
+            status = fixed_add(prod, tmp, &sum);
+            if (status != STATUS_SUCCESS) {
+                LOG_ERROR("Addition error at %d,%d", row, col);
+                return status;
+            }
+        }
+    }
+
+    *result = sum;
+    return STATUS_SUCCESS;
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include "../common/matrix.h"
+#include "../common/status.h"
+#include "accelerator.h"
+#include "config.h"
+
+/**
+ * Row-granular streaming of one input frame
+ * Rows are pushed in chunks as a line-scanned source produces them, and
+ * the stages (ReLU, pooling mode and stride) apply as in cnn_forward_stages.
+ * Only the software backend lowers output latency: it keeps a small ring of
+ * input lines and emits each pooled output row as soon as its receptive
+ * field is complete. The accelerator backend (frames up to the synthesized
+ * INPUT_SIZE) forwards every chunk to the fabric, but its output arrives in
+ * one S2MM packet that completes at the frame's tlast, so it reports no rows
+ * before stream_end.
+ */
+
+// Input lines one pooled output row depends on (at most)
+#define STREAM_WINDOW_ROWS ((POOL_SIZE - 1) * STRIDE + KERNEL_SIZE)
+
+typedef enum {
+    STREAM_BACKEND_ACCELERATOR = 0,
+    STREAM_BACKEND_SOFTWARE = 1,
+} stream_backend_t;
+
+typedef struct {
+    stream_backend_t backend;
+    accelerator_t *acc;
+    matrix_t *kernel;
+    cnn_stages_t stages;
+    matrix_t *output;
+    int rows;
+    int cols;
+    int rows_in;
+    int rows_out;
+
+    // Software line ring
+    fixed_point_t *lines;
+
+    // Accelerator staging frame (DMA source)
+    matrix_t *staging;
+} stream_t;
+
+// Public Interface
+status_t stream_begin(stream_t *s, stream_backend_t backend, accelerator_t *acc, matrix_t *kernel,
+                      const cnn_stages_t *stages, int rows, int cols, matrix_t *output);
+status_t stream_push_rows(stream_t *s, const fixed_point_t *data, int num_rows, int *rows_ready);
+status_t stream_end(stream_t *s, int *rows_ready);
@@ -1,17 +1,48 @@
 #include "xil_printf.h"
 
 #include "cnn/cnn.h"
+#include "common/trace.h"
 #include "hal/accelerator.h"
 #include "hal/bump_allocator.h"
+#include "hal/cache.h"
+#include "hal/dispatcher.h"
+#include "hal/stream.h"
+#include "sched/scheduler.h"
 #include "utils/benchmark.h"
+#include "utils/sparsity.h"
+#include "utils/sweep.h"
+#include "utils/throughput.h"
 
 #define BENCH_ITERATIONS 100
+#define BENCH_WARMUP     5
+#define DISPATCH_FRAMES  16
+#define SCHEDULE_FRAMES  64
+#define STREAM_CHUNK     4
+#define BATCH_FRAMES     8
+#define SWEEP_ITERATIONS 10
+#define SUSTAIN_BUFFERS  2
+#define SUSTAIN_FRAMES   1000
+#define SUSTAIN_US       1000000.0
+#define SWEEP_FORMAT     SWEEP_FORMAT_CSV
+#define SPARSITY_SIZE    128
+
+static status_t run_dispatch(accelerator_backend_t backend, int num_instances);
+static status_t run_schedule(accelerator_t *accelerator);
+static status_t run_stream(stream_backend_t backend, accelerator_t *accelerator);
+static status_t run_filters(accelerator_t *accelerator);
+static status_t run_batch(accelerator_t *accelerator);
+static status_t run_sweep(accelerator_t *accelerator);
+static status_t run_sustained(accelerator_t *accelerator);
+static status_t run_sparsity(void);
 
 int main(void) {
     status_t status;
     benchmark_t hw_bench, sw_bench;
     int compare_result;
-    matrix_t *input, *kernel, *hw_output, *sw_output;
+    accelerator_t accelerator;
+    accelerator_kernel_t kernel_handle;
+    perf_counters_t counters;
+    matrix_t *input, *kernels[NUM_FILTERS], *hw_output, *sw_output;
 
     // Initialize memory manager
     status = allocator_init();
@@ -21,75 +52,96 @@ int main(void) {
     }
 
     // Initialize hardware
-    status = accelerator_init();
+    status = accelerator_init(&accelerator, 0, ACCELERATOR_BACKEND_HARDWARE);
     if (status != STATUS_SUCCESS) {
         xil_printf("Hardware initialization failed\r\n");
         return XST_FAILURE;
     }
 
+    // Trace the hot paths of the main benchmark (no-op unless TRACE_ENABLE)
+    trace_reset();
+
     // Reset benchmarks
     benchmark_reset(&hw_bench);
     benchmark_reset(&sw_bench);
+    benchmark_set_warmup(&hw_bench, BENCH_WARMUP);
+    benchmark_set_warmup(&sw_bench, BENCH_WARMUP);
 
-    // Run benchmark iterations
-    for(int i = 0; i < BENCH_ITERATIONS; i++) {
+    //
+    // Generate Test Data
+    //
 
-    	//
-    	// Generate Test Data
-    	//
+    // Reset allocator
+    allocator_reset();
 
-    	// Reset allocator
-    	allocator_reset();
+    // Create input matrix
+    input = matrix_create(INPUT_SIZE, INPUT_SIZE);
+    if (!input) {
+        xil_printf("Failed to create input matrix\r\n");
+        return XST_FAILURE;
+    }
 
-        // Create input matrix
-        input = matrix_create(INPUT_SIZE, INPUT_SIZE);
-        if (!input) {
-            xil_printf("Failed to create input matrix\r\n");
+    // Create kernel matrices (one per filter of the bitstream)
+    for (int f = 0; f < NUM_FILTERS; f++) {
+        kernels[f] = matrix_create(KERNEL_SIZE, KERNEL_SIZE);
+        if (!kernels[f]) {
+            xil_printf("Failed to create kernel matrix\r\n");
             return XST_FAILURE;
         }
+    }
 
+    // Create output matrix for hardware (stream-only, mapped uncached;
+    // each pixel carries NUM_FILTERS interleaved channels)
+    hw_output = matrix_create_uncached(OUTPUT_SIZE, OUTPUT_SIZE * NUM_FILTERS);
+    if (!hw_output) {
+        xil_printf("Failed to create hardware output matrix\r\n");
+        return XST_FAILURE;
+    }
 
-        // Create kernel matrix
-        kernel = matrix_create(KERNEL_SIZE, KERNEL_SIZE);
-        if (!kernel) {
-            xil_printf("Failed to create kernel matrix\r\n");
-            matrix_destroy(input);
-            return XST_FAILURE;
-        }
+    // Create output matrix for software
+    sw_output = matrix_create(OUTPUT_SIZE, OUTPUT_SIZE * NUM_FILTERS);
+    if (!sw_output) {
+        xil_printf("Failed to create software output matrix\r\n");
+        return XST_FAILURE;
+    }
 
-        // Create output matrix for hardware
-        hw_output = matrix_create(OUTPUT_SIZE, OUTPUT_SIZE);
-        if (!hw_output) {
-            matrix_destroy(kernel);
-            matrix_destroy(input);
-            xil_printf("Failed to create hardware output matrix\r\n");
-            return XST_FAILURE;
+    // Randomize kernel matrices once, so every iteration after the first
+    // finds the weights already loaded and skips the upload
+    for (int f = 0; f < NUM_FILTERS; f++) {
+        status = matrix_randomize(kernels[f], -1.0f, 1.0f);
+        if (status != STATUS_SUCCESS) {
+            xil_printf("Failed to randomize kernel matrix\r\n");
+            goto cleanup;
         }
+    }
 
-        // Create output matrix for software
-        sw_output = matrix_create(OUTPUT_SIZE, OUTPUT_SIZE);
-        if (!sw_output) {
-            matrix_destroy(kernel);
-            matrix_destroy(input);
-            matrix_destroy(hw_output);
-            xil_printf("Failed to create software output matrix\r\n");
-            return XST_FAILURE;
+    // Snapshot kernels for upload
+    status = accelerator_kernel_create_filters(&kernel_handle, kernels, NUM_FILTERS);
+    if (status != STATUS_SUCCESS) {
+        xil_printf("Failed to create kernel handle\r\n");
+        goto cleanup;
+    }
+
+    // Run benchmark iterations (the first BENCH_WARMUP are not measured)
+    for(int i = 0; i < BENCH_WARMUP + BENCH_ITERATIONS; i++) {
+
+        // Restart the cache statistics and fabric counters after warmup
+        if (i == BENCH_WARMUP) {
+            cache_stats_reset();
+            status = accelerator_read_counters(&accelerator, 1, &counters);
+            if (status != STATUS_SUCCESS) {
+                xil_printf("Failed to clear performance counters\r\n");
+                goto cleanup;
+            }
         }
 
-        // Randomize input matrix
+        // Randomize input matrix (a new frame per iteration)
         status = matrix_randomize(input, -1.0f, 1.0f);
         if (status != STATUS_SUCCESS) {
             xil_printf("Failed to randomize input matrix\r\n");
             goto cleanup;
         }
 
-        // Randomize kernel matrix
-        status = matrix_randomize(kernel, -1.0f, 1.0f);
-        if (status != STATUS_SUCCESS) {
-            xil_printf("Failed to randomize kernel matrix\r\n");
-            goto cleanup;
-        }
-
         //
         // Hardware Benchmark
         //
@@ -97,19 +149,28 @@ int main(void) {
         // Start counter
         benchmark_start(&hw_bench, "Hardware CNN");
 
-        // Configure hardware with kernel
-        status = accelerator_set_kernel(kernel);
+        // Configure hardware with kernel (skipped if unchanged)
+        status = accelerator_load_kernel(&accelerator, &kernel_handle);
         if (status != STATUS_SUCCESS) {
             xil_printf("Failed to set kernel in hardware\r\n");
             goto cleanup;
         }
+        benchmark_phase(&hw_bench, "Kernel upload");
+
+        // Hardware computation (submit covers the cache flush and DMA setup)
+        status = accelerator_submit(&accelerator, input, hw_output);
+        if (status != STATUS_SUCCESS) {
+            xil_printf("Hardware submit failed\r\n");
+            goto cleanup;
+        }
+        benchmark_phase(&hw_bench, "Flush and DMA submit");
 
-        // Hardware computation
-        status = accelerator_compute(input, hw_output);
+        status = accelerator_wait(&accelerator);
         if (status != STATUS_SUCCESS) {
             xil_printf("Hardware computation failed\r\n");
             goto cleanup;
         }
+        benchmark_phase(&hw_bench, "Fabric and DMA wait");
 
         // Stop counter
         benchmark_stop(&hw_bench);
@@ -122,7 +183,7 @@ int main(void) {
         benchmark_start(&sw_bench, "Software CNN");
 
         // Software computation
-        status = cnn_forward(input, kernel, 2, 1, sw_output);
+        status = cnn_forward_filters(input, kernels, NUM_FILTERS, 2, 1, sw_output);
         if (status != STATUS_SUCCESS) {
             xil_printf("Software computation failed\r\n");
             goto cleanup;
@@ -156,21 +217,533 @@ int main(void) {
             goto cleanup;
         }
 
-        // Destroy matrices
-        matrix_destroy(kernel);
-        matrix_destroy(input);
-        matrix_destroy(hw_output);
-        matrix_destroy(sw_output);
+    }
 
+    // Destroy matrices
+    for (int f = 0; f < NUM_FILTERS; f++) {
+        matrix_destroy(kernels[f]);
     }
+    matrix_destroy(input);
+    matrix_destroy(hw_output);
+    matrix_destroy(sw_output);
 
     // Print benchmark results
     benchmark_print(&hw_bench);
     benchmark_print(&sw_bench);
     benchmark_compare(&hw_bench, &sw_bench);
 
+#ifdef TRACE_ENABLE
+    // Chrome trace of the most recent events over the UART
+    xil_printf("\r\nTrace (%u events):\r\n", (unsigned)trace_count());
+    trace_write(stdout);
+#endif
+
+    // Where the hardware time went
+    status = accelerator_read_counters(&accelerator, 0, &counters);
+    if (status != STATUS_SUCCESS) {
+        xil_printf("Failed to read performance counters\r\n");
+        goto cleanup;
+    }
+    benchmark_print_counters(&hw_bench, &counters);
+    cache_stats_print(BENCH_ITERATIONS);
+    xil_printf("Kernel uploads: %u, skipped: %u\r\n", accelerator.kernel_uploads, accelerator.kernel_skips);
+
+    // Multi-instance scaling on the host model
+    for (int n = 1; n <= ACCELERATOR_MAX_INSTANCES; n++) {
+        status = run_dispatch(ACCELERATOR_BACKEND_MODEL, n);
+        if (status != STATUS_SUCCESS) {
+            xil_printf("Model dispatch failed\r\n");
+            goto cleanup;
+        }
+    }
+
+    // Cost-model driven backend selection
+    status = run_schedule(&accelerator);
+    if (status != STATUS_SUCCESS) {
+        xil_printf("Scheduled batch failed\r\n");
+        goto cleanup;
+    }
+
+    // Row-granular streaming on both backends
+    status = run_stream(STREAM_BACKEND_SOFTWARE, &accelerator);
+    if (status == STATUS_SUCCESS) {
+        status = run_stream(STREAM_BACKEND_ACCELERATOR, &accelerator);
+    }
+    if (status != STATUS_SUCCESS) {
+        xil_printf("Row streaming failed\r\n");
+        goto cleanup;
+    }
+
+    // Every filter of the bitstream from one input pass
+    status = run_filters(&accelerator);
+    if (status != STATUS_SUCCESS) {
+        xil_printf("Multi-filter pass failed\r\n");
+        goto cleanup;
+    }
+
+    // Back-to-back frames in one transfer against one transfer per frame
+    status = run_batch(&accelerator);
+    if (status != STATUS_SUCCESS) {
+        xil_printf("Batched frames failed\r\n");
+        goto cleanup;
+    }
+
+    // Continuous load rather than isolated calls
+    status = run_sustained(&accelerator);
+    if (status != STATUS_SUCCESS) {
+        xil_printf("Sustained throughput run failed\r\n");
+        goto cleanup;
+    }
+
+    // Machine-readable timings across layer shapes and backends
+    status = run_sweep(&accelerator);
+    if (status != STATUS_SUCCESS) {
+        xil_printf("Parameter sweep failed\r\n");
+        goto cleanup;
+    }
+
+    // Zero-skipping convolution against the dense one
+    status = run_sparsity();
+    if (status != STATUS_SUCCESS) {
+        xil_printf("Sparsity sweep failed\r\n");
+        goto cleanup;
+    }
+
 cleanup:
-    accelerator_cleanup();
+    accelerator_cleanup(&accelerator);
 
     return (status == STATUS_SUCCESS) ? 0 : 1;
 }
+
+static status_t run_dispatch(accelerator_backend_t backend, int num_instances) {
+    status_t status;
+    accelerator_t instances[ACCELERATOR_MAX_INSTANCES];
+    matrix_t *inputs[DISPATCH_FRAMES], *outputs[DISPATCH_FRAMES];
+    matrix_t *kernel;
+    dispatcher_t dispatcher;
+
+    allocator_reset();
+
+    // Generate batch
+    kernel = matrix_create(KERNEL_SIZE, KERNEL_SIZE);
+    if (!kernel) {
+        return STATUS_ERROR_MEMORY;
+    }
+
+    status = matrix_randomize(kernel, -1.0f, 1.0f);
+    if (status != STATUS_SUCCESS) {
+        return status;
+    }
+
+    // The kernel loads as filter 0, the other channels come back zero
+    for (int i = 0; i < DISPATCH_FRAMES; i++) {
+        inputs[i] = matrix_create(INPUT_SIZE, INPUT_SIZE);
+        outputs[i] = matrix_create(OUTPUT_SIZE, OUTPUT_SIZE * NUM_FILTERS);
+        if (!inputs[i] || !outputs[i]) {
+            return STATUS_ERROR_MEMORY;
+        }
+
+        status = matrix_randomize(inputs[i], -1.0f, 1.0f);
+        if (status != STATUS_SUCCESS) {
+            return status;
+        }
+    }
+
+    // Bring up instances
+    for (int i = 0; i < num_instances; i++) {
+        status = accelerator_init(&instances[i], i, backend);
+        if (status != STATUS_SUCCESS) {
+            return status;
+        }
+    }
+
+    status = dispatcher_init(&dispatcher, instances, num_instances);
+    if (status != STATUS_SUCCESS) {
+        goto cleanup;
+    }
+
+    status = dispatcher_set_kernel(&dispatcher, kernel);
+    if (status != STATUS_SUCCESS) {
+        goto cleanup;
+    }
+
+    // Spread the batch across instances
+    status = dispatcher_run(&dispatcher, inputs, outputs, DISPATCH_FRAMES);
+    if (status != STATUS_SUCCESS) {
+        goto cleanup;
+    }
+
+    dispatcher_print(&dispatcher);
+
+cleanup:
+    for (int i = 0; i < num_instances; i++) {
+        accelerator_cleanup(&instances[i]);
+    }
+    return status;
+}
+
+static status_t run_schedule(accelerator_t *accelerator) {
+    status_t status;
+    matrix_t *inputs[SCHEDULE_FRAMES], *outputs[SCHEDULE_FRAMES];
+    matrix_t *kernel;
+    scheduler_t scheduler;
+    benchmark_t batch_bench;
+
+    // The software backend computes a single channel
+    if (NUM_FILTERS > 1) {
+        xil_printf("\r\nScheduled batch skipped (needs NUM_FILTERS 1)\r\n");
+        return STATUS_SUCCESS;
+    }
+
+    allocator_reset();
+
+    status = scheduler_init(&scheduler, accelerator);
+    if (status != STATUS_SUCCESS) {
+        return status;
+    }
+
+    status = scheduler_calibrate(&scheduler);
+    if (status != STATUS_SUCCESS) {
+        return status;
+    }
+
+    // Generate batch
+    kernel = matrix_create(KERNEL_SIZE, KERNEL_SIZE);
+    if (!kernel) {
+        return STATUS_ERROR_MEMORY;
+    }
+
+    status = matrix_randomize(kernel, -1.0f, 1.0f);
+    if (status != STATUS_SUCCESS) {
+        return status;
+    }
+
+    for (int i = 0; i < SCHEDULE_FRAMES; i++) {
+        inputs[i] = matrix_create(INPUT_SIZE, INPUT_SIZE);
+        outputs[i] = matrix_create(OUTPUT_SIZE, OUTPUT_SIZE);
+        if (!inputs[i] || !outputs[i]) {
+            return STATUS_ERROR_MEMORY;
+        }
+
+        status = matrix_randomize(inputs[i], -1.0f, 1.0f);
+        if (status != STATUS_SUCCESS) {
+            return status;
+        }
+    }
+
+    // Split the batch across CPU and fabric
+    benchmark_reset(&batch_bench);
+    benchmark_start(&batch_bench, "Scheduled batch");
+    status = scheduler_run_batch(&scheduler, inputs, kernel, outputs, SCHEDULE_FRAMES);
+    if (status != STATUS_SUCCESS) {
+        return status;
+    }
+    benchmark_stop(&batch_bench);
+
+    scheduler_print(&scheduler);
+    benchmark_print(&batch_bench);
+
+    return STATUS_SUCCESS;
+}
+
+static status_t run_stream(stream_backend_t backend, accelerator_t *accelerator) {
+    status_t status;
+    stream_t stream;
+    cnn_stages_t stages = { 1, CNN_POOL_MAX, 0 };
+    matrix_t *input, *kernel, *output, *reference;
+    int rows_ready = 0, first_row_at = -1, compare_result;
+
+    // The software backend computes a single channel
+    if (NUM_FILTERS > 1) {
+        xil_printf("\r\nRow streaming skipped (needs NUM_FILTERS 1)\r\n");
+        return STATUS_SUCCESS;
+    }
+
+    allocator_reset();
+
+    input = matrix_create(INPUT_SIZE, INPUT_SIZE);
+    kernel = matrix_create(KERNEL_SIZE, KERNEL_SIZE);
+    output = matrix_create(OUTPUT_SIZE, OUTPUT_SIZE);
+    reference = matrix_create(OUTPUT_SIZE, OUTPUT_SIZE);
+    if (!input || !kernel || !output || !reference) {
+        return STATUS_ERROR_MEMORY;
+    }
+
+    status = matrix_randomize(input, -1.0f, 1.0f);
+    if (status == STATUS_SUCCESS) {
+        status = matrix_randomize(kernel, -1.0f, 1.0f);
+    }
+    if (status == STATUS_SUCCESS) {
+        status = cnn_forward(input, kernel, POOL_SIZE, STRIDE, reference);
+    }
+    if (status != STATUS_SUCCESS) {
+        return status;
+    }
+
+    // Feed the frame a few lines at a time, as a line-scanned sensor would
+    status = stream_begin(&stream, backend, accelerator, kernel, &stages, INPUT_SIZE, INPUT_SIZE, output);
+    if (status != STATUS_SUCCESS) {
+        return status;
+    }
+
+    for (int row = 0; row < INPUT_SIZE; row += STREAM_CHUNK) {
+        int chunk = (INPUT_SIZE - row < STREAM_CHUNK) ? INPUT_SIZE - row : STREAM_CHUNK;
+        status = stream_push_rows(&stream, &input->data[row * INPUT_SIZE], chunk, &rows_ready);
+        if (status != STATUS_SUCCESS) {
+            return status;
+        }
+        if (rows_ready > 0 && first_row_at < 0) {
+            first_row_at = row + chunk;
+        }
+    }
+
+    status = stream_end(&stream, &rows_ready);
+    if (status != STATUS_SUCCESS) {
+        return status;
+    }
+    if (first_row_at < 0) {
+        first_row_at = INPUT_SIZE;
+    }
+
+    status = matrix_compare(output, reference, &compare_result);
+    if (status != STATUS_SUCCESS) {
+        return status;
+    }
+
+    xil_printf("\r\nRow Streaming (%s):\r\n", backend == STREAM_BACKEND_SOFTWARE ? "Software" : "Accelerator");
+    xil_printf("  Pooled rows:      %d\r\n", rows_ready);
+    xil_printf("  First row after:  %d input rows\r\n", first_row_at);
+    xil_printf("  Result:           %s\r\n", compare_result == 0 ? "match" : "MISMATCH");
+
+    return (compare_result == 0) ? STATUS_SUCCESS : STATUS_ERROR_HARDWARE;
+}
+
+static status_t run_filters(accelerator_t *accelerator) {
+    status_t status = STATUS_SUCCESS;
+    matrix_t *kernels[NUM_FILTERS];
+    matrix_t *input, *output, *reference;
+    int compare_result;
+
+    allocator_reset();
+
+    // Output pixels hold NUM_FILTERS interleaved channels
+    input = matrix_create(INPUT_SIZE, INPUT_SIZE);
+    output = matrix_create(OUTPUT_SIZE, OUTPUT_SIZE * NUM_FILTERS);
+    reference = matrix_create(OUTPUT_SIZE, OUTPUT_SIZE * NUM_FILTERS);
+    if (!input || !output || !reference) {
+        return STATUS_ERROR_MEMORY;
+    }
+
+    for (int f = 0; f < NUM_FILTERS && status == STATUS_SUCCESS; f++) {
+        kernels[f] = matrix_create(KERNEL_SIZE, KERNEL_SIZE);
+        if (!kernels[f]) {
+            return STATUS_ERROR_MEMORY;
+        }
+        status = matrix_randomize(kernels[f], -1.0f, 1.0f);
+    }
+    if (status == STATUS_SUCCESS) {
+        status = matrix_randomize(input, -1.0f, 1.0f);
+    }
+    if (status == STATUS_SUCCESS) {
+        status = cnn_forward_filters(input, kernels, NUM_FILTERS, POOL_SIZE, STRIDE, reference);
+    }
+    if (status == STATUS_SUCCESS) {
+        status = accelerator_set_filters(accelerator, kernels, NUM_FILTERS);
+    }
+    if (status == STATUS_SUCCESS) {
+        status = accelerator_compute(accelerator, input, output);
+    }
+    if (status == STATUS_SUCCESS) {
+        status = matrix_compare(output, reference, &compare_result);
+    }
+    if (status != STATUS_SUCCESS) {
+        return status;
+    }
+
+    xil_printf("\r\nMulti-Filter Pass:\r\n");
+    xil_printf("  Filters:          %d\r\n", NUM_FILTERS);
+    xil_printf("  Input passes:     1 (instead of %d)\r\n", NUM_FILTERS);
+    xil_printf("  Result:           %s\r\n", compare_result == 0 ? "match" : "MISMATCH");
+
+    return (compare_result == 0) ? STATUS_SUCCESS : STATUS_ERROR_HARDWARE;
+}
+
+static status_t run_batch(accelerator_t *accelerator) {
+    status_t status = STATUS_SUCCESS;
+    matrix_t *kernels[NUM_FILTERS];
+    matrix_t *input, *output, *reference;
+    benchmark_t frame_bench, batch_bench;
+    int compare_result;
+
+    allocator_reset();
+
+    // Frames are stacked vertically, each followed by the next in memory
+    input = matrix_create(BATCH_FRAMES * INPUT_SIZE, INPUT_SIZE);
+    output = matrix_create_uncached(BATCH_FRAMES * OUTPUT_SIZE, OUTPUT_SIZE * NUM_FILTERS);
+    reference = matrix_create(BATCH_FRAMES * OUTPUT_SIZE, OUTPUT_SIZE * NUM_FILTERS);
+    if (!input || !output || !reference) {
+        return STATUS_ERROR_MEMORY;
+    }
+
+    for (int f = 0; f < NUM_FILTERS && status == STATUS_SUCCESS; f++) {
+        kernels[f] = matrix_create(KERNEL_SIZE, KERNEL_SIZE);
+        if (!kernels[f]) {
+            return STATUS_ERROR_MEMORY;
+        }
+        status = matrix_randomize(kernels[f], -1.0f, 1.0f);
+    }
+    if (status == STATUS_SUCCESS) {
+        status = matrix_randomize(input, -1.0f, 1.0f);
+    }
+    if (status == STATUS_SUCCESS) {
+        status = accelerator_set_filters(accelerator, kernels, NUM_FILTERS);
+    }
+    if (status != STATUS_SUCCESS) {
+        return status;
+    }
+
+    // One transfer per frame (views into the stacked buffers), with the
+    // software pass as the reference
+    benchmark_reset(&frame_bench);
+    benchmark_reset(&batch_bench);
+    for (int i = 0; i < BATCH_FRAMES; i++) {
+        matrix_t frame_in, frame_out, frame_ref;
+
+        status = matrix_view_rows(input, i * INPUT_SIZE, INPUT_SIZE, &frame_in);
+        if (status == STATUS_SUCCESS) {
+            status = matrix_view_rows(output, i * OUTPUT_SIZE, OUTPUT_SIZE, &frame_out);
+        }
+        if (status == STATUS_SUCCESS) {
+            status = matrix_view_rows(reference, i * OUTPUT_SIZE, OUTPUT_SIZE, &frame_ref);
+        }
+        if (status != STATUS_SUCCESS) {
+            return status;
+        }
+
+        benchmark_start(&frame_bench, "Per-frame transfers");
+        status = accelerator_compute(accelerator, &frame_in, &frame_out);
+        benchmark_stop(&frame_bench);
+        if (status == STATUS_SUCCESS) {
+            status = cnn_forward_filters(&frame_in, kernels, NUM_FILTERS, POOL_SIZE, STRIDE, &frame_ref);
+        }
+
+        // Ownership changes made through the views reach the parents
+        matrix_view_release(input, &frame_in);
+        matrix_view_release(output, &frame_out);
+        matrix_view_release(reference, &frame_ref);
+        if (status != STATUS_SUCCESS) {
+            return status;
+        }
+    }
+
+    // Whole batch in one transfer each way
+    benchmark_start(&batch_bench, "Batched transfer");
+    status = accelerator_compute_batch(accelerator, input, output, BATCH_FRAMES);
+    benchmark_stop(&batch_bench);
+    if (status != STATUS_SUCCESS) {
+        return status;
+    }
+
+    status = matrix_compare(output, reference, &compare_result);
+    if (status != STATUS_SUCCESS) {
+        return status;
+    }
+
+    xil_printf("\r\nBatched Frames:\r\n");
+    xil_printf("  Frames:           %d\r\n", BATCH_FRAMES);
+    xil_printf("  Result:           %s\r\n", compare_result == 0 ? "match" : "MISMATCH");
+    benchmark_print(&frame_bench);
+    benchmark_print(&batch_bench);
+
+    return (compare_result == 0) ? STATUS_SUCCESS : STATUS_ERROR_HARDWARE;
+}
+
+static status_t run_sweep(accelerator_t *accelerator) {
+    static const int input_sizes[] = { 16, 32, 64, INPUT_SIZE, 2 * INPUT_SIZE };
+    static const int kernel_sizes[] = { 3, 5 };
+    static const int strides[] = { 1, 2 };
+    static const int pool_sizes[] = { 1, 2 };
+    static const sweep_backend_t backends[] = {
+        SWEEP_BACKEND_SOFTWARE, SWEEP_BACKEND_MODEL, SWEEP_BACKEND_HARDWARE
+    };
+
+    sweep_config_t config = {
+        input_sizes, sizeof(input_sizes) / sizeof(input_sizes[0]),
+        kernel_sizes, sizeof(kernel_sizes) / sizeof(kernel_sizes[0]),
+        strides, sizeof(strides) / sizeof(strides[0]),
+        pool_sizes, sizeof(pool_sizes) / sizeof(pool_sizes[0]),
+        backends, sizeof(backends) / sizeof(backends[0]),
+        SWEEP_ITERATIONS, BENCH_WARMUP, SWEEP_FORMAT
+    };
+
+    allocator_reset();
+
+    xil_printf("\r\nParameter Sweep:\r\n");
+    return sweep_run(&config, accelerator);
+}
+
+static status_t run_sustained(accelerator_t *accelerator) {
+    status_t status;
+    matrix_t *inputs[SUSTAIN_BUFFERS], *outputs[SUSTAIN_BUFFERS];
+    matrix_t *kernel;
+    throughput_t result;
+
+    allocator_reset();
+
+    kernel = matrix_create(KERNEL_SIZE, KERNEL_SIZE);
+    if (!kernel) {
+        return STATUS_ERROR_MEMORY;
+    }
+
+    status = matrix_randomize(kernel, -1.0f, 1.0f);
+    if (status != STATUS_SUCCESS) {
+        return status;
+    }
+
+    // Buffers rotate, so the CPU never waits on cache maintenance for the
+    // frame the fabric is reading, and each holds a packet of frames that
+    // streams back to back
+    for (int i = 0; i < SUSTAIN_BUFFERS; i++) {
+        inputs[i] = matrix_create(BATCH_FRAMES * INPUT_SIZE, INPUT_SIZE);
+        outputs[i] = matrix_create_uncached(BATCH_FRAMES * OUTPUT_SIZE, OUTPUT_SIZE * NUM_FILTERS);
+        if (!inputs[i] || !outputs[i]) {
+            return STATUS_ERROR_MEMORY;
+        }
+
+        status = matrix_randomize(inputs[i], -1.0f, 1.0f);
+        if (status != STATUS_SUCCESS) {
+            return status;
+        }
+    }
+
+    status = accelerator_set_kernel(accelerator, kernel);
+    if (status != STATUS_SUCCESS) {
+        return status;
+    }
+
+    status = throughput_run(accelerator, inputs, outputs, SUSTAIN_BUFFERS, BATCH_FRAMES, SUSTAIN_FRAMES, SUSTAIN_US,
+                            &result);
+    if (status != STATUS_SUCCESS) {
+        return status;
+    }
+
+    throughput_print(&result, "Hardware CNN");
+    return STATUS_SUCCESS;
+}
+
+static status_t run_sparsity(void) {
+    static const int weight_zeros[] = { 0, 50, 75 };
+    static const int input_zeros[] = { 0, 25, 50, 75, 90, 99 };
+
+    sparsity_config_t config = {
+        SPARSITY_SIZE, KERNEL_SIZE, STRIDE,
+        weight_zeros, sizeof(weight_zeros) / sizeof(weight_zeros[0]),
+        input_zeros, sizeof(input_zeros) / sizeof(input_zeros[0]),
+        SWEEP_ITERATIONS, BENCH_WARMUP, SWEEP_FORMAT
+    };
+
+    allocator_reset();
+
+    xil_printf("\r\nSparsity Sweep:\r\n");
+    return sparsity_run(&config);
+}
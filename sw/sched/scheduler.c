@@ -0,0 +1,536 @@
+#include "scheduler.h"
+
+#include "xil_exception.h"
+#include "xil_printf.h"
+#include <stdio.h>
+#include <string.h>
+
+#include "../cnn/cnn.h"
+#include "../hal/bump_allocator.h"
+#include "../utils/benchmark.h"
+
+#define CALIBRATION_ITERATIONS 10
+#define CALIBRATION_SMALL_SIZE 16
+
+// Forward declarations
+static status_t calibrate_accelerator(scheduler_t *s, matrix_t *kernel);
+static status_t calibrate_software(scheduler_t *s, matrix_t *kernel);
+static status_t calibrate_copy(scheduler_t *s);
+static int is_eligible(sched_backend_t backend, matrix_t *input, matrix_t *kernel);
+static double conv_macs(int rows, int cols);
+static void batch_complete(void *ctx);
+
+static const char *backend_names[SCHED_NUM_BACKENDS] = {
+    "Accelerator",
+    "Tiled accelerator",
+    "Software",
+};
+
+status_t scheduler_init(scheduler_t *s, accelerator_t *acc) {
+    if (!s || !acc) {
+        LOG_ERROR("NULL pointer(s)");
+        return STATUS_ERROR_INVALID_PARAM;
+    }
+
+    // The software backend and stolen frames compute a single channel, so
+    // their outputs could not stand in for a multi-filter fabric's
+    if (NUM_FILTERS > 1) {
+        LOG_ERROR("Scheduler needs NUM_FILTERS 1 (bitstream has %d)", NUM_FILTERS);
+        return STATUS_ERROR_INVALID_PARAM;
+    }
+
+    memset(s, 0, sizeof(*s));
+    s->acc = acc;
+
+    return STATUS_SUCCESS;
+}
+
+status_t scheduler_calibrate(scheduler_t *s) {
+    if (!s) {
+        LOG_ERROR("NULL pointer");
+        return STATUS_ERROR_INVALID_PARAM;
+    }
+
+    matrix_t *kernel = matrix_create(KERNEL_SIZE, KERNEL_SIZE);
+    if (!kernel) {
+        LOG_ERROR("Could not create calibration kernel");
+        return STATUS_ERROR_MEMORY;
+    }
+
+    status_t status = matrix_randomize(kernel, -1.0f, 1.0f);
+    if (status != STATUS_SUCCESS) {
+        goto cleanup;
+    }
+
+    status = calibrate_copy(s);
+    if (status != STATUS_SUCCESS) {
+        LOG_ERROR("Copy calibration failed");
+        goto cleanup;
+    }
+
+    status = calibrate_software(s, kernel);
+    if (status != STATUS_SUCCESS) {
+        LOG_ERROR("Software calibration failed");
+        goto cleanup;
+    }
+
+    status = calibrate_accelerator(s, kernel);
+    if (status != STATUS_SUCCESS) {
+        LOG_ERROR("Accelerator calibration failed");
+        goto cleanup;
+    }
+
+    s->calibrated = 1;
+
+cleanup:
+    matrix_destroy(kernel);
+    return status;
+}
+
+status_t scheduler_estimate(scheduler_t *s, sched_backend_t backend, int rows, int cols, double *cost_us) {
+    if (!s || !cost_us) {
+        LOG_ERROR("NULL pointer(s)");
+        return STATUS_ERROR_INVALID_PARAM;
+    }
+
+    if (!s->calibrated) {
+        LOG_ERROR("Cost model not calibrated");
+        return STATUS_ERROR_INVALID_PARAM;
+    }
+
+    const cost_model_t *c = &s->cost;
+    double frame_bytes = (double)INPUT_SIZE * INPUT_SIZE * sizeof(fixed_point_t);
+    double out_bytes = (double)OUTPUT_SIZE * OUTPUT_SIZE * sizeof(fixed_point_t);
+
+    switch (backend) {
+        case SCHED_BACKEND_ACCELERATOR:
+            *cost_us = c->setup_us + (double)rows * cols * sizeof(fixed_point_t) / c->bytes_per_us;
+            break;
+
+        case SCHED_BACKEND_TILED: {
+            int out_rows = ((rows - KERNEL_SIZE) / STRIDE + 1) / POOL_SIZE;
+            int out_cols = ((cols - KERNEL_SIZE) / STRIDE + 1) / POOL_SIZE;
+            int tiles = ((out_rows + OUTPUT_SIZE - 1) / OUTPUT_SIZE) * ((out_cols + OUTPUT_SIZE - 1) / OUTPUT_SIZE);
+            *cost_us = tiles * (c->setup_us + frame_bytes / c->bytes_per_us +
+                                (frame_bytes + out_bytes) / c->copy_bytes_per_us);
+            break;
+        }
+
+        case SCHED_BACKEND_SOFTWARE:
+            *cost_us = c->sw_setup_us + conv_macs(rows, cols) / c->macs_per_us;
+            break;
+
+        default:
+            LOG_ERROR("Invalid backend %d", backend);
+            return STATUS_ERROR_INVALID_PARAM;
+    }
+
+    return STATUS_SUCCESS;
+}
+
+status_t scheduler_select(scheduler_t *s, matrix_t *input, matrix_t *kernel, sched_backend_t *backend) {
+    if (!s || !input || !kernel || !backend) {
+        LOG_ERROR("NULL pointer(s)");
+        return STATUS_ERROR_INVALID_PARAM;
+    }
+
+    // The software backend runs one layer with the instance's stages, so a
+    // chained instance's frames could come back computed two ways
+    if (s->acc->chained) {
+        LOG_ERROR("Scheduler cannot run chained layers on instance %d", s->acc->id);
+        return STATUS_ERROR_INVALID_PARAM;
+    }
+
+    double best_cost = 0.0;
+    int found = 0;
+
+    for (int b = 0; b < SCHED_NUM_BACKENDS; b++) {
+        if (!is_eligible((sched_backend_t)b, input, kernel)) {
+            continue;
+        }
+
+        double cost;
+        status_t status = scheduler_estimate(s, (sched_backend_t)b, input->rows, input->cols, &cost);
+        if (status != STATUS_SUCCESS) {
+            return status;
+        }
+
+        if (!found || cost < best_cost) {
+            best_cost = cost;
+            *backend = (sched_backend_t)b;
+            found = 1;
+        }
+    }
+
+    return STATUS_SUCCESS;
+}
+
+status_t scheduler_run(scheduler_t *s, matrix_t *input, matrix_t *kernel, matrix_t *output) {
+    sched_backend_t backend;
+
+    status_t status = scheduler_select(s, input, kernel, &backend);
+    if (status != STATUS_SUCCESS) {
+        LOG_ERROR("Backend selection failed");
+        return status;
+    }
+
+    switch (backend) {
+        case SCHED_BACKEND_ACCELERATOR:
+            status = accelerator_set_kernel(s->acc, kernel);
+            if (status == STATUS_SUCCESS) {
+                status = accelerator_compute(s->acc, input, output);
+            }
+            break;
+
+        case SCHED_BACKEND_TILED:
+            status = accelerator_set_kernel(s->acc, kernel);
+            if (status == STATUS_SUCCESS) {
+                status = accelerator_compute_tiled(s->acc, input, output);
+            }
+            break;
+
+        default:
+            status = cnn_forward_stages(input, &kernel, 1, POOL_SIZE, STRIDE, &s->acc->stages, output);
+            break;
+    }
+
+    if (status != STATUS_SUCCESS) {
+        LOG_ERROR("%s backend failed", backend_names[backend]);
+        return status;
+    }
+
+    s->jobs[backend]++;
+    return STATUS_SUCCESS;
+}
+
+status_t scheduler_run_batch(scheduler_t *s, matrix_t **inputs, matrix_t *kernel, matrix_t **outputs, int num_frames) {
+    if (!s || !inputs || !kernel || !outputs) {
+        LOG_ERROR("NULL pointer(s)");
+        return STATUS_ERROR_INVALID_PARAM;
+    }
+
+    if (num_frames <= 0) {
+        LOG_ERROR("Invalid number of frames %d", num_frames);
+        return STATUS_ERROR_INVALID_PARAM;
+    }
+
+    // Only whole-frame accelerator jobs are split; anything else runs one by one
+    sched_backend_t backend;
+    status_t status = scheduler_select(s, inputs[0], kernel, &backend);
+    if (status != STATUS_SUCCESS) {
+        return status;
+    }
+
+    int uniform = 1;
+    for (int i = 0; i < num_frames; i++) {
+        if (!is_eligible(SCHED_BACKEND_ACCELERATOR, inputs[i], kernel)) {
+            uniform = 0;
+            break;
+        }
+    }
+
+    if (backend != SCHED_BACKEND_ACCELERATOR || !uniform || num_frames == 1) {
+        for (int i = 0; i < num_frames; i++) {
+            status = scheduler_run(s, inputs[i], kernel, outputs[i]);
+            if (status != STATUS_SUCCESS) {
+                return status;
+            }
+        }
+        return STATUS_SUCCESS;
+    }
+
+    double hw_us, sw_us;
+    status = scheduler_estimate(s, SCHED_BACKEND_ACCELERATOR, INPUT_SIZE, INPUT_SIZE, &hw_us);
+    if (status == STATUS_SUCCESS) {
+        status = scheduler_estimate(s, SCHED_BACKEND_SOFTWARE, INPUT_SIZE, INPUT_SIZE, &sw_us);
+    }
+    if (status != STATUS_SUCCESS) {
+        return status;
+    }
+
+    status = accelerator_set_kernel(s->acc, kernel);
+    if (status != STATUS_SUCCESS) {
+        return status;
+    }
+
+    // Stolen frames use the fabric's stages and share one compiled kernel,
+    // as the fabric shares one upload, and one set of intermediate maps
+    // (every frame fits the fabric)
+    cnn_stages_t stages = s->acc->stages;
+    cnn_sparse_kernel_t sparse;
+    cnn_scratch_t scratch;
+    int map_side = (INPUT_SIZE - KERNEL_SIZE) / STRIDE + 1;
+    status = cnn_sparse_compile(kernel, &sparse);
+    if (status == STATUS_SUCCESS) {
+        status = cnn_scratch_create(&scratch, map_side * map_side);
+    }
+    if (status != STATUS_SUCCESS) {
+        return status;
+    }
+
+    // The fabric consumes frames from the front, the CPU steals from the back
+    s->inputs = inputs;
+    s->outputs = outputs;
+    s->front = 1;
+    s->back = num_frames;
+    s->batch_status = STATUS_SUCCESS;
+
+    status = accelerator_set_callback(s->acc, batch_complete, s);
+    if (status != STATUS_SUCCESS) {
+        return status;
+    }
+
+    status = accelerator_submit(s->acc, inputs[0], outputs[0]);
+    if (status != STATUS_SUCCESS) {
+        accelerator_set_callback(s->acc, NULL, NULL);
+        return status;
+    }
+    s->jobs[SCHED_BACKEND_ACCELERATOR]++;
+
+    while (s->batch_status == STATUS_SUCCESS) {
+        int done, frame = -1;
+
+        // Drives completion on backends without interrupts; the completion
+        // interrupt submits the next frame, so it stays masked while the
+        // poll reads the instance and DMA state
+        Xil_ExceptionDisable();
+        status = accelerator_poll(s->acc, &done);
+        Xil_ExceptionEnable();
+        if (status != STATUS_SUCCESS) {
+            s->batch_status = status;
+            break;
+        }
+
+        // Steal a frame only if the fabric would still be busy when the CPU finishes it
+        Xil_ExceptionDisable();
+        if ((s->back - s->front) * hw_us > sw_us) {
+            frame = --s->back;
+        }
+        Xil_ExceptionEnable();
+
+        if (frame < 0) {
+            break;
+        }
+
+        status = cnn_forward_compiled(inputs[frame], &sparse, 1, POOL_SIZE, STRIDE, &stages, &scratch, outputs[frame]);
+        if (status != STATUS_SUCCESS) {
+            s->batch_status = status;
+            break;
+        }
+        s->jobs[SCHED_BACKEND_SOFTWARE]++;
+    }
+
+    // Drain the fabric (each completion chains the next front frame; the
+    // wait only reads flags the interrupt sets, so it runs unmasked)
+    while (s->batch_status == STATUS_SUCCESS && (s->front < s->back || s->acc->busy)) {
+        status = accelerator_wait(s->acc);
+        if (status != STATUS_SUCCESS) {
+            s->batch_status = status;
+        }
+    }
+
+    accelerator_wait(s->acc);
+    accelerator_set_callback(s->acc, NULL, NULL);
+
+    return s->batch_status;
+}
+
+void scheduler_print(scheduler_t *s) {
+    printf("\nScheduler Cost Model:\n");
+    printf("  Accelerator setup:   %.2f us\n", s->cost.setup_us);
+    printf("  Accelerator stream:  %.2f bytes/us\n", s->cost.bytes_per_us);
+    printf("  CPU copy:            %.2f bytes/us\n", s->cost.copy_bytes_per_us);
+    printf("  Software setup:      %.2f us\n", s->cost.sw_setup_us);
+    printf("  Software MAC rate:   %.2f MACs/us\n", s->cost.macs_per_us);
+
+    printf("\nScheduler Jobs:\n");
+    for (int b = 0; b < SCHED_NUM_BACKENDS; b++) {
+        printf("  %-18s %u\n", backend_names[b], (unsigned)s->jobs[b]);
+    }
+}
+
+static status_t calibrate_accelerator(scheduler_t *s, matrix_t *kernel) {
+    int sizes[2] = { CALIBRATION_SMALL_SIZE, INPUT_SIZE };
+    double times[2];
+    benchmark_t bench;
+    status_t status;
+
+    // Bitstreams too small for the small frame fall back to a single point
+    if (!accelerator_dimensions_supported(sizes[0], sizes[0])) {
+        sizes[0] = INPUT_SIZE;
+    }
+
+    // Two-point fit separates per-frame overhead from the measured (rather
+    // than the nominal one beat per fabric clock) streaming rate
+    for (int p = 0; p < 2; p++) {
+        int n = sizes[p];
+        int out = ((n - KERNEL_SIZE) / STRIDE + 1) / POOL_SIZE;
+
+        matrix_t *input = matrix_create(n, n);
+        matrix_t *output = matrix_create(out, out * NUM_FILTERS);
+        if (!input || !output) {
+            return STATUS_ERROR_MEMORY;
+        }
+
+        status = matrix_randomize(input, -1.0f, 1.0f);
+        if (status != STATUS_SUCCESS) {
+            return status;
+        }
+
+        benchmark_reset(&bench);
+        for (int i = 0; i < CALIBRATION_ITERATIONS; i++) {
+            benchmark_start(&bench, "Accelerator calibration");
+
+            status = accelerator_set_kernel(s->acc, kernel);
+            if (status != STATUS_SUCCESS) {
+                return status;
+            }
+
+            status = accelerator_compute(s->acc, input, output);
+            if (status != STATUS_SUCCESS) {
+                return status;
+            }
+
+            benchmark_stop(&bench);
+        }
+        times[p] = bench.avg_time_us;
+
+        matrix_destroy(input);
+        matrix_destroy(output);
+    }
+
+    double bytes_small = (double)sizes[0] * sizes[0] * sizeof(fixed_point_t);
+    double bytes_large = (double)sizes[1] * sizes[1] * sizeof(fixed_point_t);
+
+    if (sizes[1] == sizes[0] || times[1] <= times[0]) {
+        s->cost.bytes_per_us = (times[1] > 0.0) ? bytes_large / times[1] : bytes_large;
+        s->cost.setup_us = 0.0;
+    } else {
+        s->cost.bytes_per_us = (bytes_large - bytes_small) / (times[1] - times[0]);
+        s->cost.setup_us = times[0] - bytes_small / s->cost.bytes_per_us;
+        if (s->cost.setup_us < 0.0) {
+            s->cost.setup_us = 0.0;
+        }
+    }
+
+    return STATUS_SUCCESS;
+}
+
+static status_t calibrate_software(scheduler_t *s, matrix_t *kernel) {
+    const int sizes[2] = { CALIBRATION_SMALL_SIZE, INPUT_SIZE };
+    double times[2];
+    benchmark_t bench;
+    status_t status;
+
+    // Two-point fit separates fixed overhead from MAC throughput
+    for (int p = 0; p < 2; p++) {
+        int n = sizes[p];
+        int out = ((n - KERNEL_SIZE) / STRIDE + 1) / POOL_SIZE;
+
+        matrix_t *input = matrix_create(n, n);
+        matrix_t *output = matrix_create(out, out);
+        if (!input || !output) {
+            return STATUS_ERROR_MEMORY;
+        }
+
+        status = matrix_randomize(input, -1.0f, 1.0f);
+        if (status != STATUS_SUCCESS) {
+            return status;
+        }
+
+        benchmark_reset(&bench);
+        for (int i = 0; i < CALIBRATION_ITERATIONS; i++) {
+            benchmark_start(&bench, "Software calibration");
+            status = cnn_forward(input, kernel, POOL_SIZE, STRIDE, output);
+            if (status != STATUS_SUCCESS) {
+                return status;
+            }
+            benchmark_stop(&bench);
+        }
+        times[p] = bench.avg_time_us;
+
+        matrix_destroy(input);
+        matrix_destroy(output);
+    }
+
+    double macs_small = conv_macs(sizes[0], sizes[0]);
+    double macs_large = conv_macs(sizes[1], sizes[1]);
+
+    if (times[1] <= times[0]) {
+        s->cost.macs_per_us = (times[1] > 0.0) ? macs_large / times[1] : macs_large;
+        s->cost.sw_setup_us = 0.0;
+    } else {
+        s->cost.macs_per_us = (macs_large - macs_small) / (times[1] - times[0]);
+        s->cost.sw_setup_us = times[0] - macs_small / s->cost.macs_per_us;
+        if (s->cost.sw_setup_us < 0.0) {
+            s->cost.sw_setup_us = 0.0;
+        }
+    }
+
+    return STATUS_SUCCESS;
+}
+
+static status_t calibrate_copy(scheduler_t *s) {
+    benchmark_t bench;
+    u32 size = INPUT_SIZE * INPUT_SIZE * sizeof(fixed_point_t);
+
+    void *src = allocator_alloc(size);
+    void *dst = allocator_alloc(size);
+    if (!src || !dst) {
+        return STATUS_ERROR_MEMORY;
+    }
+
+    benchmark_reset(&bench);
+    for (int i = 0; i < CALIBRATION_ITERATIONS; i++) {
+        benchmark_start(&bench, "Copy calibration");
+        memcpy(dst, src, size);
+        benchmark_stop(&bench);
+    }
+
+    s->cost.copy_bytes_per_us = (bench.avg_time_us > 0.0) ? size / bench.avg_time_us : (double)size;
+
+    allocator_free(src);
+    allocator_free(dst);
+    return STATUS_SUCCESS;
+}
+
+static int is_eligible(sched_backend_t backend, matrix_t *input, matrix_t *kernel) {
+    // Multi-filter bitstreams emit several channels per pixel, which a
+    // single-kernel job cannot take
+    int hw_kernel = (kernel->rows == KERNEL_SIZE && kernel->cols == KERNEL_SIZE && NUM_FILTERS == 1);
+
+    switch (backend) {
+        case SCHED_BACKEND_ACCELERATOR:
+            return hw_kernel && accelerator_dimensions_supported(input->rows, input->cols);
+        case SCHED_BACKEND_TILED:
+            return hw_kernel && accelerator_tiling_supported(input->rows, input->cols) &&
+                   !accelerator_dimensions_supported(input->rows, input->cols);
+        case SCHED_BACKEND_SOFTWARE:
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+static double conv_macs(int rows, int cols) {
+    double conv_rows = (rows - KERNEL_SIZE) / STRIDE + 1;
+    double conv_cols = (cols - KERNEL_SIZE) / STRIDE + 1;
+    return conv_rows * conv_cols * KERNEL_SIZE * KERNEL_SIZE;
+}
+
+static void batch_complete(void *ctx) {
+    scheduler_t *s = (scheduler_t *)ctx;
+
+    if (s->batch_status != STATUS_SUCCESS || s->front >= s->back) {
+        return;
+    }
+
+    // Chain the next front frame straight from the completion interrupt
+    int frame = s->front++;
+    status_t status = accelerator_submit(s->acc, s->inputs[frame], s->outputs[frame]);
+    if (status != STATUS_SUCCESS) {
+        s->batch_status = status;
+        return;
+    }
+    s->jobs[SCHED_BACKEND_ACCELERATOR]++;
+}
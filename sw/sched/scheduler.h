@@ -0,0 +1,53 @@
+#pragma once
+
+#include "../common/matrix.h"
+#include "../common/status.h"
+#include "../hal/accelerator.h"
+
+/**
+ * Heterogeneous scheduler
+ * Picks the accelerator, the tiled accelerator or the software model per
+ * job using a cost model calibrated at startup. Batches of accelerator
+ * frames are split between the fabric and the CPU so both run concurrently.
+ */
+
+typedef enum {
+    SCHED_BACKEND_ACCELERATOR = 0,
+    SCHED_BACKEND_TILED = 1,
+    SCHED_BACKEND_SOFTWARE = 2,
+    SCHED_NUM_BACKENDS = 3,
+} sched_backend_t;
+
+// Calibrated cost model
+typedef struct {
+    double setup_us;          // Per-frame accelerator overhead (kernel upload, DMA setup, interrupts)
+    double bytes_per_us;      // Accelerator streaming rate
+    double copy_bytes_per_us; // CPU gather/scatter rate for tiles
+    double sw_setup_us;       // Software model fixed overhead
+    double macs_per_us;       // Software model MAC rate
+} cost_model_t;
+
+typedef struct {
+    accelerator_t *acc;
+    cost_model_t cost;
+    int calibrated;
+    u32 jobs[SCHED_NUM_BACKENDS];
+
+    // Concurrent batch state (shared with the completion callback)
+    matrix_t **inputs;
+    matrix_t **outputs;
+    volatile int front;
+    volatile int back;
+    volatile status_t batch_status;
+} scheduler_t;
+
+// Public Interface
+status_t scheduler_init(scheduler_t *s, accelerator_t *acc);
+status_t scheduler_calibrate(scheduler_t *s);
+status_t scheduler_estimate(scheduler_t *s, sched_backend_t backend, int rows, int cols, double *cost_us);
+status_t scheduler_select(scheduler_t *s, matrix_t *input, matrix_t *kernel, sched_backend_t *backend);
+status_t scheduler_run(scheduler_t *s, matrix_t *input, matrix_t *kernel, matrix_t *output);
+status_t scheduler_run_batch(scheduler_t *s, matrix_t **inputs, matrix_t *kernel, matrix_t **outputs, int num_frames);
+
+// Results handling
+void scheduler_print(scheduler_t *s);
@@ -1,33 +1,127 @@
 #include "benchmark.h"
 
-#include "xparameters.h"
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
-#define COUNTS_PER_USECOND (XPAR_CPU_CORTEXA9_CORE_CLOCK_FREQ_HZ / 1000000)
+#include "../hal/config.h"
+
+// Forward declarations
+static int compare_samples(const void *a, const void *b);
+static double square_root(double x);
 
 void benchmark_start(benchmark_t *b, char *name) {
     b->name = name;
-    XTime_GetTime(&b->start);
+    b->start = timer_now();
+    b->mark = b->start;
+}
+
+// Closes the interval since the start (or the previous phase) under name
+void benchmark_phase(benchmark_t *b, const char *name) {
+    timer_ticks_t now = timer_now();
+
+    double time_us = timer_elapsed_us(b->mark, now);
+    b->mark = now;
+    if (b->warmed < b->warmup) {
+        return;
+    }
+
+    int i = 0;
+    while (i < b->num_phases && strcmp(b->phases[i].name, name) != 0) {
+        i++;
+    }
+    if (i == BENCHMARK_MAX_PHASES) {
+        return;
+    }
+    if (i == b->num_phases) {
+        b->phases[i].name = name;
+        b->phases[i].total_us = 0;
+        b->phases[i].max_us = 0;
+        b->phases[i].count = 0;
+        b->num_phases++;
+    }
+
+    b->phases[i].total_us += time_us;
+    b->phases[i].count++;
+    if (time_us > b->phases[i].max_us) {
+        b->phases[i].max_us = time_us;
+    }
 }
 
 void benchmark_stop(benchmark_t *b) {
-    XTime_GetTime(&b->end);
+    b->end = timer_now();
+
+    // Warmup iterations (cold caches, first kernel upload) are not counted
+    if (b->warmed < b->warmup) {
+        b->warmed++;
+        return;
+    }
+
+    double time_us = timer_elapsed_us(b->start, b->end);
+    double delta = time_us - b->avg_time_us;
+
     b->iterations++;
-    b->total_time_us += (b->end - b-> start) / (double)COUNTS_PER_USECOND;
+    b->total_time_us += time_us;
     b->avg_time_us = b->total_time_us / b->iterations;
+    b->m2 += delta * (time_us - b->avg_time_us);
+
+    if (b->iterations == 1 || time_us < b->min_time_us) {
+        b->min_time_us = time_us;
+    }
+    if (time_us > b->max_time_us) {
+        b->max_time_us = time_us;
+    }
+    if (b->num_samples < BENCHMARK_MAX_SAMPLES) {
+        b->samples_us[b->num_samples++] = (float)time_us;
+    }
 }
 
 void benchmark_reset(benchmark_t *b) {
     b->iterations = 0;
     b->total_time_us = 0;
     b->avg_time_us = 0;
+    b->min_time_us = 0;
+    b->max_time_us = 0;
+    b->m2 = 0;
+    b->warmup = 0;
+    b->warmed = 0;
+    b->num_samples = 0;
+    b->num_phases = 0;
+}
+
+void benchmark_set_warmup(benchmark_t *b, int iterations) {
+    b->warmup = iterations > 0 ? iterations : 0;
+    b->warmed = 0;
 }
 
 void benchmark_print(benchmark_t *b) {
     printf("\nBenchmark Results for %s:\n", b->name);
-    printf("  Iterations:   %d\n", b->iterations);
+    printf("  Iterations:   %d", b->iterations);
+    if (b->warmup > 0) {
+        printf(" (after %d warmup)", b->warmed);
+    }
+    printf("\n");
     printf("  Total time:   %.2f us\n", b->total_time_us);
-    printf("  Average time: %.2f us\n", b->avg_time_us);
+    printf("  Average time: %.2f us (stddev %.2f us)\n", b->avg_time_us, benchmark_get_stddev_us(b));
+    if (b->iterations == 0) {
+        return;
+    }
+
+    printf("  Min / max:    %.2f / %.2f us\n", b->min_time_us, b->max_time_us);
+    printf("  p50/p90/p99:  %.2f / %.2f / %.2f us", benchmark_get_percentile_us(b, 50),
+           benchmark_get_percentile_us(b, 90), benchmark_get_percentile_us(b, 99));
+    if (b->num_samples < b->iterations) {
+        printf(" (first %d iterations)", b->num_samples);
+    }
+    printf("\n");
+
+    // Phase shares are of the total, the remainder is untimed between phases
+    for (int i = 0; i < b->num_phases; i++) {
+        const benchmark_phase_t *phase = &b->phases[i];
+        printf("  - %-22s avg %.2f us, max %.2f us (%.1f%%)\n", phase->name,
+               phase->total_us / phase->count, phase->max_us,
+               b->total_time_us > 0 ? 100.0 * phase->total_us / b->total_time_us : 0.0);
+    }
 }
 
 void benchmark_compare(benchmark_t *hwb, benchmark_t *swb) {
@@ -39,6 +133,87 @@ void benchmark_compare(benchmark_t *hwb, benchmark_t *swb) {
     printf("  Speedup: %2.fx\n", speedup);
 }
 
-double benchmark_get_throughput_mbps(benchmark_t *b, int data_size) {
-    return ((data_size * 8.0) / b->avg_time_us) * 1.0;
+void benchmark_print_counters(benchmark_t *b, const perf_counters_t *counters) {
+    double wall_cycles = b->total_time_us * (ACCELERATOR_CLOCK_HZ / 1000000.0);
+    double active = counters->active_cycles ? (double)counters->active_cycles : 1.0;
+
+    // Stalls are shares of the active cycles; utilization is of the wall time
+    printf("\nFabric Counters for %s:\n", b->name);
+    printf("  Frames:         %u\n", (unsigned)counters->frames);
+    printf("  Active cycles:  %u (%.2f%% of wall time)\n", (unsigned)counters->active_cycles,
+           wall_cycles > 0 ? 100.0 * counters->active_cycles / wall_cycles : 0.0);
+    printf("  Input stalls:   %u (%.2f%%)\n", (unsigned)counters->input_stall_cycles,
+           100.0 * counters->input_stall_cycles / active);
+    printf("  Output stalls:  %u (%.2f%%)\n", (unsigned)counters->output_stall_cycles,
+           100.0 * counters->output_stall_cycles / active);
+    printf("  Beats in/out:   %u / %u\n", (unsigned)counters->input_beats, (unsigned)counters->output_beats);
+}
+
+double benchmark_get_time_us(benchmark_t *b) {
+    return timer_elapsed_us(b->start, b->end);
+}
+
+double benchmark_get_avg_time_us(benchmark_t *b) {
+    return b->avg_time_us;
+}
+
+double benchmark_get_stddev_us(benchmark_t *b) {
+    return b->iterations > 1 ? square_root(b->m2 / (b->iterations - 1)) : 0.0;
+}
+
+// Nearest-rank percentile over the stored samples
+double benchmark_get_percentile_us(benchmark_t *b, double percentile) {
+    static float sorted[BENCHMARK_MAX_SAMPLES];
+
+    if (b->num_samples == 0) {
+        return 0.0;
+    }
+
+    memcpy(sorted, b->samples_us, b->num_samples * sizeof(float));
+    qsort(sorted, b->num_samples, sizeof(float), compare_samples);
+
+    double position = percentile / 100.0 * b->num_samples;
+    int rank = (int)position;
+    if (rank < position) {
+        rank++;
+    }
+    if (rank < 1) {
+        rank = 1;
+    }
+    if (rank > b->num_samples) {
+        rank = b->num_samples;
+    }
+    return sorted[rank - 1];
+}
+
+// Megabytes per second moved per average iteration, both directions
+double benchmark_get_throughput_mbps(benchmark_t *b, int input_bytes, int output_bytes) {
+    if (b->avg_time_us <= 0.0) {
+        return 0.0;
+    }
+    return ((double)input_bytes + output_bytes) / b->avg_time_us;
+}
+
+static int compare_samples(const void *a, const void *b) {
+    float x = *(const float *)a;
+    float y = *(const float *)b;
+
+    return (x > y) - (x < y);
+}
+
+// Newton iteration (the standalone BSP does not link libm)
+static double square_root(double x) {
+    double root = x > 1.0 ? x : 1.0;
+
+    if (x <= 0.0) {
+        return 0.0;
+    }
+    for (int i = 0; i < 64; i++) {
+        double next = 0.5 * (root + x / root);
+        if (next >= root) {
+            break;
+        }
+        root = next;
+    }
+    return root;
 }
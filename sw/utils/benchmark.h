@@ -1,27 +1,54 @@
 #pragma once
 
 #include <stdint.h>
-#include "xtime_l.h"
+
+#include "../common/timer.h"
+#include "../hal/registers.h"
+
+#define BENCHMARK_MAX_SAMPLES 256  // Per-iteration times kept for percentiles
+#define BENCHMARK_MAX_PHASES  8    // Named sub-phases per measurement
+
+typedef struct {
+    const char* name;
+    double total_us;
+    double max_us;
+    int count;
+} benchmark_phase_t;
 
 typedef struct {
     const char* name;
-    XTime start;
-    XTime end;
+    timer_ticks_t start;
+    timer_ticks_t end;
+    timer_ticks_t mark;                 // End of the last phase (or the start)
     int iterations;
     double total_time_us;
     double avg_time_us;
+    double min_time_us;
+    double max_time_us;
+    double m2;                   // Sum of squared deviations (Welford)
+    int warmup;                  // Leading iterations to discard
+    int warmed;                  // Iterations discarded so far
+    int num_samples;             // First BENCHMARK_MAX_SAMPLES iterations
+    float samples_us[BENCHMARK_MAX_SAMPLES];
+    int num_phases;
+    benchmark_phase_t phases[BENCHMARK_MAX_PHASES];
 } benchmark_t;
 
 // Core functions
 void benchmark_start(benchmark_t *b, char *name);
+void benchmark_phase(benchmark_t *b, const char *name);
 void benchmark_stop(benchmark_t *b);
 void benchmark_reset(benchmark_t *b);
+void benchmark_set_warmup(benchmark_t *b, int iterations);
 
 // Results handling
 void benchmark_print(benchmark_t *b);
 void benchmark_compare(benchmark_t *hwb, benchmark_t *swb);
+void benchmark_print_counters(benchmark_t *b, const perf_counters_t *counters);
 
 // Utility
 double benchmark_get_time_us(benchmark_t *b);
 double benchmark_get_avg_time_us(benchmark_t *b);
-double benchmark_get_throughput_mbps(benchmark_t *b, int data_size);
+double benchmark_get_stddev_us(benchmark_t *b);
+double benchmark_get_percentile_us(benchmark_t *b, double percentile);
+double benchmark_get_throughput_mbps(benchmark_t *b, int input_bytes, int output_bytes);
@@ -0,0 +1,208 @@
+#include "sparsity.h"
+
+#include "xil_printf.h"
+#include <stdio.h>
+
+#include "../cnn/cnn.h"
+#include "benchmark.h"
+
+typedef struct {
+    int weight_zeros;
+    int input_zeros;
+    int taps;
+    double density;           // Percent of nonzero inputs
+} sparsity_point_t;
+
+// Allocated once per run, so the sweep leaves the rest of the pool alone
+typedef struct {
+    matrix_t *input;
+    matrix_t *kernel;
+    matrix_t *dense_out;
+    matrix_t *sparse_out;
+} sparsity_buffers_t;
+
+// Forward declarations
+static int is_zeroed(u32 index, int percent);
+static status_t measure(const sparsity_config_t *config, sparsity_point_t *point, sparsity_buffers_t *buffers,
+                        benchmark_t *dense, benchmark_t *sparse);
+static void print_header(sweep_format_t format);
+static void print_record(sweep_format_t format, const sparsity_point_t *point, benchmark_t *dense,
+                         benchmark_t *sparse, int first);
+static void print_footer(sweep_format_t format);
+
+status_t sparsity_run(const sparsity_config_t *config) {
+    status_t status = STATUS_SUCCESS;
+    sparsity_buffers_t buffers;
+    benchmark_t dense, sparse;
+    int records = 0;
+
+    if (!config || !config->weight_zeros || !config->input_zeros) {
+        LOG_ERROR("NULL pointer(s)");
+        return STATUS_ERROR_INVALID_PARAM;
+    }
+
+    if (config->iterations <= 0 || config->warmup < 0) {
+        LOG_ERROR("Invalid iteration count %d (warmup %d)", config->iterations, config->warmup);
+        return STATUS_ERROR_INVALID_PARAM;
+    }
+
+    if (config->stride <= 0 || config->kernel_size <= 0 || config->input_size < config->kernel_size ||
+        config->kernel_size * config->kernel_size > CNN_SPARSE_MAX_TAPS) {
+        LOG_ERROR("Invalid layer %d/%d/%d", config->input_size, config->kernel_size, config->stride);
+        return STATUS_ERROR_INVALID_PARAM;
+    }
+
+    int n = config->input_size;
+    int out = (n - config->kernel_size) / config->stride + 1;
+    buffers.input = matrix_create(n, n);
+    buffers.kernel = matrix_create(config->kernel_size, config->kernel_size);
+    buffers.dense_out = matrix_create(out, out);
+    buffers.sparse_out = matrix_create(out, out);
+    if (!buffers.input || !buffers.kernel || !buffers.dense_out || !buffers.sparse_out) {
+        LOG_ERROR("Could not allocate sparsity buffers");
+        return STATUS_ERROR_MEMORY;
+    }
+
+    print_header(config->format);
+
+    for (int w = 0; w < config->num_weight_zeros; w++) {
+        for (int a = 0; a < config->num_input_zeros; a++) {
+            sparsity_point_t point = { config->weight_zeros[w], config->input_zeros[a], 0, 0.0 };
+
+            status = measure(config, &point, &buffers, &dense, &sparse);
+            if (status != STATUS_SUCCESS) {
+                LOG_ERROR("Sparsity point %d/%d failed", point.weight_zeros, point.input_zeros);
+                goto cleanup;
+            }
+
+            print_record(config->format, &point, &dense, &sparse, records == 0);
+            records++;
+        }
+    }
+
+cleanup:
+    print_footer(config->format);
+    return status;
+}
+
+// Multiplicative hash, so the zeroed share is close to percent at any size
+static int is_zeroed(u32 index, int percent) {
+    return (int)(((index * 2654435761u) >> 16) % 100) < percent;
+}
+
+static status_t measure(const sparsity_config_t *config, sparsity_point_t *point, sparsity_buffers_t *buffers,
+                        benchmark_t *dense, benchmark_t *sparse) {
+    int n = config->input_size;
+    int k = config->kernel_size;
+    int blocks = (n + SPARSITY_BLOCK - 1) / SPARSITY_BLOCK;
+    matrix_t *input = buffers->input;
+    matrix_t *kernel = buffers->kernel;
+    matrix_t *dense_out = buffers->dense_out;
+    matrix_t *sparse_out = buffers->sparse_out;
+    cnn_sparse_kernel_t compiled;
+    int compare_result;
+    status_t status;
+
+    status = matrix_randomize(input, -1.0f, 1.0f);
+    if (status != STATUS_SUCCESS) {
+        return status;
+    }
+    status = matrix_randomize(kernel, -1.0f, 1.0f);
+    if (status != STATUS_SUCCESS) {
+        return status;
+    }
+
+    // Zeroed in place, so both buffers follow the matrix.h cache rule
+    cache_prepare_cpu_access(input->data, n * n * sizeof(fixed_point_t), &input->cache_state);
+    cache_prepare_cpu_access(kernel->data, k * k * sizeof(fixed_point_t), &kernel->cache_state);
+
+    int nonzero = 0;
+    for (int i = 0; i < n; i++) {
+        for (int j = 0; j < n; j++) {
+            if (is_zeroed((i / SPARSITY_BLOCK) * blocks + j / SPARSITY_BLOCK, point->input_zeros)) {
+                input->data[i * n + j] = 0;
+            }
+            nonzero += (input->data[i * n + j] != 0);
+        }
+    }
+    for (int i = 0; i < k * k; i++) {
+        if (is_zeroed(i, point->weight_zeros)) {
+            kernel->data[i] = 0;
+        }
+    }
+    cache_mark_cpu_dirty(&input->cache_state);
+    cache_mark_cpu_dirty(&kernel->cache_state);
+
+    // Compiling is per kernel load, not per frame, so it stays untimed
+    status = cnn_sparse_compile(kernel, &compiled);
+    if (status != STATUS_SUCCESS) {
+        return status;
+    }
+    point->taps = compiled.num_taps;
+    point->density = 100.0 * nonzero / (n * n);
+
+    benchmark_reset(dense);
+    benchmark_reset(sparse);
+    benchmark_set_warmup(dense, config->warmup);
+    benchmark_set_warmup(sparse, config->warmup);
+    for (int i = 0; i < config->warmup + config->iterations; i++) {
+        benchmark_start(dense, "Dense");
+        status = cnn_convolve(input, kernel, config->stride, dense_out);
+        benchmark_stop(dense);
+        if (status != STATUS_SUCCESS) {
+            return status;
+        }
+
+        benchmark_start(sparse, "Sparse");
+        status = cnn_convolve_sparse(input, &compiled, config->stride, sparse_out);
+        benchmark_stop(sparse);
+        if (status != STATUS_SUCCESS) {
+            return status;
+        }
+    }
+
+    status = matrix_compare(dense_out, sparse_out, &compare_result);
+    if (status != STATUS_SUCCESS) {
+        return status;
+    }
+    if (compare_result != 0) {
+        LOG_ERROR("Sparse convolution differs at %d/%d", point->weight_zeros, point->input_zeros);
+        return STATUS_ERROR_HARDWARE;
+    }
+
+    return STATUS_SUCCESS;
+}
+
+static void print_header(sweep_format_t format) {
+    if (format == SWEEP_FORMAT_JSON) {
+        printf("[\n");
+    } else {
+        printf("weight_zeros,input_zeros,taps,density,iterations,dense_avg_us,sparse_avg_us,"
+               "dense_p50_us,sparse_p50_us,speedup\n");
+    }
+}
+
+static void print_record(sweep_format_t format, const sparsity_point_t *point, benchmark_t *dense,
+                         benchmark_t *sparse, int first) {
+    double speedup = (sparse->avg_time_us > 0.0) ? dense->avg_time_us / sparse->avg_time_us : 0.0;
+
+    if (format == SWEEP_FORMAT_JSON) {
+        printf("%s  {\"weight_zeros\": %d, \"input_zeros\": %d, \"taps\": %d, \"density\": %.1f, "
+               "\"iterations\": %d, \"dense_avg_us\": %.3f, \"sparse_avg_us\": %.3f, "
+               "\"dense_p50_us\": %.3f, \"sparse_p50_us\": %.3f, \"speedup\": %.2f}",
+               first ? "" : ",\n", point->weight_zeros, point->input_zeros, point->taps, point->density,
+               sparse->iterations, dense->avg_time_us, sparse->avg_time_us,
+               benchmark_get_percentile_us(dense, 50), benchmark_get_percentile_us(sparse, 50), speedup);
+    } else {
+        printf("%d,%d,%d,%.1f,%d,%.3f,%.3f,%.3f,%.3f,%.2f\n",
+               point->weight_zeros, point->input_zeros, point->taps, point->density, sparse->iterations,
+               dense->avg_time_us, sparse->avg_time_us, benchmark_get_percentile_us(dense, 50),
+               benchmark_get_percentile_us(sparse, 50), speedup);
+    }
+}
+
+static void print_footer(sweep_format_t format) {
+    if (format == SWEEP_FORMAT_JSON) {
+        printf("\n]\n");
+    }
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include "../common/status.h"
+#include "sweep.h"
+
+/**
+ * Sparsity sweep
+ * Times the dense convolution against the zero-skipping one for every
+ * combination of zero weights and zero inputs, and prints one record per
+ * point (CSV or JSON, as the parameter sweep) with the compiled tap count,
+ * the measured input density and the speedup. Inputs are zeroed in square
+ * blocks, as ReLU leaves whole regions of a feature map at zero, and every
+ * point checks that both convolutions agree bit for bit.
+ */
+
+#define SPARSITY_BLOCK 4  // Side of the zeroed input blocks
+
+typedef struct {
+    int input_size;
+    int kernel_size;
+    int stride;
+    const int *weight_zeros;       // Percent of kernel weights set to zero
+    int num_weight_zeros;
+    const int *input_zeros;        // Percent of input blocks set to zero
+    int num_input_zeros;
+    int iterations;
+    int warmup;
+    sweep_format_t format;
+} sparsity_config_t;
+
+// Public Interface (allocates its buffers once from the allocator and
+// leaves resetting the pool to the caller)
+status_t sparsity_run(const sparsity_config_t *config);
@@ -0,0 +1,247 @@
+#include "sweep.h"
+
+#include "xil_printf.h"
+#include <stdio.h>
+
+#include "../cnn/cnn.h"
+#include "benchmark.h"
+
+typedef struct {
+    sweep_backend_t backend;
+    int input_size;
+    int kernel_size;
+    int stride;
+    int pool_size;
+} sweep_point_t;
+
+// Buffers for the largest point, reshaped for each one so the sweep
+// allocates once and every buffer keeps its cache state across points
+typedef struct {
+    matrix_t *input;
+    matrix_t *kernel;
+    matrix_t *output;
+    cnn_scratch_t scratch;
+} sweep_buffers_t;
+
+// Forward declarations
+static int is_supported(const sweep_point_t *point, accelerator_t *hardware);
+static status_t create_buffers(const sweep_config_t *config, sweep_buffers_t *buffers);
+static status_t measure(const sweep_config_t *config, const sweep_point_t *point, accelerator_t *acc,
+                        sweep_buffers_t *buffers, benchmark_t *bench);
+static void print_header(sweep_format_t format);
+static void print_record(sweep_format_t format, const sweep_point_t *point, benchmark_t *bench, int first);
+static void print_footer(sweep_format_t format);
+
+static const char *backend_names[SWEEP_NUM_BACKENDS] = {
+    "software",
+    "model",
+    "hardware",
+};
+
+status_t sweep_run(const sweep_config_t *config, accelerator_t *hardware) {
+    status_t status = STATUS_SUCCESS;
+    accelerator_t model;
+    sweep_buffers_t buffers;
+    benchmark_t bench;
+    int records = 0;
+
+    if (!config || !config->input_sizes || !config->kernel_sizes || !config->strides ||
+        !config->pool_sizes || !config->backends) {
+        LOG_ERROR("NULL pointer(s)");
+        return STATUS_ERROR_INVALID_PARAM;
+    }
+
+    if (config->iterations <= 0 || config->warmup < 0) {
+        LOG_ERROR("Invalid iteration count %d (warmup %d)", config->iterations, config->warmup);
+        return STATUS_ERROR_INVALID_PARAM;
+    }
+
+    status = create_buffers(config, &buffers);
+    if (status != STATUS_SUCCESS) {
+        LOG_ERROR("Could not allocate sweep buffers");
+        return status;
+    }
+
+    status = accelerator_init(&model, 0, ACCELERATOR_BACKEND_MODEL);
+    if (status != STATUS_SUCCESS) {
+        return status;
+    }
+
+    print_header(config->format);
+
+    for (int b = 0; b < config->num_backends; b++) {
+        for (int n = 0; n < config->num_input_sizes; n++) {
+            for (int k = 0; k < config->num_kernel_sizes; k++) {
+                for (int s = 0; s < config->num_strides; s++) {
+                    for (int p = 0; p < config->num_pool_sizes; p++) {
+                        sweep_point_t point = {
+                            config->backends[b], config->input_sizes[n], config->kernel_sizes[k],
+                            config->strides[s], config->pool_sizes[p]
+                        };
+                        if (!is_supported(&point, hardware)) {
+                            continue;
+                        }
+
+                        accelerator_t *acc = (point.backend == SWEEP_BACKEND_HARDWARE) ? hardware : &model;
+                        status = measure(config, &point, acc, &buffers, &bench);
+                        if (status != STATUS_SUCCESS) {
+                            LOG_ERROR("Sweep point %s %d/%d/%d/%d failed", backend_names[point.backend],
+                                      point.input_size, point.kernel_size, point.stride, point.pool_size);
+                            goto cleanup;
+                        }
+
+                        print_record(config->format, &point, &bench, records == 0);
+                        records++;
+                    }
+                }
+            }
+        }
+    }
+
+cleanup:
+    print_footer(config->format);
+    accelerator_cleanup(&model);
+    return status;
+}
+
+static int is_supported(const sweep_point_t *point, accelerator_t *hardware) {
+    int n = point->input_size;
+
+    if (point->backend < 0 || point->backend >= SWEEP_NUM_BACKENDS ||
+        point->kernel_size <= 0 || point->stride <= 0 || point->pool_size <= 0 ||
+        n < point->kernel_size || ((n - point->kernel_size) / point->stride + 1) < point->pool_size) {
+        return 0;
+    }
+
+    if (point->backend == SWEEP_BACKEND_SOFTWARE) {
+        return 1;
+    }
+    if (point->backend == SWEEP_BACKEND_HARDWARE && !hardware) {
+        return 0;
+    }
+
+    // The bitstream fixes the layer shape and emits one channel per filter
+    if (point->kernel_size != KERNEL_SIZE || point->stride != STRIDE ||
+        point->pool_size != POOL_SIZE || NUM_FILTERS != 1) {
+        return 0;
+    }
+    return accelerator_dimensions_supported(n, n) || accelerator_tiling_supported(n, n);
+}
+
+// Sized for the largest input and kernel (a convolution output is never
+// larger than its input)
+static status_t create_buffers(const sweep_config_t *config, sweep_buffers_t *buffers) {
+    int max_n = 0, max_k = 0;
+    for (int n = 0; n < config->num_input_sizes; n++) {
+        if (config->input_sizes[n] > max_n) max_n = config->input_sizes[n];
+    }
+    for (int k = 0; k < config->num_kernel_sizes; k++) {
+        if (config->kernel_sizes[k] > max_k) max_k = config->kernel_sizes[k];
+    }
+    if (max_n <= 0 || max_k <= 0) {
+        LOG_ERROR("Invalid sweep sizes %d/%d", max_n, max_k);
+        return STATUS_ERROR_INVALID_PARAM;
+    }
+
+    buffers->input = matrix_create(max_n, max_n);
+    buffers->kernel = matrix_create(max_k, max_k);
+    buffers->output = matrix_create(max_n, max_n);
+    if (!buffers->input || !buffers->kernel || !buffers->output) {
+        return STATUS_ERROR_MEMORY;
+    }
+
+    return cnn_scratch_create(&buffers->scratch, max_n * max_n);
+}
+
+static status_t measure(const sweep_config_t *config, const sweep_point_t *point, accelerator_t *acc,
+                        sweep_buffers_t *buffers, benchmark_t *bench) {
+    int n = point->input_size;
+    int out = ((n - point->kernel_size) / point->stride + 1) / point->pool_size;
+    int tiled = point->backend != SWEEP_BACKEND_SOFTWARE && !accelerator_dimensions_supported(n, n);
+    cnn_stages_t stages = { 1, CNN_POOL_MAX, 0 };
+    cnn_sparse_kernel_t sparse;
+    status_t status;
+
+    matrix_t *input = buffers->input;
+    matrix_t *kernel = buffers->kernel;
+    matrix_t *output = buffers->output;
+    input->rows = input->cols = n;
+    kernel->rows = kernel->cols = point->kernel_size;
+    output->rows = output->cols = out;
+
+    status = matrix_randomize(input, -1.0f, 1.0f);
+    if (status != STATUS_SUCCESS) {
+        return status;
+    }
+    status = matrix_randomize(kernel, -1.0f, 1.0f);
+    if (status != STATUS_SUCCESS) {
+        return status;
+    }
+
+    // The kernel upload (or compile) is per network, not per frame, so it
+    // stays untimed
+    if (point->backend == SWEEP_BACKEND_SOFTWARE) {
+        status = cnn_sparse_compile(kernel, &sparse);
+    } else {
+        status = accelerator_set_kernel(acc, kernel);
+    }
+    if (status != STATUS_SUCCESS) {
+        return status;
+    }
+
+    benchmark_reset(bench);
+    benchmark_set_warmup(bench, config->warmup);
+    for (int i = 0; i < config->warmup + config->iterations; i++) {
+        benchmark_start(bench, (char *)backend_names[point->backend]);
+
+        if (point->backend == SWEEP_BACKEND_SOFTWARE) {
+            status = cnn_forward_compiled(input, &sparse, 1, point->pool_size, point->stride, &stages,
+                                          &buffers->scratch, output);
+        } else if (tiled) {
+            status = accelerator_compute_tiled(acc, input, output);
+        } else {
+            status = accelerator_compute(acc, input, output);
+        }
+        if (status != STATUS_SUCCESS) {
+            return status;
+        }
+
+        benchmark_stop(bench);
+    }
+
+    return STATUS_SUCCESS;
+}
+
+static void print_header(sweep_format_t format) {
+    if (format == SWEEP_FORMAT_JSON) {
+        printf("[\n");
+    } else {
+        printf("backend,input,kernel,stride,pool,iterations,avg_us,stddev_us,min_us,p50_us,p90_us,p99_us,max_us\n");
+    }
+}
+
+static void print_record(sweep_format_t format, const sweep_point_t *point, benchmark_t *bench, int first) {
+    if (format == SWEEP_FORMAT_JSON) {
+        printf("%s  {\"backend\": \"%s\", \"input\": %d, \"kernel\": %d, \"stride\": %d, \"pool\": %d, "
+               "\"iterations\": %d, \"avg_us\": %.3f, \"stddev_us\": %.3f, \"min_us\": %.3f, "
+               "\"p50_us\": %.3f, \"p90_us\": %.3f, \"p99_us\": %.3f, \"max_us\": %.3f}",
+               first ? "" : ",\n", backend_names[point->backend], point->input_size, point->kernel_size,
+               point->stride, point->pool_size, bench->iterations, bench->avg_time_us,
+               benchmark_get_stddev_us(bench), bench->min_time_us, benchmark_get_percentile_us(bench, 50),
+               benchmark_get_percentile_us(bench, 90), benchmark_get_percentile_us(bench, 99),
+               bench->max_time_us);
+    } else {
+        printf("%s,%d,%d,%d,%d,%d,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f\n",
+               backend_names[point->backend], point->input_size, point->kernel_size, point->stride,
+               point->pool_size, bench->iterations, bench->avg_time_us, benchmark_get_stddev_us(bench),
+               bench->min_time_us, benchmark_get_percentile_us(bench, 50),
+               benchmark_get_percentile_us(bench, 90), benchmark_get_percentile_us(bench, 99),
+               bench->max_time_us);
+    }
+}
+
+static void print_footer(sweep_format_t format) {
+    if (format == SWEEP_FORMAT_JSON) {
+        printf("\n]\n");
+    }
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include "../common/status.h"
+#include "../hal/accelerator.h"
+
+/**
+ * Parameter sweep
+ * Times every combination of input size, kernel size, stride, pool size
+ * and backend, and prints one machine-readable record per point (CSV with
+ * a header row, or a JSON array) so results can be diffed across commits
+ * and bitstreams. The accelerator backends only run the points the
+ * configured bitstream implements; the rest are left out.
+ */
+
+typedef enum {
+    SWEEP_BACKEND_SOFTWARE = 0,
+    SWEEP_BACKEND_MODEL = 1,
+    SWEEP_BACKEND_HARDWARE = 2,
+    SWEEP_NUM_BACKENDS = 3,
+} sweep_backend_t;
+
+typedef enum {
+    SWEEP_FORMAT_CSV = 0,
+    SWEEP_FORMAT_JSON = 1,
+} sweep_format_t;
+
+typedef struct {
+    const int *input_sizes;
+    int num_input_sizes;
+    const int *kernel_sizes;
+    int num_kernel_sizes;
+    const int *strides;
+    int num_strides;
+    const int *pool_sizes;
+    int num_pool_sizes;
+    const sweep_backend_t *backends;
+    int num_backends;
+    int iterations;
+    int warmup;
+    sweep_format_t format;
+} sweep_config_t;
+
+// Public Interface (allocates its buffers once from the allocator and
+// leaves resetting the pool to the caller; hardware may be NULL to leave
+// the fabric out)
+status_t sweep_run(const sweep_config_t *config, accelerator_t *hardware);
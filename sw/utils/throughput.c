@@ -0,0 +1,103 @@
+#include "throughput.h"
+
+#include "xil_printf.h"
+#include <stdio.h>
+#include <string.h>
+
+#include "../common/timer.h"
+
+status_t throughput_run(accelerator_t *acc, matrix_t **inputs, matrix_t **outputs, int num_buffers,
+                        int packet_frames, int max_frames, double max_duration_us, throughput_t *result) {
+    status_t status;
+
+    if (!acc || !inputs || !outputs || !result) {
+        LOG_ERROR("NULL pointer(s)");
+        return STATUS_ERROR_INVALID_PARAM;
+    }
+
+    if (num_buffers <= 0 || packet_frames <= 0 || max_frames < 0 || max_duration_us < 0.0 ||
+        (max_frames == 0 && max_duration_us == 0.0)) {
+        LOG_ERROR("Invalid run: %d buffers of %d frames, %d frames, %.0f us", num_buffers, packet_frames,
+                  max_frames, max_duration_us);
+        return STATUS_ERROR_INVALID_PARAM;
+    }
+
+    memset(result, 0, sizeof(*result));
+
+    // Restart the fabric counters so they cover this run only
+    status = accelerator_read_counters(acc, 1, &result->counters);
+    if (status != STATUS_SUCCESS) {
+        return status;
+    }
+
+    timer_ticks_t start = timer_now();
+    timer_ticks_t now = start;
+
+    while ((max_frames == 0 || result->frames < max_frames) &&
+           (max_duration_us == 0.0 || timer_elapsed_us(start, now) < max_duration_us)) {
+        matrix_t *input = inputs[result->packets % num_buffers];
+        matrix_t *output = outputs[result->packets % num_buffers];
+
+        // The frames of a packet stream back to back with no idle cycles
+        status = accelerator_submit_batch(acc, input, output, packet_frames);
+        if (status != STATUS_SUCCESS) {
+            return status;
+        }
+
+        // Everything outside this loop is driver work on the CPU
+        timer_ticks_t wait_start = timer_now();
+        int done = 0;
+        while (!done) {
+            status = accelerator_poll(acc, &done);
+            if (status != STATUS_SUCCESS) {
+                return status;
+            }
+        }
+        now = timer_now();
+        result->wait_us += timer_elapsed_us(wait_start, now);
+
+        result->packets++;
+        result->frames += packet_frames;
+        result->pixels += (u64)input->rows * input->cols;
+        result->input_bytes += (u64)input->rows * input->cols * sizeof(fixed_point_t);
+        result->output_bytes += (u64)output->rows * output->cols * sizeof(fixed_point_t);
+    }
+
+    result->elapsed_us = timer_elapsed_us(start, now);
+
+    return accelerator_read_counters(acc, 0, &result->counters);
+}
+
+void throughput_print(const throughput_t *t, const char *name) {
+    double elapsed_us = t->elapsed_us > 0.0 ? t->elapsed_us : 1.0;
+
+    // Bytes per microsecond are megabytes per second
+    printf("\nSustained Throughput for %s:\n", name);
+    printf("  Frames:          %d in %d packet(s), %.2f us\n", t->frames, t->packets, t->elapsed_us);
+    printf("  Frame rate:      %.1f fps\n", throughput_get_fps(t));
+    printf("  Bandwidth:       %.2f MB/s in, %.2f MB/s out\n",
+           t->input_bytes / elapsed_us, t->output_bytes / elapsed_us);
+    printf("  Driver overhead: %.2f%% of wall time (busy-polling the rest)\n",
+           100.0 * throughput_get_driver_overhead(t));
+    printf("  Fabric:          %.2f Mpixel/s (%.2f%% of %d pixel(s) per clock)\n",
+           t->pixels / elapsed_us, 100.0 * throughput_get_fabric_utilization(t), PIXELS_PER_BEAT);
+    printf("  Fabric active:   %.2f%% of wall time\n",
+           100.0 * t->counters.active_cycles / (elapsed_us * (ACCELERATOR_CLOCK_HZ / 1000000.0)));
+}
+
+double throughput_get_fps(const throughput_t *t) {
+    return t->elapsed_us > 0.0 ? t->frames * 1000000.0 / t->elapsed_us : 0.0;
+}
+
+// Wall time outside the completion wait (submits, cache maintenance and
+// bookkeeping); the wait itself busy-polls, so this is not CPU utilization
+double throughput_get_driver_overhead(const throughput_t *t) {
+    return t->elapsed_us > 0.0 ? 1.0 - t->wait_us / t->elapsed_us : 0.0;
+}
+
+// Streamed pixels against PIXELS_PER_BEAT per accelerator clock over the run
+double throughput_get_fabric_utilization(const throughput_t *t) {
+    double peak = t->elapsed_us * (ACCELERATOR_CLOCK_HZ / 1000000.0) * PIXELS_PER_BEAT;
+
+    return peak > 0.0 ? t->pixels / peak : 0.0;
+}
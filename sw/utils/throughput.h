@@ -0,0 +1,41 @@
+#pragma once
+
+#include "../common/matrix.h"
+#include "../common/status.h"
+#include "../hal/accelerator.h"
+
+/**
+ * Sustained throughput
+ * Keeps one accelerator busy until a frame count or a duration runs out,
+ * rotating through a set of input/output buffers. Each buffer holds a
+ * packet of frames stacked by rows that streams back to back in one
+ * transfer each way, so the fabric only idles between packets while the
+ * next one is submitted. Reports frames per second, MB/s each way, the
+ * driver overhead (the share of wall time spent outside the completion
+ * wait; the CPU busy-polls through the rest, so this is not idle time),
+ * and the fabric's pixel rate against its peak of PIXELS_PER_BEAT pixels
+ * per clock.
+ */
+
+typedef struct {
+    int frames;
+    int packets;
+    double elapsed_us;
+    double wait_us;           // Spent polling for completion
+    u64 input_bytes;
+    u64 output_bytes;
+    u64 pixels;               // Input pixels streamed
+    perf_counters_t counters;
+} throughput_t;
+
+// Public Interface (stops at the first whole packet reaching max_frames or
+// max_duration_us, whichever comes first; either may be 0 for no limit,
+// but not both)
+status_t throughput_run(accelerator_t *acc, matrix_t **inputs, matrix_t **outputs, int num_buffers,
+                        int packet_frames, int max_frames, double max_duration_us, throughput_t *result);
+
+// Results handling
+void throughput_print(const throughput_t *t, const char *name);
+double throughput_get_fps(const throughput_t *t);
+double throughput_get_driver_overhead(const throughput_t *t);
+double throughput_get_fabric_utilization(const throughput_t *t);